@@ -0,0 +1,16 @@
+#!/bin/bash
+# usage: bench.sh [cirno] -- time each benchmark interpreted, with closures
+# only and with the jit
+
+cirno=${1:-./cirno}
+
+TIMEFORMAT="%3Rs"
+
+for script in bench/*.9c; do
+  echo "$script"
+  
+  for flags in -J -N ""; do
+    printf "  %-4s " "${flags:-jit}"
+    time $cirno $flags $script > /dev/null || exit 1
+  done
+done
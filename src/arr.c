@@ -0,0 +1,519 @@
+#include "arr.h"
+
+#include <math.h>
+#include <string.h>
+
+// the kernels work on 8 elements at a time with gcc's vector extensions and
+// finish the rest one at a time. on x86-64 each is built for AVX2 and for
+// the SSE2 every such cpu has, and which of them runs is chosen by the cpu
+// the program is loaded on. f32 sums are kept in 8 lanes, so they can
+// differ from a loop over the array in their last bits.
+
+#if defined(__x86_64__)
+#define ARR_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define ARR_CLONES
+#endif
+
+#define ARR_LANES 8
+
+typedef float f32x8 __attribute__((vector_size(32), aligned(4), may_alias));
+typedef int   i32x8 __attribute__((vector_size(32), aligned(4), may_alias));
+
+#define ARR_F32(p) (*(f32x8 *) (p))
+#define ARR_I32(p) (*(i32x8 *) (p))
+
+// the lanes of 'a' where 'mask' is set and of 'b' where it is not
+#define ARR_SELECT(type, mask, a, b) ((type) (((i32x8) (a) & (mask)) | ((i32x8) (b) & ~(mask))))
+
+ARR_CLONES
+void arr_fill_f32(float *a, float x, int n)
+{
+  f32x8 v = { x, x, x, x, x, x, x, x };
+  
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    ARR_F32(&a[i]) = v;
+  
+  for (; i < n; i++)
+    a[i] = x;
+}
+
+ARR_CLONES
+void arr_scale_f32(float *a, float s, int n)
+{
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    ARR_F32(&a[i]) *= s;
+  
+  for (; i < n; i++)
+    a[i] *= s;
+}
+
+ARR_CLONES
+void arr_add_f32(float *a, const float *b, int n)
+{
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    ARR_F32(&a[i]) += ARR_F32(&b[i]);
+  
+  for (; i < n; i++)
+    a[i] += b[i];
+}
+
+ARR_CLONES
+void arr_mul_f32(float *a, const float *b, int n)
+{
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    ARR_F32(&a[i]) *= ARR_F32(&b[i]);
+  
+  for (; i < n; i++)
+    a[i] *= b[i];
+}
+
+ARR_CLONES
+void arr_axpy_f32(float *y, float a, const float *x, int n)
+{
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    ARR_F32(&y[i]) += a * ARR_F32(&x[i]);
+  
+  for (; i < n; i++)
+    y[i] += a * x[i];
+}
+
+ARR_CLONES
+void arr_clamp_f32(float *a, float lo, float hi, int n)
+{
+  f32x8 lo_v = { lo, lo, lo, lo, lo, lo, lo, lo };
+  f32x8 hi_v = { hi, hi, hi, hi, hi, hi, hi, hi };
+  
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES) {
+    f32x8 x = ARR_F32(&a[i]);
+    x = ARR_SELECT(f32x8, x < lo_v, lo_v, x);
+    ARR_F32(&a[i]) = ARR_SELECT(f32x8, x > hi_v, hi_v, x);
+  }
+  
+  for (; i < n; i++)
+    a[i] = a[i] < lo ? lo : a[i] > hi ? hi : a[i];
+}
+
+ARR_CLONES
+float arr_min_f32(const float *a, int n)
+{
+  if (n == 0)
+    return 0;
+  
+  float min = a[0];
+  
+  int i = 0;
+  if (n >= ARR_LANES) {
+    f32x8 m = ARR_F32(a);
+    for (i = ARR_LANES; i + ARR_LANES <= n; i += ARR_LANES) {
+      f32x8 x = ARR_F32(&a[i]);
+      m = ARR_SELECT(f32x8, x < m, x, m);
+    }
+    
+    for (int j = 0; j < ARR_LANES; j++)
+      min = m[j] < min ? m[j] : min;
+  }
+  
+  for (; i < n; i++)
+    min = a[i] < min ? a[i] : min;
+  
+  return min;
+}
+
+ARR_CLONES
+float arr_max_f32(const float *a, int n)
+{
+  if (n == 0)
+    return 0;
+  
+  float max = a[0];
+  
+  int i = 0;
+  if (n >= ARR_LANES) {
+    f32x8 m = ARR_F32(a);
+    for (i = ARR_LANES; i + ARR_LANES <= n; i += ARR_LANES) {
+      f32x8 x = ARR_F32(&a[i]);
+      m = ARR_SELECT(f32x8, x > m, x, m);
+    }
+    
+    for (int j = 0; j < ARR_LANES; j++)
+      max = m[j] > max ? m[j] : max;
+  }
+  
+  for (; i < n; i++)
+    max = a[i] > max ? a[i] : max;
+  
+  return max;
+}
+
+ARR_CLONES
+float arr_sum_f32(const float *a, int n)
+{
+  f32x8 acc = { 0 };
+  
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    acc += ARR_F32(&a[i]);
+  
+  float sum = 0;
+  for (int j = 0; j < ARR_LANES; j++)
+    sum += acc[j];
+  
+  for (; i < n; i++)
+    sum += a[i];
+  
+  return sum;
+}
+
+ARR_CLONES
+float arr_dot_f32(const float *a, const float *b, int n)
+{
+  f32x8 acc = { 0 };
+  
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    acc += ARR_F32(&a[i]) * ARR_F32(&b[i]);
+  
+  float sum = 0;
+  for (int j = 0; j < ARR_LANES; j++)
+    sum += acc[j];
+  
+  for (; i < n; i++)
+    sum += a[i] * b[i];
+  
+  return sum;
+}
+
+// each element depends on the one before, so a scan is done in order
+void arr_prefix_sum_f32(float *a, int n)
+{
+  for (int i = 1; i < n; i++)
+    a[i] += a[i - 1];
+}
+
+ARR_CLONES
+void arr_fill_i32(int *a, int x, int n)
+{
+  i32x8 v = { x, x, x, x, x, x, x, x };
+  
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    ARR_I32(&a[i]) = v;
+  
+  for (; i < n; i++)
+    a[i] = x;
+}
+
+ARR_CLONES
+void arr_scale_i32(int *a, int s, int n)
+{
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    ARR_I32(&a[i]) *= s;
+  
+  for (; i < n; i++)
+    a[i] *= s;
+}
+
+ARR_CLONES
+void arr_add_i32(int *a, const int *b, int n)
+{
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    ARR_I32(&a[i]) += ARR_I32(&b[i]);
+  
+  for (; i < n; i++)
+    a[i] += b[i];
+}
+
+ARR_CLONES
+void arr_mul_i32(int *a, const int *b, int n)
+{
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    ARR_I32(&a[i]) *= ARR_I32(&b[i]);
+  
+  for (; i < n; i++)
+    a[i] *= b[i];
+}
+
+ARR_CLONES
+void arr_clamp_i32(int *a, int lo, int hi, int n)
+{
+  i32x8 lo_v = { lo, lo, lo, lo, lo, lo, lo, lo };
+  i32x8 hi_v = { hi, hi, hi, hi, hi, hi, hi, hi };
+  
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES) {
+    i32x8 x = ARR_I32(&a[i]);
+    x = ARR_SELECT(i32x8, x < lo_v, lo_v, x);
+    ARR_I32(&a[i]) = ARR_SELECT(i32x8, x > hi_v, hi_v, x);
+  }
+  
+  for (; i < n; i++)
+    a[i] = a[i] < lo ? lo : a[i] > hi ? hi : a[i];
+}
+
+ARR_CLONES
+int arr_min_i32(const int *a, int n)
+{
+  if (n == 0)
+    return 0;
+  
+  int min = a[0];
+  
+  int i = 0;
+  if (n >= ARR_LANES) {
+    i32x8 m = ARR_I32(a);
+    for (i = ARR_LANES; i + ARR_LANES <= n; i += ARR_LANES) {
+      i32x8 x = ARR_I32(&a[i]);
+      m = ARR_SELECT(i32x8, x < m, x, m);
+    }
+    
+    for (int j = 0; j < ARR_LANES; j++)
+      min = m[j] < min ? m[j] : min;
+  }
+  
+  for (; i < n; i++)
+    min = a[i] < min ? a[i] : min;
+  
+  return min;
+}
+
+ARR_CLONES
+int arr_max_i32(const int *a, int n)
+{
+  if (n == 0)
+    return 0;
+  
+  int max = a[0];
+  
+  int i = 0;
+  if (n >= ARR_LANES) {
+    i32x8 m = ARR_I32(a);
+    for (i = ARR_LANES; i + ARR_LANES <= n; i += ARR_LANES) {
+      i32x8 x = ARR_I32(&a[i]);
+      m = ARR_SELECT(i32x8, x > m, x, m);
+    }
+    
+    for (int j = 0; j < ARR_LANES; j++)
+      max = m[j] > max ? m[j] : max;
+  }
+  
+  for (; i < n; i++)
+    max = a[i] > max ? a[i] : max;
+  
+  return max;
+}
+
+ARR_CLONES
+int arr_sum_i32(const int *a, int n)
+{
+  i32x8 acc = { 0 };
+  
+  int i = 0;
+  for (; i + ARR_LANES <= n; i += ARR_LANES)
+    acc += ARR_I32(&a[i]);
+  
+  int sum = 0;
+  for (int j = 0; j < ARR_LANES; j++)
+    sum += acc[j];
+  
+  for (; i < n; i++)
+    sum += a[i];
+  
+  return sum;
+}
+
+void arr_prefix_sum_i32(int *a, int n)
+{
+  for (int i = 1; i < n; i++)
+    a[i] += a[i - 1];
+}
+
+// libm is called for each element, as the natives sin(), cos(), sqrt() and
+// pow() do, so the results are the same as a loop calling them
+void arr_sin(float *a, int n)
+{
+  for (int i = 0; i < n; i++)
+    a[i] = sin(a[i]);
+}
+
+void arr_cos(float *a, int n)
+{
+  for (int i = 0; i < n; i++)
+    a[i] = cos(a[i]);
+}
+
+void arr_sqrt(float *a, int n)
+{
+  for (int i = 0; i < n; i++)
+    a[i] = sqrt(a[i]);
+}
+
+void arr_pow(float *a, float y, int n)
+{
+  for (int i = 0; i < n; i++)
+    a[i] = powf(a[i], y);
+}
+
+// the program of an element-wise loop is postfix over blocks of elements:
+// 'a' to 'd' push a block of an array, 'p' to 's' a scalar, '~' negates and
+// the others pop two and push what they make. what is left is stored to the
+// first array. each op rounds as the one in the loop would, so the elements
+// are the ones it would have stored.
+#define ARR_BLOCK 64
+#define ARR_STACK 8
+#define ARR_VECS  (ARR_BLOCK / ARR_LANES)
+
+static bool arr_eval_check(const char *prog, const char *binop)
+{
+  int depth = 0;
+  
+  for (const char *c = prog; *c; c++) {
+    if ((*c >= 'a' && *c <= 'd') || (*c >= 'p' && *c <= 's')) {
+      if (++depth > ARR_STACK)
+        return false;
+    } else if (*c == '~') {
+      if (depth < 1)
+        return false;
+    } else if (strchr(binop, *c)) {
+      if (--depth < 1)
+        return false;
+    } else {
+      return false;
+    }
+  }
+  
+  return depth == 1;
+}
+
+ARR_CLONES
+bool arr_eval_f32(const char *prog, float *const array[], const float scalar[], int lo, int hi)
+{
+  if (!arr_eval_check(prog, "+-*/"))
+    return false;
+  
+  f32x8 stack[ARR_STACK][ARR_VECS] = { 0 };
+  
+  for (int i = lo; i < hi; i += ARR_BLOCK) {
+    int n = hi - i < ARR_BLOCK ? hi - i : ARR_BLOCK;
+    int top = 0;
+    
+    for (const char *c = prog; *c; c++) {
+      switch (*c) {
+      case 'a':
+      case 'b':
+      case 'c':
+      case 'd':
+        memcpy(stack[top++], &array[*c - 'a'][i], n * sizeof(float));
+        break;
+      case 'p':
+      case 'q':
+      case 'r':
+      case 's': {
+        float x = scalar[*c - 'p'];
+        f32x8 v = { x, x, x, x, x, x, x, x };
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top][k] = v;
+        top++;
+        break;
+      }
+      case '~':
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top - 1][k] = -stack[top - 1][k];
+        break;
+      case '+':
+        top--;
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top - 1][k] += stack[top][k];
+        break;
+      case '-':
+        top--;
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top - 1][k] -= stack[top][k];
+        break;
+      case '*':
+        top--;
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top - 1][k] *= stack[top][k];
+        break;
+      case '/':
+        top--;
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top - 1][k] /= stack[top][k];
+        break;
+      }
+    }
+    
+    memcpy(&array[0][i], stack[0], n * sizeof(float));
+  }
+  
+  return true;
+}
+
+// i32 division is left to the loop, which reports a division by zero
+ARR_CLONES
+bool arr_eval_i32(const char *prog, int *const array[], const int scalar[], int lo, int hi)
+{
+  if (!arr_eval_check(prog, "+-*"))
+    return false;
+  
+  i32x8 stack[ARR_STACK][ARR_VECS] = { 0 };
+  
+  for (int i = lo; i < hi; i += ARR_BLOCK) {
+    int n = hi - i < ARR_BLOCK ? hi - i : ARR_BLOCK;
+    int top = 0;
+    
+    for (const char *c = prog; *c; c++) {
+      switch (*c) {
+      case 'a':
+      case 'b':
+      case 'c':
+      case 'd':
+        memcpy(stack[top++], &array[*c - 'a'][i], n * sizeof(int));
+        break;
+      case 'p':
+      case 'q':
+      case 'r':
+      case 's': {
+        int x = scalar[*c - 'p'];
+        i32x8 v = { x, x, x, x, x, x, x, x };
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top][k] = v;
+        top++;
+        break;
+      }
+      case '~':
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top - 1][k] = -stack[top - 1][k];
+        break;
+      case '+':
+        top--;
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top - 1][k] += stack[top][k];
+        break;
+      case '-':
+        top--;
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top - 1][k] -= stack[top][k];
+        break;
+      case '*':
+        top--;
+        for (int k = 0; k < ARR_VECS; k++)
+          stack[top - 1][k] *= stack[top][k];
+        break;
+      }
+    }
+    
+    memcpy(&array[0][i], stack[0], n * sizeof(int));
+  }
+  
+  return true;
+}
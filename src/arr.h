@@ -0,0 +1,36 @@
+#ifndef ARR_H
+#define ARR_H
+
+#include <stdbool.h>
+
+extern void   arr_fill_f32(float *a, float x, int n);
+extern void   arr_scale_f32(float *a, float s, int n);
+extern void   arr_add_f32(float *a, const float *b, int n);
+extern void   arr_mul_f32(float *a, const float *b, int n);
+extern void   arr_axpy_f32(float *y, float a, const float *x, int n);
+extern void   arr_clamp_f32(float *a, float lo, float hi, int n);
+extern float  arr_min_f32(const float *a, int n);
+extern float  arr_max_f32(const float *a, int n);
+extern float  arr_sum_f32(const float *a, int n);
+extern float  arr_dot_f32(const float *a, const float *b, int n);
+extern void   arr_prefix_sum_f32(float *a, int n);
+
+extern void   arr_fill_i32(int *a, int x, int n);
+extern void   arr_scale_i32(int *a, int s, int n);
+extern void   arr_add_i32(int *a, const int *b, int n);
+extern void   arr_mul_i32(int *a, const int *b, int n);
+extern void   arr_clamp_i32(int *a, int lo, int hi, int n);
+extern int    arr_min_i32(const int *a, int n);
+extern int    arr_max_i32(const int *a, int n);
+extern int    arr_sum_i32(const int *a, int n);
+extern void   arr_prefix_sum_i32(int *a, int n);
+
+extern void   arr_sin(float *a, int n);
+extern void   arr_cos(float *a, int n);
+extern void   arr_sqrt(float *a, int n);
+extern void   arr_pow(float *a, float y, int n);
+
+extern bool   arr_eval_f32(const char *prog, float *const array[], const float scalar[], int lo, int hi);
+extern bool   arr_eval_i32(const char *prog, int *const array[], const int scalar[], int lo, int hi);
+
+#endif
@@ -13,7 +13,8 @@ bool type_cmp(const type_t *a, const type_t *b)
 {
   return a->spec == b->spec
         && a->arr == b->arr
-        && a->class == b->class;
+        && a->class == b->class
+        && a->dim == b->dim;
 }
 
 bool type_fn(const type_t *type)
@@ -26,6 +27,21 @@ bool type_class(const type_t *type)
   return type->spec == SPEC_CLASS && !type_array(type);
 }
 
+bool type_struct(const type_t *type)
+{
+  return type->spec == SPEC_STRUCT && !type_array(type);
+}
+
+bool type_soa(const type_t *type)
+{
+  return type->spec == SPEC_SOA && !type_array(type);
+}
+
+bool type_map(const type_t *type)
+{
+  return type->spec == SPEC_MAP && !type_array(type);
+}
+
 bool type_array(const type_t *type)
 {
   return type->arr;
@@ -48,13 +64,23 @@ int type_size_base(const type_t *type)
     return 4;
   case SPEC_CLASS:
   case SPEC_STRING:
+  case SPEC_MAP:
     return 8;
+  case SPEC_STRUCT:
+  case SPEC_SOA:
+    return type->class->size;
   default:
     LOG_ERROR("unknown type (%i)", type->spec);
     return 0;
   }
 }
 
+// fields are 4 bytes, so an element's fields are SOA_RUN * 4 bytes apart
+int soa_offset(int size, int index)
+{
+  return index / SOA_RUN * SOA_RUN * size + index % SOA_RUN * 4;
+}
+
 void expr_i32(expr_t *expr, int i32)
 {
   expr->type = type_i32;
@@ -146,11 +172,14 @@ void scope_new(
   scope->ret_type = *ret_type;
   scope->ret_value = (expr_t) {0};
   
-  scope->ret_flag = false;
-  scope->cont_flag = false;
-  scope->break_flag = false;
-  
   scope->block = block;
+  scope->loop = false;
+  scope->value = false;
+  
+  scope->tail = false;
+  scope->tail_fn = NULL;
+  scope->tail_arg = NULL;
+  scope->tail_node = NULL;
   
   scope->size = 0;
 }
@@ -235,12 +264,17 @@ fn_t *scope_add_fn(
 {
   fn_t *fn = ZONE_ALLOC(sizeof(fn_t));
   fn->node = node;
+  fn->lazy = NULL;
   fn->xaction = xaction;
   fn->param = param;
   fn->type = *type;
   fn->scope_parent = scope;
   fn->scope_class = scope_class;
   fn->is_new = is_new;
+  fn->num_call = 0;
+  fn->jit = NULL;
+  fn->exe = NULL;
+  fn->jit_fail = false;
   
   map_put(&scope->map_fn, ident, fn);
   
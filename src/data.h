@@ -9,10 +9,20 @@
 typedef struct scope_s  scope_t;
 typedef struct fn_s     fn_t;
 
+// 'size' bytes of the block are in use, an array's length, out of 'cap'
 typedef struct heap_block_s {
   char  *block;
   bool  use;
   int   size;
+  int   cap;
+  
+  // a slice's elements are in its parent's block
+  struct heap_block_s *parent;
+  
+  // the extents of a T[,] or T[,,], which has one layer
+  int   layers;
+  int   rows;
+  int   cols;
   
   struct heap_block_s *next;
   struct heap_block_s *prev;
@@ -24,15 +34,28 @@ typedef enum {
   SPEC_F32,
   SPEC_CLASS,
   SPEC_FN,
-  SPEC_STRING
+  SPEC_STRING,
+  SPEC_STRUCT,
+  SPEC_SOA,
+  SPEC_MAP
 } spec_t;
 
+// an soa array keeps each field of its structs in runs of SOA_RUN elements,
+// a power of two
+#define SOA_RUN 16
+
+// the 'class' of a map holds the types of its keys and values as the vars
+// 'key' and 'value'. 'dim' is the number of indices of a T[,] or T[,,] and
+// 0 for any other type.
 typedef struct {
   spec_t        spec;
   bool          arr;
   const scope_t *class;
+  int           dim;
 } type_t;
 
+#define GRID_DIM  3
+
 typedef struct {
   union {
     int           i32;
@@ -59,11 +82,18 @@ struct scope_s {
   type_t  ret_type;
   expr_t  ret_value;
   
-  bool    ret_flag;
-  bool    cont_flag;
-  bool    break_flag;
-  
   bool    block;
+  bool    loop;
+  
+  // a struct_def, whose instances are stored in place of a reference
+  bool    value;
+  
+  // a return here ends the function, a call it makes is then run in place
+  // of the function once its body unwinds
+  bool            tail;
+  fn_t            *tail_fn;
+  expr_t          *tail_arg;
+  const s_node_t  *tail_node;
   
   int     size;
 };
@@ -78,12 +108,17 @@ typedef bool (*xaction_t)(expr_t *ret_value, scope_t *scope_args);
 
 typedef struct fn_s {
   s_node_t      *node;
+  s_node_t      *lazy;
   s_node_t      *param;
   type_t        type;
   xaction_t     xaction;
   const scope_t *scope_parent;
   const scope_t *scope_class;
   bool          is_new;
+  int           num_call;
+  void          *jit;
+  void          *exe;
+  bool          jit_fail;
 } fn_t;
 
 extern type_t type_none;
@@ -93,10 +128,14 @@ extern type_t type_string;
 
 extern bool type_cmp(const type_t *a, const type_t *b);
 extern bool type_class(const type_t *type);
+extern bool type_struct(const type_t *type);
+extern bool type_soa(const type_t *type);
+extern bool type_map(const type_t *type);
 extern bool type_fn(const type_t *type);
 extern bool type_array(const type_t *type);
 extern int  type_size(const type_t *type);
 extern int  type_size_base(const type_t *type);
+extern int  soa_offset(int size, int index);
 
 extern bool expr_cast(expr_t *expr, const type_t *type);
 extern bool expr_lvalue(const expr_t *expr);
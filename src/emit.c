@@ -0,0 +1,2961 @@
+#include "emit.h"
+
+#include "data.h"
+#include "log.h"
+#include "map.h"
+#include "zone.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EMIT_MAX_VAR  256
+#define EMIT_MAX_ARG  16
+
+typedef struct emit_class_s emit_class_t;
+
+typedef struct {
+  spec_t              spec;
+  bool                arr;
+  const emit_class_t  *class;
+  int                 dim;
+} emit_type_t;
+
+typedef struct {
+  const char  *ident;
+  emit_type_t type;
+  int         block;
+} emit_var_t;
+
+typedef struct {
+  const lexeme_t      *ident;
+  const char          *name;
+  s_node_t            *node;
+  s_node_t            *param;
+  emit_type_t         type;
+  emit_type_t         arg_type[EMIT_MAX_ARG];
+  int                 num_arg;
+  const emit_class_t  *class;
+  bool                is_new;
+  bool                native;
+} emit_fn_t;
+
+// a struct_def is a C struct held by value, 'num_f32' is the number of f32s
+// of one which is a vector and 'col' the type of a matrix's columns
+struct emit_class_s {
+  const lexeme_t      *ident;
+  s_node_t            *node;
+  map_t               map_var;
+  map_t               map_fn;
+  bool                value;
+  int                 num_f32;
+  const emit_class_t  *col;
+};
+
+typedef struct emit_str_s {
+  struct emit_str_s *next;
+  char              data[];
+} emit_str_t;
+
+typedef struct {
+  FILE          *out;
+  int           indent;
+  
+  map_t         map_class;
+  map_t         map_fn;
+  map_t         map_var;
+  
+  emit_fn_t     *fn;
+  emit_var_t    var[EMIT_MAX_VAR];
+  int           num_var;
+  int           block;
+  int           loop;
+  int           num_tmp;
+  
+  // a continue in a loop with an increment jumps to the label before it,
+  // 'loop_cont' names it and is NULL in a while loop
+  char          *loop_cont;
+  bool          loop_cont_used;
+  
+  // while 'hold' is set, the array an lvalue is an element of is kept in
+  // 'hold_block', which is where the lvalue is found again
+  bool          hold;
+  char          *hold_block;
+  
+  const s_node_t  *hoist[EMIT_MAX_VAR];
+  int             num_hoist;
+  
+  emit_str_t    *str_list;
+} emit_t;
+
+static bool emit_collect(emit_t *e, s_node_t *node);
+static bool emit_collect_class(emit_t *e, emit_class_t *class);
+static void emit_collect_vec(emit_class_t *class);
+static bool emit_add_fn(emit_t *e, s_node_t *node, emit_class_t *class);
+
+static bool emit_program(emit_t *e, s_node_t *node, const char *src);
+static void emit_class(emit_t *e, const emit_class_t *class);
+static void emit_vec(emit_t *e, const emit_class_t *class);
+static void emit_proto(emit_t *e, const emit_fn_t *fn);
+static void emit_native(emit_t *e, const emit_fn_t *fn);
+static bool emit_fn(emit_t *e, emit_fn_t *fn);
+static bool emit_script(emit_t *e, s_node_t *node);
+static bool emit_main(emit_t *e, const char *src);
+
+static bool emit_body(emit_t *e, const s_node_t *node);
+static bool emit_body_scope(emit_t *e, const s_node_t *node);
+static bool emit_stmt(emit_t *e, const s_node_t *node);
+static bool emit_decl(emit_t *e, const s_node_t *node);
+static bool emit_print(emit_t *e, const s_node_t *node);
+static bool emit_if_stmt(emit_t *e, const s_node_t *node);
+static bool emit_hoist(emit_t *e, const s_node_t *node);
+static bool emit_hoisted(const emit_t *e, const s_node_t *node);
+static bool emit_while_stmt(emit_t *e, const s_node_t *node);
+static bool emit_for_stmt(emit_t *e, const s_node_t *node);
+static bool emit_loop(emit_t *e, const s_node_t *cond, const s_node_t *inc, const s_node_t *body);
+static bool emit_ret_stmt(emit_t *e, const s_node_t *node);
+static bool emit_ctrl_stmt(emit_t *e, const s_node_t *node);
+
+static char *emit_cond(emit_t *e, const s_node_t *node);
+static char *emit_expr(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_lvalue(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_constant(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_unary(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_binop(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_assign(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_index(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_grid_index(emit_t *e, const s_node_t *node, const emit_type_t *base_type, char *base, emit_type_t *type);
+static char *emit_direct(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_proc(emit_t *e, const s_node_t *node, emit_type_t *type, bool value);
+static char *emit_array_init(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_grid_init(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_post_op(emit_t *e, const s_node_t *node, emit_type_t *type);
+static char *emit_struct_new(emit_t *e, const s_node_t *node, const emit_class_t *class, emit_type_t *type);
+static char *emit_vec_binop(emit_t *e, int op, char *lhs, const emit_type_t *lhs_type, char *rhs, const emit_type_t *rhs_type, emit_type_t *type);
+static char *emit_vec_method(emit_t *e, const s_node_t *node, const emit_type_t *self_type, char *self, emit_type_t *type);
+static char *emit_array_method(emit_t *e, const s_node_t *node, const emit_type_t *self_type, char *self, emit_type_t *type, bool value);
+static char *emit_sort_by(emit_t *e, const s_node_t *node, const emit_type_t *elem, char *self);
+static char *emit_hold(emit_t *e, const emit_type_t *type, char *lvalue);
+
+static char *emit_cast(emit_t *e, char *expr, const emit_type_t *from, const emit_type_t *to);
+static char *emit_spill(emit_t *e, const emit_type_t *type, char *expr);
+static bool emit_order(const s_node_t *node, const s_node_t *next);
+static bool emit_pure(const s_node_t *node);
+static bool emit_literal(const s_node_t *node);
+
+static bool emit_type(emit_t *e, emit_type_t *type, const s_node_t *node);
+static bool emit_type_cmp(const emit_type_t *a, const emit_type_t *b);
+static bool emit_type_num(const emit_type_t *type);
+static bool emit_type_struct(const emit_type_t *type);
+static bool emit_type_vec(const emit_type_t *type);
+static char *emit_zero(emit_t *e, const emit_type_t *type);
+static const char *emit_type_name(emit_t *e, const emit_type_t *type);
+static const char *emit_ctype(emit_t *e, const emit_type_t *type);
+static const char *emit_cdecl(emit_t *e, const emit_type_t *type, const char *name);
+
+static emit_var_t *emit_find(emit_t *e, const char *ident);
+static emit_var_t *emit_add(emit_t *e, const emit_type_t *type, const char *ident);
+static const lexeme_t *emit_lexeme(const s_node_t *node);
+
+static void emit_line(emit_t *e, const char *fmt, ...);
+static char *emit_str(emit_t *e, const char *fmt, ...);
+static char *emit_msg(emit_t *e, const lexeme_t *lexeme, const char *fmt, ...);
+
+static const emit_type_t emit_none = { SPEC_NONE, false, NULL };
+static const emit_type_t emit_i32 = { SPEC_I32, false, NULL };
+static const emit_type_t emit_f32 = { SPEC_F32, false, NULL };
+static const emit_type_t emit_string = { SPEC_STRING, false, NULL };
+
+static void _class_free(void *block);
+static void _free(void *block);
+
+// translate a parsed program into a C program which runs it against the
+// interpreter's heap and natives
+bool emit_c(FILE *out, s_node_t *node, const char *src)
+{
+  emit_t e = {0};
+  
+  map_new(&e.map_class);
+  map_new(&e.map_fn);
+  map_new(&e.map_var);
+  
+  char *buf = NULL;
+  size_t len = 0;
+  e.out = open_memstream(&buf, &len);
+  
+  bool ok = emit_collect(&e, node) && emit_program(&e, node, src);
+  
+  fclose(e.out);
+  
+  if (ok)
+    fwrite(buf, 1, len, out);
+  
+  free(buf);
+  
+  while (e.str_list) {
+    emit_str_t *next = e.str_list->next;
+    ZONE_FREE(e.str_list);
+    e.str_list = next;
+  }
+  
+  map_flush(&e.map_class, _class_free);
+  map_flush(&e.map_fn, _free);
+  map_flush(&e.map_var, _free);
+  
+  return ok;
+}
+
+static bool emit_collect(emit_t *e, s_node_t *node)
+{
+  s_node_t *head = node;
+  while (head) {
+    s_node_t *body = head->stmt.body;
+    
+    if (body->node_type == S_CLASS_DEF) {
+      const char *ident = body->class_def.ident->data.ident;
+      if (map_get(&e->map_class, ident)) {
+        c_error(body->class_def.ident, "redefinition of class '%s'", ident);
+        return false;
+      }
+      
+      emit_class_t *class = ZONE_ALLOC(sizeof(emit_class_t));
+      class->ident = body->class_def.ident;
+      class->node = body;
+      class->value = body->class_def.spec->token == TK_STRUCT_DEF;
+      map_new(&class->map_var);
+      map_new(&class->map_fn);
+      
+      map_put(&e->map_class, ident, class);
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  head = node;
+  while (head) {
+    s_node_t *body = head->stmt.body;
+    
+    switch (body->node_type) {
+    case S_CLASS_DEF:
+      if (!emit_collect_class(e, map_get(&e->map_class, body->class_def.ident->data.ident)))
+        return false;
+      break;
+    case S_FN:
+      if (!emit_add_fn(e, body, NULL))
+        return false;
+      break;
+    case S_DECL: {
+      emit_type_t type;
+      if (!emit_type(e, &type, body->decl.type))
+        return false;
+      
+      const char *ident = body->decl.ident->data.ident;
+      if (map_get(&e->map_var, ident)) {
+        c_error(body->decl.ident, "redefinition of '%s'", ident);
+        return false;
+      }
+      
+      emit_var_t *var = ZONE_ALLOC(sizeof(emit_var_t));
+      var->ident = ident;
+      var->type = type;
+      var->block = 0;
+      
+      map_put(&e->map_var, ident, var);
+      break;
+    }
+    default:
+      break;
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  return true;
+}
+
+static bool emit_collect_class(emit_t *e, emit_class_t *class)
+{
+  s_node_t *head = class->node->class_def.class_decl;
+  while (head) {
+    s_node_t *body = head->stmt.body;
+    
+    switch (body->node_type) {
+    case S_FN:
+      if (class->value) {
+        c_error(body->fn.fn_ident, "struct '%s' can not have methods", class->ident->data.ident);
+        return false;
+      }
+      
+      if (!emit_add_fn(e, body, class))
+        return false;
+      break;
+    case S_CLASS_NEW:
+      if (class->value) {
+        c_error(
+          class->ident,
+          "constructor of struct '%s' is not supported by --emit-c",
+          class->ident->data.ident);
+        return false;
+      }
+      
+      if (!emit_add_fn(e, body, class))
+        return false;
+      break;
+    case S_DECL: {
+      emit_type_t type;
+      if (!emit_type(e, &type, body->decl.type))
+        return false;
+      
+      const char *ident = body->decl.ident->data.ident;
+      if (map_get(&class->map_var, ident)) {
+        c_error(body->decl.ident, "redefinition of '%s'", ident);
+        return false;
+      }
+      
+      if (body->decl.init) {
+        c_error(body->decl.ident, "cannot initialize '%s", ident);
+        return false;
+      }
+      
+      if (class->value && !emit_type_num(&type) && (type.spec != SPEC_STRUCT || type.arr)) {
+        c_error(body->decl.ident, "struct '%s' can only hold i32, f32 and structs", class->ident->data.ident);
+        return false;
+      }
+      
+      emit_var_t *var = ZONE_ALLOC(sizeof(emit_var_t));
+      var->ident = ident;
+      var->type = type;
+      var->block = 0;
+      
+      map_put(&class->map_var, ident, var);
+      break;
+    }
+    default:
+      break;
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  if (class->value)
+    emit_collect_vec(class);
+  
+  return true;
+}
+
+// a struct whose fields are all f32, or structs which are, is a vector, and
+// one whose fields are n vectors of n f32s is also a matrix of columns. it is
+// worked on by the helpers emit_class() writes for it.
+static void emit_collect_vec(emit_class_t *class)
+{
+  class->num_f32 = 0;
+  class->col = NULL;
+  
+  bool col = true;
+  int num_col = 0;
+  
+  s_node_t *head = class->node->class_def.class_decl;
+  while (head) {
+    if (head->stmt.body->node_type == S_DECL) {
+      const emit_var_t *var = map_get(&class->map_var, head->stmt.body->decl.ident->data.ident);
+      
+      if (emit_type_cmp(&var->type, &emit_f32)) {
+        class->num_f32++;
+        col = false;
+      } else if (var->type.spec == SPEC_STRUCT && var->type.class->num_f32) {
+        class->num_f32 += var->type.class->num_f32;
+        col = col && (!class->col || class->col == var->type.class);
+        class->col = var->type.class;
+        num_col++;
+      } else {
+        class->num_f32 = 0;
+        class->col = NULL;
+        return;
+      }
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  if (!col || !class->col || class->col->num_f32 != num_col)
+    class->col = NULL;
+}
+
+static bool emit_add_fn(emit_t *e, s_node_t *node, emit_class_t *class)
+{
+  bool is_new = node->node_type == S_CLASS_NEW;
+  
+  const lexeme_t *lexeme = is_new ? class->ident : node->fn.fn_ident;
+  const char *ident = is_new ? "+new" : lexeme->data.ident;
+  s_node_t *param = is_new ? node->class_new.param_decl : node->fn.param_decl;
+  
+  bool has_body = is_new
+    ? node->class_new.body || node->class_new.lazy_body
+    : node->fn.body || node->fn.lazy_body;
+  
+  map_t *map_fn = class ? &class->map_fn : &e->map_fn;
+  
+  emit_fn_t *fn = map_get(map_fn, ident);
+  if (fn && (has_body || !fn->native)) {
+    c_error(lexeme, "redefinition of function '%s'", ident);
+    return false;
+  }
+  
+  if (!has_body && class) {
+    c_error(lexeme, "bodyless method '%s' is not supported by --emit-c", ident);
+    return false;
+  }
+  
+  if (!fn) {
+    fn = ZONE_ALLOC(sizeof(emit_fn_t));
+    map_put(map_fn, ident, fn);
+  }
+  
+  fn->ident = lexeme;
+  fn->node = node;
+  fn->param = param;
+  fn->class = class;
+  fn->is_new = is_new;
+  fn->native = !has_body;
+  
+  if (is_new)
+    fn->name = emit_str(e, "new_%s", class->ident->data.ident);
+  else if (class)
+    fn->name = emit_str(e, "fn_%s_%s", class->ident->data.ident, ident);
+  else
+    fn->name = emit_str(e, "fn_%s", ident);
+  
+  fn->type = emit_none;
+  if (is_new)
+    fn->type = (emit_type_t) { SPEC_CLASS, false, class };
+  else if (node->fn.type && !emit_type(e, &fn->type, node->fn.type))
+    return false;
+  
+  fn->num_arg = 0;
+  
+  s_node_t *head = param;
+  while (head) {
+    if (fn->num_arg == EMIT_MAX_ARG) {
+      c_error(head->param_decl.ident, "too many params for --emit-c");
+      return false;
+    }
+    
+    if (!emit_type(e, &fn->arg_type[fn->num_arg], head->param_decl.type))
+      return false;
+    
+    emit_type_t elem = fn->arg_type[fn->num_arg];
+    elem.arr = false;
+    
+    if (fn->native && !emit_type_num(&fn->arg_type[fn->num_arg])
+    && !emit_type_cmp(&fn->arg_type[fn->num_arg], &emit_string)
+    && (!fn->arg_type[fn->num_arg].arr || !emit_type_num(&elem))) {
+      c_error(
+        head->param_decl.ident,
+        "native param '%s' must be i32, f32, string or an array of i32 or f32",
+        head->param_decl.ident->data.ident);
+      return false;
+    }
+    
+    fn->num_arg++;
+    head = head->param_decl.next;
+  }
+  
+  if (has_body) {
+    s_lazy_body(node);
+    if (s_error())
+      return false;
+  }
+  
+  return true;
+}
+
+static bool emit_program(emit_t *e, s_node_t *node, const char *src)
+{
+  emit_line(e, "// generated by cirno --emit-c from '%s'", src);
+  emit_line(e, "");
+  emit_line(e, "#include \"int_main.h\"");
+  emit_line(e, "#include \"lib.h\"");
+  emit_line(e, "#include \"mem.h\"");
+  emit_line(e, "#include \"rt.h\"");
+  emit_line(e, "#include \"sdl.h\"");
+  emit_line(e, "#include \"vec.h\"");
+  emit_line(e, "#include \"zone.h\"");
+  emit_line(e, "#include <math.h>");
+  emit_line(e, "#include <stdio.h>");
+  
+  s_node_t *head = node;
+  while (head) {
+    if (head->stmt.body->node_type == S_CLASS_DEF)
+      emit_class(e, map_get(&e->map_class, head->stmt.body->class_def.ident->data.ident));
+    head = head->stmt.next;
+  }
+  
+  emit_line(e, "");
+  
+  head = node;
+  while (head) {
+    s_node_t *body = head->stmt.body;
+    
+    if (body->node_type == S_FN) {
+      emit_fn_t *fn = map_get(&e->map_fn, body->fn.fn_ident->data.ident);
+      if (fn->node == body && !fn->native)
+        emit_proto(e, fn);
+    } else if (body->node_type == S_CLASS_DEF) {
+      emit_class_t *class = map_get(&e->map_class, body->class_def.ident->data.ident);
+      
+      s_node_t *decl = body->class_def.class_decl;
+      while (decl) {
+        if (decl->stmt.body->node_type == S_FN)
+          emit_proto(e, map_get(&class->map_fn, decl->stmt.body->fn.fn_ident->data.ident));
+        else if (decl->stmt.body->node_type == S_CLASS_NEW)
+          emit_proto(e, map_get(&class->map_fn, "+new"));
+        decl = decl->stmt.next;
+      }
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  emit_line(e, "");
+  
+  head = node;
+  while (head) {
+    s_node_t *body = head->stmt.body;
+    if (body->node_type == S_DECL) {
+      emit_var_t *var = map_get(&e->map_var, body->decl.ident->data.ident);
+      emit_line(e, "static %s;", emit_cdecl(e, &var->type, emit_str(e, "v_%s", var->ident)));
+    }
+    head = head->stmt.next;
+  }
+  
+  head = node;
+  while (head) {
+    s_node_t *body = head->stmt.body;
+    
+    if (body->node_type == S_FN) {
+      emit_fn_t *fn = map_get(&e->map_fn, body->fn.fn_ident->data.ident);
+      if (fn->node == body) {
+        if (fn->native)
+          emit_native(e, fn);
+        else if (!emit_fn(e, fn))
+          return false;
+      }
+    } else if (body->node_type == S_CLASS_DEF) {
+      emit_class_t *class = map_get(&e->map_class, body->class_def.ident->data.ident);
+      
+      s_node_t *decl = body->class_def.class_decl;
+      while (decl) {
+        emit_fn_t *fn = NULL;
+        if (decl->stmt.body->node_type == S_FN)
+          fn = map_get(&class->map_fn, decl->stmt.body->fn.fn_ident->data.ident);
+        else if (decl->stmt.body->node_type == S_CLASS_NEW)
+          fn = map_get(&class->map_fn, "+new");
+        
+        if (fn && !emit_fn(e, fn))
+          return false;
+        
+        decl = decl->stmt.next;
+      }
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  if (!emit_script(e, node))
+    return false;
+  
+  return emit_main(e, src);
+}
+
+static void emit_class(emit_t *e, const emit_class_t *class)
+{
+  emit_line(e, "");
+  emit_line(e, "typedef struct {");
+  e->indent++;
+  
+  int num_field = 0;
+  
+  s_node_t *head = class->node->class_def.class_decl;
+  while (head) {
+    if (head->stmt.body->node_type == S_DECL) {
+      emit_var_t *var = map_get(&class->map_var, head->stmt.body->decl.ident->data.ident);
+      emit_line(e, "%s;", emit_cdecl(e, &var->type, emit_str(e, "v_%s", var->ident)));
+      num_field++;
+    }
+    head = head->stmt.next;
+  }
+  
+  if (num_field == 0)
+    emit_line(e, "char empty;");
+  
+  e->indent--;
+  
+  if (!class->value) {
+    emit_line(e, "} class_%s;", class->ident->data.ident);
+    return;
+  }
+  
+  emit_line(e, "} struct_%s;", class->ident->data.ident);
+  
+  if (class->num_f32)
+    emit_vec(e, class);
+}
+
+// a vector is passed by value and worked on through its f32s by the kernels
+// the interpreter runs, those which update it in place take its address
+static void emit_vec(emit_t *e, const emit_class_t *class)
+{
+  const char *name = emit_str(e, "struct_%s", class->ident->data.ident);
+  const char *ptr = "(float *) &a, (float *) &a";
+  int n = class->num_f32;
+  
+  const char *op[] = { "add", "sub", "mul", "div" };
+  for (int i = 0; i < 4; i++) {
+    const char *arg = i < 2 ? emit_str(e, "%s b", name) : "float b";
+    emit_line(e, "");
+    emit_line(e, "static inline %s %s_%s(%s a, %s)", name, name, op[i], name, arg);
+    emit_line(e, "{");
+    emit_line(e, "  vec_%s(%s, %sb, %i);", op[i], ptr, i < 2 ? "(float *) &" : "", n);
+    emit_line(e, "  return a;");
+    emit_line(e, "}");
+  }
+  
+  // the methods vec2 had as a class
+  const char *update[] = { "add", "sub", "mul" };
+  for (int i = 0; i < 3; i++) {
+    const char *arg = i < 2 ? emit_str(e, "%s b", name) : "float b";
+    emit_line(e, "");
+    emit_line(e, "static inline %s *%s_%s_in(%s *a, %s)", name, name, update[i], name, arg);
+    emit_line(e, "{");
+    emit_line(e, "  *a = %s_%s(*a, b);", name, update[i]);
+    emit_line(e, "  return a;");
+    emit_line(e, "}");
+  }
+  
+  emit_line(e, "");
+  emit_line(e, "static inline float %s_dot(%s a, %s b)", name, name, name);
+  emit_line(e, "{");
+  emit_line(e, "  return vec_dot((float *) &a, (float *) &b, %i);", n);
+  emit_line(e, "}");
+  
+  emit_line(e, "");
+  emit_line(e, "static inline float %s_length(%s a)", name, name);
+  emit_line(e, "{");
+  emit_line(e, "  return sqrtf(vec_dot((float *) &a, (float *) &a, %i));", n);
+  emit_line(e, "}");
+  
+  emit_line(e, "");
+  emit_line(e, "static inline %s %s_normalize(%s a)", name, name, name);
+  emit_line(e, "{");
+  emit_line(e, "  return %s_div(a, %s_length(a));", name, name);
+  emit_line(e, "}");
+  
+  emit_line(e, "");
+  emit_line(e, "static inline %s %s_lerp(%s a, %s b, float t)", name, name, name, name);
+  emit_line(e, "{");
+  emit_line(e, "  vec_lerp(%s, (float *) &b, t, %i);", ptr, n);
+  emit_line(e, "  return a;");
+  emit_line(e, "}");
+  
+  if (n == 3) {
+    emit_line(e, "");
+    emit_line(e, "static inline %s %s_cross(%s a, %s b)", name, name, name, name);
+    emit_line(e, "{");
+    emit_line(e, "  vec_cross(%s, (float *) &b);", ptr);
+    emit_line(e, "  return a;");
+    emit_line(e, "}");
+  }
+  
+  if (!class->col)
+    return;
+  
+  const char *col = emit_str(e, "struct_%s", class->col->ident->data.ident);
+  int num_col = class->col->num_f32;
+  
+  emit_line(e, "");
+  emit_line(e, "static inline %s %s_mat(%s a, %s b)", col, name, name, col);
+  emit_line(e, "{");
+  emit_line(e, "  %s r;", col);
+  emit_line(e, "  vec_mat((float *) &r, (float *) &a, (float *) &b, %i);", num_col);
+  emit_line(e, "  return r;");
+  emit_line(e, "}");
+  
+  emit_line(e, "");
+  emit_line(e, "static inline %s %s_mat_mat(%s a, %s b)", name, name, name, name);
+  emit_line(e, "{");
+  emit_line(e, "  %s r;", name);
+  emit_line(e, "  for (int i = 0; i < %i; i++)", num_col);
+  emit_line(e, "    vec_mat(&((float *) &r)[i * %i], (float *) &a, &((float *) &b)[i * %i], %i);", num_col, num_col, num_col);
+  emit_line(e, "  return r;");
+  emit_line(e, "}");
+}
+
+static const char *emit_params(emit_t *e, const emit_fn_t *fn)
+{
+  const char *params = "";
+  const char *sep = "";
+  
+  if (fn->class && !fn->is_new) {
+    params = "heap_block_t *v_this";
+    sep = ", ";
+  }
+  
+  s_node_t *head = fn->param;
+  for (int i = 0; i < fn->num_arg; i++) {
+    const char *name = emit_str(e, "v_%s", head->param_decl.ident->data.ident);
+    params = emit_str(e, "%s%s%s", params, sep, emit_cdecl(e, &fn->arg_type[i], name));
+    sep = ", ";
+    head = head->param_decl.next;
+  }
+  
+  return params;
+}
+
+static const char *emit_ret_type(emit_t *e, const emit_fn_t *fn)
+{
+  if (emit_type_cmp(&fn->type, &emit_none))
+    return "void ";
+  
+  return emit_cdecl(e, &fn->type, "");
+}
+
+static void emit_proto(emit_t *e, const emit_fn_t *fn)
+{
+  emit_line(e, "static %s%s(%s);", emit_ret_type(e, fn), fn->name, emit_params(e, fn));
+}
+
+// natives are called through the interpreter's bindings
+static void emit_native(emit_t *e, const emit_fn_t *fn)
+{
+  emit_line(e, "");
+  emit_line(e, "static %s%s(%s)", emit_ret_type(e, fn), fn->name, emit_params(e, fn));
+  emit_line(e, "{");
+  e->indent++;
+  
+  const char *param = "";
+  const char *arg = "";
+  const char *sep = "";
+  
+  s_node_t *head = fn->param;
+  for (int i = 0; i < fn->num_arg; i++) {
+    const char *ident = head->param_decl.ident->data.ident;
+    const char *wrap = emit_str(e, "rt_string(v_%s)", ident);
+    if (emit_type_cmp(&fn->arg_type[i], &emit_i32))
+      wrap = emit_str(e, "rt_i32(v_%s)", ident);
+    else if (emit_type_cmp(&fn->arg_type[i], &emit_f32))
+      wrap = emit_str(e, "rt_f32(v_%s)", ident);
+    else if (fn->arg_type[i].arr)
+      wrap = emit_str(e, "rt_array(v_%s, %s)", ident, fn->arg_type[i].spec == SPEC_I32 ? "SPEC_I32" : "SPEC_F32");
+    
+    param = emit_str(e, "%s%s\"%s\"", param, sep, ident);
+    arg = emit_str(e, "%s%s%s", arg, sep, wrap);
+    sep = ", ";
+    head = head->param_decl.next;
+  }
+  
+  const char *call = "NULL, NULL, 0";
+  if (fn->num_arg > 0) {
+    emit_line(e, "const char *param[] = { %s };", param);
+    emit_line(e, "expr_t arg_list[] = { %s };", arg);
+    call = emit_str(e, "param, arg_list, %i", fn->num_arg);
+  }
+  
+  const char *ident = fn->ident->data.ident;
+  
+  if (emit_type_cmp(&fn->type, &emit_none))
+    emit_line(e, "rt_native(\"%s\", %s);", ident, call);
+  else if (emit_type_cmp(&fn->type, &emit_i32))
+    emit_line(e, "return rt_native(\"%s\", %s).i32;", ident, call);
+  else if (emit_type_cmp(&fn->type, &emit_f32))
+    emit_line(e, "return rt_native(\"%s\", %s).f32;", ident, call);
+  else
+    emit_line(e, "return rt_native(\"%s\", %s).block;", ident, call);
+  
+  e->indent--;
+  emit_line(e, "}");
+}
+
+static bool emit_fn(emit_t *e, emit_fn_t *fn)
+{
+  e->fn = fn;
+  e->num_var = 0;
+  e->block = 0;
+  e->loop = 0;
+  e->num_tmp = 0;
+  e->num_hoist = 0;
+  
+  emit_line(e, "");
+  emit_line(e, "static %s%s(%s)", emit_ret_type(e, fn), fn->name, emit_params(e, fn));
+  emit_line(e, "{");
+  e->indent++;
+  
+  if (fn->class) {
+    emit_type_t type = { SPEC_CLASS, false, fn->class };
+    emit_add(e, &type, "this");
+    
+    if (fn->is_new)
+      emit_line(e, "heap_block_t *v_this = heap_alloc(sizeof(class_%s));", fn->class->ident->data.ident);
+  }
+  
+  s_node_t *head = fn->param;
+  for (int i = 0; i < fn->num_arg; i++) {
+    if (!emit_add(e, &fn->arg_type[i], head->param_decl.ident->data.ident)) {
+      c_error(
+        head->param_decl.ident,
+        "redefinition of param '%s'",
+        head->param_decl.ident->data.ident);
+      return false;
+    }
+    head = head->param_decl.next;
+  }
+  
+  const s_node_t *body = fn->is_new ? fn->node->class_new.body : fn->node->fn.body;
+  if (!emit_body(e, body))
+    return false;
+  
+  if (fn->is_new)
+    emit_line(e, "return v_this;");
+  else if (!emit_type_cmp(&fn->type, &emit_none))
+    emit_line(e, "return %s;", emit_zero(e, &fn->type));
+  
+  e->indent--;
+  emit_line(e, "}");
+  
+  e->fn = NULL;
+  
+  return true;
+}
+
+static bool emit_script(emit_t *e, s_node_t *node)
+{
+  e->fn = NULL;
+  e->num_var = 0;
+  e->block = 0;
+  e->loop = 0;
+  e->num_tmp = 0;
+  e->num_hoist = 0;
+  
+  emit_line(e, "");
+  emit_line(e, "static void script()");
+  emit_line(e, "{");
+  e->indent++;
+  
+  s_node_t *head = node;
+  while (head) {
+    s_node_t *body = head->stmt.body;
+    
+    if (body->node_type == S_DECL) {
+      emit_var_t *var = map_get(&e->map_var, body->decl.ident->data.ident);
+      
+      char *init = emit_zero(e, &var->type);
+      
+      if (body->decl.init) {
+        emit_type_t type;
+        init = emit_expr(e, body->decl.init, &type);
+        if (!init)
+          return false;
+        
+        init = emit_cast(e, init, &type, &var->type);
+        if (!init) {
+          c_error(
+            body->decl.type->type.spec,
+            "incompatible types when initializing '%s' with '%s'",
+            emit_type_name(e, &var->type),
+            emit_type_name(e, &type));
+          return false;
+        }
+      }
+      
+      emit_line(e, "v_%s = %s;", var->ident, init);
+    } else if (body->node_type != S_FN && body->node_type != S_CLASS_DEF) {
+      if (!emit_stmt(e, body))
+        return false;
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  e->indent--;
+  emit_line(e, "}");
+  
+  return true;
+}
+
+// update and draw are bound as natives so sdl_frame() reaches them
+static bool emit_main(emit_t *e, const char *src)
+{
+  const char *bind[] = { "update", "draw" };
+  bool sdl = false;
+  
+  for (int i = 0; i < 2; i++) {
+    emit_fn_t *fn = map_get(&e->map_fn, bind[i]);
+    if (!fn || fn->native)
+      continue;
+    
+    if (fn->num_arg > 0 || !emit_type_cmp(&fn->type, &emit_none)) {
+      c_error(fn->ident, "'%s' must take no arguments and return nothing", bind[i]);
+      return false;
+    }
+    
+    emit_line(e, "");
+    emit_line(e, "static bool bind_%s(expr_t *ret_value, scope_t *scope_args)", bind[i]);
+    emit_line(e, "{");
+    emit_line(e, "  return rt_run(fn_%s);", bind[i]);
+    emit_line(e, "}");
+    
+    sdl = true;
+  }
+  
+  emit_line(e, "");
+  emit_line(e, "int main(int argc, char *argv[])");
+  emit_line(e, "{");
+  e->indent++;
+  
+  emit_line(e, "int_init();");
+  emit_line(e, "");
+  emit_line(e, "lib_load_stdlib();");
+  emit_line(e, "lib_load_math();");
+  emit_line(e, "lib_load_array();");
+  emit_line(e, "");
+  
+  if (sdl) {
+    emit_line(e, "sdl_init();");
+    for (int i = 0; i < 2; i++) {
+      emit_fn_t *fn = map_get(&e->map_fn, bind[i]);
+      if (fn && !fn->native)
+        emit_line(e, "int_bind(\"%s\", bind_%s);", bind[i], bind[i]);
+    }
+    emit_line(e, "");
+  }
+  
+  if (sdl) {
+    emit_line(e, "if (rt_run(script)) {");
+    emit_line(e, "  while (sdl_frame());");
+    emit_line(e, "} else {");
+    emit_line(e, "  printf(\"cirno: failed to run '%%s'\\n\", \"%s\");", src);
+    emit_line(e, "}");
+  } else {
+    emit_line(e, "if (!rt_run(script))");
+    emit_line(e, "  printf(\"cirno: failed to run '%%s'\\n\", \"%s\");", src);
+  }
+  emit_line(e, "");
+  emit_line(e, "int_stop();");
+  emit_line(e, "");
+  emit_line(e, "zone_log();");
+  emit_line(e, "");
+  emit_line(e, "return 0;");
+  
+  e->indent--;
+  emit_line(e, "}");
+  
+  return true;
+}
+
+static bool emit_body(emit_t *e, const s_node_t *node)
+{
+  while (node) {
+    if (!emit_stmt(e, node->stmt.body))
+      return false;
+    
+    node = node->stmt.next;
+  }
+  
+  return true;
+}
+
+static bool emit_body_scope(emit_t *e, const s_node_t *node)
+{
+  int num_var = e->num_var;
+  e->block++;
+  
+  bool ok = emit_body(e, node);
+  
+  e->block--;
+  e->num_var = num_var;
+  
+  return ok;
+}
+
+static bool emit_stmt(emit_t *e, const s_node_t *node)
+{
+  emit_type_t type;
+  char *expr;
+  
+  switch (node->node_type) {
+  case S_PROC:
+    expr = emit_proc(e, node, &type, false);
+    break;
+  case S_BINOP:
+  case S_CONSTANT:
+  case S_INDEX:
+  case S_DIRECT:
+  case S_UNARY:
+  case S_ARRAY_INIT:
+  case S_POST_OP:
+    expr = emit_expr(e, node, &type);
+    break;
+  case S_DECL:
+    return emit_decl(e, node);
+  case S_PRINT:
+    return emit_print(e, node);
+  case S_IF_STMT:
+    return emit_if_stmt(e, node);
+  case S_WHILE_STMT:
+    return emit_while_stmt(e, node);
+  case S_FOR_STMT:
+    return emit_for_stmt(e, node);
+  case S_RET_STMT:
+    return emit_ret_stmt(e, node);
+  case S_CTRL_STMT:
+    return emit_ctrl_stmt(e, node);
+  case S_FN:
+    c_error(node->fn.fn_ident, "nested function '%s' is not supported by --emit-c", node->fn.fn_ident->data.ident);
+    return false;
+  case S_CLASS_DEF:
+    c_error(node->class_def.ident, "nested class '%s' is not supported by --emit-c", node->class_def.ident->data.ident);
+    return false;
+  default:
+    LOG_ERROR("unknown statement node_type (%i)", node->node_type);
+    return false;
+  }
+  
+  if (!expr)
+    return false;
+  
+  emit_line(e, "%s;", expr);
+  
+  return true;
+}
+
+static bool emit_decl(emit_t *e, const s_node_t *node)
+{
+  emit_type_t type;
+  if (!emit_type(e, &type, node->decl.type))
+    return false;
+  
+  const char *ident = node->decl.ident->data.ident;
+  
+  // the vars of the script's outermost block are the program's globals,
+  // hoisted vars are declared ahead of their if-else chain
+  bool hoisted = emit_hoisted(e, node);
+  bool global = !e->fn && e->block == 0 && !hoisted;
+  
+  if (!global && !emit_add(e, &type, ident)) {
+    c_error(node->decl.ident, "redefinition of '%s'", ident);
+    return false;
+  }
+  
+  char *init = emit_zero(e, &type);
+  
+  if (node->decl.init) {
+    emit_type_t init_type;
+    init = emit_expr(e, node->decl.init, &init_type);
+    if (!init)
+      return false;
+    
+    init = emit_cast(e, init, &init_type, &type);
+    if (!init) {
+      c_error(
+        node->decl.type->type.spec,
+        "incompatible types when initializing '%s' with '%s'",
+        emit_type_name(e, &type),
+        emit_type_name(e, &init_type));
+      return false;
+    }
+  }
+  
+  if (global || hoisted)
+    emit_line(e, "v_%s = %s;", ident, init);
+  else
+    emit_line(e, "%s = %s;", emit_cdecl(e, &type, emit_str(e, "v_%s", ident)), init);
+  
+  return true;
+}
+
+static bool emit_print(emit_t *e, const s_node_t *node)
+{
+  const s_node_t *arg = node->print.arg;
+  
+  while (arg) {
+    const s_node_t *body = arg->arg.body;
+    
+    // a call which returns nothing is still made and prints as (none), as
+    // in the interpreter
+    emit_type_t type;
+    char *expr = body->node_type == S_PROC
+      ? emit_proc(e, body, &type, true)
+      : emit_expr(e, body, &type);
+    if (!expr)
+      return false;
+    
+    if (emit_type_cmp(&type, &emit_none)) {
+      emit_line(e, "%s;", expr);
+      emit_line(e, "rt_print_none();");
+    } else if (emit_type_cmp(&type, &emit_i32)) {
+      emit_line(e, "rt_print_i32(%s);", expr);
+    } else if (emit_type_cmp(&type, &emit_f32)) {
+      emit_line(e, "rt_print_f32(%s);", expr);
+    } else if (emit_type_cmp(&type, &emit_string)) {
+      emit_line(e, "rt_print_string(%s);", expr);
+    } else {
+      c_error(
+        emit_lexeme(arg->arg.body),
+        "printing '%s' is not supported by --emit-c",
+        emit_type_name(e, &type));
+      return false;
+    }
+    
+    arg = arg->arg.next;
+  }
+  
+  emit_line(e, "rt_print_end();");
+  
+  return true;
+}
+
+static bool emit_if_stmt(emit_t *e, const s_node_t *node)
+{
+  if (!emit_hoist(e, node))
+    return false;
+  
+  char *cond = emit_cond(e, node->if_stmt.cond);
+  if (!cond)
+    return false;
+  
+  emit_line(e, "if (%s) {", cond);
+  e->indent++;
+  
+  if (!emit_body_scope(e, node->if_stmt.body))
+    return false;
+  
+  e->indent--;
+  
+  if (node->if_stmt.next) {
+    emit_line(e, "} else {");
+    e->indent++;
+    
+    if (!emit_body(e, node->if_stmt.next))
+      return false;
+    
+    e->indent--;
+  }
+  
+  emit_line(e, "}");
+  
+  return true;
+}
+
+// the else branch runs in the enclosing scope, so the vars it declares are
+// declared ahead of the whole if-else chain
+static bool emit_hoist(emit_t *e, const s_node_t *node)
+{
+  const s_node_t *head = node->if_stmt.next;
+  while (head) {
+    const s_node_t *body = head->stmt.body;
+    
+    if (body->node_type == S_DECL && !emit_hoisted(e, body)) {
+      if (e->num_hoist == EMIT_MAX_VAR) {
+        LOG_ERROR("ran out of hoisted vars %i/%i", e->num_hoist, EMIT_MAX_VAR);
+        return false;
+      }
+      
+      emit_type_t type;
+      if (!emit_type(e, &type, body->decl.type))
+        return false;
+      
+      e->hoist[e->num_hoist++] = body;
+      
+      const char *name = emit_str(e, "v_%s", body->decl.ident->data.ident);
+      emit_line(e, "%s = %s;", emit_cdecl(e, &type, name), emit_zero(e, &type));
+    } else if (body->node_type == S_IF_STMT && !emit_hoist(e, body)) {
+      return false;
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  return true;
+}
+
+static bool emit_hoisted(const emit_t *e, const s_node_t *node)
+{
+  for (int i = 0; i < e->num_hoist; i++) {
+    if (e->hoist[i] == node)
+      return true;
+  }
+  
+  return false;
+}
+
+static bool emit_while_stmt(emit_t *e, const s_node_t *node)
+{
+  return emit_loop(e, node->while_stmt.cond, NULL, node->while_stmt.body);
+}
+
+static bool emit_for_stmt(emit_t *e, const s_node_t *node)
+{
+  int num_var = e->num_var;
+  e->block++;
+  
+  emit_line(e, "{");
+  e->indent++;
+  
+  if (node->for_stmt.decl && !emit_stmt(e, node->for_stmt.decl->stmt.body))
+    return false;
+  
+  if (!emit_loop(e, node->for_stmt.cond, node->for_stmt.inc, node->for_stmt.body))
+    return false;
+  
+  e->indent--;
+  emit_line(e, "}");
+  
+  e->block--;
+  e->num_var = num_var;
+  
+  return true;
+}
+
+static bool emit_loop(emit_t *e, const s_node_t *cond, const s_node_t *inc, const s_node_t *body)
+{
+  // the condition's temporaries are emitted where it is evaluated, at the
+  // top of each iteration
+  FILE *out = e->out;
+  char *buf = NULL;
+  size_t len = 0;
+  
+  e->out = open_memstream(&buf, &len);
+  e->indent++;
+  
+  char *cond_expr = emit_cond(e, cond);
+  
+  e->indent--;
+  fclose(e->out);
+  e->out = out;
+  
+  if (!cond_expr) {
+    free(buf);
+    return false;
+  }
+  
+  if (len == 0) {
+    emit_line(e, "while (%s) {", cond_expr);
+    e->indent++;
+  } else {
+    emit_line(e, "while (1) {");
+    e->indent++;
+    fwrite(buf, 1, len, e->out);
+    emit_line(e, "if (!%s)", cond_expr);
+    emit_line(e, "  break;");
+    emit_line(e, "");
+  }
+  
+  free(buf);
+  
+  char *loop_cont = e->loop_cont;
+  bool loop_cont_used = e->loop_cont_used;
+  e->loop++;
+  e->loop_cont = inc ? emit_str(e, "c%i", e->num_tmp++) : NULL;
+  e->loop_cont_used = false;
+  
+  if (!emit_body_scope(e, body))
+    return false;
+  
+  if (e->loop_cont_used)
+    emit_line(e, "%s:;", e->loop_cont);
+  
+  e->loop--;
+  e->loop_cont = loop_cont;
+  e->loop_cont_used = loop_cont_used;
+  
+  if (inc) {
+    emit_type_t type;
+    char *expr = inc->node_type == S_PROC
+      ? emit_proc(e, inc, &type, false)
+      : emit_expr(e, inc, &type);
+    
+    if (!expr)
+      return false;
+    
+    emit_line(e, "%s;", expr);
+  }
+  
+  e->indent--;
+  emit_line(e, "}");
+  
+  return true;
+}
+
+static bool emit_ret_stmt(emit_t *e, const s_node_t *node)
+{
+  if (e->fn && e->fn->is_new) {
+    c_error(node->ret_stmt.ret_token, "'return' inside a constructor is not supported by --emit-c");
+    return false;
+  }
+  
+  emit_type_t type;
+  char *expr = emit_expr(e, node->ret_stmt.body, &type);
+  if (!expr)
+    return false;
+  
+  const emit_type_t *ret_type = e->fn ? &e->fn->type : &emit_none;
+  
+  if (!emit_type_cmp(&type, ret_type)) {
+    c_error(
+      node->ret_stmt.ret_token,
+      "incompatible types when returning type '%s' but '%s' was expected",
+      emit_type_name(e, &type),
+      emit_type_name(e, ret_type));
+    return false;
+  }
+  
+  emit_line(e, "return %s;", expr);
+  
+  return true;
+}
+
+static bool emit_ctrl_stmt(emit_t *e, const s_node_t *node)
+{
+  const lexeme_t *lexeme = node->ctrl_stmt.lexeme;
+  
+  if (!e->loop) {
+    c_error(lexeme, "cannot %s outside loop", lexeme->token == TK_BREAK ? "break" : "continue");
+    return false;
+  }
+  
+  if (lexeme->token == TK_BREAK) {
+    emit_line(e, "break;");
+  } else if (e->loop_cont) {
+    emit_line(e, "goto %s;", e->loop_cont);
+    e->loop_cont_used = true;
+  } else {
+    emit_line(e, "continue;");
+  }
+  
+  return true;
+}
+
+// conditions test the low 32 bits of the value
+static char *emit_cond(emit_t *e, const s_node_t *node)
+{
+  emit_type_t type;
+  char *expr = emit_expr(e, node, &type);
+  if (!expr)
+    return NULL;
+  
+  if (emit_type_cmp(&type, &emit_i32))
+    return expr;
+  
+  if (emit_type_cmp(&type, &emit_f32))
+    return emit_str(e, "rt_f32_bits(%s)", expr);
+  
+  c_error(
+    emit_lexeme(node),
+    "condition of type '%s' is not supported by --emit-c",
+    emit_type_name(e, &type));
+  
+  return NULL;
+}
+
+static char *emit_expr(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  switch (node->node_type) {
+  case S_BINOP:
+    return emit_binop(e, node, type);
+  case S_UNARY:
+    return emit_unary(e, node, type);
+  case S_INDEX:
+    return emit_index(e, node, type);
+  case S_DIRECT:
+    return emit_direct(e, node, type);
+  case S_PROC: {
+    char *expr = emit_proc(e, node, type, true);
+    if (expr && emit_type_cmp(type, &emit_none)) {
+      c_error(node->proc.left_bracket, "function '%h' returns no value", node->proc.base);
+      return NULL;
+    }
+    return expr;
+  }
+  case S_CONSTANT:
+    return emit_constant(e, node, type);
+  case S_ARRAY_INIT:
+    return emit_array_init(e, node, type);
+  case S_POST_OP:
+    return emit_post_op(e, node, type);
+  case S_NEW:
+    c_error(node->new.class_ident, "'new %s' must be called", node->new.class_ident->data.ident);
+    return NULL;
+  default:
+    LOG_ERROR("unknown node_type (%i)", node->node_type);
+    return NULL;
+  }
+}
+
+static char *emit_lvalue(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    if (node->constant.lexeme->token == TK_IDENTIFIER)
+      return emit_constant(e, node, type);
+    break;
+  case S_INDEX:
+    return emit_index(e, node, type);
+  case S_DIRECT:
+    if (node->direct.base)
+      return emit_direct(e, node, type);
+    break;
+  default:
+    break;
+  }
+  
+  c_error(emit_lexeme(node), "lvalue required as left operand of assignment");
+  
+  return NULL;
+}
+
+static char *emit_constant(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  const lexeme_t *lexeme = node->constant.lexeme;
+  
+  switch (lexeme->token) {
+  case TK_CONST_INTEGER:
+    *type = emit_i32;
+    return emit_str(e, "%i", lexeme->data.i32);
+  case TK_CONST_FLOAT: {
+    *type = emit_f32;
+    
+    char *f32 = emit_str(e, "%.9g", lexeme->data.f32);
+    if (!strpbrk(f32, ".e"))
+      f32 = emit_str(e, "%s.0", f32);
+    
+    return emit_str(e, "%sf", f32);
+  }
+  case TK_STRING_LITERAL: {
+    *type = emit_string;
+    
+    char *str = "";
+    for (const char *c = lexeme->data.string_literal; *c; c++) {
+      if (*c == '"' || *c == '\\')
+        str = emit_str(e, "%s\\%c", str, *c);
+      else if (*c < ' ' || *c > '~')
+        str = emit_str(e, "%s\\%03o", str, (unsigned char) *c);
+      else
+        str = emit_str(e, "%s%c", str, *c);
+    }
+    
+    return emit_str(e, "heap_alloc_string(\"%s\")", str);
+  }
+  case TK_IDENTIFIER: {
+    const char *ident = lexeme->data.ident;
+    
+    emit_var_t *var = emit_find(e, ident);
+    if (!var)
+      var = map_get(&e->map_var, ident);
+    
+    if (var) {
+      *type = var->type;
+      return emit_str(e, "v_%s", ident);
+    }
+    
+    if (map_get(&e->map_fn, ident)) {
+      c_error(lexeme, "function '%s' used as a value is not supported by --emit-c", ident);
+      return NULL;
+    }
+    
+    c_error(lexeme, "'%s' undeclared", ident);
+    return NULL;
+  }
+  default:
+    LOG_ERROR("unknown constant token (%i)", lexeme->token);
+    return NULL;
+  }
+}
+
+static char *emit_unary(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  char *rhs = emit_expr(e, node->unary.rhs, type);
+  if (!rhs)
+    return NULL;
+  
+  if (node->unary.op->token == '-' && emit_type_num(type))
+    return emit_str(e, "(-%s)", rhs);
+  
+  if (node->unary.op->token == '-' && emit_type_vec(type))
+    return emit_spill(e, type, emit_str(e, "struct_%s_mul(%s, -1.0f)", type->class->ident->data.ident, rhs));
+  
+  if (node->unary.op->token == '!' && emit_type_cmp(type, &emit_i32))
+    return emit_str(e, "(!%s)", rhs);
+  
+  c_error(
+    node->unary.op,
+    "unknown operand type for '%t': '%s'",
+    node->unary.op->token,
+    emit_type_name(e, type));
+  
+  return NULL;
+}
+
+static bool emit_assign_op(int op)
+{
+  return op == '=' || (op >= TK_ADD_ASSIGN && op <= TK_DIV_ASSIGN);
+}
+
+static char *emit_binop(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  int op = node->binop.op->token;
+  
+  if (emit_assign_op(op))
+    return emit_assign(e, node, type);
+  
+  emit_type_t lhs_type;
+  char *lhs = emit_expr(e, node->binop.lhs, &lhs_type);
+  if (!lhs)
+    return NULL;
+  
+  if (emit_order(node->binop.lhs, node->binop.rhs))
+    lhs = emit_spill(e, &lhs_type, lhs);
+  
+  emit_type_t rhs_type;
+  char *rhs = emit_expr(e, node->binop.rhs, &rhs_type);
+  if (!rhs)
+    return NULL;
+  
+  if (emit_type_vec(&lhs_type) || emit_type_vec(&rhs_type)) {
+    char *vec = emit_vec_binop(e, op, lhs, &lhs_type, rhs, &rhs_type, type);
+    if (!vec)
+      goto err_no_op;
+    
+    return emit_spill(e, type, vec);
+  }
+  
+  const char *str_op = NULL;
+  switch (op) {
+  case '+':
+  case '-':
+  case '*':
+  case '/':
+  case '<':
+  case '>':
+    str_op = emit_str(e, "%c", op);
+    break;
+  case TK_LE:
+    str_op = "<=";
+    break;
+  case TK_GE:
+    str_op = ">=";
+    break;
+  case TK_EQ:
+    str_op = "==";
+    break;
+  case TK_NE:
+    str_op = "!=";
+    break;
+  case TK_AND:
+    str_op = "&";
+    break;
+  case TK_OR:
+    str_op = "|";
+    break;
+  }
+  
+  if (!str_op)
+    goto err_no_op;
+  
+  if (emit_type_cmp(&lhs_type, &emit_i32) && emit_type_cmp(&rhs_type, &emit_i32)) {
+    *type = emit_i32;
+    
+    // both sides are always evaluated
+    if (op == TK_AND || op == TK_OR)
+      return emit_str(e, "((%s != 0) %s (%s != 0))", lhs, str_op, rhs);
+    
+    return emit_str(e, "(%s %s %s)", lhs, str_op, rhs);
+  } else if (emit_type_num(&lhs_type) && emit_type_num(&rhs_type)) {
+    if (op == TK_AND || op == TK_OR)
+      goto err_no_op;
+    
+    lhs = emit_cast(e, lhs, &lhs_type, &emit_f32);
+    rhs = emit_cast(e, rhs, &rhs_type, &emit_f32);
+    
+    switch (op) {
+    case '+':
+    case '-':
+    case '*':
+    case '/':
+      *type = emit_f32;
+      return emit_str(e, "(%s %s %s)", lhs, str_op, rhs);
+    case '<':
+    case '>':
+      *type = emit_i32;
+      return emit_str(e, "(%s %s %s)", lhs, str_op, rhs);
+    default:
+      // the interpreter stores these as the f32 1.0 in an i32
+      *type = emit_i32;
+      return emit_str(e, "(%s %s %s ? 0x3f800000 : 0)", lhs, str_op, rhs);
+    }
+  } else if (emit_type_cmp(&lhs_type, &emit_string) && emit_type_cmp(&rhs_type, &emit_string) && op == '+') {
+    *type = emit_string;
+    return emit_str(e, "rt_concat(%s, %s)", lhs, rhs);
+  }
+
+err_no_op:
+  c_error(
+    node->binop.op,
+    "unknown operand type for '%t': '%s' and '%s' '%h'",
+    node->binop.op->token,
+    emit_type_name(e, &lhs_type),
+    emit_type_name(e, &rhs_type),
+    node);
+  
+  return NULL;
+}
+
+// the lhs is read before the rhs is evaluated
+static char *emit_assign(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  int op = node->binop.op->token;
+  bool order = emit_order(node->binop.lhs, node->binop.rhs);
+  
+  e->hold = order;
+  e->hold_block = NULL;
+  
+  char *lhs = emit_lvalue(e, node->binop.lhs, type);
+  e->hold = false;
+  if (!lhs)
+    return NULL;
+  
+  // an element is found again only once the rhs has run
+  bool held = order && e->hold_block;
+  
+  if (order && node->binop.lhs->node_type != S_CONSTANT)
+    lhs = emit_hold(e, type, lhs);
+  
+  char *old = lhs;
+  if (order && op != '=')
+    old = emit_spill(e, type, lhs);
+  
+  emit_type_t rhs_type;
+  char *rhs = emit_expr(e, node->binop.rhs, &rhs_type);
+  if (!rhs)
+    return NULL;
+  
+  if (held)
+    rhs = emit_spill(e, &rhs_type, rhs);
+  
+  if (emit_type_num(type)) {
+    rhs = emit_cast(e, rhs, &rhs_type, type);
+    if (!rhs)
+      goto err_no_op;
+    
+    if (op == '=')
+      return emit_str(e, "(%s = %s)", lhs, rhs);
+    
+    char arith_op = "+-*/"[op - TK_ADD_ASSIGN];
+    
+    if (old == lhs)
+      return emit_str(e, "(%s %c= %s)", lhs, arith_op, rhs);
+    
+    return emit_str(e, "(%s = %s %c %s)", lhs, old, arith_op, rhs);
+  } else if (emit_type_cmp(type, &emit_string) && emit_type_cmp(&rhs_type, &emit_string)) {
+    if (op == '=')
+      return emit_str(e, "(%s = %s)", lhs, rhs);
+    
+    if (op == TK_ADD_ASSIGN)
+      return emit_str(e, "(%s = rt_concat(%s, %s))", lhs, old, rhs);
+  } else if (emit_type_struct(type)) {
+    if (op == '=' && emit_type_cmp(type, &rhs_type))
+      return emit_str(e, "(%s = %s)", lhs, rhs);
+    
+    // 'v += w' is 'v = v + w', which must keep the type of v
+    emit_type_t vec_type;
+    char *vec = NULL;
+    if (op != '=')
+      vec = emit_vec_binop(e, "+-*/"[op - TK_ADD_ASSIGN], old, type, rhs, &rhs_type, &vec_type);
+    
+    if (vec && emit_type_cmp(&vec_type, type))
+      return emit_str(e, "(%s = %s)", lhs, vec);
+  } else if (op == '=' && ((type->spec == SPEC_CLASS && rhs_type.spec == SPEC_CLASS && !type->arr && !rhs_type.arr)
+  || (type->arr && rhs_type.arr))) {
+    return emit_str(e, "(%s = %s)", lhs, rhs);
+  }
+
+err_no_op:
+  c_error(
+    node->binop.op,
+    "unknown operand type for '%t': '%s' and '%s' '%h'",
+    node->binop.op->token,
+    emit_type_name(e, type),
+    emit_type_name(e, &rhs_type),
+    node);
+  
+  return NULL;
+}
+
+static char *emit_index(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  bool hold = e->hold;
+  e->hold = false;
+  
+  emit_type_t base_type;
+  char *base = emit_expr(e, node->index.base, &base_type);
+  if (!base)
+    return NULL;
+  
+  if (!base_type.arr) {
+    c_error(node->index.left_bracket, "subscripted value is not an array '%h'", node);
+    return NULL;
+  }
+  
+  int num_index = 0;
+  for (const s_node_t *head = node->index.index; head && head->node_type == S_ARG; head = head->arg.next)
+    num_index++;
+  
+  if (num_index != base_type.dim) {
+    c_error(node->index.left_bracket, "wrong number of indices to array '%h'", node->index.base);
+    return NULL;
+  }
+  
+  if (hold || emit_order(node->index.base, node->index.index))
+    base = emit_spill(e, &base_type, base);
+  
+  if (base_type.dim) {
+    if (hold)
+      e->hold_block = base;
+    
+    return emit_grid_index(e, node, &base_type, base, type);
+  }
+  
+  emit_type_t index_type;
+  char *index = emit_expr(e, node->index.index, &index_type);
+  if (!index)
+    return NULL;
+  
+  if (hold)
+    e->hold_block = base;
+  
+  if (!emit_type_cmp(&index_type, &emit_i32)) {
+    c_error(
+      node->index.left_bracket,
+      "array subscript is of type '%s', not 'i32' '%h'",
+      emit_type_name(e, &index_type),
+      node);
+    return NULL;
+  }
+  
+  *type = base_type;
+  type->arr = false;
+  
+  const char *ctype = emit_ctype(e, type);
+  
+  if (node->index.in_range) {
+    return emit_str(
+      e,
+      "(((%s%s*) (%s)->block)[%s])",
+      ctype,
+      ctype[strlen(ctype) - 1] == '*' ? "" : " ",
+      base,
+      index);
+  }
+  
+  return emit_str(
+    e,
+    "(*(%s%s*) rt_index(%s, %s, sizeof(%s), %s, %s))",
+    ctype,
+    ctype[strlen(ctype) - 1] == '*' ? "" : " ",
+    base,
+    index,
+    ctype,
+    emit_msg(e, node->index.left_bracket, "cannot index into uninitialised array '%h'", node->index.base),
+    emit_msg(e, node->index.left_bracket, "index out of bounds '%h'", node));
+}
+
+// the indices of a T[,] or T[,,] are checked together by rt_grid_index()
+static char *emit_grid_index(emit_t *e, const s_node_t *node, const emit_type_t *base_type, char *base, emit_type_t *type)
+{
+  char *index_list = "";
+  
+  for (const s_node_t *head = node->index.index; head; head = head->arg.next) {
+    emit_type_t index_type;
+    char *index = emit_expr(e, head->arg.body, &index_type);
+    if (!index)
+      return NULL;
+    
+    if (!emit_type_cmp(&index_type, &emit_i32)) {
+      c_error(
+        node->index.left_bracket,
+        "array subscript is of type '%s', not 'i32' '%h'",
+        emit_type_name(e, &index_type),
+        node);
+      return NULL;
+    }
+    
+    if (emit_order(head->arg.body, head->arg.next))
+      index = emit_spill(e, &emit_i32, index);
+    
+    index_list = emit_str(e, "%s%s%s", index_list, *index_list ? ", " : "", index);
+  }
+  
+  *type = *base_type;
+  type->arr = false;
+  type->dim = 0;
+  
+  const char *ctype = emit_ctype(e, type);
+  
+  return emit_str(
+    e,
+    "(*(%s%s*) rt_grid_index(%s, (int[]) { %s }, %i, sizeof(%s), %s, %s))",
+    ctype,
+    ctype[strlen(ctype) - 1] == '*' ? "" : " ",
+    base,
+    index_list,
+    base_type->dim,
+    ctype,
+    emit_msg(e, node->index.left_bracket, "cannot index into uninitialised array '%h'", node->index.base),
+    emit_msg(e, node->index.left_bracket, "index out of bounds '%h'", node));
+}
+
+static char *emit_direct(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  emit_type_t base_type;
+  char *base = emit_expr(e, node->direct.base, &base_type);
+  if (!base)
+    return NULL;
+  
+  const char *ident = node->direct.child_ident->data.ident;
+  
+  if (base_type.arr) {
+    bool extent = base_type.dim && (strcmp(ident, "rows") == 0 || strcmp(ident, "cols") == 0);
+    if (base_type.dim == 3 && strcmp(ident, "layers") == 0)
+      extent = true;
+    
+    if (extent) {
+      *type = emit_i32;
+      return emit_str(e, "(%s)->%s", base, ident);
+    }
+    
+    if (strcmp(ident, "length") != 0 && strcmp(ident, "capacity") != 0) {
+      c_error(
+        node->direct.child_ident,
+        "request for unknown member '%s' in array",
+        ident);
+      return NULL;
+    }
+    
+    emit_type_t elem = base_type;
+    elem.arr = false;
+    elem.dim = 0;
+    
+    *type = emit_i32;
+    return emit_str(e, "rt_%s(%s, sizeof(%s))", ident, base, emit_ctype(e, &elem));
+  }
+  
+  if (emit_type_struct(&base_type)) {
+    emit_var_t *var = map_get(&base_type.class->map_var, ident);
+    if (!var) {
+      c_error(
+        node->direct.child_ident,
+        "'struct %s' has no member named '%s'",
+        base_type.class->ident->data.ident,
+        ident);
+      return NULL;
+    }
+    
+    *type = var->type;
+    return emit_str(e, "%s.v_%s", base, ident);
+  }
+  
+  if (base_type.spec != SPEC_CLASS) {
+    c_error(
+      node->direct.child_ident,
+      "request for member '%s' in non-class",
+      ident);
+    return NULL;
+  }
+  
+  emit_var_t *var = map_get(&base_type.class->map_var, ident);
+  if (!var) {
+    if (map_get(&base_type.class->map_fn, ident))
+      c_error(node->direct.child_ident, "method '%s' used as a value is not supported by --emit-c", ident);
+    else
+      c_error(
+        node->direct.child_ident,
+        "'class %s' has no member named '%s'",
+        base_type.class->ident->data.ident,
+        ident);
+    return NULL;
+  }
+  
+  *type = var->type;
+  
+  // a class's members stay where they are
+  e->hold_block = NULL;
+  
+  // 'this' is never null
+  if (strcmp(base, "v_this") != 0) {
+    base = emit_str(
+      e,
+      "rt_class(%s, %s)",
+      base,
+      emit_msg(e, node->direct.child_ident, "request for member '%s' in uninitialised class", ident));
+  }
+  
+  return emit_str(e, "((class_%s *) %s->block)->v_%s", base_type.class->ident->data.ident, base, ident);
+}
+
+static char *emit_proc(emit_t *e, const s_node_t *node, emit_type_t *type, bool value)
+{
+  const s_node_t *base = node->proc.base;
+  const s_node_t *self_node = NULL;
+  char *self = NULL;
+  emit_fn_t *fn = NULL;
+  
+  switch (base->node_type) {
+  case S_CONSTANT: {
+    const char *ident = base->constant.lexeme->data.ident;
+    
+    if (base->constant.lexeme->token == TK_IDENTIFIER
+    && !emit_find(e, ident) && !map_get(&e->map_var, ident)) {
+      fn = map_get(&e->map_fn, ident);
+      if (!fn) {
+        c_error(base->constant.lexeme, "'%s' undeclared", ident);
+        return NULL;
+      }
+    }
+    break;
+  }
+  case S_DIRECT: {
+    e->hold = true;
+    e->hold_block = NULL;
+    
+    emit_type_t class;
+    self = emit_expr(e, base->direct.base, &class);
+    e->hold = false;
+    if (!self)
+      return NULL;
+    
+    const char *ident = base->direct.child_ident->data.ident;
+    
+    // the methods of a struct of f32s and of arrays are built in
+    if (emit_type_vec(&class))
+      return emit_vec_method(e, node, &class, self, type);
+    
+    if (class.arr)
+      return emit_array_method(e, node, &class, self, type, value);
+    
+    if (class.spec != SPEC_CLASS) {
+      c_error(
+        base->direct.child_ident,
+        "request for member '%s' in non-class",
+        ident);
+      return NULL;
+    }
+    
+    if (!map_get(&class.class->map_var, ident))
+      fn = map_get(&class.class->map_fn, ident);
+    
+    if (!fn) {
+      c_error(
+        base->direct.child_ident,
+        "'class %s' has no method named '%s'",
+        class.class->ident->data.ident,
+        ident);
+      return NULL;
+    }
+    
+    if (strcmp(self, "v_this") != 0) {
+      self = emit_str(
+        e,
+        "rt_class(%s, %s)",
+        self,
+        emit_msg(e, base->direct.child_ident, "request for member '%s' in uninitialised class", ident));
+    }
+    
+    self_node = base->direct.base;
+    break;
+  }
+  case S_NEW: {
+    const char *ident = base->new.class_ident->data.ident;
+    
+    emit_class_t *class = map_get(&e->map_class, ident);
+    if (!class) {
+      c_error(base->new.class_ident, "undeclared class '%s'", ident);
+      return NULL;
+    }
+    
+    // a struct_def is filled in from its fields in order
+    if (class->value)
+      return emit_struct_new(e, node, class, type);
+    
+    fn = map_get(&class->map_fn, "+new");
+    if (!fn) {
+      c_error(base->new.class_ident, "class '%s' has no constructor", ident);
+      return NULL;
+    }
+    break;
+  }
+  default:
+    break;
+  }
+  
+  if (!fn) {
+    c_error(node->proc.left_bracket, "calling '%h' is not supported by --emit-c", base);
+    return NULL;
+  }
+  
+  char *args = "";
+  const char *sep = "";
+  
+  if (self) {
+    if (self_node && emit_order(self_node, node->proc.arg))
+      self = emit_spill(e, &(emit_type_t) { SPEC_CLASS, false, fn->class }, self);
+    
+    args = self;
+    sep = ", ";
+  }
+  
+  const s_node_t *arg = node->proc.arg;
+  for (int i = 0; i < fn->num_arg; i++) {
+    if (!arg) {
+      c_error(node->proc.left_bracket, "too few arguments to function '%h'", node);
+      return NULL;
+    }
+    
+    emit_type_t arg_type;
+    char *arg_expr = emit_expr(e, arg->arg.body, &arg_type);
+    if (!arg_expr)
+      return NULL;
+    
+    char *cast = emit_cast(e, arg_expr, &arg_type, &fn->arg_type[i]);
+    if (!cast) {
+      c_error(
+        emit_lexeme(arg->arg.body),
+        "expected '%s' but argument is of type '%s'",
+        emit_type_name(e, &fn->arg_type[i]),
+        emit_type_name(e, &arg_type));
+      return NULL;
+    }
+    
+    if (emit_order(arg->arg.body, arg->arg.next))
+      cast = emit_spill(e, &fn->arg_type[i], cast);
+    
+    args = emit_str(e, "%s%s%s", args, sep, cast);
+    sep = ", ";
+    
+    arg = arg->arg.next;
+  }
+  
+  if (arg) {
+    c_error(node->proc.left_bracket, "too many arguments to function '%h'", node);
+    return NULL;
+  }
+  
+  *type = fn->type;
+  
+  // a struct which is used is held in a temporary, so that it can be updated
+  // in place like any other
+  if (value && emit_type_struct(type))
+    return emit_spill(e, type, emit_str(e, "%s(%s)", fn->name, args));
+  
+  return emit_str(e, "%s(%s)", fn->name, args);
+}
+
+static char *emit_array_init(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  emit_type_t elem;
+  if (!emit_type(e, &elem, node->array_init.type))
+    return NULL;
+  
+  *type = elem;
+  type->arr = true;
+  
+  const char *ctype = emit_ctype(e, &elem);
+  
+  if (node->array_init.init) {
+    int num_arg = 0;
+    const s_node_t *head = node->array_init.init;
+    while (head) {
+      num_arg++;
+      head = head->arg.next;
+    }
+    
+    char *array = emit_spill(e, type, emit_str(e, "heap_alloc(%i * sizeof(%s))", num_arg, ctype));
+    
+    head = node->array_init.init;
+    for (int i = 0; i < num_arg; i++) {
+      emit_type_t arg_type;
+      char *arg = emit_expr(e, head->arg.body, &arg_type);
+      if (!arg)
+        return NULL;
+      
+      if (!emit_type_cmp(&arg_type, &elem)) {
+        c_error(
+          node->array_init.array_init,
+          "incompatible types when initializing array type '%s' with '%s' at '%h'",
+          emit_type_name(e, &elem),
+          emit_type_name(e, &arg_type),
+          head->arg.body);
+        return NULL;
+      }
+      
+      emit_line(e, "((%s%s*) %s->block)[%i] = %s;", ctype, ctype[strlen(ctype) - 1] == '*' ? "" : " ", array, i, arg);
+      
+      head = head->arg.next;
+    }
+    
+    return array;
+  }
+  
+  if (node->array_init.size && node->array_init.size->node_type == S_ARG)
+    return emit_grid_init(e, node, type);
+  
+  emit_type_t size_type;
+  char *size = emit_expr(e, node->array_init.size, &size_type);
+  if (!size)
+    return NULL;
+  
+  if (!emit_type_cmp(&size_type, &emit_i32)) {
+    c_error(
+      node->array_init.array_init,
+      "size of array has non-integer type");
+    return NULL;
+  }
+  
+  return emit_str(e, "heap_alloc(%s * sizeof(%s))", size, ctype);
+}
+
+static char *emit_grid_init(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  emit_type_t elem = *type;
+  elem.arr = false;
+  
+  char *extent_list = "";
+  type->dim = 0;
+  
+  for (const s_node_t *head = node->array_init.size; head; head = head->arg.next) {
+    if (type->dim == GRID_DIM) {
+      c_error(node->array_init.array_init, "array has more than %i dimensions", GRID_DIM);
+      return NULL;
+    }
+    
+    emit_type_t size_type;
+    char *size = emit_expr(e, head->arg.body, &size_type);
+    if (!size)
+      return NULL;
+    
+    if (!emit_type_cmp(&size_type, &emit_i32)) {
+      c_error(
+        node->array_init.array_init,
+        "size of array has non-integer type");
+      return NULL;
+    }
+    
+    if (emit_order(head->arg.body, head->arg.next))
+      size = emit_spill(e, &emit_i32, size);
+    
+    extent_list = emit_str(e, "%s%s%s", extent_list, *extent_list ? ", " : "", size);
+    type->dim++;
+  }
+  
+  return emit_str(
+    e,
+    "rt_grid((int[]) { %s }, %i, sizeof(%s), %s)",
+    extent_list,
+    type->dim,
+    emit_ctype(e, &elem),
+    emit_msg(e, node->array_init.array_init, "size of array out of range"));
+}
+
+static char *emit_post_op(emit_t *e, const s_node_t *node, emit_type_t *type)
+{
+  char *lhs = emit_lvalue(e, node->post_op.lhs, type);
+  if (!lhs)
+    return NULL;
+  
+  if (!emit_type_num(type)) {
+    c_error(
+      node->post_op.op,
+      "unknown postfix operand type for '%t': '%s'",
+      node->post_op.op->token,
+      emit_type_name(e, type));
+    return NULL;
+  }
+  
+  return emit_str(e, "(%s%s)", lhs, node->post_op.op->token == TK_INC ? "++" : "--");
+}
+
+// 'new' on a struct_def takes a value for each field, in the order they are
+// declared
+static char *emit_struct_new(emit_t *e, const s_node_t *node, const emit_class_t *class, emit_type_t *type)
+{
+  *type = (emit_type_t) { SPEC_STRUCT, false, class };
+  
+  char *fields = "";
+  const char *sep = "";
+  
+  const s_node_t *arg = node->proc.arg;
+  
+  const s_node_t *head = class->node->class_def.class_decl;
+  while (head) {
+    if (head->stmt.body->node_type != S_DECL) {
+      head = head->stmt.next;
+      continue;
+    }
+    
+    if (!arg) {
+      c_error(node->proc.left_bracket, "too few arguments to function '%h'", node);
+      return NULL;
+    }
+    
+    const emit_var_t *var = map_get(&class->map_var, head->stmt.body->decl.ident->data.ident);
+    
+    emit_type_t arg_type;
+    char *arg_expr = emit_expr(e, arg->arg.body, &arg_type);
+    if (!arg_expr)
+      return NULL;
+    
+    char *cast = emit_cast(e, arg_expr, &arg_type, &var->type);
+    if (!cast) {
+      c_error(
+        node->proc.left_bracket,
+        "expected '%s' but argument is of type '%s'",
+        emit_type_name(e, &var->type),
+        emit_type_name(e, &arg_type));
+      return NULL;
+    }
+    
+    if (emit_order(arg->arg.body, arg->arg.next))
+      cast = emit_spill(e, &var->type, cast);
+    
+    fields = emit_str(e, "%s%s%s", fields, sep, cast);
+    sep = ", ";
+    
+    arg = arg->arg.next;
+    head = head->stmt.next;
+  }
+  
+  if (arg) {
+    c_error(node->proc.left_bracket, "too many arguments to function '%h'", node);
+    return NULL;
+  }
+  
+  return emit_str(e, "((%s) { %s })", emit_ctype(e, type), fields);
+}
+
+// the operators of a vector, as the interpreter takes them, or NULL
+static char *emit_vec_binop(emit_t *e, int op, char *lhs, const emit_type_t *lhs_type, char *rhs, const emit_type_t *rhs_type, emit_type_t *type)
+{
+  if (emit_type_vec(lhs_type) && emit_type_struct(rhs_type)) {
+    const emit_class_t *class = lhs_type->class;
+    const char *name = class->ident->data.ident;
+    
+    if ((op == '+' || op == '-') && emit_type_cmp(lhs_type, rhs_type)) {
+      *type = *lhs_type;
+      return emit_str(e, "struct_%s_%s(%s, %s)", name, op == '+' ? "add" : "sub", lhs, rhs);
+    }
+    
+    if (op != '*' || !class->col)
+      return NULL;
+    
+    if (rhs_type->class == class->col) {
+      *type = *rhs_type;
+      return emit_str(e, "struct_%s_mat(%s, %s)", name, lhs, rhs);
+    } else if (emit_type_cmp(lhs_type, rhs_type)) {
+      *type = *lhs_type;
+      return emit_str(e, "struct_%s_mat_mat(%s, %s)", name, lhs, rhs);
+    }
+  } else if (emit_type_vec(lhs_type)) {
+    if ((op != '*' && op != '/') || !emit_type_num(rhs_type))
+      return NULL;
+    
+    *type = *lhs_type;
+    return emit_str(
+      e,
+      "struct_%s_%s(%s, %s)",
+      lhs_type->class->ident->data.ident,
+      op == '*' ? "mul" : "div",
+      lhs,
+      emit_cast(e, rhs, rhs_type, &emit_f32));
+  } else if (emit_type_vec(rhs_type)) {
+    if (op != '*' || !emit_type_num(lhs_type))
+      return NULL;
+    
+    *type = *rhs_type;
+    return emit_str(
+      e,
+      "struct_%s_mul(%s, %s)",
+      rhs_type->class->ident->data.ident,
+      rhs,
+      emit_cast(e, lhs, lhs_type, &emit_f32));
+  }
+  
+  return NULL;
+}
+
+static char *emit_vec_method(emit_t *e, const s_node_t *node, const emit_type_t *self_type, char *self, emit_type_t *type)
+{
+  static const struct {
+    const char  *ident;
+    const char  *arg;
+  } vec_method[] = {
+    // 'v' is the type of the vector called on, 'f' an f32, 'm' either 'v' or
+    // its column
+    { "dot",        "v" },
+    { "length",     "" },
+    { "normalize",  "" },
+    { "lerp",       "vf" },
+    { "cross",      "v" },
+    { "mul",        "m" },
+    { "copy",       "" },
+    
+    // the methods vec2 had as a class, which update it in place
+    { "add",        "v" },
+    { "sub",        "v" },
+    { "mulf",       "f" }
+  };
+  
+  const s_node_t *self_node = node->proc.base->direct.base;
+  const lexeme_t *child_ident = node->proc.base->direct.child_ident;
+  const char *ident = child_ident->data.ident;
+  const char *name = self_type->class->ident->data.ident;
+  
+  int method = 0;
+  while (method < (int) (sizeof(vec_method) / sizeof(vec_method[0])) && strcmp(vec_method[method].ident, ident) != 0)
+    method++;
+  
+  if (method == sizeof(vec_method) / sizeof(vec_method[0])) {
+    c_error(child_ident, "'struct %s' has no member named '%s'", name, ident);
+    return NULL;
+  }
+  
+  const char *want = vec_method[method].arg;
+  bool update = method >= 7;
+  
+  if (update && self_node->node_type == S_BINOP && emit_assign_op(self_node->binop.op->token)) {
+    c_error(child_ident, "updating an assignment in place is not supported by --emit-c");
+    return NULL;
+  }
+  
+  // the vector updated is found before the args are evaluated, and one in
+  // an array again after them
+  bool order = emit_order(self_node, node->proc.arg);
+  bool held = update && order && e->hold_block;
+  
+  if (order)
+    self = update ? emit_hold(e, self_type, self) : emit_spill(e, self_type, self);
+  
+  if (update)
+    self = emit_str(e, "&%s", self);
+  
+  int num_arg = 0;
+  for (const s_node_t *head = node->proc.arg; head; head = head->arg.next)
+    num_arg++;
+  
+  if (num_arg != (int) strlen(want)) {
+    c_error(
+      node->proc.left_bracket,
+      "too %s arguments to function '%h'",
+      num_arg < (int) strlen(want) ? "few" : "many",
+      node);
+    return NULL;
+  }
+  
+  char *arg[2];
+  emit_type_t arg_type[2];
+  
+  const s_node_t *head = node->proc.arg;
+  for (int i = 0; i < num_arg; i++) {
+    emit_type_t value_type;
+    char *value = emit_expr(e, head->arg.body, &value_type);
+    if (!value)
+      return NULL;
+    
+    arg_type[i] = *self_type;
+    if (want[i] == 'f')
+      arg_type[i] = emit_f32;
+    else if (want[i] == 'm' && emit_type_struct(&value_type) && value_type.class == self_type->class->col)
+      arg_type[i] = value_type;
+    
+    arg[i] = emit_cast(e, value, &value_type, &arg_type[i]);
+    if (!arg[i]) {
+      c_error(
+        node->proc.left_bracket,
+        "expected '%s' but argument is of type '%s'",
+        emit_type_name(e, &arg_type[i]),
+        emit_type_name(e, &value_type));
+      return NULL;
+    }
+    
+    if (held || emit_order(head->arg.body, head->arg.next))
+      arg[i] = emit_spill(e, &arg_type[i], arg[i]);
+    
+    head = head->arg.next;
+  }
+  
+  *type = *self_type;
+  
+  if (strcmp(ident, "dot") == 0 || strcmp(ident, "length") == 0) {
+    *type = emit_f32;
+    return emit_str(e, "struct_%s_%s(%s%s%s)", name, ident, self, num_arg ? ", " : "", num_arg ? arg[0] : "");
+  } else if (strcmp(ident, "normalize") == 0) {
+    return emit_spill(e, type, emit_str(e, "struct_%s_normalize(%s)", name, self));
+  } else if (strcmp(ident, "lerp") == 0) {
+    return emit_spill(e, type, emit_str(e, "struct_%s_lerp(%s, %s, %s)", name, self, arg[0], arg[1]));
+  } else if (strcmp(ident, "cross") == 0) {
+    if (self_type->class->num_f32 != 3) {
+      c_error(child_ident, "cross product of 'struct %s', which is not 3 f32s", name);
+      return NULL;
+    }
+    
+    return emit_spill(e, type, emit_str(e, "struct_%s_cross(%s, %s)", name, self, arg[0]));
+  } else if (strcmp(ident, "mul") == 0) {
+    char *mul = emit_vec_binop(e, '*', self, self_type, arg[0], &arg_type[0], type);
+    if (!mul) {
+      c_error(
+        child_ident,
+        "cannot multiply '%s' by '%s'",
+        emit_type_name(e, self_type),
+        emit_type_name(e, &arg_type[0]));
+      return NULL;
+    }
+    
+    return emit_spill(e, type, mul);
+  } else if (strcmp(ident, "copy") == 0) {
+    return emit_spill(e, type, self);
+  }
+  
+  return emit_str(e, "(*struct_%s_%s_in(%s, %s))", name, strcmp(ident, "mulf") == 0 ? "mul" : ident, self, arg[0]);
+}
+
+static char *emit_array_method(emit_t *e, const s_node_t *node, const emit_type_t *self_type, char *self, emit_type_t *type, bool value)
+{
+  static const struct {
+    const char  *ident;
+    const char  *arg;
+  } array_method[] = {
+    // 'e' is an element, 'i' an i32, 's' a string
+    { "push",     "e" },
+    { "pop",      "" },
+    { "insert",   "ie" },
+    { "remove",   "i" },
+    { "reserve",  "i" },
+    { "resize",   "i" },
+    { "sort_by",  "s" },
+    { "slice",    "ii" }
+  };
+  
+  const s_node_t *self_node = node->proc.base->direct.base;
+  const lexeme_t *child_ident = node->proc.base->direct.child_ident;
+  const char *ident = child_ident->data.ident;
+  
+  int method = 0;
+  while (method < (int) (sizeof(array_method) / sizeof(array_method[0])) && strcmp(array_method[method].ident, ident) != 0)
+    method++;
+  
+  if (method == sizeof(array_method) / sizeof(array_method[0])) {
+    c_error(child_ident, "request for unknown member '%s' in array", ident);
+    return NULL;
+  }
+  
+  if (self_type->dim) {
+    c_error(child_ident, "'%s' on array '%h' of more than one dimension", ident, self_node);
+    return NULL;
+  }
+  
+  const char *want = array_method[method].arg;
+  
+  // the array is checked before the args are evaluated
+  self = emit_spill(
+    e,
+    self_type,
+    emit_str(
+      e,
+      "rt_class(%s, %s)",
+      self,
+      emit_msg(e, child_ident, "call to '%s' on uninitialised array '%h'", ident, self_node)));
+  
+  int num_arg = 0;
+  for (const s_node_t *head = node->proc.arg; head; head = head->arg.next)
+    num_arg++;
+  
+  if (num_arg != (int) strlen(want)) {
+    c_error(
+      node->proc.left_bracket,
+      "too %s arguments to function '%h'",
+      num_arg < (int) strlen(want) ? "few" : "many",
+      node);
+    return NULL;
+  }
+  
+  emit_type_t elem = *self_type;
+  elem.arr = false;
+  elem.dim = 0;
+  
+  const char *ctype = emit_ctype(e, &elem);
+  const char *space = ctype[strlen(ctype) - 1] == '*' ? "" : " ";
+  
+  if (strcmp(ident, "sort_by") == 0) {
+    *type = emit_none;
+    return emit_sort_by(e, node, &elem, self);
+  }
+  
+  // an arg may read the array, so it is taken before the array changes
+  char *arg[2];
+  
+  const s_node_t *head = node->proc.arg;
+  for (int i = 0; i < num_arg; i++) {
+    emit_type_t value_type;
+    char *value = emit_expr(e, head->arg.body, &value_type);
+    if (!value)
+      return NULL;
+    
+    const emit_type_t *arg_type = want[i] == 'i' ? &emit_i32 : &elem;
+    
+    arg[i] = emit_cast(e, value, &value_type, arg_type);
+    if (!arg[i]) {
+      c_error(
+        node->proc.left_bracket,
+        "expected '%s' but argument is of type '%s'",
+        emit_type_name(e, arg_type),
+        emit_type_name(e, &value_type));
+      return NULL;
+    }
+    
+    if (!emit_literal(head->arg.body))
+      arg[i] = emit_spill(e, arg_type, arg[i]);
+    
+    head = head->arg.next;
+  }
+  
+  *type = emit_none;
+  
+  char *err_bounds = emit_msg(e, node->proc.left_bracket, "index out of bounds '%h'", node);
+  char *err_size = emit_msg(e, node->proc.left_bracket, "size of array out of range '%h'", node);
+  
+  if (strcmp(ident, "push") == 0) {
+    return emit_str(
+      e,
+      "(*(%s%s*) rt_insert(%s, rt_length(%s, sizeof(%s)), sizeof(%s), NULL) = %s)",
+      ctype, space, self, self, ctype, ctype, arg[0]);
+  } else if (strcmp(ident, "pop") == 0) {
+    char *pop = emit_str(
+      e,
+      "(*(%s%s*) rt_pop(%s, sizeof(%s), %s))",
+      ctype, space, self, ctype,
+      emit_msg(e, child_ident, "pop from empty array '%h'", self_node));
+    
+    if (!value)
+      return pop;
+    
+    *type = elem;
+    return emit_spill(e, type, pop);
+  } else if (strcmp(ident, "insert") == 0) {
+    return emit_str(
+      e,
+      "(*(%s%s*) rt_insert(%s, %s, sizeof(%s), %s) = %s)",
+      ctype, space, self, arg[0], ctype, err_bounds, arg[1]);
+  } else if (strcmp(ident, "remove") == 0) {
+    return emit_str(e, "rt_remove(%s, %s, sizeof(%s), %s)", self, arg[0], ctype, err_bounds);
+  } else if (strcmp(ident, "slice") == 0) {
+    *type = *self_type;
+    return emit_str(e, "rt_slice(%s, %s, %s, sizeof(%s), %s)", self, arg[0], arg[1], ctype, err_bounds);
+  }
+  
+  return emit_str(
+    e,
+    "rt_resize(%s, %s, sizeof(%s), %s, %s)",
+    self, arg[0], ctype, strcmp(ident, "reserve") == 0 ? "true" : "false", err_size);
+}
+
+// the field is found by its offset in the element, so it has to be named by
+// a literal
+static char *emit_sort_by(emit_t *e, const s_node_t *node, const emit_type_t *elem, char *self)
+{
+  const s_node_t *arg = node->proc.arg->arg.body;
+  if (arg->node_type != S_CONSTANT || arg->constant.lexeme->token != TK_STRING_LITERAL) {
+    c_error(node->proc.left_bracket, "'sort_by' on a field not named by a literal is not supported by --emit-c");
+    return NULL;
+  }
+  
+  const char *field = arg->constant.lexeme->data.string_literal;
+  bool ref = elem->spec == SPEC_CLASS && !elem->arr;
+  
+  emit_var_t *var = ref || emit_type_struct(elem) ? map_get(&elem->class->map_var, field) : NULL;
+  if (!var || !emit_type_num(&var->type)) {
+    c_error(node->proc.left_bracket, "'%s' is not an i32 or f32 field of '%s'", field, emit_type_name(e, elem));
+    return NULL;
+  }
+  
+  return emit_str(
+    e,
+    "rt_sort_by(%s, sizeof(%s), offsetof(%s, v_%s), %s, %s, %s)",
+    self,
+    emit_ctype(e, elem),
+    ref ? emit_str(e, "class_%s", elem->class->ident->data.ident) : emit_ctype(e, elem),
+    field,
+    emit_type_cmp(&var->type, &emit_f32) ? "true" : "false",
+    ref ? "true" : "false",
+    emit_msg(
+      e,
+      node->proc.base->direct.child_ident,
+      "sort_by on array '%h' with an uninitialised class",
+      node->proc.base->direct.base));
+}
+
+static char *emit_cast(emit_t *e, char *expr, const emit_type_t *from, const emit_type_t *to)
+{
+  if (emit_type_cmp(from, to))
+    return expr;
+  
+  if (emit_type_cmp(from, &emit_i32) && emit_type_cmp(to, &emit_f32))
+    return emit_str(e, "((float) %s)", expr);
+  
+  if (emit_type_cmp(from, &emit_f32) && emit_type_cmp(to, &emit_i32))
+    return emit_str(e, "((int) %s)", expr);
+  
+  return NULL;
+}
+
+static char *emit_spill(emit_t *e, const emit_type_t *type, char *expr)
+{
+  char *tmp = emit_str(e, "t%i", e->num_tmp++);
+  emit_line(e, "%s = %s;", emit_cdecl(e, type, tmp), expr);
+  return tmp;
+}
+
+// an lvalue kept while the operands after it are evaluated. one in an array
+// is kept by its offset, as a call can grow the array and move its elements.
+static char *emit_hold(emit_t *e, const emit_type_t *type, char *lvalue)
+{
+  char *addr = emit_str(e, "t%i", e->num_tmp++);
+  
+  if (!e->hold_block) {
+    emit_line(e, "%s = &%s;", emit_cdecl(e, type, emit_str(e, "*%s", addr)), lvalue);
+    return emit_str(e, "(*%s)", addr);
+  }
+  
+  const char *ctype = emit_ctype(e, type);
+  
+  emit_line(e, "int %s = (char *) &%s - %s->block;", addr, lvalue, e->hold_block);
+  
+  return emit_str(
+    e,
+    "(*(%s%s*) &%s->block[%s])",
+    ctype,
+    ctype[strlen(ctype) - 1] == '*' ? "" : " ",
+    e->hold_block,
+    addr);
+}
+
+// whether 'node' has to be evaluated into a temporary to keep it ahead of
+// the operands after it, C leaves the order open
+static bool emit_order(const s_node_t *node, const s_node_t *next)
+{
+  if (emit_literal(node))
+    return false;
+  
+  while (next) {
+    const s_node_t *body = next->node_type == S_ARG ? next->arg.body : next;
+    
+    if (!emit_literal(body) && (!emit_pure(node) || !emit_pure(body)))
+      return true;
+    
+    next = next->node_type == S_ARG ? next->arg.next : NULL;
+  }
+  
+  return false;
+}
+
+// expressions which neither write nor fail
+static bool emit_pure(const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return true;
+  case S_UNARY:
+    return emit_pure(node->unary.rhs);
+  case S_BINOP:
+    return !emit_assign_op(node->binop.op->token)
+      && emit_pure(node->binop.lhs)
+      && emit_pure(node->binop.rhs);
+  default:
+    return false;
+  }
+}
+
+static bool emit_literal(const s_node_t *node)
+{
+  return node->node_type == S_CONSTANT && node->constant.lexeme->token != TK_IDENTIFIER;
+}
+
+static bool emit_type(emit_t *e, emit_type_t *type, const s_node_t *node)
+{
+  type->class = NULL;
+  switch (node->type.spec->token) {
+  case TK_I32:
+    type->spec = SPEC_I32;
+    break;
+  case TK_F32:
+    type->spec = SPEC_F32;
+    break;
+  case TK_STRING:
+    type->spec = SPEC_STRING;
+    break;
+  case TK_CLASS:
+  case TK_STRUCT:
+    type->spec = node->type.spec->token == TK_CLASS ? SPEC_CLASS : SPEC_STRUCT;
+    
+    type->class = map_get(&e->map_class, node->type.class_ident->data.ident);
+    if (!type->class) {
+      c_error(
+        node->type.class_ident,
+        "use of undefined %s '%s'",
+        type->spec == SPEC_CLASS ? "class" : "struct",
+        node->type.class_ident->data.ident);
+      return false;
+    }
+    
+    if (type->spec == SPEC_CLASS && type->class->value)
+      type->spec = SPEC_STRUCT;
+    
+    if (type->class->value != (type->spec == SPEC_STRUCT)) {
+      c_error(
+        node->type.class_ident,
+        "'%s' is not a %s",
+        node->type.class_ident->data.ident,
+        type->spec == SPEC_CLASS ? "class" : "struct");
+      return false;
+    }
+    
+    break;
+  case TK_SOA:
+    c_error(node->type.class_ident, "soa '%s' is not supported by --emit-c", node->type.class_ident->data.ident);
+    return false;
+  case TK_MAP:
+  case TK_MAP_INIT:
+    c_error(node->type.spec, "map is not supported by --emit-c");
+    return false;
+  default:
+    return false;
+  }
+  
+  type->arr = node->type.left_bracket != NULL;
+  type->dim = node->type.dim;
+  
+  if (type->dim > GRID_DIM) {
+    c_error(node->type.left_bracket, "array has more than %i dimensions", GRID_DIM);
+    return false;
+  }
+  
+  return true;
+}
+
+static bool emit_type_cmp(const emit_type_t *a, const emit_type_t *b)
+{
+  return a->spec == b->spec && a->arr == b->arr && a->class == b->class && a->dim == b->dim;
+}
+
+static bool emit_type_num(const emit_type_t *type)
+{
+  return emit_type_cmp(type, &emit_i32) || emit_type_cmp(type, &emit_f32);
+}
+
+static bool emit_type_struct(const emit_type_t *type)
+{
+  return type->spec == SPEC_STRUCT && !type->arr;
+}
+
+static bool emit_type_vec(const emit_type_t *type)
+{
+  return emit_type_struct(type) && type->class->num_f32;
+}
+
+// the value a var holds before it is assigned
+static char *emit_zero(emit_t *e, const emit_type_t *type)
+{
+  if (emit_type_num(type))
+    return "0";
+  
+  if (emit_type_struct(type))
+    return emit_str(e, "(%s) {0}", emit_ctype(e, type));
+  
+  return "NULL";
+}
+
+static const char *emit_type_name(emit_t *e, const emit_type_t *type)
+{
+  const char *str_spec_table[] = {
+    "none",
+    "i32",
+    "f32",
+    "class",
+    "fn",
+    "string",
+    "struct",
+    "soa"
+  };
+  
+  const char *name = str_spec_table[type->spec];
+  
+  if (type->spec == SPEC_CLASS || type->spec == SPEC_STRUCT)
+    name = emit_str(e, "%s %s", name, type->class->ident->data.ident);
+  
+  if (type->dim)
+    name = emit_str(e, "%s[%s]", name, type->dim == 3 ? ",," : ",");
+  else if (type->arr)
+    name = emit_str(e, "%s[]", name);
+  
+  return name;
+}
+
+static const char *emit_ctype(emit_t *e, const emit_type_t *type)
+{
+  if (emit_type_cmp(type, &emit_i32))
+    return "int";
+  
+  if (emit_type_cmp(type, &emit_f32))
+    return "float";
+  
+  if (emit_type_struct(type))
+    return emit_str(e, "struct_%s", type->class->ident->data.ident);
+  
+  return "heap_block_t *";
+}
+
+static const char *emit_cdecl(emit_t *e, const emit_type_t *type, const char *name)
+{
+  const char *ctype = emit_ctype(e, type);
+  
+  if (ctype[strlen(ctype) - 1] == '*')
+    return emit_str(e, "%s%s", ctype, name);
+  
+  return emit_str(e, "%s %s", ctype, name);
+}
+
+static emit_var_t *emit_find(emit_t *e, const char *ident)
+{
+  for (int i = e->num_var - 1; i >= 0; i--) {
+    if (strcmp(e->var[i].ident, ident) == 0)
+      return &e->var[i];
+  }
+  
+  return NULL;
+}
+
+static emit_var_t *emit_add(emit_t *e, const emit_type_t *type, const char *ident)
+{
+  emit_var_t *var = emit_find(e, ident);
+  if (var && var->block == e->block)
+    return NULL;
+  
+  if (e->num_var == EMIT_MAX_VAR) {
+    LOG_ERROR("ran out of vars %i/%i", e->num_var, EMIT_MAX_VAR);
+    return NULL;
+  }
+  
+  var = &e->var[e->num_var++];
+  var->ident = ident;
+  var->type = *type;
+  var->block = e->block;
+  
+  return var;
+}
+
+static const lexeme_t *emit_lexeme(const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return node->constant.lexeme;
+  case S_BINOP:
+    return node->binop.op;
+  case S_UNARY:
+    return node->unary.op;
+  case S_INDEX:
+    return node->index.left_bracket;
+  case S_DIRECT:
+    return node->direct.child_ident;
+  case S_PROC:
+    return node->proc.left_bracket;
+  case S_NEW:
+    return node->new.class_ident;
+  case S_ARRAY_INIT:
+    return node->array_init.array_init;
+  case S_POST_OP:
+    return node->post_op.op;
+  default:
+    return NULL;
+  }
+}
+
+static void emit_line(emit_t *e, const char *fmt, ...)
+{
+  if (*fmt)
+    fprintf(e->out, "%*s", e->indent * 2, "");
+  
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(e->out, fmt, args);
+  va_end(args);
+  
+  fputc('\n', e->out);
+}
+
+// strings live until emit_c() returns
+static char *emit_str(emit_t *e, const char *fmt, ...)
+{
+  va_list args;
+  
+  va_start(args, fmt);
+  int len = vsnprintf(NULL, 0, fmt, args);
+  va_end(args);
+  
+  emit_str_t *str = ZONE_ALLOC(sizeof(emit_str_t) + len + 1);
+  
+  va_start(args, fmt);
+  vsnprintf(str->data, len + 1, fmt, args);
+  va_end(args);
+  
+  str->next = e->str_list;
+  e->str_list = str;
+  
+  return str->data;
+}
+
+// a runtime error message as it would be reported by c_error(), quoted as a
+// C string
+static char *emit_msg(emit_t *e, const lexeme_t *lexeme, const char *fmt, ...)
+{
+  char *buf = NULL;
+  size_t len = 0;
+  FILE *out = open_memstream(&buf, &len);
+  
+  fprintf(out, "%s:%i:error: ", lexeme->src, lexeme->line);
+  
+  va_list args;
+  va_start(args, fmt);
+  c_vfprint(out, fmt, args);
+  va_end(args);
+  
+  fclose(out);
+  
+  char *msg = "";
+  for (const char *c = buf; *c; c++) {
+    if (*c == '"' || *c == '\\')
+      msg = emit_str(e, "%s\\%c", msg, *c);
+    else
+      msg = emit_str(e, "%s%c", msg, *c);
+  }
+  
+  free(buf);
+  
+  return emit_str(e, "\"%s\"", msg);
+}
+
+static void _class_free(void *block)
+{
+  emit_class_t *class = block;
+  map_flush(&class->map_var, _free);
+  map_flush(&class->map_fn, _free);
+  ZONE_FREE(class);
+}
+
+static void _free(void *block)
+{
+  ZONE_FREE(block);
+}
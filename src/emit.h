@@ -0,0 +1,10 @@
+#ifndef EMIT_H
+#define EMIT_H
+
+#include "syntax.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+extern bool emit_c(FILE *out, s_node_t *node, const char *src);
+
+#endif
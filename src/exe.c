@@ -0,0 +1,2543 @@
+#include "jit_local.h"
+
+#include "vec.h"
+#include "zone.h"
+#include <limits.h>
+#include <math.h>
+#include <setjmp.h>
+
+#define EXE_MAX_VAR 256
+
+// statements return how control leaves them
+typedef enum {
+  EXE_NEXT,
+  EXE_BREAK,
+  EXE_CONTINUE,
+  EXE_RET,
+  EXE_TAIL,
+  EXE_CALL
+} exe_status_t;
+
+typedef struct exe_node_s exe_node_t;
+
+// 'size' is the number of slots in the frame, callees get the frame after it
+typedef struct {
+  jit_slot_t  *frame;
+  scope_t     *scope;
+  int         size;
+} exe_ctx_t;
+
+// every node is evaluated through the function picked for its operator and
+// operand types when it was built, statements return an exe_status_t
+typedef jit_slot_t (*exe_eval_t)(const exe_node_t *x, exe_ctx_t *c);
+
+struct exe_node_s {
+  exe_eval_t        eval;
+  
+  exe_node_t        *a;
+  exe_node_t        *b;
+  exe_node_t        *c;
+  exe_node_t        *next;
+  
+  int               slot;
+  int               size;
+  jit_slot_t        imm;
+  fn_t              *fn;
+  jit_site_t        *site;
+  const s_node_t    *node;
+  
+  exe_node_t        *link;
+};
+
+typedef struct exe_fn_s {
+  exe_node_t        *body;
+  int               frame;
+  struct exe_fn_s   *next;
+} exe_fn_t;
+
+typedef struct {
+  const char  *ident;
+  type_t      type;
+  int         slot;
+  int         block;
+} exe_var_t;
+
+typedef struct {
+  fn_t          *fn;
+  const scope_t *scope;
+  
+  exe_var_t     var[EXE_MAX_VAR];
+  int           num_var;
+  int           num_slot;
+  int           frame;
+  int           block;
+  
+  // struct values are held after the locals' slots, which point at them
+  int           size;
+  
+  int           loop;
+  
+  // the code being built runs while an address in an array's block is held,
+  // so it can not call script functions or grow arrays
+  int           hold;
+} exe_t;
+
+static jmp_buf    *exe_jmp = NULL;
+static exe_node_t *exe_node_list = NULL;
+static exe_fn_t   *exe_fn_list = NULL;
+
+static int        exe_enter(const exe_fn_t *exe_fn, jit_slot_t *frame, scope_t *scope);
+static void       exe_fail();
+static jit_slot_t exe_run_param_struct(const exe_node_t *x, exe_ctx_t *c);
+
+static exe_node_t *exe_body(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_body_scope(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_stmt(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_decl(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_print_stmt(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_if_stmt(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_while_stmt(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_for_stmt(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_loop(exe_t *e, const s_node_t *cond, const s_node_t *inc, const s_node_t *body);
+static exe_node_t *exe_ret_stmt(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_ret_tail(exe_t *e, const s_node_t *node, fn_t *callee);
+static exe_node_t *exe_ctrl_stmt(exe_t *e, const s_node_t *node);
+
+static exe_node_t *exe_cond(exe_t *e, const s_node_t *node);
+static exe_node_t *exe_expr(exe_t *e, const s_node_t *node, type_t *type);
+static exe_node_t *exe_lvalue(exe_t *e, const s_node_t *node, type_t *type);
+static exe_node_t *exe_constant(exe_t *e, const s_node_t *node, type_t *type);
+static exe_node_t *exe_unary(exe_t *e, const s_node_t *node, type_t *type);
+static exe_node_t *exe_binop(exe_t *e, const s_node_t *node, type_t *type);
+static exe_node_t *exe_assign(exe_t *e, const s_node_t *node, type_t *type);
+static exe_node_t *exe_index(exe_t *e, const s_node_t *node, type_t *type, bool lvalue);
+static exe_node_t *exe_direct(exe_t *e, const s_node_t *node, type_t *type, bool lvalue);
+static exe_node_t *exe_proc(exe_t *e, const s_node_t *node, type_t *type, bool value);
+static exe_node_t *exe_array_init(exe_t *e, const s_node_t *node, type_t *type);
+static exe_node_t *exe_post_op(exe_t *e, const s_node_t *node, type_t *type);
+static exe_node_t *exe_struct_new(exe_t *e, const s_node_t *node, const scope_t *class, type_t *type);
+static exe_node_t *exe_vec_binop(exe_t *e, int op, exe_node_t *lhs, const type_t *lhs_type, exe_node_t *rhs, const type_t *rhs_type, type_t *type);
+static exe_node_t *exe_vec_method(exe_t *e, const s_node_t *node, exe_node_t *self, const type_t *self_type, type_t *type);
+static exe_node_t *exe_array_method(exe_t *e, const s_node_t *node, exe_node_t *self, const type_t *self_type, type_t *type, bool value);
+
+static exe_node_t *exe_cast(exe_t *e, exe_node_t *x, const type_t *from, const type_t *to);
+static exe_node_t *exe_new(exe_eval_t eval);
+static bool       exe_type(const scope_t *scope, type_t *type, const s_node_t *node);
+static bool       exe_param(const scope_t *scope, const fn_t *fn, type_t *arg_type, int *num_arg);
+static int        exe_struct_slot(exe_t *e, const type_t *type);
+static exe_var_t  *exe_find(exe_t *e, const char *ident);
+static exe_var_t  *exe_add(exe_t *e, const type_t *type, const char *ident);
+
+static bool type_num(const type_t *type)
+{
+  return type_cmp(type, &type_i32) || type_cmp(type, &type_f32);
+}
+
+// structs and soa elements are held in place and used by their address
+static bool type_addr(const type_t *type)
+{
+  return type_struct(type) || type_soa(type);
+}
+
+// build the closure tree of a function. the same functions are accepted as
+// by the native compiler so either can run them, except those holding struct
+// values, which are only kept in the frames of closures.
+bool exe_compile(fn_t *fn)
+{
+  exe_t e = {0};
+  
+  e.fn = fn;
+  e.scope = fn->scope_class ? fn->scope_parent->scope_find : fn->scope_parent;
+  
+  if (!e.scope || e.scope->scope_find)
+    return false;
+  
+  type_t arg_type[JIT_MAX_ARG];
+  int num_arg;
+  if (!exe_param(e.scope, fn, arg_type, &num_arg))
+    return false;
+  
+  e.num_slot = 1;
+  e.frame = 1 + (fn->scope_class ? 1 : 0) + num_arg + jit_count_decl(fn->node);
+  
+  if (fn->scope_class) {
+    type_t type = { .spec = SPEC_CLASS, .arr = false, .class = fn->scope_class };
+    exe_add(&e, &type, "this");
+  }
+  
+  s_node_t *head = fn->param;
+  for (int i = 0; i < num_arg; i++) {
+    if (!exe_add(&e, &arg_type[i], head->param_decl.ident->data.ident))
+      return false;
+    head = head->param_decl.next;
+  }
+  
+  exe_node_t *body = exe_body(&e, fn->node);
+  if (!body)
+    return false;
+  
+  // struct params are passed by the address of the caller's copy, they are
+  // copied into the frame before the body is run
+  for (int i = 0; i < num_arg; i++) {
+    if (!type_struct(&arg_type[i]))
+      continue;
+    
+    exe_node_t *stmt = exe_new(exe_run_param_struct);
+    stmt->slot = (fn->scope_class ? 2 : 1) + i;
+    stmt->size = exe_struct_slot(&e, &arg_type[i]);
+    stmt->imm.i32 = type_size(&arg_type[i]);
+    stmt->next = body->a;
+    body->a = stmt;
+  }
+  
+  exe_fn_t *exe_fn = ZONE_ALLOC(sizeof(exe_fn_t));
+  exe_fn->body = body;
+  exe_fn->frame = e.frame + e.size;
+  exe_fn->next = exe_fn_list;
+  exe_fn_list = exe_fn;
+  
+  fn->exe = exe_fn;
+  
+  return true;
+}
+
+// run a compiled function from outside the closure tree, errors unwind to
+// here
+int exe_call(fn_t *fn, jit_slot_t *frame, scope_t *scope)
+{
+  jmp_buf *prev = exe_jmp;
+  jmp_buf jmp;
+  
+  exe_jmp = &jmp;
+  
+  if (setjmp(jmp) != 0) {
+    exe_jmp = prev;
+    return JIT_FAIL;
+  }
+  
+  int status = exe_enter(fn->exe, frame, scope);
+  
+  exe_jmp = prev;
+  
+  return status;
+}
+
+// the closure trees are kept until the interpreter stops, functions can be
+// compiled from any of them
+void exe_stop()
+{
+  while (exe_fn_list) {
+    exe_fn_t *next = exe_fn_list->next;
+    ZONE_FREE(exe_fn_list);
+    exe_fn_list = next;
+  }
+  
+  while (exe_node_list) {
+    exe_node_t *link = exe_node_list->link;
+    ZONE_FREE(exe_node_list);
+    exe_node_list = link;
+  }
+}
+
+static int exe_enter(const exe_fn_t *exe_fn, jit_slot_t *frame, scope_t *scope)
+{
+  if (&frame[exe_fn->frame + 2 + JIT_MAX_ARG] > &jit_stack[JIT_STACK_SIZE]) {
+    jit_error(NULL, JIT_ERR_STACK);
+    exe_fail();
+  }
+  
+  exe_ctx_t c = { frame, scope, exe_fn->frame };
+  
+  jit_slot_t status;
+  do {
+    status = exe_fn->body->eval(exe_fn->body, &c);
+  } while (status.i32 == EXE_TAIL);
+  
+  if (status.i32 == EXE_CALL)
+    return JIT_TAIL;
+  
+  return status.i32 == EXE_RET ? JIT_VALUE : JIT_VOID;
+}
+
+static void exe_fail()
+{
+  longjmp(*exe_jmp, 1);
+}
+
+// statements
+
+static jit_slot_t exe_run_block(const exe_node_t *x, exe_ctx_t *c)
+{
+  for (const exe_node_t *stmt = x->a; stmt; stmt = stmt->next) {
+    jit_slot_t status = stmt->eval(stmt, c);
+    if (status.i32 != EXE_NEXT)
+      return status;
+  }
+  
+  return (jit_slot_t) { .i32 = EXE_NEXT };
+}
+
+static jit_slot_t exe_run_expr(const exe_node_t *x, exe_ctx_t *c)
+{
+  x->a->eval(x->a, c);
+  return (jit_slot_t) { .i32 = EXE_NEXT };
+}
+
+static jit_slot_t exe_run_decl(const exe_node_t *x, exe_ctx_t *c)
+{
+  c->frame[x->slot] = x->a->eval(x->a, c);
+  return (jit_slot_t) { .i32 = EXE_NEXT };
+}
+
+static jit_slot_t exe_run_decl_none(const exe_node_t *x, exe_ctx_t *c)
+{
+  c->frame[x->slot].block = NULL;
+  return (jit_slot_t) { .i32 = EXE_NEXT };
+}
+
+// a struct local's slot points at its value in the frame
+static jit_slot_t exe_run_decl_struct(const exe_node_t *x, exe_ctx_t *c)
+{
+  char *ptr = (char*) &c->frame[x->size];
+  c->frame[x->slot].ptr = ptr;
+  
+  if (x->a)
+    memmove(ptr, x->a->eval(x->a, c).ptr, x->imm.i32);
+  else
+    memset(ptr, 0, x->imm.i32);
+  
+  return (jit_slot_t) { .i32 = EXE_NEXT };
+}
+
+static jit_slot_t exe_run_param_struct(const exe_node_t *x, exe_ctx_t *c)
+{
+  char *ptr = (char*) &c->frame[x->size];
+  
+  memmove(ptr, c->frame[x->slot].ptr, x->imm.i32);
+  c->frame[x->slot].ptr = ptr;
+  
+  return (jit_slot_t) { .i32 = EXE_NEXT };
+}
+
+static jit_slot_t exe_run_print(const exe_node_t *x, exe_ctx_t *c)
+{
+  for (const exe_node_t *arg = x->a; arg; arg = arg->next)
+    jit_print(arg->site, arg->a->eval(arg->a, c).block);
+  
+  jit_print_end();
+  
+  return (jit_slot_t) { .i32 = EXE_NEXT };
+}
+
+static jit_slot_t exe_run_if(const exe_node_t *x, exe_ctx_t *c)
+{
+  if (x->a->eval(x->a, c).i32 != 0)
+    return x->b->eval(x->b, c);
+  
+  if (x->c)
+    return x->c->eval(x->c, c);
+  
+  return (jit_slot_t) { .i32 = EXE_NEXT };
+}
+
+// a continue goes on to the increment, a return or tail call leaves the
+// function
+static jit_slot_t exe_run_loop(const exe_node_t *x, exe_ctx_t *c)
+{
+  while (x->a->eval(x->a, c).i32 != 0) {
+    jit_slot_t status = x->b->eval(x->b, c);
+    if (status.i32 == EXE_BREAK)
+      break;
+    else if (status.i32 != EXE_NEXT && status.i32 != EXE_CONTINUE)
+      return status;
+    
+    if (x->c)
+      x->c->eval(x->c, c);
+  }
+  
+  return (jit_slot_t) { .i32 = EXE_NEXT };
+}
+
+static jit_slot_t exe_run_ret(const exe_node_t *x, exe_ctx_t *c)
+{
+  c->frame[0] = x->a->eval(x->a, c);
+  return (jit_slot_t) { .i32 = EXE_RET };
+}
+
+// a call to the function itself in tail position, the args are stored in
+// the params and the body is run again
+static jit_slot_t exe_run_tail(const exe_node_t *x, exe_ctx_t *c)
+{
+  jit_slot_t arg[JIT_MAX_ARG];
+  int num_arg = 0;
+  
+  for (const exe_node_t *head = x->a; head; head = head->next)
+    arg[num_arg++] = head->eval(head, c);
+  
+  memcpy(&c->frame[1], arg, num_arg * sizeof(jit_slot_t));
+  
+  return (jit_slot_t) { .i32 = EXE_TAIL };
+}
+
+// any other call in tail position is made by jit_tail_run() once the
+// function returns
+static jit_slot_t exe_run_tail_call(const exe_node_t *x, exe_ctx_t *c)
+{
+  exe_run_tail(x, c);
+  c->frame[0].site = x->site;
+  
+  return (jit_slot_t) { .i32 = EXE_CALL };
+}
+
+static jit_slot_t exe_run_break(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .i32 = EXE_BREAK };
+}
+
+static jit_slot_t exe_run_continue(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .i32 = EXE_CONTINUE };
+}
+
+// values
+
+static jit_slot_t exe_imm(const exe_node_t *x, exe_ctx_t *c)
+{
+  return x->imm;
+}
+
+static jit_slot_t exe_string(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .block = heap_alloc_string(x->imm.ptr) };
+}
+
+static jit_slot_t exe_local(const exe_node_t *x, exe_ctx_t *c)
+{
+  return c->frame[x->slot];
+}
+
+static jit_slot_t exe_global_4(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .i32 = *(int*) x->imm.ptr };
+}
+
+static jit_slot_t exe_global_8(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .block = *(heap_block_t**) x->imm.ptr };
+}
+
+static jit_slot_t exe_load_4(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .i32 = *(int*) x->a->eval(x->a, c).ptr };
+}
+
+static jit_slot_t exe_load_8(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .block = *(heap_block_t**) x->a->eval(x->a, c).ptr };
+}
+
+// addresses of assignable expressions
+
+static jit_slot_t exe_addr_local(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .ptr = (char*) &c->frame[x->slot] };
+}
+
+static jit_slot_t exe_addr_index(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = x->a->eval(x->a, c).block;
+  int index = x->b->eval(x->b, c).i32;
+  
+  if (!base) {
+    jit_error(x->node, JIT_ERR_INDEX_NULL);
+    exe_fail();
+  }
+  
+  if (index < 0 || (long) index * x->size >= base->size) {
+    jit_error(x->node, JIT_ERR_INDEX_BOUNDS);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .ptr = &base->block[index * x->size] };
+}
+
+// the indices of a T[,] or T[,,] are a list in 'b'
+static jit_slot_t exe_addr_grid(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = x->a->eval(x->a, c).block;
+  
+  int index[GRID_DIM];
+  int dim = 0;
+  for (const exe_node_t *head = x->b; head; head = head->next)
+    index[dim++] = head->eval(head, c).i32;
+  
+  if (!base) {
+    jit_error(x->node, JIT_ERR_INDEX_NULL);
+    exe_fail();
+  }
+  
+  int element = heap_grid_index(base, index, dim);
+  if (element < 0) {
+    jit_error(x->node, JIT_ERR_INDEX_BOUNDS);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .ptr = &base->block[element * x->size] };
+}
+
+static jit_slot_t exe_addr_index_soa(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = x->a->eval(x->a, c).block;
+  int index = x->b->eval(x->b, c).i32;
+  
+  if (!base) {
+    jit_error(x->node, JIT_ERR_INDEX_NULL);
+    exe_fail();
+  }
+  
+  if (index < 0 || (long) index * x->size >= base->size) {
+    jit_error(x->node, JIT_ERR_INDEX_BOUNDS);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .ptr = &base->block[soa_offset(x->size, index)] };
+}
+
+static jit_slot_t exe_addr_index_in_range(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = x->a->eval(x->a, c).block;
+  int offset = x->b->eval(x->b, c).i32 * x->size;
+  
+  return (jit_slot_t) { .ptr = &base->block[offset] };
+}
+
+static jit_slot_t exe_addr_field(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = x->a->eval(x->a, c).block;
+  
+  if (!base) {
+    jit_error(x->node, JIT_ERR_MEMBER_NULL);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .ptr = &base->block[x->size] };
+}
+
+// a struct is held in place, so its fields are at an offset from it
+static jit_slot_t exe_addr_offset(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .ptr = (char*) x->a->eval(x->a, c).ptr + x->size };
+}
+
+static jit_slot_t exe_field_local_4(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = c->frame[x->slot].block;
+  
+  if (!base) {
+    jit_error(x->node, JIT_ERR_MEMBER_NULL);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .i32 = *(int*) &base->block[x->size] };
+}
+
+static jit_slot_t exe_field_local_8(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = c->frame[x->slot].block;
+  
+  if (!base) {
+    jit_error(x->node, JIT_ERR_MEMBER_NULL);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .block = *(heap_block_t**) &base->block[x->size] };
+}
+
+static jit_slot_t exe_length(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = x->a->eval(x->a, c).block;
+  
+  if (!base) {
+    jit_error(x->node, JIT_ERR_MEMBER_NULL);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .i32 = base->size / x->size };
+}
+
+static jit_slot_t exe_capacity(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = x->a->eval(x->a, c).block;
+  
+  if (!base) {
+    jit_error(x->node, JIT_ERR_MEMBER_NULL);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .i32 = base->cap / x->size };
+}
+
+// an extent of a T[,] or T[,,], 'size' bytes into its heap block
+static jit_slot_t exe_extent(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *base = x->a->eval(x->a, c).block;
+  
+  if (!base) {
+    jit_error(x->node, JIT_ERR_MEMBER_NULL);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .i32 = *(const int*) ((const char*) base + x->size) };
+}
+
+// the methods of arrays of values which fit in a slot, 'size' bytes each.
+// the array is checked before the args are evaluated, as the interpreter
+// does.
+
+static heap_block_t *exe_array(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *array = x->a->eval(x->a, c).block;
+  
+  if (!array) {
+    jit_error(x->node, JIT_ERR_ARRAY_NULL);
+    exe_fail();
+  }
+  
+  return array;
+}
+
+static void exe_array_store(const exe_node_t *x, char *ptr, jit_slot_t value)
+{
+  if (x->size == 8)
+    *(heap_block_t**) ptr = value.block;
+  else
+    *(int*) ptr = value.i32;
+}
+
+static jit_slot_t exe_array_push(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *array = exe_array(x, c);
+  jit_slot_t value = x->b->eval(x->b, c);
+  
+  exe_array_store(x, heap_insert(array, array->size / x->size, x->size), value);
+  
+  return (jit_slot_t) { .block = NULL };
+}
+
+static jit_slot_t exe_array_pop(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *array = exe_array(x, c);
+  
+  if (array->size == 0) {
+    jit_error(x->node, JIT_ERR_ARRAY_EMPTY);
+    exe_fail();
+  }
+  
+  array->size -= x->size;
+  
+  if (x->size == 8)
+    return (jit_slot_t) { .block = *(heap_block_t**) &array->block[array->size] };
+  else
+    return (jit_slot_t) { .i32 = *(int*) &array->block[array->size] };
+}
+
+static jit_slot_t exe_array_insert(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *array = exe_array(x, c);
+  int index = x->b->eval(x->b, c).i32;
+  jit_slot_t value = x->c->eval(x->c, c);
+  
+  if (index < 0 || index > array->size / x->size) {
+    jit_error(x->node, JIT_ERR_ARRAY_BOUNDS);
+    exe_fail();
+  }
+  
+  exe_array_store(x, heap_insert(array, index, x->size), value);
+  
+  return (jit_slot_t) { .block = NULL };
+}
+
+static jit_slot_t exe_array_remove(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *array = exe_array(x, c);
+  int index = x->b->eval(x->b, c).i32;
+  
+  if (index < 0 || index >= array->size / x->size) {
+    jit_error(x->node, JIT_ERR_ARRAY_BOUNDS);
+    exe_fail();
+  }
+  
+  heap_remove(array, index, x->size);
+  
+  return (jit_slot_t) { .block = NULL };
+}
+
+static jit_slot_t exe_array_slice(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *array = exe_array(x, c);
+  int lo = x->b->eval(x->b, c).i32;
+  int hi = x->c->eval(x->c, c).i32;
+  
+  if (lo < 0 || lo > hi || hi > array->size / x->size) {
+    jit_error(x->node, JIT_ERR_ARRAY_BOUNDS);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .block = heap_slice(array, lo, hi, x->size) };
+}
+
+static int exe_array_length(const exe_node_t *x, exe_ctx_t *c)
+{
+  int length = x->b->eval(x->b, c).i32;
+  
+  if (length < 0 || (long) length * x->size > INT_MAX - SOA_RUN * x->size) {
+    jit_error(x->node, JIT_ERR_ARRAY_SIZE);
+    exe_fail();
+  }
+  
+  return length;
+}
+
+static jit_slot_t exe_array_reserve(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *array = exe_array(x, c);
+  heap_reserve(array, exe_array_length(x, c), x->size, false);
+  return (jit_slot_t) { .block = NULL };
+}
+
+static jit_slot_t exe_array_resize(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *array = exe_array(x, c);
+  heap_resize(array, exe_array_length(x, c), x->size, false);
+  return (jit_slot_t) { .block = NULL };
+}
+
+// assignment, the lhs is evaluated before the rhs
+
+static jit_slot_t exe_set_local(const exe_node_t *x, exe_ctx_t *c)
+{
+  return c->frame[x->slot] = x->b->eval(x->b, c);
+}
+
+static jit_slot_t exe_set_4(const exe_node_t *x, exe_ctx_t *c)
+{
+  char *ptr = x->a->eval(x->a, c).ptr;
+  jit_slot_t value = x->b->eval(x->b, c);
+  *(int*) ptr = value.i32;
+  return value;
+}
+
+static jit_slot_t exe_set_8(const exe_node_t *x, exe_ctx_t *c)
+{
+  char *ptr = x->a->eval(x->a, c).ptr;
+  jit_slot_t value = x->b->eval(x->b, c);
+  *(heap_block_t**) ptr = value.block;
+  return value;
+}
+
+static jit_slot_t exe_set_concat(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t **ptr = (heap_block_t**) x->a->eval(x->a, c).ptr;
+  heap_block_t *lhs = *ptr;
+  heap_block_t *rhs = x->b->eval(x->b, c).block;
+  return (jit_slot_t) { .block = *ptr = jit_concat(lhs, rhs) };
+}
+
+#define EXE_SET_OP(name, op) \
+  static jit_slot_t exe_##name##_set_i32(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    int *ptr = (int*) x->a->eval(x->a, c).ptr; \
+    int lhs = *ptr; \
+    int rhs = x->b->eval(x->b, c).i32; \
+    return (jit_slot_t) { .i32 = *ptr = lhs op rhs }; \
+  } \
+  static jit_slot_t exe_##name##_set_f32(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    float *ptr = (float*) x->a->eval(x->a, c).ptr; \
+    float lhs = *ptr; \
+    float rhs = x->b->eval(x->b, c).f32; \
+    return (jit_slot_t) { .f32 = *ptr = lhs op rhs }; \
+  } \
+  static jit_slot_t exe_##name##_set_local_i32(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    int lhs = c->frame[x->slot].i32; \
+    int rhs = x->b->eval(x->b, c).i32; \
+    return (jit_slot_t) { .i32 = c->frame[x->slot].i32 = lhs op rhs }; \
+  } \
+  static jit_slot_t exe_##name##_set_local_f32(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    float lhs = c->frame[x->slot].f32; \
+    float rhs = x->b->eval(x->b, c).f32; \
+    return (jit_slot_t) { .f32 = c->frame[x->slot].f32 = lhs op rhs }; \
+  }
+
+EXE_SET_OP(add, +)
+EXE_SET_OP(sub, -)
+EXE_SET_OP(mul, *)
+EXE_SET_OP(div, /)
+
+static const exe_eval_t exe_set_table[][4] = {
+  // i32, f32, local i32, local f32
+  { exe_add_set_i32, exe_add_set_f32, exe_add_set_local_i32, exe_add_set_local_f32 },
+  { exe_sub_set_i32, exe_sub_set_f32, exe_sub_set_local_i32, exe_sub_set_local_f32 },
+  { exe_mul_set_i32, exe_mul_set_f32, exe_mul_set_local_i32, exe_mul_set_local_f32 },
+  { exe_div_set_i32, exe_div_set_f32, exe_div_set_local_i32, exe_div_set_local_f32 }
+};
+
+static jit_slot_t exe_inc_local_i32(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .i32 = c->frame[x->slot].i32++ };
+}
+
+static jit_slot_t exe_dec_local_i32(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .i32 = c->frame[x->slot].i32-- };
+}
+
+static jit_slot_t exe_post_i32(const exe_node_t *x, exe_ctx_t *c)
+{
+  int *ptr = (int*) x->a->eval(x->a, c).ptr;
+  int value = *ptr;
+  *ptr = value + x->imm.i32;
+  return (jit_slot_t) { .i32 = value };
+}
+
+static jit_slot_t exe_post_f32(const exe_node_t *x, exe_ctx_t *c)
+{
+  float *ptr = (float*) x->a->eval(x->a, c).ptr;
+  float value = *ptr;
+  *ptr = value + x->imm.i32;
+  return (jit_slot_t) { .f32 = value };
+}
+
+// operators. i32 operators have forms for a local and a constant or two
+// locals as operands, which covers most loop conditions and counters.
+
+#define EXE_BINOP_I32(name, op) \
+  static jit_slot_t exe_##name##_i32(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    int lhs = x->a->eval(x->a, c).i32; \
+    int rhs = x->b->eval(x->b, c).i32; \
+    return (jit_slot_t) { .i32 = lhs op rhs }; \
+  } \
+  static jit_slot_t exe_##name##_i32_local_const(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    return (jit_slot_t) { .i32 = c->frame[x->slot].i32 op x->imm.i32 }; \
+  } \
+  static jit_slot_t exe_##name##_i32_local_local(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    return (jit_slot_t) { .i32 = c->frame[x->slot].i32 op c->frame[x->size].i32 }; \
+  }
+
+EXE_BINOP_I32(add, +)
+EXE_BINOP_I32(sub, -)
+EXE_BINOP_I32(mul, *)
+EXE_BINOP_I32(div, /)
+EXE_BINOP_I32(lt, <)
+EXE_BINOP_I32(gt, >)
+EXE_BINOP_I32(le, <=)
+EXE_BINOP_I32(ge, >=)
+EXE_BINOP_I32(eq, ==)
+EXE_BINOP_I32(ne, !=)
+
+// both sides are always evaluated
+static jit_slot_t exe_and_i32(const exe_node_t *x, exe_ctx_t *c)
+{
+  int lhs = x->a->eval(x->a, c).i32;
+  int rhs = x->b->eval(x->b, c).i32;
+  return (jit_slot_t) { .i32 = (lhs != 0) & (rhs != 0) };
+}
+
+static jit_slot_t exe_or_i32(const exe_node_t *x, exe_ctx_t *c)
+{
+  int lhs = x->a->eval(x->a, c).i32;
+  int rhs = x->b->eval(x->b, c).i32;
+  return (jit_slot_t) { .i32 = (lhs != 0) | (rhs != 0) };
+}
+
+#define EXE_ARITH_F32(name, op) \
+  static jit_slot_t exe_##name##_f32(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    float lhs = x->a->eval(x->a, c).f32; \
+    float rhs = x->b->eval(x->b, c).f32; \
+    return (jit_slot_t) { .f32 = lhs op rhs }; \
+  }
+
+// the interpreter stores all but < and > as the f32 1.0 in an i32
+#define EXE_CMP_F32(name, op, true_value) \
+  static jit_slot_t exe_##name##_f32(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    float lhs = x->a->eval(x->a, c).f32; \
+    float rhs = x->b->eval(x->b, c).f32; \
+    return (jit_slot_t) { .i32 = lhs op rhs ? true_value : 0 }; \
+  }
+
+EXE_ARITH_F32(add, +)
+EXE_ARITH_F32(sub, -)
+EXE_ARITH_F32(mul, *)
+EXE_ARITH_F32(div, /)
+EXE_CMP_F32(lt, <, 1)
+EXE_CMP_F32(gt, >, 1)
+EXE_CMP_F32(le, <=, 0x3f800000)
+EXE_CMP_F32(ge, >=, 0x3f800000)
+EXE_CMP_F32(eq, ==, 0x3f800000)
+EXE_CMP_F32(ne, !=, 0x3f800000)
+
+static jit_slot_t exe_concat(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *lhs = x->a->eval(x->a, c).block;
+  heap_block_t *rhs = x->b->eval(x->b, c).block;
+  return (jit_slot_t) { .block = jit_concat(lhs, rhs) };
+}
+
+static jit_slot_t exe_neg_i32(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .i32 = -x->a->eval(x->a, c).i32 };
+}
+
+static jit_slot_t exe_neg_f32(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .f32 = -x->a->eval(x->a, c).f32 };
+}
+
+static jit_slot_t exe_not_i32(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .i32 = !x->a->eval(x->a, c).i32 };
+}
+
+static jit_slot_t exe_i32_to_f32(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .f32 = x->a->eval(x->a, c).i32 };
+}
+
+static jit_slot_t exe_f32_to_i32(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .i32 = x->a->eval(x->a, c).f32 };
+}
+
+// structs are used by their address. those an operator or a call makes are
+// held in the frame at 'slot', an operator updating its lhs in place has no
+// slot.
+
+static jit_slot_t exe_set_struct(const exe_node_t *x, exe_ctx_t *c)
+{
+  char *ptr = x->a->eval(x->a, c).ptr;
+  memmove(ptr, x->b->eval(x->b, c).ptr, x->size);
+  return (jit_slot_t) { .ptr = ptr };
+}
+
+static jit_slot_t exe_copy_struct(const exe_node_t *x, exe_ctx_t *c)
+{
+  char *ptr = (char*) &c->frame[x->slot];
+  memmove(ptr, x->a->eval(x->a, c).ptr, x->size);
+  return (jit_slot_t) { .ptr = ptr };
+}
+
+// the fields are a list of values stored at their offset 'size'
+static jit_slot_t exe_new_struct(const exe_node_t *x, exe_ctx_t *c)
+{
+  char *ptr = (char*) &c->frame[x->slot];
+  
+  for (const exe_node_t *field = x->a; field; field = field->next) {
+    jit_slot_t value = field->a->eval(field->a, c);
+    
+    if (field->imm.i32 == 4)
+      *(int*) &ptr[field->size] = value.i32;
+    else
+      memmove(&ptr[field->size], value.ptr, field->imm.i32);
+  }
+  
+  return (jit_slot_t) { .ptr = ptr };
+}
+
+// vectors of 'size' f32s
+
+#define EXE_VEC_OP(name) \
+  static jit_slot_t exe_vec_##name(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    float *lhs = (float*) x->a->eval(x->a, c).ptr; \
+    float *rhs = (float*) x->b->eval(x->b, c).ptr; \
+    float *r = x->slot ? (float*) &c->frame[x->slot] : lhs; \
+    vec_##name(r, lhs, rhs, x->size); \
+    return (jit_slot_t) { .ptr = (char*) r }; \
+  }
+
+#define EXE_VEC_SCALE(name) \
+  static jit_slot_t exe_vec_##name(const exe_node_t *x, exe_ctx_t *c) \
+  { \
+    float *lhs = (float*) x->a->eval(x->a, c).ptr; \
+    float rhs = x->b->eval(x->b, c).f32; \
+    float *r = x->slot ? (float*) &c->frame[x->slot] : lhs; \
+    vec_##name(r, lhs, rhs, x->size); \
+    return (jit_slot_t) { .ptr = (char*) r }; \
+  }
+
+EXE_VEC_OP(add)
+EXE_VEC_OP(sub)
+EXE_VEC_OP(mat)
+EXE_VEC_SCALE(mul)
+EXE_VEC_SCALE(div)
+
+// an f32 times a vector, evaluated in the order written
+static jit_slot_t exe_vec_scale(const exe_node_t *x, exe_ctx_t *c)
+{
+  float lhs = x->a->eval(x->a, c).f32;
+  float *rhs = (float*) x->b->eval(x->b, c).ptr;
+  float *r = (float*) &c->frame[x->slot];
+  vec_mul(r, rhs, lhs, x->size);
+  return (jit_slot_t) { .ptr = (char*) r };
+}
+
+static jit_slot_t exe_vec_neg(const exe_node_t *x, exe_ctx_t *c)
+{
+  float *r = (float*) &c->frame[x->slot];
+  vec_mul(r, (float*) x->a->eval(x->a, c).ptr, -1.0, x->size);
+  return (jit_slot_t) { .ptr = (char*) r };
+}
+
+// each column of the rhs is multiplied by the lhs
+static jit_slot_t exe_vec_mat_mat(const exe_node_t *x, exe_ctx_t *c)
+{
+  float *lhs = (float*) x->a->eval(x->a, c).ptr;
+  float *rhs = (float*) x->b->eval(x->b, c).ptr;
+  float *r = (float*) &c->frame[x->slot];
+  
+  for (int i = 0; i < x->size; i++)
+    vec_mat(&r[i * x->size], lhs, &rhs[i * x->size], x->size);
+  
+  return (jit_slot_t) { .ptr = (char*) r };
+}
+
+static jit_slot_t exe_vec_dot(const exe_node_t *x, exe_ctx_t *c)
+{
+  float *lhs = (float*) x->a->eval(x->a, c).ptr;
+  float *rhs = (float*) x->b->eval(x->b, c).ptr;
+  return (jit_slot_t) { .f32 = vec_dot(lhs, rhs, x->size) };
+}
+
+static jit_slot_t exe_vec_length(const exe_node_t *x, exe_ctx_t *c)
+{
+  float *lhs = (float*) x->a->eval(x->a, c).ptr;
+  return (jit_slot_t) { .f32 = sqrtf(vec_dot(lhs, lhs, x->size)) };
+}
+
+static jit_slot_t exe_vec_normalize(const exe_node_t *x, exe_ctx_t *c)
+{
+  float *lhs = (float*) x->a->eval(x->a, c).ptr;
+  float *r = (float*) &c->frame[x->slot];
+  vec_div(r, lhs, sqrtf(vec_dot(lhs, lhs, x->size)), x->size);
+  return (jit_slot_t) { .ptr = (char*) r };
+}
+
+static jit_slot_t exe_vec_lerp(const exe_node_t *x, exe_ctx_t *c)
+{
+  float *lhs = (float*) x->a->eval(x->a, c).ptr;
+  float *rhs = (float*) x->b->eval(x->b, c).ptr;
+  float t = x->c->eval(x->c, c).f32;
+  float *r = (float*) &c->frame[x->slot];
+  vec_lerp(r, lhs, rhs, t, x->size);
+  return (jit_slot_t) { .ptr = (char*) r };
+}
+
+static jit_slot_t exe_vec_cross(const exe_node_t *x, exe_ctx_t *c)
+{
+  float *lhs = (float*) x->a->eval(x->a, c).ptr;
+  float *rhs = (float*) x->b->eval(x->b, c).ptr;
+  float *r = (float*) &c->frame[x->slot];
+  vec_cross(r, lhs, rhs);
+  return (jit_slot_t) { .ptr = (char*) r };
+}
+
+// calls. the callee's frame follows the caller's, the arguments are only
+// stored once all of them are evaluated as those may make calls too.
+static jit_slot_t exe_run_proc(const exe_node_t *x, exe_ctx_t *c)
+{
+  jit_slot_t arg[JIT_MAX_ARG + 1];
+  int num_arg = 0;
+  
+  if (x->a) {
+    arg[num_arg].block = x->a->eval(x->a, c).block;
+    
+    if (!arg[num_arg++].block) {
+      jit_error(x->node->proc.base, JIT_ERR_MEMBER_NULL);
+      exe_fail();
+    }
+  }
+  
+  for (const exe_node_t *head = x->b; head; head = head->next)
+    arg[num_arg++] = head->eval(head, c);
+  
+  jit_slot_t *frame = &c->frame[c->size];
+  fn_t *fn = x->fn;
+  
+  // 'this' goes in slot 1 followed by the params, constructors get theirs
+  // from jit_call()
+  memcpy(&frame[!x->a && fn->scope_class ? 2 : 1], arg, num_arg * sizeof(jit_slot_t));
+  
+  int status;
+  if (fn->jit && !fn->is_new) {
+    status = ((jit_code_t) fn->jit)(frame, c->scope);
+  } else if (fn->exe && !fn->is_new) {
+    jit_hot(fn);
+    status = exe_enter(fn->exe, frame, c->scope);
+  } else {
+    status = jit_call(x->site, c->scope, frame);
+  }
+  
+  if (status == JIT_TAIL)
+    status = jit_tail_run(frame, c->scope);
+  
+  if (status == JIT_FAIL)
+    exe_fail();
+  
+  if (x->size && status != JIT_VALUE) {
+    jit_error(x->node, JIT_ERR_NO_VALUE);
+    exe_fail();
+  }
+  
+  // a struct returned is copied out before the callee's frame is reused
+  if (x->imm.i32) {
+    char *ptr = (char*) &c->frame[x->slot];
+    memmove(ptr, frame[0].ptr, x->imm.i32);
+    return (jit_slot_t) { .ptr = ptr };
+  }
+  
+  return frame[0];
+}
+
+static jit_slot_t exe_array_list(const exe_node_t *x, exe_ctx_t *c)
+{
+  heap_block_t *array = heap_alloc(x->imm.i32 * x->size);
+  
+  int offset = 0;
+  for (const exe_node_t *head = x->a; head; head = head->next) {
+    jit_slot_t value = head->eval(head, c);
+    
+    if (x->size == 8)
+      *(heap_block_t**) &array->block[offset] = value.block;
+    else
+      *(int*) &array->block[offset] = value.i32;
+    
+    offset += x->size;
+  }
+  
+  return (jit_slot_t) { .block = array };
+}
+
+static jit_slot_t exe_array_size(const exe_node_t *x, exe_ctx_t *c)
+{
+  return (jit_slot_t) { .block = heap_alloc(x->a->eval(x->a, c).i32 * x->size) };
+}
+
+// the extents of a T[,] or T[,,] are a list in 'a'
+static jit_slot_t exe_array_grid(const exe_node_t *x, exe_ctx_t *c)
+{
+  int extent[GRID_DIM];
+  int dim = 0;
+  for (const exe_node_t *head = x->a; head; head = head->next)
+    extent[dim++] = head->eval(head, c).i32;
+  
+  heap_block_t *grid = heap_alloc_grid(extent, dim, x->size);
+  if (!grid) {
+    jit_error(x->node, JIT_ERR_GRID_SIZE);
+    exe_fail();
+  }
+  
+  return (jit_slot_t) { .block = grid };
+}
+
+// building
+
+static exe_node_t *exe_body(exe_t *e, const s_node_t *node)
+{
+  exe_node_t *block = exe_new(exe_run_block);
+  exe_node_t *tail = NULL;
+  
+  while (node) {
+    exe_node_t *stmt = exe_stmt(e, node->stmt.body);
+    if (!stmt)
+      return NULL;
+    
+    if (tail)
+      tail = tail->next = stmt;
+    else
+      block->a = tail = stmt;
+    
+    node = node->stmt.next;
+  }
+  
+  return block;
+}
+
+static exe_node_t *exe_body_scope(exe_t *e, const s_node_t *node)
+{
+  int num_var = e->num_var;
+  e->block++;
+  
+  exe_node_t *block = exe_body(e, node);
+  
+  e->block--;
+  e->num_var = num_var;
+  
+  return block;
+}
+
+static exe_node_t *exe_stmt(exe_t *e, const s_node_t *node)
+{
+  type_t type;
+  exe_node_t *x;
+  
+  if (!node)
+    return NULL;
+  
+  switch (node->node_type) {
+  case S_PROC:
+    x = exe_proc(e, node, &type, false);
+    break;
+  case S_BINOP:
+  case S_CONSTANT:
+  case S_INDEX:
+  case S_DIRECT:
+  case S_UNARY:
+  case S_ARRAY_INIT:
+  case S_POST_OP:
+    x = exe_expr(e, node, &type);
+    break;
+  case S_DECL:
+    return exe_decl(e, node);
+  case S_PRINT:
+    return exe_print_stmt(e, node);
+  case S_IF_STMT:
+    return exe_if_stmt(e, node);
+  case S_WHILE_STMT:
+    return exe_while_stmt(e, node);
+  case S_FOR_STMT:
+    return exe_for_stmt(e, node);
+  case S_RET_STMT:
+    return exe_ret_stmt(e, node);
+  case S_CTRL_STMT:
+    return exe_ctrl_stmt(e, node);
+  default:
+    return NULL;
+  }
+  
+  if (!x)
+    return NULL;
+  
+  exe_node_t *stmt = exe_new(exe_run_expr);
+  stmt->a = x;
+  
+  return stmt;
+}
+
+static exe_node_t *exe_decl(exe_t *e, const s_node_t *node)
+{
+  type_t type;
+  if (!exe_type(e->scope, &type, node->decl.type))
+    return NULL;
+  
+  exe_var_t *var = exe_add(e, &type, node->decl.ident->data.ident);
+  if (!var)
+    return NULL;
+  
+  exe_node_t *stmt;
+  
+  if (node->decl.init) {
+    type_t init_type;
+    exe_node_t *init = exe_expr(e, node->decl.init, &init_type);
+    if (!init)
+      return NULL;
+    
+    init = exe_cast(e, init, &init_type, &type);
+    if (!init)
+      return NULL;
+    
+    stmt = exe_new(exe_run_decl);
+    stmt->a = init;
+  } else {
+    stmt = exe_new(exe_run_decl_none);
+  }
+  
+  stmt->slot = var->slot;
+  
+  // a struct is held in the frame after the locals
+  if (type_struct(&type)) {
+    stmt->eval = exe_run_decl_struct;
+    stmt->size = exe_struct_slot(e, &type);
+    stmt->imm.i32 = type_size(&type);
+  }
+  
+  return stmt;
+}
+
+static exe_node_t *exe_print_stmt(exe_t *e, const s_node_t *node)
+{
+  exe_node_t *stmt = exe_new(exe_run_print);
+  exe_node_t *tail = NULL;
+  
+  const s_node_t *arg = node->print.arg;
+  while (arg) {
+    type_t type;
+    exe_node_t *x = exe_expr(e, arg->arg.body, &type);
+    if (!x)
+      return NULL;
+    
+    if (type_array(&type) || type_addr(&type) || type_cmp(&type, &type_none))
+      return NULL;
+    
+    // the value may be a call, which has a site of its own
+    exe_node_t *value = exe_new(NULL);
+    value->a = x;
+    value->site = jit_site(arg->arg.body, NULL, &type);
+    
+    if (tail)
+      tail = tail->next = value;
+    else
+      stmt->a = tail = value;
+    
+    arg = arg->arg.next;
+  }
+  
+  return stmt;
+}
+
+static exe_node_t *exe_cond(exe_t *e, const s_node_t *node)
+{
+  type_t type;
+  exe_node_t *x = exe_expr(e, node, &type);
+  if (!x)
+    return NULL;
+  
+  if (type_cmp(&type, &type_none) || type_addr(&type))
+    return NULL;
+  
+  return x;
+}
+
+static exe_node_t *exe_if_stmt(exe_t *e, const s_node_t *node)
+{
+  exe_node_t *stmt = exe_new(exe_run_if);
+  
+  stmt->a = exe_cond(e, node->if_stmt.cond);
+  if (!stmt->a)
+    return NULL;
+  
+  stmt->b = exe_body_scope(e, node->if_stmt.body);
+  if (!stmt->b)
+    return NULL;
+  
+  if (node->if_stmt.next) {
+    // the else branch runs in the enclosing scope, declarations made there
+    // are only visible if it was taken
+    const s_node_t *head = node->if_stmt.next;
+    while (head) {
+      if (head->stmt.body && head->stmt.body->node_type == S_DECL)
+        return NULL;
+      head = head->stmt.next;
+    }
+    
+    stmt->c = exe_body(e, node->if_stmt.next);
+    if (!stmt->c)
+      return NULL;
+  }
+  
+  return stmt;
+}
+
+static exe_node_t *exe_loop(exe_t *e, const s_node_t *cond, const s_node_t *inc, const s_node_t *body)
+{
+  e->loop++;
+  
+  exe_node_t *stmt = exe_new(exe_run_loop);
+  
+  stmt->a = exe_cond(e, cond);
+  if (!stmt->a)
+    return NULL;
+  
+  stmt->b = exe_body_scope(e, body);
+  if (!stmt->b)
+    return NULL;
+  
+  if (inc) {
+    type_t type;
+    stmt->c = inc->node_type == S_PROC
+      ? exe_proc(e, inc, &type, false)
+      : exe_expr(e, inc, &type);
+    
+    if (!stmt->c)
+      return NULL;
+  }
+  
+  e->loop--;
+  
+  return stmt;
+}
+
+static exe_node_t *exe_while_stmt(exe_t *e, const s_node_t *node)
+{
+  return exe_loop(e, node->while_stmt.cond, NULL, node->while_stmt.body);
+}
+
+static exe_node_t *exe_for_stmt(exe_t *e, const s_node_t *node)
+{
+  if (!node->for_stmt.decl)
+    return NULL;
+  
+  int num_var = e->num_var;
+  e->block++;
+  
+  exe_node_t *stmt = exe_new(exe_run_block);
+  
+  stmt->a = exe_stmt(e, node->for_stmt.decl->stmt.body);
+  if (stmt->a)
+    stmt->a->next = exe_loop(e, node->for_stmt.cond, node->for_stmt.inc, node->for_stmt.body);
+  
+  e->block--;
+  e->num_var = num_var;
+  
+  if (!stmt->a || !stmt->a->next)
+    return NULL;
+  
+  return stmt;
+}
+
+static exe_node_t *exe_ret_stmt(exe_t *e, const s_node_t *node)
+{
+  if (e->fn->is_new)
+    return NULL;
+  
+  fn_t *callee = jit_tail(e->scope, e->fn, node);
+  if (callee && exe_find(e, node->ret_stmt.body->proc.base->constant.lexeme->data.ident))
+    callee = NULL;
+  
+  // struct args point into the frame a tail call reuses, those calls are
+  // made as any other
+  type_t arg_type[JIT_MAX_ARG];
+  int num_arg;
+  if (callee && jit_param(e->scope, callee, arg_type, &num_arg))
+    return exe_ret_tail(e, node, callee);
+  
+  // a struct is returned by its address, the caller copies it
+  type_t type;
+  exe_node_t *x = exe_expr(e, node->ret_stmt.body, &type);
+  if (!x)
+    return NULL;
+  
+  if (!type_cmp(&type, &e->fn->type) || type_soa(&type))
+    return NULL;
+  
+  exe_node_t *stmt = exe_new(exe_run_ret);
+  stmt->a = x;
+  
+  return stmt;
+}
+
+static exe_node_t *exe_ret_tail(exe_t *e, const s_node_t *node, fn_t *callee)
+{
+  const s_node_t *proc = node->ret_stmt.body;
+  
+  type_t arg_type[JIT_MAX_ARG];
+  int num_arg;
+  if (!jit_param(e->scope, callee, arg_type, &num_arg))
+    return NULL;
+  
+  exe_node_t *stmt = exe_new(exe_run_tail);
+  exe_node_t *tail = NULL;
+  
+  const s_node_t *arg = proc->proc.arg;
+  for (int i = 0; i < num_arg; i++) {
+    if (!arg)
+      return NULL;
+    
+    type_t type;
+    exe_node_t *x = exe_expr(e, arg->arg.body, &type);
+    if (!x)
+      return NULL;
+    
+    x = exe_cast(e, x, &type, &arg_type[i]);
+    if (!x)
+      return NULL;
+    
+    if (tail)
+      tail = tail->next = x;
+    else
+      stmt->a = tail = x;
+    
+    arg = arg->arg.next;
+  }
+  
+  if (arg)
+    return NULL;
+  
+  if (callee == e->fn && !e->fn->scope_class && jit_returns(e->fn->node))
+    return stmt;
+  
+  type_t ret_type = callee->type;
+  stmt->eval = exe_run_tail_call;
+  stmt->site = jit_site(proc, callee, &ret_type);
+  memcpy(stmt->site->arg_type, arg_type, sizeof(type_t) * num_arg);
+  stmt->site->num_arg = num_arg;
+  
+  return stmt;
+}
+
+// one outside a loop is left for the interpreter to report
+static exe_node_t *exe_ctrl_stmt(exe_t *e, const s_node_t *node)
+{
+  if (!e->loop)
+    return NULL;
+  
+  return exe_new(node->ctrl_stmt.lexeme->token == TK_BREAK ? exe_run_break : exe_run_continue);
+}
+
+static exe_node_t *exe_expr(exe_t *e, const s_node_t *node, type_t *type)
+{
+  switch (node->node_type) {
+  case S_BINOP:
+    return exe_binop(e, node, type);
+  case S_UNARY:
+    return exe_unary(e, node, type);
+  case S_INDEX:
+    return exe_index(e, node, type, false);
+  case S_DIRECT:
+    return exe_direct(e, node, type, false);
+  case S_PROC:
+    return exe_proc(e, node, type, true);
+  case S_CONSTANT:
+    return exe_constant(e, node, type);
+  case S_ARRAY_INIT:
+    return exe_array_init(e, node, type);
+  case S_POST_OP:
+    return exe_post_op(e, node, type);
+  default:
+    return NULL;
+  }
+}
+
+// a node giving the address of an assignable expression
+static exe_node_t *exe_lvalue(exe_t *e, const s_node_t *node, type_t *type)
+{
+  switch (node->node_type) {
+  case S_CONSTANT: {
+    if (node->constant.lexeme->token != TK_IDENTIFIER)
+      return NULL;
+    
+    // a struct local's slot already holds its address
+    exe_var_t *var = exe_find(e, node->constant.lexeme->data.ident);
+    if (var) {
+      exe_node_t *x = exe_new(type_struct(&var->type) ? exe_local : exe_addr_local);
+      x->slot = var->slot;
+      *type = var->type;
+      return x;
+    }
+    
+    var_t *global = scope_find_var(e->scope, node->constant.lexeme->data.ident);
+    if (!global)
+      return NULL;
+    
+    exe_node_t *x = exe_new(exe_imm);
+    x->imm.ptr = &stack_mem->block[global->loc];
+    *type = global->type;
+    return x;
+  }
+  case S_INDEX:
+    return exe_index(e, node, type, true);
+  case S_DIRECT:
+    return exe_direct(e, node, type, true);
+  default:
+    return NULL;
+  }
+}
+
+static exe_node_t *exe_constant(exe_t *e, const s_node_t *node, type_t *type)
+{
+  const lexeme_t *lexeme = node->constant.lexeme;
+  exe_node_t *x;
+  
+  switch (lexeme->token) {
+  case TK_CONST_INTEGER:
+    x = exe_new(exe_imm);
+    x->imm.i32 = lexeme->data.i32;
+    *type = type_i32;
+    return x;
+  case TK_CONST_FLOAT:
+    x = exe_new(exe_imm);
+    x->imm.f32 = lexeme->data.f32;
+    *type = type_f32;
+    return x;
+  case TK_STRING_LITERAL:
+    x = exe_new(exe_string);
+    x->imm.ptr = lexeme->data.string_literal;
+    *type = type_string;
+    return x;
+  case TK_IDENTIFIER: {
+    exe_var_t *var = exe_find(e, lexeme->data.ident);
+    if (var) {
+      x = exe_new(exe_local);
+      x->slot = var->slot;
+      *type = var->type;
+      return x;
+    }
+    
+    var_t *global = scope_find_var(e->scope, lexeme->data.ident);
+    if (!global)
+      return NULL;
+    
+    *type = global->type;
+    
+    // a struct is used by its address
+    if (type_addr(type)) {
+      x = exe_new(exe_imm);
+      x->imm.ptr = &stack_mem->block[global->loc];
+      return x;
+    }
+    
+    x = exe_new(type_size(type) == 8 ? exe_global_8 : exe_global_4);
+    x->imm.ptr = &stack_mem->block[global->loc];
+    return x;
+  }
+  default:
+    return NULL;
+  }
+}
+
+static exe_node_t *exe_unary(exe_t *e, const s_node_t *node, type_t *type)
+{
+  exe_node_t *rhs = exe_expr(e, node->unary.rhs, type);
+  if (!rhs)
+    return NULL;
+  
+  exe_node_t *x;
+  
+  if (node->unary.op->token == '-' && type_cmp(type, &type_i32))
+    x = exe_new(exe_neg_i32);
+  else if (node->unary.op->token == '-' && type_cmp(type, &type_f32))
+    x = exe_new(exe_neg_f32);
+  else if (node->unary.op->token == '!' && type_cmp(type, &type_i32))
+    x = exe_new(exe_not_i32);
+  else if (node->unary.op->token == '-' && int_vec_size(type))
+    x = exe_new(exe_vec_neg);
+  else
+    return NULL;
+  
+  if (x->eval == exe_vec_neg) {
+    x->slot = exe_struct_slot(e, type);
+    x->size = int_vec_size(type);
+  }
+  
+  x->a = rhs;
+  
+  return x;
+}
+
+static exe_node_t *exe_binop_i32(int op, exe_node_t *lhs, exe_node_t *rhs)
+{
+  static const struct {
+    int         op;
+    exe_eval_t  eval[3];
+  } binop_table[] = {
+    { '+',    { exe_add_i32,  exe_add_i32_local_const,  exe_add_i32_local_local } },
+    { '-',    { exe_sub_i32,  exe_sub_i32_local_const,  exe_sub_i32_local_local } },
+    { '*',    { exe_mul_i32,  exe_mul_i32_local_const,  exe_mul_i32_local_local } },
+    { '/',    { exe_div_i32,  exe_div_i32_local_const,  exe_div_i32_local_local } },
+    { '<',    { exe_lt_i32,   exe_lt_i32_local_const,   exe_lt_i32_local_local } },
+    { '>',    { exe_gt_i32,   exe_gt_i32_local_const,   exe_gt_i32_local_local } },
+    { TK_LE,  { exe_le_i32,   exe_le_i32_local_const,   exe_le_i32_local_local } },
+    { TK_GE,  { exe_ge_i32,   exe_ge_i32_local_const,   exe_ge_i32_local_local } },
+    { TK_EQ,  { exe_eq_i32,   exe_eq_i32_local_const,   exe_eq_i32_local_local } },
+    { TK_NE,  { exe_ne_i32,   exe_ne_i32_local_const,   exe_ne_i32_local_local } },
+    { TK_AND, { exe_and_i32,  NULL,                     NULL } },
+    { TK_OR,  { exe_or_i32,   NULL,                     NULL } }
+  };
+  
+  for (int i = 0; i < (int) (sizeof(binop_table) / sizeof(binop_table[0])); i++) {
+    if (binop_table[i].op != op)
+      continue;
+    
+    exe_node_t *x = exe_new(binop_table[i].eval[0]);
+    x->a = lhs;
+    x->b = rhs;
+    
+    if (lhs->eval == exe_local && rhs->eval == exe_imm && binop_table[i].eval[1]) {
+      x->eval = binop_table[i].eval[1];
+      x->slot = lhs->slot;
+      x->imm = rhs->imm;
+    } else if (lhs->eval == exe_local && rhs->eval == exe_local && binop_table[i].eval[2]) {
+      x->eval = binop_table[i].eval[2];
+      x->slot = lhs->slot;
+      x->size = rhs->slot;
+    }
+    
+    return x;
+  }
+  
+  return NULL;
+}
+
+static exe_node_t *exe_binop_f32(int op, exe_node_t *lhs, exe_node_t *rhs, type_t *type)
+{
+  static const struct {
+    int         op;
+    exe_eval_t  eval;
+    bool        cmp;
+  } binop_table[] = {
+    { '+',    exe_add_f32,  false },
+    { '-',    exe_sub_f32,  false },
+    { '*',    exe_mul_f32,  false },
+    { '/',    exe_div_f32,  false },
+    { '<',    exe_lt_f32,   true },
+    { '>',    exe_gt_f32,   true },
+    { TK_LE,  exe_le_f32,   true },
+    { TK_GE,  exe_ge_f32,   true },
+    { TK_EQ,  exe_eq_f32,   true },
+    { TK_NE,  exe_ne_f32,   true }
+  };
+  
+  for (int i = 0; i < (int) (sizeof(binop_table) / sizeof(binop_table[0])); i++) {
+    if (binop_table[i].op != op)
+      continue;
+    
+    exe_node_t *x = exe_new(binop_table[i].eval);
+    x->a = lhs;
+    x->b = rhs;
+    
+    *type = binop_table[i].cmp ? type_i32 : type_f32;
+    
+    return x;
+  }
+  
+  return NULL;
+}
+
+static exe_node_t *exe_binop(exe_t *e, const s_node_t *node, type_t *type)
+{
+  int op = node->binop.op->token;
+  
+  if (op == '=' || (op >= TK_ADD_ASSIGN && op <= TK_DIV_ASSIGN))
+    return exe_assign(e, node, type);
+  
+  type_t lhs_type;
+  exe_node_t *lhs = exe_expr(e, node->binop.lhs, &lhs_type);
+  if (!lhs)
+    return NULL;
+  
+  bool hold = type_addr(&lhs_type) && jit_in_array(node->binop.lhs);
+  
+  e->hold += hold;
+  type_t rhs_type;
+  exe_node_t *rhs = exe_expr(e, node->binop.rhs, &rhs_type);
+  e->hold -= hold;
+  
+  if (!rhs)
+    return NULL;
+  
+  if (int_vec_size(&lhs_type) || int_vec_size(&rhs_type)) {
+    exe_node_t *x = exe_vec_binop(e, op, lhs, &lhs_type, rhs, &rhs_type, type);
+    if (x)
+      x->slot = exe_struct_slot(e, type);
+    return x;
+  } else if (type_cmp(&lhs_type, &type_i32) && type_cmp(&rhs_type, &type_i32)) {
+    *type = type_i32;
+    return exe_binop_i32(op, lhs, rhs);
+  } else if (type_num(&lhs_type) && type_num(&rhs_type)) {
+    lhs = exe_cast(e, lhs, &lhs_type, &type_f32);
+    rhs = exe_cast(e, rhs, &rhs_type, &type_f32);
+    return exe_binop_f32(op, lhs, rhs, type);
+  } else if (type_cmp(&lhs_type, &type_string) && type_cmp(&rhs_type, &type_string) && op == '+') {
+    exe_node_t *x = exe_new(exe_concat);
+    x->a = lhs;
+    x->b = rhs;
+    *type = type_string;
+    return x;
+  }
+  
+  return NULL;
+}
+
+static exe_node_t *exe_assign(exe_t *e, const s_node_t *node, type_t *type)
+{
+  int op = node->binop.op->token;
+  
+  exe_node_t *lhs = exe_lvalue(e, node->binop.lhs, type);
+  if (!lhs || type_soa(type))
+    return NULL;
+  
+  bool hold = jit_in_array(node->binop.lhs);
+  
+  e->hold += hold;
+  type_t rhs_type;
+  exe_node_t *rhs = exe_expr(e, node->binop.rhs, &rhs_type);
+  e->hold -= hold;
+  
+  if (!rhs)
+    return NULL;
+  
+  // structs are copied, vectors can be updated in place
+  if (type_struct(type) && op == '=') {
+    if (!type_cmp(type, &rhs_type))
+      return NULL;
+    
+    exe_node_t *x = exe_new(exe_set_struct);
+    x->a = lhs;
+    x->b = rhs;
+    x->size = type_size(type);
+    return x;
+  } else if (type_struct(type)) {
+    type_t vec_type;
+    exe_node_t *x = exe_vec_binop(e, "+-*/"[op - TK_ADD_ASSIGN], lhs, type, rhs, &rhs_type, &vec_type);
+    if (!x || x->eval == exe_vec_mat || x->eval == exe_vec_mat_mat || x->eval == exe_vec_scale)
+      return NULL;
+    return x;
+  }
+  
+  exe_node_t *x = exe_new(type_size(type) == 8 ? exe_set_8 : exe_set_4);
+  x->a = lhs;
+  x->b = rhs;
+  
+  if (type_num(type)) {
+    if (!type_num(&rhs_type))
+      return NULL;
+    
+    x->b = exe_cast(e, rhs, &rhs_type, type);
+    
+    if (op != '=') {
+      int form = type_cmp(type, &type_i32) ? 0 : 1;
+      if (lhs->eval == exe_addr_local)
+        form += 2;
+      
+      x->eval = exe_set_table[op - TK_ADD_ASSIGN][form];
+    }
+  } else if (type_cmp(type, &type_string) && type_cmp(&rhs_type, &type_string)) {
+    if (op == TK_ADD_ASSIGN)
+      x->eval = exe_set_concat;
+    else if (op != '=')
+      return NULL;
+  } else if (op != '=' || !type_cmp(type, &rhs_type)) {
+    return NULL;
+  }
+  
+  // a whole slot is written for locals
+  if (lhs->eval == exe_addr_local) {
+    x->slot = lhs->slot;
+    if (op == '=')
+      x->eval = exe_set_local;
+  }
+  
+  return x;
+}
+
+static exe_node_t *exe_index(exe_t *e, const s_node_t *node, type_t *type, bool lvalue)
+{
+  type_t base_type;
+  exe_node_t *base = exe_expr(e, node->index.base, &base_type);
+  if (!base)
+    return NULL;
+  
+  if (!type_array(&base_type))
+    return NULL;
+  
+  exe_node_t *x;
+  
+  if (base_type.dim) {
+    x = exe_new(exe_addr_grid);
+    
+    // misuse of the indices is reported by the interpreter
+    exe_node_t **link = &x->b;
+    int num_index = 0;
+    
+    for (const s_node_t *head = node->index.index; head && head->node_type == S_ARG; head = head->arg.next) {
+      type_t index_type;
+      exe_node_t *index = exe_expr(e, head->arg.body, &index_type);
+      if (!index || !type_cmp(&index_type, &type_i32))
+        return NULL;
+      
+      *link = index;
+      link = &index->next;
+      num_index++;
+    }
+    
+    if (num_index != base_type.dim)
+      return NULL;
+  } else {
+    type_t index_type;
+    exe_node_t *index = exe_expr(e, node->index.index, &index_type);
+    if (!index)
+      return NULL;
+    
+    if (!type_cmp(&index_type, &type_i32))
+      return NULL;
+    
+    x = exe_new(node->index.in_range ? exe_addr_index_in_range : exe_addr_index);
+    if (base_type.spec == SPEC_SOA)
+      x->eval = exe_addr_index_soa;
+    x->b = index;
+  }
+  
+  x->a = base;
+  x->size = type_size_base(&base_type);
+  x->node = node;
+  
+  *type = base_type;
+  type->arr = false;
+  type->dim = 0;
+  
+  if (lvalue || type_addr(type))
+    return x;
+  
+  exe_node_t *load = exe_new(type_size(type) == 8 ? exe_load_8 : exe_load_4);
+  load->a = x;
+  
+  return load;
+}
+
+static exe_node_t *exe_direct(exe_t *e, const s_node_t *node, type_t *type, bool lvalue)
+{
+  type_t base_type;
+  exe_node_t *base = exe_expr(e, node->direct.base, &base_type);
+  if (!base)
+    return NULL;
+  
+  const char *ident = node->direct.child_ident->data.ident;
+  
+  if (type_array(&base_type)) {
+    int extent = jit_extent(&base_type, ident);
+    
+    if (lvalue || (extent < 0 && strcmp(ident, "length") != 0 && strcmp(ident, "capacity") != 0))
+      return NULL;
+    
+    exe_node_t *x = exe_new(extent >= 0 ? exe_extent : ident[0] == 'l' ? exe_length : exe_capacity);
+    x->a = base;
+    x->size = extent >= 0 ? extent : type_size_base(&base_type);
+    x->node = node;
+    
+    *type = type_i32;
+    return x;
+  }
+  
+  if (!type_class(&base_type) && !type_addr(&base_type))
+    return NULL;
+  
+  var_t *var = map_get(&base_type.class->map_var, ident);
+  if (!var)
+    return NULL;
+  
+  *type = var->type;
+  
+  exe_node_t *x = exe_new(type_addr(&base_type) ? exe_addr_offset : exe_addr_field);
+  x->a = base;
+  x->size = var->loc;
+  x->node = node;
+  
+  // the fields of an soa element are a run apart
+  if (type_soa(&base_type)) {
+    x->size *= SOA_RUN;
+    if (type_struct(type))
+      type->spec = SPEC_SOA;
+  }
+  
+  if (lvalue || type_addr(type))
+    return x;
+  
+  if (base->eval == exe_local && type_class(&base_type)) {
+    x->eval = type_size(type) == 8 ? exe_field_local_8 : exe_field_local_4;
+    x->slot = base->slot;
+    return x;
+  }
+  
+  exe_node_t *load = exe_new(type_size(type) == 8 ? exe_load_8 : exe_load_4);
+  load->a = x;
+  
+  return load;
+}
+
+static exe_node_t *exe_proc(exe_t *e, const s_node_t *node, type_t *type, bool value)
+{
+  const s_node_t *base = node->proc.base;
+  exe_node_t *self = NULL;
+  fn_t *fn = NULL;
+  
+  switch (base->node_type) {
+  case S_CONSTANT: {
+    if (base->constant.lexeme->token != TK_IDENTIFIER)
+      return NULL;
+    
+    const char *ident = base->constant.lexeme->data.ident;
+    if (exe_find(e, ident) || scope_find_var(e->scope, ident))
+      return NULL;
+    
+    fn = scope_find_fn(e->scope, ident);
+    break;
+  }
+  case S_DIRECT: {
+    type_t class;
+    self = exe_expr(e, base->direct.base, &class);
+    if (!self)
+      return NULL;
+    
+    if (int_vec_size(&class))
+      return exe_vec_method(e, node, self, &class, type);
+    
+    if (type_array(&class))
+      return exe_array_method(e, node, self, &class, type, value);
+    
+    if (!type_class(&class))
+      return NULL;
+    
+    const char *method = base->direct.child_ident->data.ident;
+    if (map_get(&class.class->map_var, method))
+      return NULL;
+    
+    fn = map_get(&class.class->map_fn, method);
+    break;
+  }
+  case S_NEW: {
+    const scope_t *new_class = scope_find_class(e->scope, base->new.class_ident->data.ident);
+    if (!new_class)
+      return NULL;
+    
+    // a struct_def's constructor fills in a value, which is left to the
+    // interpreter
+    fn = map_get(&new_class->map_fn, "+new");
+    if (!fn && new_class->value)
+      return exe_struct_new(e, node, new_class, type);
+    else if (new_class->value)
+      return NULL;
+    
+    fn = scope_find_fn(new_class, "+new");
+    break;
+  }
+  default:
+    return NULL;
+  }
+  
+  // natives can not reach the arrays of the script
+  if (!fn || (e->hold && !fn->xaction))
+    return NULL;
+  
+  type_t arg_type[JIT_MAX_ARG];
+  int num_arg;
+  if (!exe_param(e->scope, fn, arg_type, &num_arg))
+    return NULL;
+  
+  exe_node_t *x = exe_new(exe_run_proc);
+  exe_node_t *tail = NULL;
+  
+  // struct args are passed by their address, which the args after them
+  // must not move
+  int hold = e->hold;
+  int i = 0;
+  
+  const s_node_t *arg = node->proc.arg;
+  for (; i < num_arg && arg; i++) {
+    type_t type;
+    exe_node_t *arg_x = exe_expr(e, arg->arg.body, &type);
+    if (arg_x)
+      arg_x = exe_cast(e, arg_x, &type, &arg_type[i]);
+    if (!arg_x)
+      break;
+    
+    if (type_addr(&type) && jit_in_array(arg->arg.body))
+      e->hold++;
+    
+    if (tail)
+      tail = tail->next = arg_x;
+    else
+      x->b = tail = arg_x;
+    
+    arg = arg->arg.next;
+  }
+  
+  e->hold = hold;
+  
+  if (i < num_arg || arg)
+    return NULL;
+  
+  x->a = self;
+  x->fn = fn;
+  x->node = node;
+  
+  // the callee may not be compiled by the time the call is made
+  type_t ret_type = fn->type;
+  x->site = jit_site(node, fn, &ret_type);
+  memcpy(x->site->arg_type, arg_type, sizeof(type_t) * num_arg);
+  x->site->num_arg = num_arg;
+  
+  if (!value) {
+    *type = type_none;
+    return x;
+  }
+  
+  if (fn->is_new) {
+    *type = (type_t) { .spec = SPEC_CLASS, .arr = false, .class = fn->scope_class };
+  } else {
+    if (type_cmp(&fn->type, &type_none))
+      return NULL;
+    
+    x->size = 1;
+    *type = fn->type;
+    
+    if (type_struct(type)) {
+      x->slot = exe_struct_slot(e, type);
+      x->imm.i32 = type_size(type);
+    }
+  }
+  
+  return x;
+}
+
+static exe_node_t *exe_array_init(exe_t *e, const s_node_t *node, type_t *type)
+{
+  if (!exe_type(e->scope, type, node->array_init.type))
+    return NULL;
+  
+  exe_node_t *x;
+  
+  // a list of structs is copied in by the interpreter
+  if (node->array_init.init && type_struct(type)) {
+    return NULL;
+  } else if (node->array_init.init) {
+    x = exe_new(exe_array_list);
+    exe_node_t *tail = NULL;
+    
+    const s_node_t *head = node->array_init.init;
+    while (head) {
+      type_t arg_type;
+      exe_node_t *arg = exe_expr(e, head->arg.body, &arg_type);
+      if (!arg)
+        return NULL;
+      
+      if (!type_cmp(&arg_type, type))
+        return NULL;
+      
+      if (tail)
+        tail = tail->next = arg;
+      else
+        x->a = tail = arg;
+      
+      x->imm.i32++;
+      head = head->arg.next;
+    }
+  } else if (node->array_init.size && node->array_init.size->node_type == S_ARG) {
+    x = exe_new(exe_array_grid);
+    x->node = node;
+    type->dim = 0;
+    
+    exe_node_t **link = &x->a;
+    for (const s_node_t *head = node->array_init.size; head; head = head->arg.next) {
+      if (++type->dim > GRID_DIM)
+        return NULL;
+      
+      type_t size_type;
+      exe_node_t *size = exe_expr(e, head->arg.body, &size_type);
+      if (!size || !type_cmp(&size_type, &type_i32))
+        return NULL;
+      
+      *link = size;
+      link = &size->next;
+    }
+  } else if (node->array_init.size) {
+    type_t size_type;
+    exe_node_t *size = exe_expr(e, node->array_init.size, &size_type);
+    if (!size)
+      return NULL;
+    
+    if (!type_cmp(&size_type, &type_i32))
+      return NULL;
+    
+    x = exe_new(exe_array_size);
+    x->a = size;
+  } else {
+    return NULL;
+  }
+  
+  x->size = type_size(type);
+  type->arr = true;
+  
+  return x;
+}
+
+static exe_node_t *exe_post_op(exe_t *e, const s_node_t *node, type_t *type)
+{
+  exe_node_t *lhs = exe_lvalue(e, node->post_op.lhs, type);
+  if (!lhs)
+    return NULL;
+  
+  bool inc = node->post_op.op->token == TK_INC;
+  
+  exe_node_t *x;
+  
+  if (type_cmp(type, &type_i32) && lhs->eval == exe_addr_local) {
+    x = exe_new(inc ? exe_inc_local_i32 : exe_dec_local_i32);
+    x->slot = lhs->slot;
+    return x;
+  } else if (type_cmp(type, &type_i32)) {
+    x = exe_new(exe_post_i32);
+  } else if (type_cmp(type, &type_f32)) {
+    x = exe_new(exe_post_f32);
+  } else {
+    return NULL;
+  }
+  
+  x->a = lhs;
+  x->imm.i32 = inc ? 1 : -1;
+  
+  return x;
+}
+
+// a struct_def without a constructor is filled in from its fields in order
+static exe_node_t *exe_struct_new(exe_t *e, const s_node_t *node, const scope_t *class, type_t *type)
+{
+  exe_node_t *x = exe_new(exe_new_struct);
+  exe_node_t *tail = NULL;
+  
+  int loc = -1;
+  for (const s_node_t *arg = node->proc.arg; arg; arg = arg->arg.next) {
+    const var_t *field = NULL;
+    for (const entry_t *entry = class->map_var.start; entry; entry = entry->s_next) {
+      const var_t *var = entry->value;
+      if (var->loc > loc && (!field || var->loc < field->loc))
+        field = var;
+    }
+    
+    if (!field)
+      return NULL;
+    
+    type_t arg_type;
+    exe_node_t *value = exe_expr(e, arg->arg.body, &arg_type);
+    if (!value)
+      return NULL;
+    
+    value = exe_cast(e, value, &arg_type, &field->type);
+    if (!value)
+      return NULL;
+    
+    exe_node_t *store = exe_new(NULL);
+    store->a = value;
+    store->size = field->loc;
+    store->imm.i32 = type_size(&field->type);
+    
+    if (tail)
+      tail = tail->next = store;
+    else
+      x->a = tail = store;
+    
+    loc = field->loc;
+  }
+  
+  // too few args are reported by the interpreter
+  for (const entry_t *entry = class->map_var.start; entry; entry = entry->s_next) {
+    if (((const var_t*) entry->value)->loc > loc)
+      return NULL;
+  }
+  
+  *type = (type_t) { .spec = SPEC_STRUCT, .arr = false, .class = class };
+  x->slot = exe_struct_slot(e, type);
+  
+  return x;
+}
+
+// the operators of int_vec_binop(), the caller gives the node a slot or
+// leaves it to update the lhs
+static exe_node_t *exe_vec_binop(exe_t *e, int op, exe_node_t *lhs, const type_t *lhs_type, exe_node_t *rhs, const type_t *rhs_type, type_t *type)
+{
+  const scope_t *col = int_vec_size(lhs_type) ? int_vec_col(lhs_type) : NULL;
+  exe_node_t *x;
+  int n;
+  
+  if (int_vec_size(lhs_type) && type_struct(rhs_type)) {
+    if ((op == '+' || op == '-') && type_cmp(lhs_type, rhs_type)) {
+      x = exe_new(op == '+' ? exe_vec_add : exe_vec_sub);
+      n = int_vec_size(lhs_type);
+      *type = *lhs_type;
+    } else if (op == '*' && col && rhs_type->class == col) {
+      x = exe_new(exe_vec_mat);
+      n = col->size / 4;
+      *type = *rhs_type;
+    } else if (op == '*' && col && type_cmp(lhs_type, rhs_type)) {
+      x = exe_new(exe_vec_mat_mat);
+      n = col->size / 4;
+      *type = *lhs_type;
+    } else {
+      return NULL;
+    }
+  } else if (int_vec_size(lhs_type) && type_num(rhs_type) && (op == '*' || op == '/')) {
+    x = exe_new(op == '*' ? exe_vec_mul : exe_vec_div);
+    rhs = exe_cast(e, rhs, rhs_type, &type_f32);
+    n = int_vec_size(lhs_type);
+    *type = *lhs_type;
+  } else if (int_vec_size(rhs_type) && type_num(lhs_type) && op == '*') {
+    x = exe_new(exe_vec_scale);
+    lhs = exe_cast(e, lhs, lhs_type, &type_f32);
+    n = int_vec_size(rhs_type);
+    *type = *rhs_type;
+  } else {
+    return NULL;
+  }
+  
+  x->a = lhs;
+  x->b = rhs;
+  x->size = n;
+  
+  return x;
+}
+
+// the methods of int_vec_method(), misuse is reported by the interpreter
+static exe_node_t *exe_vec_method(exe_t *e, const s_node_t *node, exe_node_t *self, const type_t *self_type, type_t *type)
+{
+  const char *ident = node->proc.base->direct.child_ident->data.ident;
+  
+  exe_node_t *arg[2];
+  type_t arg_type[2];
+  int num_arg = 0;
+  
+  // self and vector args are used by their address
+  int hold = e->hold;
+  if (jit_in_array(node->proc.base->direct.base))
+    e->hold++;
+  
+  const s_node_t *head = node->proc.arg;
+  for (; head && num_arg < 2; head = head->arg.next) {
+    arg[num_arg] = exe_expr(e, head->arg.body, &arg_type[num_arg]);
+    if (!arg[num_arg])
+      break;
+    
+    if (type_addr(&arg_type[num_arg]) && jit_in_array(head->arg.body))
+      e->hold++;
+    
+    num_arg++;
+  }
+  
+  e->hold = hold;
+  
+  if (head)
+    return NULL;
+  
+  int n = int_vec_size(self_type);
+  bool vec_arg = num_arg >= 1 && type_cmp(&arg_type[0], self_type);
+  bool f32_arg = num_arg >= 1 && type_num(&arg_type[0]);
+  
+  exe_node_t *x;
+  *type = *self_type;
+  
+  if (strcmp(ident, "dot") == 0 && num_arg == 1 && vec_arg) {
+    x = exe_new(exe_vec_dot);
+    *type = type_f32;
+  } else if (strcmp(ident, "length") == 0 && num_arg == 0) {
+    x = exe_new(exe_vec_length);
+    *type = type_f32;
+  } else if (strcmp(ident, "normalize") == 0 && num_arg == 0) {
+    x = exe_new(exe_vec_normalize);
+  } else if (strcmp(ident, "lerp") == 0 && num_arg == 2 && vec_arg && type_num(&arg_type[1])) {
+    x = exe_new(exe_vec_lerp);
+    x->c = exe_cast(e, arg[1], &arg_type[1], &type_f32);
+  } else if (strcmp(ident, "cross") == 0 && num_arg == 1 && vec_arg && n == 3) {
+    x = exe_new(exe_vec_cross);
+  } else if (strcmp(ident, "mul") == 0 && num_arg == 1 && type_struct(&arg_type[0])) {
+    x = exe_vec_binop(e, '*', self, self_type, arg[0], &arg_type[0], type);
+    if (!x)
+      return NULL;
+    x->slot = exe_struct_slot(e, type);
+    return x;
+  } else if (strcmp(ident, "copy") == 0 && num_arg == 0) {
+    x = exe_new(exe_copy_struct);
+    x->a = self;
+    x->size = type_size(self_type);
+    x->slot = exe_struct_slot(e, type);
+    return x;
+  } else if (strcmp(ident, "add") == 0 && num_arg == 1 && vec_arg) {
+    return exe_vec_binop(e, '+', self, self_type, arg[0], &arg_type[0], type);
+  } else if (strcmp(ident, "sub") == 0 && num_arg == 1 && vec_arg) {
+    return exe_vec_binop(e, '-', self, self_type, arg[0], &arg_type[0], type);
+  } else if (strcmp(ident, "mulf") == 0 && num_arg == 1 && f32_arg) {
+    return exe_vec_binop(e, '*', self, self_type, arg[0], &arg_type[0], type);
+  } else {
+    return NULL;
+  }
+  
+  x->a = self;
+  x->b = num_arg >= 1 ? arg[0] : NULL;
+  x->size = n;
+  
+  if (type_struct(type))
+    x->slot = exe_struct_slot(e, type);
+  
+  return x;
+}
+
+// the methods of int_array_method() on arrays of values which fit in a slot,
+// misuse is reported by the interpreter
+static exe_node_t *exe_array_method(exe_t *e, const s_node_t *node, exe_node_t *self, const type_t *self_type, type_t *type, bool value)
+{
+  static const struct {
+    const char  *ident;
+    exe_eval_t  eval;
+    const char  *arg;
+    bool        grow;
+  } array_method[] = {
+    { "push",     exe_array_push,     "e",  true },
+    { "pop",      exe_array_pop,      "",   false },
+    { "insert",   exe_array_insert,   "ie", true },
+    { "remove",   exe_array_remove,   "i",  false },
+    { "reserve",  exe_array_reserve,  "i",  true },
+    { "resize",   exe_array_resize,   "i",  true },
+    { "slice",    exe_array_slice,    "ii", false }
+  };
+  
+  const char *ident = node->proc.base->direct.child_ident->data.ident;
+  
+  int method = 0;
+  while (method < (int) (sizeof(array_method) / sizeof(array_method[0])) && strcmp(array_method[method].ident, ident) != 0)
+    method++;
+  
+  if (method == sizeof(array_method) / sizeof(array_method[0]))
+    return NULL;
+  
+  type_t elem = *self_type;
+  elem.arr = false;
+  
+  if (type_addr(&elem) || self_type->dim || (array_method[method].grow && e->hold))
+    return NULL;
+  
+  exe_node_t *x = exe_new(array_method[method].eval);
+  exe_node_t **link = &x->b;
+  
+  const char *want = array_method[method].arg;
+  const s_node_t *head = node->proc.arg;
+  
+  for (; *want; want++) {
+    if (!head)
+      return NULL;
+    
+    type_t arg_type;
+    exe_node_t *arg = exe_expr(e, head->arg.body, &arg_type);
+    if (!arg)
+      return NULL;
+    
+    *link = exe_cast(e, arg, &arg_type, *want == 'i' ? &type_i32 : &elem);
+    if (!*link)
+      return NULL;
+    
+    link = &x->c;
+    head = head->arg.next;
+  }
+  
+  if (head)
+    return NULL;
+  
+  x->a = self;
+  x->size = type_size(&elem);
+  x->node = node;
+  
+  *type = x->eval == exe_array_pop ? elem : x->eval == exe_array_slice ? *self_type : type_none;
+  if (value && type_cmp(type, &type_none))
+    return NULL;
+  
+  return x;
+}
+
+static exe_node_t *exe_cast(exe_t *e, exe_node_t *x, const type_t *from, const type_t *to)
+{
+  if (type_cmp(from, to))
+    return x;
+  
+  exe_node_t *cast;
+  
+  if (type_cmp(from, &type_i32) && type_cmp(to, &type_f32))
+    cast = exe_new(exe_i32_to_f32);
+  else if (type_cmp(from, &type_f32) && type_cmp(to, &type_i32))
+    cast = exe_new(exe_f32_to_i32);
+  else
+    return NULL;
+  
+  cast->a = x;
+  
+  return cast;
+}
+
+// nodes are kept on one list and freed together by exe_stop(), including
+// those of functions which failed to compile
+static exe_node_t *exe_new(exe_eval_t eval)
+{
+  exe_node_t *x = ZONE_ALLOC(sizeof(exe_node_t));
+  memset(x, 0, sizeof(exe_node_t));
+  
+  x->eval = eval;
+  x->link = exe_node_list;
+  exe_node_list = x;
+  
+  return x;
+}
+
+static exe_var_t *exe_find(exe_t *e, const char *ident)
+{
+  for (int i = e->num_var - 1; i >= 0; i--) {
+    if (strcmp(e->var[i].ident, ident) == 0)
+      return &e->var[i];
+  }
+  
+  return NULL;
+}
+
+static exe_var_t *exe_add(exe_t *e, const type_t *type, const char *ident)
+{
+  exe_var_t *var = exe_find(e, ident);
+  if (var && var->block == e->block)
+    return NULL;
+  
+  if (e->num_var == EXE_MAX_VAR || e->num_slot == e->frame)
+    return NULL;
+  
+  var = &e->var[e->num_var++];
+  var->ident = ident;
+  var->type = *type;
+  var->slot = e->num_slot++;
+  var->block = e->block;
+  
+  return var;
+}
+
+// jit_type() and struct values, which only closures hold
+static bool exe_type(const scope_t *scope, type_t *type, const s_node_t *node)
+{
+  if (jit_type(scope, type, node))
+    return true;
+  
+  if (node->type.left_bracket
+    || (node->type.spec->token != TK_STRUCT && node->type.spec->token != TK_CLASS))
+    return false;
+  
+  type->spec = SPEC_STRUCT;
+  type->arr = false;
+  type->class = scope_find_class(scope, node->type.class_ident->data.ident);
+  type->dim = 0;
+  
+  return type->class && type->class->value;
+}
+
+static bool exe_param(const scope_t *scope, const fn_t *fn, type_t *arg_type, int *num_arg)
+{
+  *num_arg = 0;
+  
+  const s_node_t *head = fn->param;
+  while (head) {
+    if (*num_arg == JIT_MAX_ARG)
+      return false;
+    
+    if (!exe_type(scope, &arg_type[*num_arg], head->param_decl.type))
+      return false;
+    
+    (*num_arg)++;
+    head = head->param_decl.next;
+  }
+  
+  return true;
+}
+
+// the first slot of frame space for a struct value
+static int exe_struct_slot(exe_t *e, const type_t *type)
+{
+  int slot = e->frame + e->size;
+  e->size += (type_size(type) + sizeof(jit_slot_t) - 1) / sizeof(jit_slot_t);
+  
+  return slot;
+}
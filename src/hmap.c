@@ -0,0 +1,341 @@
+#include "hmap.h"
+
+#include "mem.h"
+#include "zone.h"
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// open addressing over 'cap' slots, a power of two. each slot has a control
+// byte, which is empty, deleted or the low 7 bits of the hash of its key, and
+// a key is looked for a group of 16 control bytes at a time: all of them are
+// compared with its hash at once and only the slots which match are read. the
+// groups are probed one after another, further each time, until one with an
+// empty slot. an entry keeps the hash of its key, so a string is hashed once
+// as it is put and the table grows without hashing any key again.
+
+#define HMAP_GROUP    16
+#define HMAP_EMPTY    0x80
+#define HMAP_DELETED  0xfe
+
+// the header, then the control bytes, then the entries
+typedef struct {
+  hmap_key_t  key;
+  int         entry_size;
+  int         cap;
+  int         num;
+  int         num_used;
+} hmap_t;
+
+#define HMAP_CTRL     32
+
+// an entry is the hash of its key, the key, then the value
+#define HMAP_KEY      8
+#define HMAP_VALUE    16
+
+static inline unsigned char *hmap_ctrl(const heap_block_t *map)
+{
+  return (unsigned char*) &map->block[HMAP_CTRL];
+}
+
+static inline char *hmap_entry(const heap_block_t *map, int slot)
+{
+  const hmap_t *hm = (const hmap_t*) map->block;
+  return &map->block[HMAP_CTRL + hm->cap + slot * hm->entry_size];
+}
+
+// a bit for each of the 16 control bytes which is 'byte'
+static inline unsigned hmap_match(const unsigned char *ctrl, unsigned char byte)
+{
+#ifdef __SSE2__
+  __m128i group = _mm_loadu_si128((const __m128i*) ctrl);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char) byte)));
+#else
+  unsigned match = 0;
+  for (int i = 0; i < HMAP_GROUP; i++)
+    match |= (unsigned) (ctrl[i] == byte) << i;
+  return match;
+#endif
+}
+
+// a bit for each slot which is empty or deleted, whose byte has its top bit set
+static inline unsigned hmap_match_free(const unsigned char *ctrl)
+{
+#ifdef __SSE2__
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) ctrl));
+#else
+  unsigned match = 0;
+  for (int i = 0; i < HMAP_GROUP; i++)
+    match |= (unsigned) (ctrl[i] >> 7) << i;
+  return match;
+#endif
+}
+
+static unsigned hmap_mix(unsigned h)
+{
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+// an uninitialised string is the empty string
+static const char *hmap_string(const heap_block_t *string)
+{
+  return string ? string->block : "";
+}
+
+static unsigned hmap_hash(hmap_key_t key, const void *data)
+{
+  switch (key) {
+  case HMAP_I32:
+  case HMAP_F32:
+    return hmap_mix(*(const unsigned*) data);
+  default: {
+    unsigned h = 2166136261u;
+    for (const unsigned char *c = (const unsigned char*) hmap_string(*(heap_block_t* const*) data); *c; c++)
+      h = (h ^ *c) * 16777619u;
+    return hmap_mix(h);
+  }
+  }
+}
+
+// f32 keys are compared by their bits, with -0 taken as 0
+static const void *hmap_norm(hmap_key_t key, const void *data, float *f32)
+{
+  if (key != HMAP_F32)
+    return data;
+  
+  *f32 = *(const float*) data;
+  if (*f32 == 0.0f)
+    *f32 = 0.0f;
+  
+  return f32;
+}
+
+static bool hmap_equal(hmap_key_t key, const char *entry, const void *data)
+{
+  if (key != HMAP_STRING)
+    return memcmp(&entry[HMAP_KEY], data, 4) == 0;
+  
+  const heap_block_t *a = *(heap_block_t* const*) &entry[HMAP_KEY];
+  const heap_block_t *b = *(heap_block_t* const*) data;
+  
+  return a == b || strcmp(hmap_string(a), hmap_string(b)) == 0;
+}
+
+// the slot holding 'data', or -1
+static int hmap_find(const heap_block_t *map, const void *data, unsigned hash)
+{
+  const hmap_t *hm = (const hmap_t*) map->block;
+  const unsigned char *ctrl = hmap_ctrl(map);
+  
+  int mask = hm->cap / HMAP_GROUP - 1;
+  int group = (hash >> 7) & mask;
+  
+  for (int step = 1; ; step++) {
+    const unsigned char *c = &ctrl[group * HMAP_GROUP];
+    
+    for (unsigned match = hmap_match(c, hash & 0x7f); match; match &= match - 1) {
+      int slot = group * HMAP_GROUP + __builtin_ctz(match);
+      const char *entry = hmap_entry(map, slot);
+      
+      if (*(const unsigned*) entry == hash && hmap_equal(hm->key, entry, data))
+        return slot;
+    }
+    
+    if (hmap_match(c, HMAP_EMPTY))
+      return -1;
+    
+    group = (group + step) & mask;
+  }
+}
+
+// the first empty or deleted slot 'hash' probes
+static int hmap_free(const heap_block_t *map, unsigned hash)
+{
+  const hmap_t *hm = (const hmap_t*) map->block;
+  const unsigned char *ctrl = hmap_ctrl(map);
+  
+  int mask = hm->cap / HMAP_GROUP - 1;
+  int group = (hash >> 7) & mask;
+  
+  for (int step = 1; ; step++) {
+    unsigned match = hmap_match_free(&ctrl[group * HMAP_GROUP]);
+    if (match)
+      return group * HMAP_GROUP + __builtin_ctz(match);
+    
+    group = (group + step) & mask;
+  }
+}
+
+static int hmap_size(int cap, int entry_size)
+{
+  return HMAP_CTRL + cap + cap * entry_size;
+}
+
+static void hmap_clear(heap_block_t *map, hmap_key_t key, int entry_size, int cap)
+{
+  hmap_t *hm = (hmap_t*) map->block;
+  hm->key = key;
+  hm->entry_size = entry_size;
+  hm->cap = cap;
+  hm->num = 0;
+  hm->num_used = 0;
+  
+  memset(hmap_ctrl(map), HMAP_EMPTY, cap);
+}
+
+heap_block_t *hmap_new(hmap_key_t key, int value_size)
+{
+  int entry_size = HMAP_VALUE + ((value_size + 7) & ~7);
+  
+  heap_block_t *map = heap_alloc(hmap_size(HMAP_GROUP, entry_size));
+  hmap_clear(map, key, entry_size, HMAP_GROUP);
+  
+  return map;
+}
+
+// the entries are moved into a table with room for as many again, or one of
+// the same size if deleted slots took up the room
+static void hmap_grow(heap_block_t *map)
+{
+  const hmap_t *hm = (const hmap_t*) map->block;
+  
+  int cap = hm->cap;
+  while ((hm->num + 1) * 16 > cap * 7)
+    cap *= 2;
+  
+  heap_block_t old = *map;
+  
+  map->size = map->cap = hmap_size(cap, hm->entry_size);
+  map->block = ZONE_ALLOC(map->size);
+  hmap_clear(map, hm->key, hm->entry_size, cap);
+  
+  hmap_t *new_hm = (hmap_t*) map->block;
+  
+  for (int slot = hmap_next(&old, 0); slot >= 0; slot = hmap_next(&old, slot + 1)) {
+    const char *entry = hmap_entry(&old, slot);
+    unsigned hash = *(const unsigned*) entry;
+    
+    int new_slot = hmap_free(map, hash);
+    hmap_ctrl(map)[new_slot] = hash & 0x7f;
+    memcpy(hmap_entry(map, new_slot), entry, new_hm->entry_size);
+  }
+  
+  new_hm->num = new_hm->num_used = ((const hmap_t*) old.block)->num;
+  
+  ZONE_FREE(old.block);
+}
+
+int hmap_length(const heap_block_t *map)
+{
+  return ((const hmap_t*) map->block)->num;
+}
+
+// the value 'key' maps to, or NULL. it moves when a key is put.
+char *hmap_get(const heap_block_t *map, const void *key)
+{
+  const hmap_t *hm = (const hmap_t*) map->block;
+  
+  float f32;
+  key = hmap_norm(hm->key, key, &f32);
+  
+  int slot = hmap_find(map, key, hmap_hash(hm->key, key));
+  if (slot < 0)
+    return NULL;
+  
+  return &hmap_entry(map, slot)[HMAP_VALUE];
+}
+
+// the value 'key' maps to, which is added if it is not already there
+char *hmap_put(heap_block_t *map, const void *key)
+{
+  hmap_t *hm = (hmap_t*) map->block;
+  
+  float f32;
+  key = hmap_norm(hm->key, key, &f32);
+  
+  unsigned hash = hmap_hash(hm->key, key);
+  
+  int slot = hmap_find(map, key, hash);
+  if (slot >= 0)
+    return &hmap_entry(map, slot)[HMAP_VALUE];
+  
+  // at least an eighth of the slots stay empty, which ends every probe
+  if ((hm->num_used + 1) * 8 > hm->cap * 7) {
+    hmap_grow(map);
+    hm = (hmap_t*) map->block;
+  }
+  
+  slot = hmap_free(map, hash);
+  
+  unsigned char *ctrl = hmap_ctrl(map);
+  if (ctrl[slot] == HMAP_EMPTY)
+    hm->num_used++;
+  
+  ctrl[slot] = hash & 0x7f;
+  hm->num++;
+  
+  char *entry = hmap_entry(map, slot);
+  memset(entry, 0, hm->entry_size);
+  *(unsigned*) entry = hash;
+  memcpy(&entry[HMAP_KEY], key, hm->key == HMAP_STRING ? sizeof(heap_block_t*) : 4);
+  
+  return &entry[HMAP_VALUE];
+}
+
+// a probe only goes past a group with no empty slot, so a slot in a group
+// which has one can be emptied, the others are marked deleted
+bool hmap_remove(heap_block_t *map, const void *key)
+{
+  hmap_t *hm = (hmap_t*) map->block;
+  
+  float f32;
+  key = hmap_norm(hm->key, key, &f32);
+  
+  int slot = hmap_find(map, key, hmap_hash(hm->key, key));
+  if (slot < 0)
+    return false;
+  
+  unsigned char *ctrl = hmap_ctrl(map);
+  
+  if (hmap_match(&ctrl[slot & ~(HMAP_GROUP - 1)], HMAP_EMPTY)) {
+    ctrl[slot] = HMAP_EMPTY;
+    hm->num_used--;
+  } else {
+    ctrl[slot] = HMAP_DELETED;
+  }
+  
+  hm->num--;
+  
+  return true;
+}
+
+// the first slot from 'slot' on which holds an entry, or -1
+int hmap_next(const heap_block_t *map, int slot)
+{
+  const hmap_t *hm = (const hmap_t*) map->block;
+  const unsigned char *ctrl = hmap_ctrl(map);
+  
+  for (; slot < hm->cap; slot++) {
+    if (!(ctrl[slot] & 0x80))
+      return slot;
+  }
+  
+  return -1;
+}
+
+char *hmap_key(const heap_block_t *map, int slot)
+{
+  return &hmap_entry(map, slot)[HMAP_KEY];
+}
+
+char *hmap_value(const heap_block_t *map, int slot)
+{
+  return &hmap_entry(map, slot)[HMAP_VALUE];
+}
@@ -0,0 +1,24 @@
+#ifndef HMAP_H
+#define HMAP_H
+
+#include "data.h"
+
+// the table behind a map, held in one heap block. keys are i32s, f32s or
+// strings, values any 'value_size' bytes, zero when first put.
+
+typedef enum {
+  HMAP_I32,
+  HMAP_F32,
+  HMAP_STRING
+} hmap_key_t;
+
+extern heap_block_t *hmap_new(hmap_key_t key, int value_size);
+extern int          hmap_length(const heap_block_t *map);
+extern char         *hmap_get(const heap_block_t *map, const void *key);
+extern char         *hmap_put(heap_block_t *map, const void *key);
+extern bool         hmap_remove(heap_block_t *map, const void *key);
+extern int          hmap_next(const heap_block_t *map, int slot);
+extern char         *hmap_key(const heap_block_t *map, int slot);
+extern char         *hmap_value(const heap_block_t *map, int slot);
+
+#endif
@@ -0,0 +1,187 @@
+#include "int_local.h"
+
+#include "sort.h"
+#include <limits.h>
+
+// arrays grow and shrink in place, their blocks keep room to grow into. an
+// soa array does not hold its elements whole, so it can only be sized.
+
+static const struct {
+  const char  *ident;
+  const char  *arg;
+  bool        soa;
+} array_method[] = {
+  // 'e' is an element, 'i' an i32, 's' a string
+  { "push",     "e",  false },
+  { "pop",      "",   false },
+  { "insert",   "ie", false },
+  { "remove",   "i",  false },
+  { "reserve",  "i",  true },
+  { "resize",   "i",  true },
+  { "sort_by",  "s",  false },
+  { "slice",    "ii", false }
+};
+
+static void array_none(expr_t *expr)
+{
+  expr->type = type_none;
+  expr->block = NULL;
+  expr->loc_base = NULL;
+  expr->loc_offset = 0;
+}
+
+bool int_array_method(scope_t *scope, expr_t *expr, const s_node_t *node, const expr_t *self)
+{
+  const lexeme_t *child_ident = node->proc.base->direct.child_ident;
+  const char *ident = child_ident->data.ident;
+  
+  int method = 0;
+  while (method < (int) (sizeof(array_method) / sizeof(array_method[0])) && strcmp(array_method[method].ident, ident) != 0)
+    method++;
+  
+  if (method == sizeof(array_method) / sizeof(array_method[0])) {
+    c_error(child_ident, "request for unknown member '%s' in array", ident);
+    return false;
+  }
+  
+  bool soa = self->type.spec == SPEC_SOA;
+  if (soa && !array_method[method].soa) {
+    c_error(child_ident, "'%s' on soa array, whose elements are spread over it", ident);
+    return false;
+  }
+  
+  // the extents of a T[,] or T[,,] are fixed
+  if (self->type.dim) {
+    c_error(child_ident, "'%s' on array '%h' of more than one dimension", ident, node->proc.base->direct.base);
+    return false;
+  }
+  
+  if (!self->block) {
+    c_error(child_ident, "call to '%s' on uninitialised array '%h'", ident, node->proc.base->direct.base);
+    return false;
+  }
+  
+  const char *want = array_method[method].arg;
+  
+  int num_arg = 0;
+  for (const s_node_t *head = node->proc.arg; head; head = head->arg.next)
+    num_arg++;
+  
+  if (num_arg != (int) strlen(want)) {
+    c_error(
+      node->proc.left_bracket,
+      "too %s arguments to function '%h'",
+      num_arg < (int) strlen(want) ? "few" : "many",
+      node);
+    return false;
+  }
+  
+  type_t elem = self->type;
+  elem.arr = false;
+  
+  expr_t arg[2];
+  const s_node_t *head = node->proc.arg;
+  for (int i = 0; i < num_arg; i++) {
+    if (!int_expr(scope, &arg[i], head->arg.body))
+      return false;
+    
+    type_t type = want[i] == 'i' ? type_i32 : want[i] == 's' ? type_string : elem;
+    
+    if (!expr_cast(&arg[i], &type)) {
+      c_error(
+        node->proc.left_bracket,
+        "expected '%z' but argument is of type '%z'",
+        &type,
+        &arg[i].type);
+      return false;
+    }
+    
+    // a struct may be an element of the array, which is about to move
+    if (type_struct(&arg[i].type))
+      temp_keep(&arg[i]);
+    
+    head = head->arg.next;
+  }
+  
+  heap_block_t *array = self->block;
+  int size = type_size(&elem);
+  int length = array->size / size;
+  
+  if (strcmp(ident, "push") == 0) {
+    heap_insert(array, length, size);
+    mem_assign(array, length * size, &elem, &arg[0]);
+    array_none(expr);
+  } else if (strcmp(ident, "pop") == 0) {
+    if (length == 0) {
+      c_error(child_ident, "pop from empty array '%h'", node->proc.base->direct.base);
+      return false;
+    }
+    
+    mem_load(array, (length - 1) * size, &elem, expr);
+    if (type_struct(&elem))
+      temp_keep(expr);
+    
+    array->size -= size;
+  } else if (strcmp(ident, "insert") == 0 || strcmp(ident, "remove") == 0) {
+    int index = arg[0].i32;
+    bool insert = ident[0] == 'i';
+    
+    if (index < 0 || index > length - (insert ? 0 : 1)) {
+      c_error(node->proc.left_bracket, "index out of bounds '%h'", node);
+      return false;
+    }
+    
+    if (insert) {
+      heap_insert(array, index, size);
+      mem_assign(array, index * size, &elem, &arg[1]);
+    } else {
+      heap_remove(array, index, size);
+    }
+    
+    array_none(expr);
+  } else if (strcmp(ident, "sort_by") == 0) {
+    // a stable sort on a numeric field of each struct or class
+    const char *field = arg[0].block ? arg[0].block->block : "";
+    const var_t *var = type_struct(&elem) || type_class(&elem) ? map_get(&elem.class->map_var, field) : NULL;
+    
+    if (!var || (!type_cmp(&var->type, &type_i32) && !type_cmp(&var->type, &type_f32))) {
+      c_error(node->proc.left_bracket, "'%s' is not an i32 or f32 field of '%z'", field, &elem);
+      return false;
+    }
+    
+    if (!sort_by(array->block, length, size, var->loc, type_cmp(&var->type, &type_f32), type_class(&elem))) {
+      c_error(child_ident, "sort_by on array '%h' with an uninitialised class", node->proc.base->direct.base);
+      return false;
+    }
+    
+    array_none(expr);
+  } else if (strcmp(ident, "slice") == 0) {
+    // elements 'lo' up to 'hi', which are not copied
+    int lo = arg[0].i32;
+    int hi = arg[1].i32;
+    
+    if (lo < 0 || lo > hi || hi > length) {
+      c_error(node->proc.left_bracket, "index out of bounds '%h'", node);
+      return false;
+    }
+    
+    expr->type = self->type;
+    expr->block = heap_slice(array, lo, hi, size);
+    expr->loc_base = NULL;
+    expr->loc_offset = 0;
+  } else {
+    if (arg[0].i32 < 0 || (long) arg[0].i32 * size > INT_MAX - SOA_RUN * size) {
+      c_error(node->proc.left_bracket, "size of array out of range '%h'", node);
+      return false;
+    }
+    
+    if (strcmp(ident, "reserve") == 0)
+      heap_reserve(array, arg[0].i32, size, soa);
+    else
+      heap_resize(array, arg[0].i32, size, soa);
+    
+    array_none(expr);
+  }
+  
+  return true;
+}
@@ -1,5 +1,23 @@
 #include "int_local.h"
 
+// a struct is copied as a whole, so its fields can not be references
+static bool struct_field(const scope_t *class, const s_node_t *node)
+{
+  const var_t *var = map_get(&class->map_var, node->decl.ident->data.ident);
+  
+  if (type_struct(&var->type) && var->type.class == class) {
+    c_error(node->decl.ident, "struct '%s' can not hold itself", class->ident);
+    return false;
+  }
+  
+  if (!type_cmp(&var->type, &type_i32) && !type_cmp(&var->type, &type_f32) && !type_struct(&var->type)) {
+    c_error(node->decl.ident, "struct '%s' can only hold i32, f32 and structs", class->ident);
+    return false;
+  }
+  
+  return true;
+}
+
 bool int_class_def(scope_t *scope, const s_node_t *node)
 {
   if (scope_find_class(scope, node->class_def.ident->data.ident)) {
@@ -10,17 +28,29 @@ bool int_class_def(scope_t *scope, const s_node_t *node)
   scope_t class;
   scope_new(&class, node->class_def.ident->data.ident, &type_none, NULL, scope, true);
   scope_t *class_scope = scope_add_class(scope, node->class_def.ident->data.ident, &class);
+  class_scope->value = node->class_def.spec->token == TK_STRUCT_DEF;
   
   s_node_t *head = node->class_def.class_decl;
   while (head) {
     switch (head->stmt.body->node_type) {
     case S_FN:
+      if (class_scope->value) {
+        c_error(
+          head->stmt.body->fn.fn_ident,
+          "struct '%s' can not have methods",
+          class_scope->ident);
+        return false;
+      }
+      
       if (!int_fn(class_scope, head->stmt.body, class_scope))
         return false;
       break;
     case S_DECL:
       if (!int_decl(class_scope, head->stmt.body, false))
         return false;
+      
+      if (class_scope->value && !struct_field(class_scope, head->stmt.body))
+        return false;
       break;
     case S_CLASS_NEW:
       if (!int_class_new(class_scope, head->stmt.body))
@@ -34,17 +64,22 @@ bool int_class_def(scope_t *scope, const s_node_t *node)
     head = head->stmt.next;
   }
   
+  if (class_scope->value && class_scope->size == 0) {
+    c_error(node->class_def.ident, "struct '%s' has no fields", class_scope->ident);
+    return false;
+  }
+  
   return true;
 }
 
-bool int_class_new(scope_t *scope, const s_node_t *node)
+bool int_class_new(scope_t *scope, s_node_t *node)
 {
   type_t type = {
-    .spec = SPEC_CLASS,
+    .spec = scope->value ? SPEC_STRUCT : SPEC_CLASS,
     .arr = false,
     .class = scope };
   
-  scope_add_fn(
+  fn_t *fn = scope_add_fn(
     scope,
     &type,
     node->class_new.param_decl,
@@ -54,6 +89,9 @@ bool int_class_new(scope_t *scope, const s_node_t *node)
     "+new",
     true);
   
+  if (!node->class_new.body)
+    fn->lazy = node;
+  
   return true;
 }
 
@@ -108,7 +146,8 @@ bool int_decl(scope_t *scope, const s_node_t *node, bool init)
   return true;
 }
 
-bool int_type(scope_t *scope, type_t *type, const s_node_t *node)
+// the type of an array_init's elements, which can be an soa
+bool int_type_elem(const scope_t *scope, type_t *type, const s_node_t *node)
 {
   type->class = NULL;
   switch (node->type.spec->token) {
@@ -122,28 +161,81 @@ bool int_type(scope_t *scope, type_t *type, const s_node_t *node)
     type->spec = SPEC_STRING;
     break;
   case TK_CLASS:
-    type->spec = SPEC_CLASS;
+  case TK_STRUCT:
+  case TK_SOA:
+    type->spec = node->type.spec->token == TK_CLASS ? SPEC_CLASS
+      : node->type.spec->token == TK_STRUCT ? SPEC_STRUCT
+      : SPEC_SOA;
     
     type->class = scope_find_class(scope, node->type.class_ident->data.ident);
     if (!type->class) {
       c_error(
         node->type.class_ident,
-        "use of undefined class '%s'",
+        "use of undefined %s '%s'",
+        type->spec == SPEC_CLASS ? "class" : "struct",
         node->type.class_ident->data.ident);
       return false;
     }
     
+    // 'class' on a struct_def names its value type, as scripts written
+    // before vec2 became a struct still do
+    if (type->spec == SPEC_CLASS && type->class->value)
+      type->spec = SPEC_STRUCT;
+    
+    if (type->class->value != (type->spec != SPEC_CLASS)) {
+      c_error(
+        node->type.class_ident,
+        "'%s' is not a %s",
+        node->type.class_ident->data.ident,
+        type->spec == SPEC_CLASS ? "class" : "struct");
+      return false;
+    }
+    
+    break;
+  case TK_MAP:
+  case TK_MAP_INIT:
+    type->spec = SPEC_MAP;
+    type->class = int_map_type(scope, node);
+    if (!type->class)
+      return false;
     break;
   }
   
   type->arr = node->type.left_bracket != NULL;
+  type->dim = node->type.dim;
+  
+  if (type->dim > GRID_DIM) {
+    c_error(node->type.left_bracket, "array has more than %i dimensions", GRID_DIM);
+    return false;
+  }
+  
+  if (type->dim && type->spec == SPEC_SOA) {
+    c_error(node->type.left_bracket, "soa array can only have one dimension");
+    return false;
+  }
   
   return true;
 }
 
-bool int_fn(scope_t *scope, const s_node_t *node, const scope_t *scope_class)
+// an soa element is spread over its array, so only soa arrays can be held
+bool int_type(const scope_t *scope, type_t *type, const s_node_t *node)
 {
-  if (node->fn.body) {
+  if (!int_type_elem(scope, type, node))
+    return false;
+  
+  if (type_soa(type)) {
+    c_error(node->type.class_ident, "soa '%s' must be an array", type->class->ident);
+    return false;
+  }
+  
+  return true;
+}
+
+bool int_fn(scope_t *scope, s_node_t *node, const scope_t *scope_class)
+{
+  bool has_body = node->fn.body || node->fn.lazy_body;
+  
+  if (has_body) {
     if (scope_find_fn(scope, node->fn.fn_ident->data.ident)) {
       c_error(node->fn.fn_ident, "redefinition of function '%s'", node->fn.fn_ident->data.ident);
       return false;
@@ -156,7 +248,7 @@ bool int_fn(scope_t *scope, const s_node_t *node, const scope_t *scope_class)
       return false;
   }
   
-  if (!node->fn.body) {
+  if (!has_body) {
     fn_t *fn = scope_find_fn(scope, node->fn.fn_ident->data.ident);
     
     if (!fn) {
@@ -170,7 +262,7 @@ bool int_fn(scope_t *scope, const s_node_t *node, const scope_t *scope_class)
     fn->type = type;
     fn->param = node->fn.param_decl;
   } else {
-    scope_add_fn(
+    fn_t *fn = scope_add_fn(
       scope,
       &type,
       node->fn.param_decl,
@@ -179,8 +271,21 @@ bool int_fn(scope_t *scope, const s_node_t *node, const scope_t *scope_class)
       scope_class,
       node->fn.fn_ident->data.ident,
       false);
+    
+    if (!node->fn.body)
+      fn->lazy = node;
   }
   
   return true;
 }
 
+// bodies skipped by the parser are parsed on the first call
+bool int_fn_body(fn_t *fn)
+{
+  if (!fn->node && fn->lazy) {
+    fn->node = s_lazy_body(fn->lazy);
+    fn->lazy = NULL;
+  }
+  
+  return fn->node || fn->xaction;
+}
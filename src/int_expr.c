@@ -1,5 +1,7 @@
 #include "int_local.h"
 
+#include "zone.h"
+
 bool int_expr(scope_t *scope, expr_t *expr, const s_node_t *node)
 {
   switch (node->node_type) {
@@ -29,9 +31,37 @@ bool int_expr(scope_t *scope, expr_t *expr, const s_node_t *node)
 
 bool int_proc(scope_t *scope, expr_t *expr, const s_node_t *node)
 {
+  const s_node_t *base_node = node->proc.base;
+  
   expr_t base;
-  if (!int_expr(scope, &base, node->proc.base))
+  if (base_node->node_type == S_DIRECT) {
+    expr_t self;
+    if (!int_expr(scope, &self, base_node->direct.base))
+      return false;
+    
+    // the methods of a struct of f32s are built in
+    if (int_vec_size(&self.type))
+      return int_vec_method(scope, expr, node, &self);
+    
+    if (type_array(&self.type))
+      return int_array_method(scope, expr, node, &self);
+    
+    if (type_map(&self.type))
+      return int_map_method(scope, expr, node, &self);
+    
+    if (!int_member(&base, base_node, &self))
+      return false;
+  } else if (base_node->node_type == S_NEW) {
+    // a struct_def without a constructor is filled in from its fields in order
+    const scope_t *class = scope_find_class(scope, base_node->new.class_ident->data.ident);
+    if (class && class->value && !map_get(&class->map_fn, "+new"))
+      return int_struct_new(scope, expr, node, class);
+    
+    if (!int_expr(scope, &base, base_node))
+      return false;
+  } else if (!int_expr(scope, &base, base_node)) {
     return false;
+  }
   
   if (!type_fn(&base.type)) {
     c_error(
@@ -49,13 +79,15 @@ bool int_proc(scope_t *scope, expr_t *expr, const s_node_t *node)
     return false;
   }
   
-  if (!fn->node && !fn->xaction) {
+  if (!int_fn_body(fn)) {
     c_error(
       node->proc.left_bracket,
       "attempt to call function without body");
     return false;
   }
   
+  jit_hot(fn);
+  
   scope_t new_scope;
   if (fn->scope_class) {
     scope_new(&new_scope, NULL, &fn->type, scope, fn->scope_parent->scope_find, true);
@@ -65,6 +97,7 @@ bool int_proc(scope_t *scope, expr_t *expr, const s_node_t *node)
     self_expr.type.spec = SPEC_CLASS;
     self_expr.type.arr = false;
     self_expr.type.class = fn->scope_class;
+    self_expr.type.dim = 0;
     self_expr.block = base.loc_base;
     self_expr.loc_base = NULL;
     self_expr.loc_offset = 0;
@@ -77,6 +110,7 @@ bool int_proc(scope_t *scope, expr_t *expr, const s_node_t *node)
   }
   
   new_scope.ret_type = fn->type;
+  new_scope.tail = !fn->is_new;
   
   s_node_t *arg = node->proc.arg;
   s_node_t *head = fn->param;
@@ -130,15 +164,11 @@ bool int_proc(scope_t *scope, expr_t *expr, const s_node_t *node)
     goto err_cleanup;
   }
   
-  if (fn->node) {
-    if (!int_body(&new_scope, fn->node)) {
+  if (!int_fn_run(&new_scope, fn, base.loc_base)) {
 err_cleanup:
-      scope_free(&new_scope);
-      scope->scope_child = NULL;
-      return false;
-    }
-  } else {
-    fn->xaction(&new_scope.ret_value, &new_scope);
+    scope_free(&new_scope);
+    scope->scope_child = NULL;
+    return false;
   }
   
   if (fn->is_new) {
@@ -146,13 +176,24 @@ err_cleanup:
     self_expr.type.spec = SPEC_CLASS;
     self_expr.type.arr = false;
     self_expr.type.class = fn->scope_class;
+    self_expr.type.dim = 0;
     self_expr.block = base.loc_base;
     self_expr.loc_base = NULL;
     self_expr.loc_offset = 0;
     
+    // a new struct is the block its constructor filled in
+    if (fn->scope_class->value) {
+      self_expr.type.spec = SPEC_STRUCT;
+      self_expr.block = NULL;
+      self_expr.loc_base = base.loc_base;
+    }
+    
     *expr = self_expr;
   } else {
     *expr = new_scope.ret_value;
+    
+    if (type_struct(&expr->type))
+      temp_keep(expr);
   }
   
   scope_free(&new_scope);
@@ -161,6 +202,73 @@ err_cleanup:
   return true;
 }
 
+// run a function whose params are bound in 'scope'. a tail call it makes is
+// run next in the same scope, so tail recursion takes no stack. the value
+// the last call returns must have the type the first was called for.
+bool int_fn_run(scope_t *scope, fn_t *fn, heap_block_t *self)
+{
+  const s_node_t *tail_node = NULL;
+  
+  while (true) {
+    if (fn->jit || fn->exe) {
+      if (!jit_run(fn, scope, self))
+        return false;
+    } else if (fn->node) {
+      if (!int_body(scope, fn->node))
+        return false;
+    } else {
+      fn->xaction(&scope->ret_value, scope);
+    }
+    
+    if (!scope->tail_fn)
+      break;
+    
+    fn = scope->tail_fn;
+    tail_node = scope->tail_node;
+    expr_t *arg = scope->tail_arg;
+    
+    scope_t *scope_parent = scope->scope_parent;
+    type_t ret_type = scope->ret_type;
+    
+    scope_free(scope);
+    scope_new(scope, NULL, &ret_type, scope_parent, fn->scope_parent, true);
+    scope->size += scope_parent->size;
+    scope->tail = true;
+    
+    s_node_t *head = fn->param;
+    for (int i = 0; head; i++) {
+      var_t *var = scope_add_var(scope, &arg[i].type, head->param_decl.ident->data.ident);
+      if (!var) {
+        c_error(
+          head->param_decl.ident,
+          "redefinition of param '%s'",
+          head->param_decl.ident->data.ident);
+        ZONE_FREE(arg);
+        return false;
+      }
+      mem_assign(stack_mem, var->loc, &var->type, &arg[i]);
+      
+      head = head->param_decl.next;
+    }
+    
+    if (arg)
+      ZONE_FREE(arg);
+    
+    self = NULL;
+  }
+  
+  if (tail_node && !type_cmp(&scope->ret_value.type, &scope->ret_type)) {
+    c_error(
+      tail_node->ret_stmt.ret_token,
+      "incompatible types when returning type '%z' but '%z' was expected",
+      &scope->ret_value.type,
+      &scope->ret_type);
+    return false;
+  }
+  
+  return true;
+}
+
 bool int_unary(scope_t *scope, expr_t *expr, const s_node_t *node)
 {  
   expr_t rhs;
@@ -177,7 +285,7 @@ bool int_unary(scope_t *scope, expr_t *expr, const s_node_t *node)
     } else if (type_cmp(&rhs.type, &type_f32)) {
       expr->f32 = -rhs.f32;
       expr->type = type_f32;
-    } else
+    } else if (!int_vec_neg(expr, &rhs))
       goto err_no_op;
   } else if (node->unary.op->token == '!') {
     if (type_cmp(&rhs.type, &type_i32)) {
@@ -395,8 +503,24 @@ bool int_binop(scope_t *scope, expr_t *expr, const s_node_t *node)
       expr->loc_base = lhs.loc_base;
       expr->loc_offset = lhs.loc_offset;
       lhs = *expr;
+    } else if (type_struct(&lhs.type)) {
+      // 'v += w' is 'v = v + w', which must keep the type of v
+      if (node->binop.op->token != '=') {
+        char op = "+-*/"[node->binop.op->token - TK_ADD_ASSIGN];
+        if (!int_vec_binop(expr, &lhs, op, &rhs) || !type_cmp(&expr->type, &lhs.type))
+          goto err_no_op;
+        rhs = *expr;
+      } else if (!type_cmp(&lhs.type, &rhs.type)) {
+        goto err_no_op;
+      }
+      
+      mem_assign(lhs.loc_base, lhs.loc_offset, &lhs.type, &rhs);
+      *expr = lhs;
+      
+      return true;
     } else if ((type_class(&lhs.type) && type_class(&rhs.type))
     || (type_array(&lhs.type) && type_array(&rhs.type))
+    || (type_map(&lhs.type) && type_cmp(&lhs.type, &rhs.type))
     || (type_cmp(&lhs.type, &type_string) && type_cmp(&rhs.type, &type_string))
     && type_cmp(&lhs.type, &rhs.type)) {
       switch (node->binop.op->token) {
@@ -417,6 +541,9 @@ bool int_binop(scope_t *scope, expr_t *expr, const s_node_t *node)
     if (type_cmp(&lhs.type, &type_i32) && type_cmp(&rhs.type, &type_i32)) {
       if (!binop_i32(expr, &lhs, node->binop.op->token, &rhs))
         goto err_no_op;
+    } else if (int_vec_size(&lhs.type) || int_vec_size(&rhs.type)) {
+      if (!int_vec_binop(expr, &lhs, node->binop.op->token, &rhs))
+        goto err_no_op;
     } else if (expr_cast(&lhs, &type_f32) && expr_cast(&rhs, &type_f32)) {
       if (!binop_f32(expr, &lhs, node->binop.op->token, &rhs))
         goto err_no_op;
@@ -440,8 +567,19 @@ err_no_op:
 
 static bool array_direct(expr_t *expr, const s_node_t *node, const expr_t *base)
 {
-  if (strcmp(node->direct.child_ident->data.ident, "length") == 0) {
+  const char *ident = node->direct.child_ident->data.ident;
+  
+  // the extents of a T[,] or T[,,], whose length is all its elements
+  if (strcmp(ident, "length") == 0) {
     expr_i32(expr, base->block->size / type_size_base(&base->type));
+  } else if (strcmp(ident, "capacity") == 0) {
+    expr_i32(expr, base->block->cap / type_size_base(&base->type));
+  } else if (base->type.dim && strcmp(ident, "rows") == 0) {
+    expr_i32(expr, base->block->rows);
+  } else if (base->type.dim && strcmp(ident, "cols") == 0) {
+    expr_i32(expr, base->block->cols);
+  } else if (base->type.dim == 3 && strcmp(ident, "layers") == 0) {
+    expr_i32(expr, base->block->layers);
   } else {
     c_error(
       node->direct.child_ident,
@@ -459,10 +597,64 @@ bool int_direct(scope_t *scope, expr_t *expr, const s_node_t *node)
   if (!int_expr(scope, &base, node->direct.base))
     return false;
   
-  if (type_array(&base.type))
-    return array_direct(expr, node, &base);
+  return int_member(expr, node, &base);
+}
+
+// the member a direct node names in its evaluated base
+bool int_member(expr_t *expr, const s_node_t *node, const expr_t *base)
+{
+  if (type_array(&base->type))
+    return array_direct(expr, node, base);
+  
+  if (type_map(&base->type)) {
+    if (strcmp(node->direct.child_ident->data.ident, "length") != 0) {
+      c_error(
+        node->direct.child_ident,
+        "request for unknown member '%s' in map",
+        node->direct.child_ident->data.ident);
+      return false;
+    }
+    
+    expr_i32(expr, int_map_length(base));
+    return true;
+  }
+  
+  if (type_struct(&base->type)) {
+    const var_t *var = map_get(&base->type.class->map_var, node->direct.child_ident->data.ident);
+    if (!var) {
+      c_error(
+        node->direct.child_ident,
+        "'struct %s' has no member named '%s'",
+        base->type.class->ident,
+        node->direct.child_ident->data.ident);
+      return false;
+    }
+    
+    mem_load(base->loc_base, base->loc_offset + var->loc, &var->type, expr);
+    return true;
+  }
   
-  if (!type_class(&base.type)) {
+  if (type_soa(&base->type)) {
+    const var_t *var = map_get(&base->type.class->map_var, node->direct.child_ident->data.ident);
+    if (!var) {
+      c_error(
+        node->direct.child_ident,
+        "'soa %s' has no member named '%s'",
+        base->type.class->ident,
+        node->direct.child_ident->data.ident);
+      return false;
+    }
+    
+    // a struct field stays spread over the array with the rest of the element
+    type_t type = var->type;
+    if (type_struct(&type))
+      type.spec = SPEC_SOA;
+    
+    mem_load(base->loc_base, base->loc_offset + var->loc * SOA_RUN, &type, expr);
+    return true;
+  }
+  
+  if (!type_class(&base->type)) {
     c_error(
       node->direct.child_ident,
       "request for member '%s' in non-class",
@@ -470,7 +662,7 @@ bool int_direct(scope_t *scope, expr_t *expr, const s_node_t *node)
     return false;
   }
   
-  if (!base.block) {
+  if (!base->block) {
     c_error(
       node->direct.child_ident,
       "request for member '%s' in uninitialised class",
@@ -478,11 +670,11 @@ bool int_direct(scope_t *scope, expr_t *expr, const s_node_t *node)
     return false;
   }
   
-  if (!int_load_ident(base.type.class, base.block, expr, node->direct.child_ident)) {
+  if (!int_load_ident(base->type.class, base->block, expr, node->direct.child_ident)) {
     c_error(
       node->direct.child_ident,
       "'class %s' has no member named '%s'",
-      base.type.class->ident,
+      base->type.class->ident,
       node->direct.child_ident->data.ident);
     return false;
   }
@@ -490,6 +682,54 @@ bool int_direct(scope_t *scope, expr_t *expr, const s_node_t *node)
   return true;
 }
 
+// a T[,] or T[,,] takes an i32 for each dimension, which are each checked
+static bool grid_index(scope_t *scope, expr_t *expr, const s_node_t *node, const expr_t *base)
+{
+  int index[GRID_DIM];
+  
+  const s_node_t *head = node->index.index;
+  for (int i = 0; i < base->type.dim; i++) {
+    expr_t value;
+    if (!int_expr(scope, &value, head->arg.body))
+      return false;
+    
+    if (!type_cmp(&value.type, &type_i32)) {
+      c_error(
+        node->index.left_bracket,
+        "array subscript is of type '%z', not 'i32' '%h'",
+        &value.type,
+        node);
+      return false;
+    }
+    
+    index[i] = value.i32;
+    head = head->arg.next;
+  }
+  
+  if (!base->block) {
+    c_error(
+      node->index.left_bracket,
+      "cannot index into uninitialised array '%h'",
+      node->index.base);
+    return false;
+  }
+  
+  int element = heap_grid_index(base->block, index, base->type.dim);
+  if (element < 0) {
+    c_error(node->index.left_bracket, "index out of bounds '%h'", node);
+    return false;
+  }
+  
+  *expr = *base;
+  expr->type.arr = false;
+  expr->type.dim = 0;
+  expr->loc_base = base->block;
+  expr->loc_offset = element * type_size_base(&base->type);
+  mem_load(expr->loc_base, expr->loc_offset, &expr->type, expr);
+  
+  return true;
+}
+
 bool int_index(scope_t *scope, expr_t *expr, const s_node_t *node)
 {
   expr_t base;
@@ -501,6 +741,18 @@ bool int_index(scope_t *scope, expr_t *expr, const s_node_t *node)
     return false;
   }
   
+  int num_index = 0;
+  for (const s_node_t *head = node->index.index; head && head->node_type == S_ARG; head = head->arg.next)
+    num_index++;
+  
+  if (num_index != base.type.dim) {
+    c_error(node->index.left_bracket, "wrong number of indices to array '%h'", node->index.base);
+    return false;
+  }
+  
+  if (base.type.dim)
+    return grid_index(scope, expr, node, &base);
+  
   expr_t index;
   if (!int_expr(scope, &index, node->index.index))
     return false;
@@ -514,20 +766,25 @@ bool int_index(scope_t *scope, expr_t *expr, const s_node_t *node)
     return false;
   }
   
-  int offset = index.i32 * type_size_base(&base.type);
+  int size = type_size_base(&base.type);
   
-  if (!base.block) {
-    c_error(
-      node->index.left_bracket,
-      "cannot index into uninitialised array '%h'",
-      node->index.base);
-    return false;
+  // indices -O has proven in range are not checked
+  if (!node->index.in_range) {
+    if (!base.block) {
+      c_error(
+        node->index.left_bracket,
+        "cannot index into uninitialised array '%h'",
+        node->index.base);
+      return false;
+    }
+    
+    if (index.i32 < 0 || (long) index.i32 * size >= base.block->size) {
+      c_error(node->index.left_bracket, "index out of bounds '%h'", node);
+      return false;
+    }
   }
   
-  if (offset >= base.block->size) {
-    c_error(node->index.left_bracket, "index out of bounds '%h'", node);
-    return false;
-  }
+  int offset = base.type.spec == SPEC_SOA ? soa_offset(size, index.i32) : index.i32 * size;
   
   *expr = base;
   expr->type.arr = false;
@@ -561,6 +818,7 @@ bool int_new(scope_t *scope, expr_t *expr, const s_node_t *node)
   expr->type.spec = SPEC_FN;
   expr->type.arr = false;
   expr->type.class = NULL;
+  expr->type.dim = 0;
   expr->fn = fn;
   expr->loc_base = heap_block;
   expr->loc_offset = 0;
@@ -568,12 +826,121 @@ bool int_new(scope_t *scope, expr_t *expr, const s_node_t *node)
   return true;
 }
 
+// 'new' on a struct_def without a constructor takes a value for each field,
+// in the order they are declared
+bool int_struct_new(scope_t *scope, expr_t *expr, const s_node_t *node, const scope_t *class)
+{
+  expr->type = (type_t) { .spec = SPEC_STRUCT, .arr = false, .class = class };
+  expr->block = NULL;
+  expr->loc_base = temp_mem;
+  expr->loc_offset = temp_alloc(class->size);
+  
+  int num_field = 0;
+  for (const entry_t *entry = class->map_var.start; entry; entry = entry->s_next)
+    num_field++;
+  
+  int num_arg = 0;
+  for (const s_node_t *arg = node->proc.arg; arg; arg = arg->arg.next)
+    num_arg++;
+  
+  if (num_arg != num_field) {
+    c_error(
+      node->proc.left_bracket,
+      "too %s arguments to function '%h'",
+      num_arg < num_field ? "few" : "many",
+      node);
+    return false;
+  }
+  
+  int loc = -1;
+  for (const s_node_t *arg = node->proc.arg; arg; arg = arg->arg.next) {
+    const var_t *field = NULL;
+    for (const entry_t *entry = class->map_var.start; entry; entry = entry->s_next) {
+      const var_t *var = entry->value;
+      if (var->loc > loc && (!field || var->loc < field->loc))
+        field = var;
+    }
+    
+    expr_t arg_value;
+    if (!int_expr(scope, &arg_value, arg->arg.body))
+      return false;
+    
+    if (!expr_cast(&arg_value, &field->type)) {
+      c_error(
+        node->proc.left_bracket,
+        "expected '%z' but argument is of type '%z'",
+        &field->type,
+        &arg_value.type);
+      return false;
+    }
+    
+    mem_assign(expr->loc_base, expr->loc_offset + field->loc, &field->type, &arg_value);
+    loc = field->loc;
+  }
+  
+  return true;
+}
+
+// 'array_init<T>(rows, cols)' or '(layers, rows, cols)' makes a T[,] or T[,,]
+static bool grid_init(scope_t *scope, expr_t *expr, const s_node_t *node, const type_t *type)
+{
+  if (type_soa(type)) {
+    c_error(node->array_init.array_init, "soa array can only have one dimension");
+    return false;
+  }
+  
+  int extent[GRID_DIM];
+  int dim = 0;
+  
+  for (const s_node_t *head = node->array_init.size; head; head = head->arg.next) {
+    if (dim == GRID_DIM) {
+      c_error(node->array_init.array_init, "array has more than %i dimensions", GRID_DIM);
+      return false;
+    }
+    
+    expr_t size;
+    if (!int_expr(scope, &size, head->arg.body))
+      return false;
+    
+    if (!type_cmp(&size.type, &type_i32)) {
+      c_error(
+        node->array_init.array_init,
+        "size of array has non-integer type");
+      return false;
+    }
+    
+    extent[dim++] = size.i32;
+  }
+  
+  expr->type = *type;
+  expr->type.arr = true;
+  expr->type.dim = dim;
+  expr->block = heap_alloc_grid(extent, dim, type_size(type));
+  expr->loc_base = NULL;
+  expr->loc_offset = 0;
+  
+  if (!expr->block) {
+    c_error(node->array_init.array_init, "size of array out of range");
+    return false;
+  }
+  
+  return true;
+}
+
 bool int_array_init(scope_t *scope, expr_t *expr, const s_node_t *node)
 {
+  if (node->array_init.array_init->token == TK_MAP_INIT)
+    return int_map_init(scope, expr, node);
+  
   type_t type;
-  if (!int_type(scope, &type, node->array_init.type))
+  if (!int_type_elem(scope, &type, node->array_init.type))
     return false;
   
+  if (node->array_init.init && type_soa(&type)) {
+    c_error(node->array_init.array_init, "soa array can only be initialized by size");
+    return false;
+  }
+  
   if (node->array_init.init) {
     int size = 0;
     s_node_t *head = node->array_init.init;
@@ -610,6 +977,8 @@ bool int_array_init(scope_t *scope, expr_t *expr, const s_node_t *node)
       num_arg++;
       head = head->arg.next;
     }
+  } else if (node->array_init.size && node->array_init.size->node_type == S_ARG) {
+    return grid_init(scope, expr, node, &type);
   } else if (node->array_init.size) {
     expr_t size;
     if (!int_expr(scope, &size, node->array_init.size))
@@ -624,9 +993,17 @@ bool int_array_init(scope_t *scope, expr_t *expr, const s_node_t *node)
     
     expr->type = type;
     expr->type.arr = true;
-    expr->block = heap_alloc(size.i32 * type_size(&type));
     expr->loc_base = NULL;
     expr->loc_offset = 0;
+    
+    // the last run of an soa array is filled out, its size is only the elements
+    if (type_soa(&type)) {
+      int num_run = (size.i32 + SOA_RUN - 1) / SOA_RUN;
+      expr->block = heap_alloc(num_run * SOA_RUN * type_size(&type));
+      expr->block->size = size.i32 * type_size(&type);
+    } else {
+      expr->block = heap_alloc(size.i32 * type_size(&type));
+    }
   } else {
     LOG_ERROR("missing size or init");
     return false;
@@ -7,37 +7,73 @@
 #include "mem.h"
 #include <string.h>
 
+// how a statement completes. an error is 0 so '!int_stmt()' still tests
+// for one
+typedef enum {
+  CTRL_ERROR,
+  CTRL_NEXT,
+  CTRL_BREAK,
+  CTRL_CONTINUE,
+  CTRL_RETURN
+} ctrl_t;
+
 // int_main.c
 extern bool int_load_ident(const scope_t *scope, heap_block_t *heap_block, expr_t *expr, const lexeme_t *lexeme);
 
 // int_stmt.h
-extern bool int_body(scope_t *scope, const s_node_t *node);
-extern bool int_body_scope(scope_t *scope, const s_node_t *node);
-extern bool int_stmt(scope_t *scope, const s_node_t *node);
+extern ctrl_t int_body(scope_t *scope, const s_node_t *node);
+extern ctrl_t int_body_scope(scope_t *scope, const s_node_t *node);
+extern ctrl_t int_stmt(scope_t *scope, const s_node_t *node);
 extern bool int_print(scope_t *scope, const s_node_t *node);
-extern bool int_ret_stmt(scope_t *scope, const s_node_t *node);
-extern bool int_if_stmt(scope_t *scope, const s_node_t *node);
-extern bool int_ctrl_stmt(scope_t *scope, const s_node_t *node);
-extern bool int_while_stmt(scope_t *scope, const s_node_t *node);
-extern bool int_for_stmt(scope_t *scope, const s_node_t *node);
+extern ctrl_t int_ret_stmt(scope_t *scope, const s_node_t *node);
+extern ctrl_t int_if_stmt(scope_t *scope, const s_node_t *node);
+extern ctrl_t int_ctrl_stmt(scope_t *scope, const s_node_t *node);
+extern ctrl_t int_while_stmt(scope_t *scope, const s_node_t *node);
+extern ctrl_t int_for_stmt(scope_t *scope, const s_node_t *node);
 
 // int_decl.h
-extern bool int_fn(scope_t *scope, const s_node_t *node, const scope_t *scope_class);
+extern bool int_fn(scope_t *scope, s_node_t *node, const scope_t *scope_class);
 extern bool int_decl(scope_t *scope, const s_node_t *node, bool init);
 extern bool int_class_def(scope_t *scope, const s_node_t *node);
-extern bool int_class_new(scope_t *scope, const s_node_t *node);
-extern bool int_type(scope_t *scope, type_t *type, const s_node_t *node);
+extern bool int_class_new(scope_t *scope, s_node_t *node);
+extern bool int_type(const scope_t *scope, type_t *type, const s_node_t *node);
+extern bool int_type_elem(const scope_t *scope, type_t *type, const s_node_t *node);
+extern bool int_fn_body(fn_t *fn);
 
 // int_expr.h
 extern bool int_expr(scope_t *scope, expr_t *expr, const s_node_t *node);
 extern bool int_unary(scope_t *scope, expr_t *expr, const s_node_t *node);
 extern bool int_index(scope_t *scope, expr_t *expr, const s_node_t *node);
 extern bool int_direct(scope_t *scope, expr_t *expr, const s_node_t *node);
+extern bool int_member(expr_t *expr, const s_node_t *node, const expr_t *base);
 extern bool int_proc(scope_t *scope, expr_t *expr, const s_node_t *node);
+extern bool int_fn_run(scope_t *scope, fn_t *fn, heap_block_t *self);
 extern bool int_binop(scope_t *scope, expr_t *expr, const s_node_t *node);
 extern bool int_constant(scope_t *scope, expr_t *expr, const s_node_t *node);
 extern bool int_new(scope_t *scope, expr_t *expr, const s_node_t *node);
+extern bool int_struct_new(scope_t *scope, expr_t *expr, const s_node_t *node, const scope_t *class);
 extern bool int_array_init(scope_t *scope, expr_t *expr, const s_node_t *node);
 extern bool int_post_op(scope_t *scope, expr_t *expr, const s_node_t *node);
 
+// int_array.c
+extern bool           int_array_method(scope_t *scope, expr_t *expr, const s_node_t *node, const expr_t *self);
+
+// int_map.c
+extern const scope_t  *int_map_type(const scope_t *scope, const s_node_t *node);
+extern void           int_map_free();
+extern bool           int_map_init(scope_t *scope, expr_t *expr, const s_node_t *node);
+extern int            int_map_length(const expr_t *map);
+extern bool           int_map_method(scope_t *scope, expr_t *expr, const s_node_t *node, const expr_t *self);
+
+// int_vec.c
+extern int            int_vec_size(const type_t *type);
+extern const scope_t  *int_vec_col(const type_t *type);
+extern bool           int_vec_neg(expr_t *expr, const expr_t *rhs);
+extern bool           int_vec_binop(expr_t *expr, const expr_t *lhs, token_t op, const expr_t *rhs);
+extern bool           int_vec_method(scope_t *scope, expr_t *expr, const s_node_t *node, const expr_t *self);
+
+// jit.c
+extern void jit_hot(fn_t *fn);
+extern bool jit_run(fn_t *fn, scope_t *scope, heap_block_t *self);
+
 #endif
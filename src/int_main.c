@@ -10,7 +10,7 @@ void int_init()
 
 bool int_run(const s_node_t *node)
 {
-  return int_body(&scope_global, node);
+  return int_body(&scope_global, node) != CTRL_ERROR;
 }
 
 void int_stop()
@@ -20,6 +20,7 @@ void int_stop()
   
   heap_clean(&scope_global);
   stack_clean();
+  int_map_free();
 }
 
 bool int_call(const char *ident, expr_t *arg_list, int num_arg_list)
@@ -30,9 +31,17 @@ bool int_call(const char *ident, expr_t *arg_list, int num_arg_list)
     return false;
   }
   
+  if (!int_fn_body(fn)) {
+    printf("int_call: error: %s(): function has no body\n", ident);
+    return false;
+  }
+  
+  jit_hot(fn);
+  
   scope_t new_scope;
   scope_new(&new_scope, NULL, &fn->type, &scope_global, fn->scope_parent, true);
   new_scope.size += scope_global.size;
+  new_scope.tail = true;
   
   int arg_num = 0;
   s_node_t *head = fn->param;
@@ -69,7 +78,7 @@ bool int_call(const char *ident, expr_t *arg_list, int num_arg_list)
     goto err_cleanup;
   }
   
-  if (!int_body(&new_scope, fn->node)) {
+  if (!int_fn_run(&new_scope, fn, NULL)) {
 err_cleanup:
     scope_free(&new_scope);
     return false;
@@ -80,6 +89,33 @@ err_cleanup:
   return true;
 }
 
+// call a function bound with int_bind() without a script prototype, 'param'
+// names the arguments for int_arg_load()
+bool int_call_bind(const char *ident, expr_t *ret_value, const char *param[], expr_t *arg_list, int num_arg_list)
+{
+  fn_t *fn = scope_find_fn(&scope_global, ident);
+  if (!fn || !fn->xaction) {
+    printf("int_call_bind: error: function '%s' unbound\n", ident);
+    return false;
+  }
+  
+  scope_t new_scope;
+  scope_new(&new_scope, NULL, &fn->type, &scope_global, fn->scope_parent, true);
+  new_scope.size += scope_global.size;
+  
+  for (int i = 0; i < num_arg_list; i++) {
+    var_t *var = scope_add_var(&new_scope, &arg_list[i].type, param[i]);
+    mem_assign(stack_mem, var->loc, &var->type, &arg_list[i]);
+  }
+  
+  fn->xaction(&new_scope.ret_value, &new_scope);
+  *ret_value = new_scope.ret_value;
+  
+  scope_free(&new_scope);
+  
+  return true;
+}
+
 void int_bind(const char *ident, xaction_t xaction)
 {
   scope_add_fn(
@@ -116,6 +152,7 @@ bool int_load_ident(const scope_t *scope, heap_block_t *heap_block, expr_t *expr
     expr->type.spec = SPEC_FN;
     expr->type.arr = false;
     expr->type.class = NULL;
+    expr->type.dim = 0;
     expr->fn = fn;
     expr->loc_offset = 0;
     expr->loc_base = heap_block;
@@ -10,6 +10,7 @@ extern bool int_run(const s_node_t *node);
 extern void int_stop();
 
 extern bool int_call(const char *ident, expr_t *arg_list, int num_arg_list);
+extern bool int_call_bind(const char *ident, expr_t *ret_value, const char *param[], expr_t *arg_list, int num_arg_list);
 extern void int_bind(const char *ident, xaction_t xaction);
 extern bool int_arg_load(const scope_t *scope, expr_t *expr, char *ident);
 
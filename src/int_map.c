@@ -0,0 +1,223 @@
+#include "int_local.h"
+
+#include "hmap.h"
+#include "zone.h"
+
+// each map type is one 'class' holding its key and value types, made the
+// first time it is named so that type_cmp() can tell map types apart.
+
+typedef struct map_type_s {
+  scope_t           scope;
+  struct map_type_s *next;
+} map_type_t;
+
+static map_type_t *map_type_list = NULL;
+
+static const struct {
+  const char  *ident;
+  const char  *arg;
+} map_method[] = {
+  // 'k' is a key, 'v' a value
+  { "put",      "kv" },
+  { "get",      "k" },
+  { "contains", "k" },
+  { "remove",   "k" },
+  { "keys",     "" },
+  { "values",   "" }
+};
+
+static const type_t *map_key(const type_t *type)
+{
+  return &((const var_t*) map_get(&type->class->map_var, "key"))->type;
+}
+
+static const type_t *map_value(const type_t *type)
+{
+  return &((const var_t*) map_get(&type->class->map_var, "value"))->type;
+}
+
+const scope_t *int_map_type(const scope_t *scope, const s_node_t *node)
+{
+  type_t key, value;
+  if (!int_type(scope, &key, node->type.key) || !int_type(scope, &value, node->type.value))
+    return NULL;
+  
+  if (!type_cmp(&key, &type_i32) && !type_cmp(&key, &type_f32) && !type_cmp(&key, &type_string)) {
+    c_error(node->type.key->type.spec, "map key must be 'i32', 'f32' or 'string', not '%z'", &key);
+    return NULL;
+  }
+  
+  for (const map_type_t *head = map_type_list; head; head = head->next) {
+    const type_t type = { .spec = SPEC_MAP, .arr = false, .class = &head->scope };
+    if (type_cmp(map_key(&type), &key) && type_cmp(map_value(&type), &value))
+      return &head->scope;
+  }
+  
+  map_type_t *map_type = ZONE_ALLOC(sizeof(map_type_t));
+  scope_new(&map_type->scope, "map", &type_none, NULL, NULL, false);
+  scope_add_var(&map_type->scope, &key, "key");
+  scope_add_var(&map_type->scope, &value, "value");
+  
+  map_type->next = map_type_list;
+  map_type_list = map_type;
+  
+  return &map_type->scope;
+}
+
+void int_map_free()
+{
+  while (map_type_list) {
+    map_type_t *next = map_type_list->next;
+    scope_free(&map_type_list->scope);
+    ZONE_FREE(map_type_list);
+    map_type_list = next;
+  }
+}
+
+bool int_map_init(scope_t *scope, expr_t *expr, const s_node_t *node)
+{
+  type_t type;
+  if (!int_type(scope, &type, node->array_init.type))
+    return false;
+  
+  const type_t *key = map_key(&type);
+  hmap_key_t hmap_key = type_cmp(key, &type_i32) ? HMAP_I32 : type_cmp(key, &type_f32) ? HMAP_F32 : HMAP_STRING;
+  
+  expr->type = type;
+  expr->block = hmap_new(hmap_key, type_size(map_value(&type)));
+  expr->loc_base = NULL;
+  expr->loc_offset = 0;
+  
+  return true;
+}
+
+int int_map_length(const expr_t *map)
+{
+  return map->block ? hmap_length(map->block) : 0;
+}
+
+static const void *map_key_ptr(const expr_t *key)
+{
+  if (type_cmp(&key->type, &type_string))
+    return &key->block;
+  
+  return type_cmp(&key->type, &type_f32) ? (const void*) &key->f32 : (const void*) &key->i32;
+}
+
+// keys() and values(), in the order the table holds them
+static void map_list(expr_t *expr, heap_block_t *map, const type_t *type, bool key)
+{
+  int size = type_size(type);
+  
+  expr->type = *type;
+  expr->type.arr = true;
+  expr->block = heap_alloc(hmap_length(map) * size);
+  expr->loc_base = NULL;
+  expr->loc_offset = 0;
+  
+  int i = 0;
+  for (int slot = hmap_next(map, 0); slot >= 0; slot = hmap_next(map, slot + 1)) {
+    char *ptr = key ? hmap_key(map, slot) : hmap_value(map, slot);
+    
+    expr_t elem;
+    mem_load(map, ptr - map->block, type, &elem);
+    mem_assign(expr->block, i++ * size, type, &elem);
+  }
+}
+
+bool int_map_method(scope_t *scope, expr_t *expr, const s_node_t *node, const expr_t *self)
+{
+  const lexeme_t *child_ident = node->proc.base->direct.child_ident;
+  const char *ident = child_ident->data.ident;
+  
+  int method = 0;
+  while (method < (int) (sizeof(map_method) / sizeof(map_method[0])) && strcmp(map_method[method].ident, ident) != 0)
+    method++;
+  
+  if (method == sizeof(map_method) / sizeof(map_method[0])) {
+    c_error(child_ident, "request for unknown member '%s' in map", ident);
+    return false;
+  }
+  
+  if (!self->block) {
+    c_error(child_ident, "call to '%s' on uninitialised map '%h'", ident, node->proc.base->direct.base);
+    return false;
+  }
+  
+  const type_t *key = map_key(&self->type);
+  const type_t *value = map_value(&self->type);
+  
+  if (strcmp(ident, "values") == 0 && type_array(value)) {
+    c_error(child_ident, "'values' of map '%h', whose values are arrays", node->proc.base->direct.base);
+    return false;
+  }
+  
+  const char *want = map_method[method].arg;
+  
+  int num_arg = 0;
+  for (const s_node_t *head = node->proc.arg; head; head = head->arg.next)
+    num_arg++;
+  
+  if (num_arg != (int) strlen(want)) {
+    c_error(
+      node->proc.left_bracket,
+      "too %s arguments to function '%h'",
+      num_arg < (int) strlen(want) ? "few" : "many",
+      node);
+    return false;
+  }
+  
+  expr_t arg[2];
+  const s_node_t *head = node->proc.arg;
+  for (int i = 0; i < num_arg; i++) {
+    if (!int_expr(scope, &arg[i], head->arg.body))
+      return false;
+    
+    const type_t *type = want[i] == 'k' ? key : value;
+    
+    if (!expr_cast(&arg[i], type)) {
+      c_error(
+        node->proc.left_bracket,
+        "expected '%z' but argument is of type '%z'",
+        type,
+        &arg[i].type);
+      return false;
+    }
+    
+    // a struct may be a value in the map, which is about to move
+    if (type_struct(&arg[i].type))
+      temp_keep(&arg[i]);
+    
+    head = head->arg.next;
+  }
+  
+  heap_block_t *map = self->block;
+  
+  if (strcmp(ident, "put") == 0) {
+    char *ptr = hmap_put(map, map_key_ptr(&arg[0]));
+    mem_assign(map, ptr - map->block, value, &arg[1]);
+    *expr = (expr_t) {0};
+  } else if (strcmp(ident, "get") == 0) {
+    char *ptr = hmap_get(map, map_key_ptr(&arg[0]));
+    if (!ptr) {
+      c_error(child_ident, "key not found in map '%h'", node->proc.base->direct.base);
+      return false;
+    }
+    
+    // a value is copied out, as the table moves when it grows
+    mem_load(map, ptr - map->block, value, expr);
+    if (type_struct(value))
+      temp_keep(expr);
+    else
+      expr->loc_base = NULL;
+  } else if (strcmp(ident, "contains") == 0) {
+    expr_i32(expr, hmap_get(map, map_key_ptr(&arg[0])) != NULL);
+  } else if (strcmp(ident, "remove") == 0) {
+    hmap_remove(map, map_key_ptr(&arg[0]));
+    *expr = (expr_t) {0};
+  } else {
+    map_list(expr, map, ident[0] == 'k' ? key : value, ident[0] == 'k');
+  }
+  
+  return true;
+}
@@ -1,55 +1,43 @@
 #include "int_local.h"
 
-bool int_body(scope_t *scope, const s_node_t *node)
+#include "zone.h"
+
+// a statement's completion is passed back up through the bodies holding it
+// until the loop or function it ends. the temporaries it made are dropped.
+ctrl_t int_body(scope_t *scope, const s_node_t *node)
 {
   const s_node_t *head = node;
   
-  bool cont_flag = scope->cont_flag;
-  bool break_flag = scope->break_flag;
-  
-  while (head && !scope->ret_flag) {
-    if (cont_flag && !scope->cont_flag)
-      break;
+  while (head) {
+    int top = temp_top;
+    ctrl_t ctrl = int_stmt(scope, head);
+    temp_top = top;
     
-    if (break_flag && !scope->break_flag)
-      break;
-    
-    if (!int_stmt(scope, head))
-      return false;
+    if (ctrl != CTRL_NEXT)
+      return ctrl;
     
     head = head->stmt.next;
   }
   
-  return true;
+  return CTRL_NEXT;
 }
 
-bool int_body_scope(scope_t *scope, const s_node_t *node)
+ctrl_t int_body_scope(scope_t *scope, const s_node_t *node)
 {
   scope_t new_scope;
   scope_new(&new_scope, NULL, &scope->ret_type, scope, scope, false);
-  new_scope.cont_flag = scope->cont_flag;
-  new_scope.break_flag = scope->break_flag;
+  new_scope.tail = scope->tail;
   new_scope.size = scope->size;
   
-  if (!int_body(&new_scope, node)) {
-    scope_free(&new_scope);
-    scope->scope_child = NULL;
-    return false;
-  }
-  
-  scope->ret_flag = new_scope.ret_flag;
-  scope->cont_flag = new_scope.cont_flag;
-  scope->break_flag = new_scope.break_flag;
-  
-  scope->ret_value = new_scope.ret_value;
+  ctrl_t ctrl = int_body(&new_scope, node);
   
   scope_free(&new_scope);
   scope->scope_child = NULL;
   
-  return true;
+  return ctrl;
 }
 
-bool int_stmt(scope_t *scope, const s_node_t *node)
+ctrl_t int_stmt(scope_t *scope, const s_node_t *node)
 {
   expr_t expr;
   switch (node->stmt.body->node_type) {
@@ -63,177 +51,420 @@ bool int_stmt(scope_t *scope, const s_node_t *node)
   case S_ARRAY_INIT:
   case S_POST_OP:
     if (!int_expr(scope, &expr, node->stmt.body))
-      return false;
+      return CTRL_ERROR;
     break;
   case S_DECL:
     if (!int_decl(scope, node->stmt.body, true))
-      return false;
+      return CTRL_ERROR;
     break;
   case S_CLASS_DEF:
     if (!int_class_def(scope, node->stmt.body))
-      return false;
+      return CTRL_ERROR;
     break;
   case S_PRINT:
     if (!int_print(scope, node->stmt.body))
-      return false;
+      return CTRL_ERROR;
     break;
   case S_IF_STMT:
-    if (!int_if_stmt(scope, node->stmt.body))
-      return false;
-    break;
+    return int_if_stmt(scope, node->stmt.body);
   case S_WHILE_STMT:
-    if (!int_while_stmt(scope, node->stmt.body))
-      return false;
-    break;
+    return int_while_stmt(scope, node->stmt.body);
   case S_FOR_STMT:
-    if (!int_for_stmt(scope, node->stmt.body))
-      return false;
-    break;
+    return int_for_stmt(scope, node->stmt.body);
   case S_FN:
     if (!int_fn(scope, node->stmt.body, NULL))
-      return false;
+      return CTRL_ERROR;
     break;
   case S_RET_STMT:
-    if (!int_ret_stmt(scope, node->stmt.body))
-      return false;
-    break;
+    return int_ret_stmt(scope, node->stmt.body);
   case S_CTRL_STMT:
-    if (!int_ctrl_stmt(scope, node->stmt.body))
-      return false;
-    break;
+    return int_ctrl_stmt(scope, node->stmt.body);
   default:
     LOG_ERROR("unknown statement node_type (%i)", node->stmt.body->node_type);
-    return false;
+    return CTRL_ERROR;
   }
   
-  return true;
+  return CTRL_NEXT;
 }
 
-bool int_while_stmt(scope_t *scope, const s_node_t *node)
+ctrl_t int_while_stmt(scope_t *scope, const s_node_t *node)
 {
+  expr_t cond;
+  if (!int_expr(scope, &cond, node->while_stmt.cond))
+    return CTRL_ERROR;
+  
   scope_t new_scope;
   scope_new(&new_scope, NULL, &scope->ret_type, scope, scope, false);
-  new_scope.cont_flag = true;
-  new_scope.break_flag = true;
+  new_scope.loop = true;
   new_scope.size = scope->size;
   
-  expr_t cond;
-  if (!int_expr(scope, &cond, node->while_stmt.cond))
-    return false;
+  ctrl_t ctrl = CTRL_NEXT;
+  int top = temp_top;
   
   while (cond.i32 != 0) {
-    if (!int_body_scope(&new_scope, node->while_stmt.body))
-      return false;
+    temp_top = top;
+    
+    ctrl = int_body_scope(&new_scope, node->while_stmt.body);
+    if (ctrl == CTRL_ERROR || ctrl == CTRL_RETURN)
+      break;
     
-    if (!new_scope.break_flag)
+    if (ctrl == CTRL_BREAK) {
+      ctrl = CTRL_NEXT;
       break;
+    }
     
     if (!int_expr(scope, &cond, node->while_stmt.cond)) {
-err_cleanup:
-      scope_free(&new_scope);
-      scope->scope_child = NULL;
-      return false;
+      ctrl = CTRL_ERROR;
+      break;
     }
+    
+    ctrl = CTRL_NEXT;
   }
   
-  scope->ret_flag = new_scope.ret_flag;
-  scope->ret_value = new_scope.ret_value;
   scope_free(&new_scope);
   scope->scope_child = NULL;
   
-  return true;
+  return ctrl;
+}
+
+// a loop of the form 'for (i32 i = a; i < n; i++)', or with <=, where n
+// is a constant or an i32 variable and the body does not define functions
+// or classes. it is run with a C loop over i's slot, n is read from its slot
+// each iteration as the body may assign either.
+static bool for_count_body(const s_node_t *node)
+{
+  if (!node)
+    return true;
+  
+  switch (node->node_type) {
+  case S_STMT:
+    while (node) {
+      if (!for_count_body(node->stmt.body))
+        return false;
+      node = node->stmt.next;
+    }
+    return true;
+  case S_IF_STMT:
+    return for_count_body(node->if_stmt.body) && for_count_body(node->if_stmt.next);
+  case S_WHILE_STMT:
+    return for_count_body(node->while_stmt.body);
+  case S_FOR_STMT:
+    return for_count_body(node->for_stmt.body);
+  case S_FN:
+  case S_CLASS_DEF:
+    return false;
+  default:
+    return true;
+  }
+}
+
+static bool for_count_ident(const s_node_t *node, const char *ident)
+{
+  return node->node_type == S_CONSTANT
+    && node->constant.lexeme->token == TK_IDENTIFIER
+    && strcmp(node->constant.lexeme->data.ident, ident) == 0;
+}
+
+static bool for_count(const s_node_t *node)
+{
+  const s_node_t *decl = node->for_stmt.decl;
+  const s_node_t *cond = node->for_stmt.cond;
+  const s_node_t *inc = node->for_stmt.inc;
+  
+  if (!decl || decl->stmt.body->node_type != S_DECL || !inc)
+    return false;
+  
+  decl = decl->stmt.body;
+  if (decl->decl.type->type.spec->token != TK_I32 || decl->decl.type->type.left_bracket)
+    return false;
+  
+  const char *ident = decl->decl.ident->data.ident;
+  
+  if (cond->node_type != S_BINOP)
+    return false;
+  
+  if (cond->binop.op->token != '<' && cond->binop.op->token != TK_LE)
+    return false;
+  
+  if (!for_count_ident(cond->binop.lhs, ident) || for_count_ident(cond->binop.rhs, ident))
+    return false;
+  
+  token_t limit = cond->binop.rhs->node_type == S_CONSTANT ? cond->binop.rhs->constant.lexeme->token : 0;
+  if (limit != TK_CONST_INTEGER && limit != TK_IDENTIFIER)
+    return false;
+  
+  if (inc->node_type != S_POST_OP || inc->post_op.op->token != TK_INC)
+    return false;
+  
+  if (!for_count_ident(inc->post_op.lhs, ident))
+    return false;
+  
+  return for_count_body(node->for_stmt.body);
+}
+
+// the body gets one scope for the whole loop which is emptied between
+// iterations
+static ctrl_t for_count_run(scope_t *scope, const s_node_t *node, int *i, const int *n)
+{
+  bool le = node->for_stmt.cond->binop.op->token == TK_LE;
+  
+  scope_t body_scope;
+  scope_new(&body_scope, NULL, &scope->ret_type, scope, scope, false);
+  
+  ctrl_t ctrl = CTRL_NEXT;
+  
+  while (le ? *i <= *n : *i < *n) {
+    body_scope.size = scope->size;
+    
+    ctrl = int_body(&body_scope, node->for_stmt.body);
+    if (ctrl == CTRL_ERROR || ctrl == CTRL_RETURN)
+      break;
+    
+    if (body_scope.map_var.start) {
+      scope_free(&body_scope);
+      scope->scope_child = &body_scope;
+    }
+    
+    if (ctrl == CTRL_BREAK) {
+      ctrl = CTRL_NEXT;
+      break;
+    }
+    
+    ctrl = CTRL_NEXT;
+    (*i)++;
+  }
+  
+  scope_free(&body_scope);
+  
+  return ctrl;
 }
 
-bool int_for_stmt(scope_t *scope, const s_node_t *node)
+ctrl_t int_for_stmt(scope_t *scope, const s_node_t *node)
 {
   scope_t new_scope;
   scope_new(&new_scope, NULL, &scope->ret_type, scope, scope, false);
-  new_scope.cont_flag = true;
-  new_scope.break_flag = true;
+  new_scope.loop = true;
   new_scope.size = scope->size;
   
   if (node->for_stmt.decl) {
-    if (!int_stmt(&new_scope, node->for_stmt.decl))
-      return false;
+    if (!int_stmt(&new_scope, node->for_stmt.decl)) {
+      scope_free(&new_scope);
+      scope->scope_child = NULL;
+      return CTRL_ERROR;
+    }
   }
   
+  if (for_count(node)) {
+    const s_node_t *rhs = node->for_stmt.cond->binop.rhs;
+    
+    var_t *i = scope_find_var(&new_scope, node->for_stmt.decl->stmt.body->decl.ident->data.ident);
+    var_t *n = NULL;
+    
+    if (rhs->constant.lexeme->token == TK_IDENTIFIER)
+      n = scope_find_var(&new_scope, rhs->constant.lexeme->data.ident);
+    
+    if (rhs->constant.lexeme->token == TK_CONST_INTEGER || (n && type_cmp(&n->type, &type_i32))) {
+      ctrl_t ctrl = for_count_run(
+        &new_scope,
+        node,
+        (int*) &stack_mem->block[i->loc],
+        n ? (int*) &stack_mem->block[n->loc] : &rhs->constant.lexeme->data.i32);
+      
+      scope_free(&new_scope);
+      scope->scope_child = NULL;
+      
+      return ctrl;
+    }
+  }
+  
+  ctrl_t ctrl = CTRL_NEXT;
+  
   expr_t cond;
   if (!int_expr(&new_scope, &cond, node->for_stmt.cond))
-    return false;
+    ctrl = CTRL_ERROR;
   
-  while (cond.i32 != 0) {
-    if (!int_body_scope(&new_scope, node->for_stmt.body))
-      goto err_cleanup;
+  int top = temp_top;
+  
+  while (ctrl == CTRL_NEXT && cond.i32 != 0) {
+    temp_top = top;
+    
+    ctrl = int_body_scope(&new_scope, node->for_stmt.body);
+    if (ctrl == CTRL_ERROR || ctrl == CTRL_RETURN)
+      break;
+    
+    if (ctrl == CTRL_BREAK) {
+      ctrl = CTRL_NEXT;
+      break;
+    }
+    
+    ctrl = CTRL_NEXT;
     
     if (node->for_stmt.inc) {
       if (!int_expr(&new_scope, &cond, node->for_stmt.inc))
-        goto err_cleanup;
+        ctrl = CTRL_ERROR;
     }
     
-    if (!int_expr(&new_scope, &cond, node->for_stmt.cond)) {
-err_cleanup:
-      scope_free(&new_scope);
-      scope->scope_child = NULL;
-      return false;
-    }
+    if (ctrl == CTRL_NEXT && !int_expr(&new_scope, &cond, node->for_stmt.cond))
+      ctrl = CTRL_ERROR;
   }
   
-  scope->ret_flag = new_scope.ret_flag;
-  scope->ret_value = new_scope.ret_value;
   scope_free(&new_scope);
   scope->scope_child = NULL;
   
-  return true;
+  return ctrl;
 }
 
-bool int_ctrl_stmt(scope_t *scope, const s_node_t *node)
+// break and continue are checked against the scopes up to the function
+// they are in, which only costs anything when one is run
+ctrl_t int_ctrl_stmt(scope_t *scope, const s_node_t *node)
 {
+  const scope_t *scope_loop = scope;
+  while (scope_loop && !scope_loop->loop && !scope_loop->block)
+    scope_loop = scope_loop->scope_parent;
+  
   switch (node->ctrl_stmt.lexeme->token) {
   case TK_BREAK:
-    if (!scope->break_flag) {
+    if (!scope_loop || !scope_loop->loop) {
       c_error(
         node->ctrl_stmt.lexeme,
         "cannot break outside loop");
-      return false;
+      return CTRL_ERROR;
     }
-    scope->break_flag = false;
-    break;
+    return CTRL_BREAK;
   case TK_CONTINUE:
-    if (!scope->break_flag) {
+    if (!scope_loop || !scope_loop->loop) {
       c_error(
         node->ctrl_stmt.lexeme,
         "cannot continue outside loop");
-      return false;
+      return CTRL_ERROR;
     }
-    scope->cont_flag= false;
-    break;
+    return CTRL_CONTINUE;
   }
   
-  return true;
+  return CTRL_NEXT;
 }
 
-bool int_if_stmt(scope_t *scope, const s_node_t *node)
+ctrl_t int_if_stmt(scope_t *scope, const s_node_t *node)
 {
   expr_t cond;
   if (!int_expr(scope, &cond, node->if_stmt.cond))
-    return false;
+    return CTRL_ERROR;
   
-  if (cond.i32 != 0) {
-    if (!int_body_scope(scope, node->if_stmt.body))
-      return false;
-  } else {
-    if (node->if_stmt.next)
-      return int_body(scope, node->if_stmt.next);
+  if (cond.i32 != 0)
+    return int_body_scope(scope, node->if_stmt.body);
+  
+  if (node->if_stmt.next)
+    return int_body(scope, node->if_stmt.next);
+  
+  return CTRL_NEXT;
+}
+
+// the function's scope, which holds the value it returns
+static scope_t *ret_scope(scope_t *scope)
+{
+  while (!scope->block && scope->scope_parent)
+    scope = scope->scope_parent;
+  
+  return scope;
+}
+
+// 'return f(...)' outside of loops and constructors, where f is a script
+// function returning the same type. the args are evaluated here and the
+// call is left to int_fn_run() once the body has unwound.
+static bool ret_tail(scope_t *scope, const s_node_t *node, bool *tail)
+{
+  const s_node_t *proc = node->ret_stmt.body;
+  
+  *tail = false;
+  
+  if (!scope->tail || proc->node_type != S_PROC)
+    return true;
+  
+  const s_node_t *base = proc->proc.base;
+  if (base->node_type != S_CONSTANT || base->constant.lexeme->token != TK_IDENTIFIER)
+    return true;
+  
+  const char *ident = base->constant.lexeme->data.ident;
+  if (scope_find_var(scope, ident))
+    return true;
+  
+  fn_t *fn = scope_find_fn(scope, ident);
+  if (!fn || !int_fn_body(fn) || !fn->node || fn->scope_class || fn->is_new)
+    return true;
+  
+  if (!type_cmp(&fn->type, &scope->ret_type))
+    return true;
+  
+  int num_arg = 0;
+  const s_node_t *arg = proc->proc.arg;
+  const s_node_t *head = fn->param;
+  while (arg && head) {
+    num_arg++;
+    arg = arg->arg.next;
+    head = head->param_decl.next;
   }
   
+  // argument errors are left to int_proc()
+  if (arg || head)
+    return true;
+  
+  expr_t *arg_value = num_arg ? ZONE_ALLOC(num_arg * sizeof(expr_t)) : NULL;
+  
+  arg = proc->proc.arg;
+  head = fn->param;
+  for (int i = 0; i < num_arg; i++) {
+    type_t type;
+    if (!int_type(fn->scope_parent, &type, head->param_decl.type))
+      goto err_cleanup;
+    
+    if (!int_expr(scope, &arg_value[i], arg->arg.body))
+      goto err_cleanup;
+    
+    if (!expr_cast(&arg_value[i], &type)) {
+      c_error(
+        head->param_decl.ident,
+        "expected '%z' but argument is of type '%z'",
+        &type,
+        &arg_value[i].type);
+      goto err_cleanup;
+    }
+    
+    // expr_cast() keeps the type of the value, the param is bound with its own
+    arg_value[i].type = type;
+    
+    arg = arg->arg.next;
+    head = head->param_decl.next;
+  }
+  
+  jit_hot(fn);
+  
+  scope_t *scope_fn = ret_scope(scope);
+  scope_fn->tail_fn = fn;
+  scope_fn->tail_arg = arg_value;
+  scope_fn->tail_node = node;
+  
+  *tail = true;
+  
   return true;
+  
+err_cleanup:
+  if (arg_value)
+    ZONE_FREE(arg_value);
+  return false;
 }
 
-bool int_ret_stmt(scope_t *scope, const s_node_t *node)
+ctrl_t int_ret_stmt(scope_t *scope, const s_node_t *node)
 {
+  bool tail;
+  if (!ret_tail(scope, node, &tail))
+    return CTRL_ERROR;
+  
+  if (tail)
+    return CTRL_RETURN;
+  
   expr_t expr;
   if (!int_expr(scope, &expr, node->ret_stmt.body))
-    return false;
+    return CTRL_ERROR;
   
   if (!type_cmp(&expr.type, &scope->ret_type)) {
     c_error(
@@ -241,13 +472,21 @@ bool int_ret_stmt(scope_t *scope, const s_node_t *node)
       "incompatible types when returning type '%z' but '%z' was expected",
       &expr.type,
       &scope->ret_type);
-    return false;
+    return CTRL_ERROR;
   }
   
-  scope->ret_flag = true;
-  scope->ret_value = expr;
+  // a struct may be in the frame being left, the caller takes it from
+  // temp_mem
+  if (type_struct(&expr.type)) {
+    int offset = temp_alloc(type_size(&expr.type));
+    mem_assign(temp_mem, offset, &expr.type, &expr);
+    expr.loc_base = temp_mem;
+    expr.loc_offset = offset;
+  }
   
-  return true;
+  ret_scope(scope)->ret_value = expr;
+  
+  return CTRL_RETURN;
 }
 
 bool int_print(scope_t *scope, const s_node_t *node)
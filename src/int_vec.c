@@ -0,0 +1,255 @@
+#include "int_local.h"
+
+#include "vec.h"
+#include <math.h>
+
+// a struct_def whose fields are all f32, or structs which are, is a vector,
+// and one whose fields are n vectors of n f32s is also a matrix of columns.
+// their operators and methods are run over their f32s in place.
+
+static const struct {
+  const char  *ident;
+  const char  *arg;
+} vec_method[] = {
+  // 'v' is the type of the vector called on, 'f' an f32, 'm' either 'v' or
+  // its column
+  { "dot",        "v" },
+  { "length",     "" },
+  { "normalize",  "" },
+  { "lerp",       "vf" },
+  { "cross",      "v" },
+  { "mul",        "m" },
+  { "copy",       "" },
+  
+  // the methods vec2 had as a class, which update it in place
+  { "add",        "v" },
+  { "sub",        "v" },
+  { "mulf",       "f" }
+};
+
+static bool vec_f32(const scope_t *class)
+{
+  for (const entry_t *entry = class->map_var.start; entry; entry = entry->s_next) {
+    const var_t *var = entry->value;
+    if (type_struct(&var->type) ? !vec_f32(var->type.class) : !type_cmp(&var->type, &type_f32))
+      return false;
+  }
+  
+  return true;
+}
+
+static float *vec_f32_ptr(const expr_t *expr)
+{
+  return (float*) &expr->loc_base->block[expr->loc_offset];
+}
+
+// operands are only found after this, which can move temp_mem
+static float *vec_new(expr_t *expr, const type_t *type)
+{
+  expr->type = *type;
+  expr->block = NULL;
+  expr->loc_base = temp_mem;
+  expr->loc_offset = temp_alloc(type_size(type));
+  
+  return vec_f32_ptr(expr);
+}
+
+// the number of f32s in a vector, 0 for any other type
+int int_vec_size(const type_t *type)
+{
+  if (!type_struct(type) || !vec_f32(type->class))
+    return 0;
+  
+  return type->class->size / 4;
+}
+
+// the type of a matrix's columns, which it has as many of as they have f32s
+const scope_t *int_vec_col(const type_t *type)
+{
+  const scope_t *col = NULL;
+  for (const entry_t *entry = type->class->map_var.start; entry; entry = entry->s_next) {
+    const var_t *var = entry->value;
+    if (!type_struct(&var->type) || (col && var->type.class != col))
+      return NULL;
+    col = var->type.class;
+  }
+  
+  if (!col || col->size / 4 * col->size != type->class->size)
+    return NULL;
+  
+  return col;
+}
+
+bool int_vec_neg(expr_t *expr, const expr_t *rhs)
+{
+  int n = int_vec_size(&rhs->type);
+  if (!n)
+    return false;
+  
+  float *r = vec_new(expr, &rhs->type);
+  vec_mul(r, vec_f32_ptr(rhs), -1.0, n);
+  
+  return true;
+}
+
+bool int_vec_binop(expr_t *expr, const expr_t *lhs, token_t op, const expr_t *rhs)
+{
+  expr_t scalar;
+  
+  if (int_vec_size(&lhs->type) && type_struct(&rhs->type)) {
+    int n = int_vec_size(&lhs->type);
+    
+    if ((op == '+' || op == '-') && type_cmp(&lhs->type, &rhs->type)) {
+      float *r = vec_new(expr, &lhs->type);
+      if (op == '+')
+        vec_add(r, vec_f32_ptr(lhs), vec_f32_ptr(rhs), n);
+      else
+        vec_sub(r, vec_f32_ptr(lhs), vec_f32_ptr(rhs), n);
+      return true;
+    }
+    
+    const scope_t *col = int_vec_col(&lhs->type);
+    if (op != '*' || !col)
+      return false;
+    
+    int num_col = col->size / 4;
+    
+    if (rhs->type.class == col) {
+      float *r = vec_new(expr, &rhs->type);
+      vec_mat(r, vec_f32_ptr(lhs), vec_f32_ptr(rhs), num_col);
+    } else if (type_cmp(&lhs->type, &rhs->type)) {
+      float *r = vec_new(expr, &lhs->type);
+      for (int i = 0; i < num_col; i++)
+        vec_mat(&r[i * num_col], vec_f32_ptr(lhs), &vec_f32_ptr(rhs)[i * num_col], num_col);
+    } else {
+      return false;
+    }
+  } else if (int_vec_size(&lhs->type)) {
+    scalar = *rhs;
+    if ((op != '*' && op != '/') || !expr_cast(&scalar, &type_f32))
+      return false;
+    
+    float *r = vec_new(expr, &lhs->type);
+    if (op == '*')
+      vec_mul(r, vec_f32_ptr(lhs), scalar.f32, int_vec_size(&lhs->type));
+    else
+      vec_div(r, vec_f32_ptr(lhs), scalar.f32, int_vec_size(&lhs->type));
+  } else if (int_vec_size(&rhs->type)) {
+    scalar = *lhs;
+    if (op != '*' || !expr_cast(&scalar, &type_f32))
+      return false;
+    
+    float *r = vec_new(expr, &rhs->type);
+    vec_mul(r, vec_f32_ptr(rhs), scalar.f32, int_vec_size(&rhs->type));
+  } else {
+    return false;
+  }
+  
+  return true;
+}
+
+bool int_vec_method(scope_t *scope, expr_t *expr, const s_node_t *node, const expr_t *self)
+{
+  const lexeme_t *child_ident = node->proc.base->direct.child_ident;
+  const char *ident = child_ident->data.ident;
+  
+  int method = 0;
+  while (method < (int) (sizeof(vec_method) / sizeof(vec_method[0])) && strcmp(vec_method[method].ident, ident) != 0)
+    method++;
+  
+  if (method == sizeof(vec_method) / sizeof(vec_method[0])) {
+    c_error(
+      child_ident,
+      "'struct %s' has no member named '%s'",
+      self->type.class->ident,
+      ident);
+    return false;
+  }
+  
+  const char *want = vec_method[method].arg;
+  
+  int num_arg = 0;
+  for (const s_node_t *head = node->proc.arg; head; head = head->arg.next)
+    num_arg++;
+  
+  if (num_arg != (int) strlen(want)) {
+    c_error(
+      node->proc.left_bracket,
+      "too %s arguments to function '%h'",
+      num_arg < (int) strlen(want) ? "few" : "many",
+      node);
+    return false;
+  }
+  
+  expr_t arg[2];
+  const s_node_t *head = node->proc.arg;
+  for (int i = 0; i < num_arg; i++) {
+    if (!int_expr(scope, &arg[i], head->arg.body))
+      return false;
+    
+    type_t type = self->type;
+    if (want[i] == 'f')
+      type = type_f32;
+    else if (want[i] == 'm' && type_struct(&arg[i].type) && arg[i].type.class == int_vec_col(&self->type))
+      type = arg[i].type;
+    
+    if (!expr_cast(&arg[i], &type)) {
+      c_error(
+        node->proc.left_bracket,
+        "expected '%z' but argument is of type '%z'",
+        &type,
+        &arg[i].type);
+      return false;
+    }
+    
+    head = head->arg.next;
+  }
+  
+  int n = int_vec_size(&self->type);
+  
+  if (strcmp(ident, "dot") == 0) {
+    expr_f32(expr, vec_dot(vec_f32_ptr(self), vec_f32_ptr(&arg[0]), n));
+  } else if (strcmp(ident, "length") == 0) {
+    expr_f32(expr, sqrtf(vec_dot(vec_f32_ptr(self), vec_f32_ptr(self), n)));
+  } else if (strcmp(ident, "normalize") == 0) {
+    float *r = vec_new(expr, &self->type);
+    vec_div(r, vec_f32_ptr(self), sqrtf(vec_dot(vec_f32_ptr(self), vec_f32_ptr(self), n)), n);
+  } else if (strcmp(ident, "lerp") == 0) {
+    float *r = vec_new(expr, &self->type);
+    vec_lerp(r, vec_f32_ptr(self), vec_f32_ptr(&arg[0]), arg[1].f32, n);
+  } else if (strcmp(ident, "cross") == 0) {
+    if (n != 3) {
+      c_error(
+        child_ident,
+        "cross product of 'struct %s', which is not 3 f32s",
+        self->type.class->ident);
+      return false;
+    }
+    
+    float *r = vec_new(expr, &self->type);
+    vec_cross(r, vec_f32_ptr(self), vec_f32_ptr(&arg[0]));
+  } else if (strcmp(ident, "mul") == 0) {
+    if (!int_vec_binop(expr, self, '*', &arg[0])) {
+      c_error(
+        child_ident,
+        "cannot multiply '%z' by '%z'",
+        &self->type,
+        &arg[0].type);
+      return false;
+    }
+  } else if (strcmp(ident, "copy") == 0) {
+    float *r = vec_new(expr, &self->type);
+    memcpy(r, vec_f32_ptr(self), n * 4);
+  } else {
+    if (strcmp(ident, "add") == 0)
+      vec_add(vec_f32_ptr(self), vec_f32_ptr(self), vec_f32_ptr(&arg[0]), n);
+    else if (strcmp(ident, "sub") == 0)
+      vec_sub(vec_f32_ptr(self), vec_f32_ptr(self), vec_f32_ptr(&arg[0]), n);
+    else
+      vec_mul(vec_f32_ptr(self), vec_f32_ptr(self), arg[0].f32, n);
+    
+    *expr = *self;
+  }
+  
+  return true;
+}
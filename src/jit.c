@@ -0,0 +1,2467 @@
+#include "jit_local.h"
+
+#include "zone.h"
+#include <stdarg.h>
+#include <stddef.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+  #define JIT_X86_64 1
+  #include <sys/mman.h>
+#else
+  #define JIT_X86_64 0
+#endif
+
+#ifndef JIT_THRESHOLD
+  #define JIT_THRESHOLD 8
+#endif
+
+#ifndef EXE_THRESHOLD
+  #define EXE_THRESHOLD 2
+#endif
+
+#define JIT_MAX_VAR     256
+#define JIT_MAX_BREAK   64
+#define JIT_MAX_REDUCE  16
+
+typedef struct jit_page_s {
+  void              *code;
+  int               size;
+  struct jit_page_s *next;
+} jit_page_t;
+
+jit_slot_t        jit_stack[JIT_STACK_SIZE + JIT_MAX_ARG + 2];
+jit_slot_t        *jit_sp = jit_stack;
+
+static bool       jit_enable = false;
+static bool       jit_native = false;
+static jit_site_t *jit_site_list = NULL;
+static jit_page_t *jit_page_list = NULL;
+
+static bool jit_compile(fn_t *fn);
+static int  jit_call_site(jit_site_t *site, scope_t *scope, jit_slot_t *frame);
+
+void jit_init(bool enable, bool native)
+{
+  jit_enable = enable;
+  jit_native = native;
+  jit_sp = jit_stack;
+}
+
+void jit_stop()
+{
+  while (jit_site_list) {
+    jit_site_t *next = jit_site_list->next;
+    ZONE_FREE(jit_site_list);
+    jit_site_list = next;
+  }
+  
+  while (jit_page_list) {
+    jit_page_t *next = jit_page_list->next;
+#if JIT_X86_64
+    munmap(jit_page_list->code, jit_page_list->size);
+#endif
+    ZONE_FREE(jit_page_list);
+    jit_page_list = next;
+  }
+  
+  exe_stop();
+}
+
+// count a call and compile the function once it is hot. closures are cheap
+// to build so they come first, native code is kept for functions which stay
+// hot. both accept the same functions.
+void jit_hot(fn_t *fn)
+{
+  if (!jit_enable || fn->jit || fn->jit_fail || !fn->node)
+    return;
+  
+  fn->num_call++;
+  
+  if (!fn->exe) {
+    if (fn->num_call < EXE_THRESHOLD)
+      return;
+    
+    if (!exe_compile(fn)) {
+      fn->jit_fail = true;
+      return;
+    }
+  }
+  
+  if (!jit_native || fn->num_call < JIT_THRESHOLD)
+    return;
+  
+  if (!jit_compile(fn))
+    fn->jit_fail = true;
+}
+
+// run a compiled function whose params are already bound in 'scope'
+bool jit_run(fn_t *fn, scope_t *scope, heap_block_t *self)
+{
+  jit_slot_t *frame = jit_sp;
+  int num_slot = 1;
+  
+  if (fn->scope_class)
+    frame[num_slot++].block = self;
+  
+  s_node_t *head = fn->param;
+  while (head) {
+    var_t *var = map_get(&scope->map_var, head->param_decl.ident->data.ident);
+    
+    // a struct is passed by its address, the closures copy it
+    expr_t expr;
+    mem_load(stack_mem, var->loc, &var->type, &expr);
+    if (type_struct(&var->type))
+      frame[num_slot++].ptr = &stack_mem->block[var->loc];
+    else
+      frame[num_slot++].block = expr.block;
+    
+    head = head->param_decl.next;
+  }
+  
+  int status = fn->jit
+    ? ((jit_code_t) fn->jit)(frame, scope)
+    : exe_call(fn, frame, scope);
+  
+  if (status == JIT_TAIL)
+    status = jit_tail_run(frame, scope);
+  
+  if (status == JIT_FAIL)
+    return false;
+  
+  if (status == JIT_VALUE)
+    jit_expr_load(&scope->ret_value, &fn->type, frame[0]);
+  
+  return true;
+}
+
+// a struct's slot is its address, which is only good until the frame it is in
+// is reused, so it is copied into temp_mem
+void jit_expr_load(expr_t *expr, const type_t *type, jit_slot_t slot)
+{
+  expr->type = *type;
+  expr->block = slot.block;
+  expr->loc_base = NULL;
+  expr->loc_offset = 0;
+  
+  if (type_struct(type)) {
+    expr->block = NULL;
+    expr->loc_base = temp_mem;
+    expr->loc_offset = temp_alloc(type_size(type));
+    memcpy(&temp_mem->block[expr->loc_offset], slot.ptr, type_size(type));
+  }
+}
+
+// calls which can not be made directly from compiled code: natives,
+// constructors and functions which are not compiled (yet)
+int jit_call(jit_site_t *site, scope_t *scope, jit_slot_t *frame)
+{
+  int status = jit_call_site(site, scope, frame);
+  
+  if (status == JIT_TAIL)
+    return jit_tail_run(frame, scope);
+  
+  return status;
+}
+
+// make the calls compiled functions leave in tail position on 'frame' until
+// one returns. as in the interpreter the last one has to return a value of
+// the type the first was called for.
+int jit_tail_run(jit_slot_t *frame, scope_t *scope)
+{
+  jit_site_t *site;
+  int status;
+  
+  do {
+    site = frame[0].site;
+    status = jit_call_site(site, scope, frame);
+  } while (status == JIT_TAIL);
+  
+  if (status == JIT_VOID && !type_cmp(&site->type, &type_none)) {
+    c_error(
+      site->node->proc.left_bracket,
+      "incompatible types when returning type '%z' but '%z' was expected",
+      &type_none,
+      &site->type);
+    return JIT_FAIL;
+  }
+  
+  return status;
+}
+
+static int jit_call_site(jit_site_t *site, scope_t *scope, jit_slot_t *frame)
+{
+  fn_t *fn = site->fn;
+  
+  if (!int_fn_body(fn)) {
+    c_error(
+      site->node->proc.left_bracket,
+      "attempt to call function without body");
+    return JIT_FAIL;
+  }
+  
+  jit_hot(fn);
+  
+  if (fn->is_new)
+    frame[1].block = heap_alloc(fn->scope_class->size);
+  
+  if (fn->jit || fn->exe) {
+    int status = fn->jit
+      ? ((jit_code_t) fn->jit)(frame, scope)
+      : exe_call(fn, frame, scope);
+    
+    if (fn->is_new && status != JIT_FAIL) {
+      frame[0] = frame[1];
+      return JIT_VALUE;
+    }
+    
+    return status;
+  }
+  
+  scope_t new_scope;
+  if (fn->scope_class) {
+    scope_new(&new_scope, NULL, &fn->type, scope, fn->scope_parent->scope_find, true);
+    new_scope.size += scope->size;
+    
+    expr_t self_expr;
+    self_expr.type.spec = SPEC_CLASS;
+    self_expr.type.arr = false;
+    self_expr.type.class = fn->scope_class;
+    self_expr.type.dim = 0;
+    self_expr.block = frame[1].block;
+    self_expr.loc_base = NULL;
+    self_expr.loc_offset = 0;
+    
+    var_t *var = scope_add_var(&new_scope, &self_expr.type, "this");
+    mem_assign(stack_mem, var->loc, &var->type, &self_expr);
+  } else {
+    scope_new(&new_scope, NULL, &fn->type, scope, fn->scope_parent, true);
+    new_scope.size += scope->size;
+  }
+  
+  new_scope.ret_type = fn->type;
+  new_scope.tail = !fn->is_new;
+  
+  jit_slot_t *arg = &frame[fn->scope_class ? 2 : 1];
+  
+  // struct args are copied through temp_mem, which is released once the
+  // call returns as the caller copies a struct returned too
+  int top = temp_top;
+  
+  s_node_t *head = fn->param;
+  for (int i = 0; i < site->num_arg; i++) {
+    var_t *var = scope_add_var(&new_scope, &site->arg_type[i], head->param_decl.ident->data.ident);
+    if (!var) {
+      c_error(
+        head->param_decl.ident,
+        "redefinition of param '%s'",
+        head->param_decl.ident->data.ident);
+      goto err_cleanup;
+    }
+    
+    expr_t arg_value;
+    jit_expr_load(&arg_value, &var->type, arg[i]);
+    mem_assign(stack_mem, var->loc, &var->type, &arg_value);
+    
+    head = head->param_decl.next;
+  }
+  
+  jit_slot_t *sp = jit_sp;
+  jit_sp = &arg[site->num_arg];
+  
+  if (!int_fn_run(&new_scope, fn, frame[1].block)) {
+    jit_sp = sp;
+err_cleanup:
+    temp_top = top;
+    scope_free(&new_scope);
+    scope->scope_child = NULL;
+    return JIT_FAIL;
+  }
+  
+  jit_sp = sp;
+  
+  int status = JIT_VALUE;
+  if (fn->is_new)
+    frame[0] = frame[1];
+  else if (type_cmp(&new_scope.ret_value.type, &type_none) || !type_cmp(&new_scope.ret_value.type, &site->type))
+    status = JIT_VOID;
+  else if (type_struct(&site->type))
+    frame[0].ptr = &new_scope.ret_value.loc_base->block[new_scope.ret_value.loc_offset];
+  else
+    frame[0].block = new_scope.ret_value.block;
+  
+  temp_top = top;
+  scope_free(&new_scope);
+  scope->scope_child = NULL;
+  
+  return status;
+}
+
+void jit_print(jit_site_t *site, heap_block_t *value)
+{
+  expr_t expr;
+  jit_expr_load(&expr, &site->type, (jit_slot_t) { .block = value });
+  c_debug("%w ", &expr);
+}
+
+void jit_print_end()
+{
+  c_debug("\n");
+}
+
+heap_block_t *jit_concat(heap_block_t *str_lhs, heap_block_t *str_rhs)
+{
+  int new_len = str_lhs->size + str_rhs->size - 2;
+  
+  heap_block_t *concat_str = heap_alloc(new_len + 1);
+  
+  memcpy(concat_str->block, str_lhs->block, str_lhs->size - 1);
+  memcpy(&concat_str->block[str_lhs->size - 1], str_rhs->block, str_rhs->size - 1);
+  
+  concat_str->block[new_len] = 0;
+  
+  return concat_str;
+}
+
+// the 'dim' extents of a T[,] or T[,,] were pushed in order, so the last is
+// at 'sp'. NULL if they are out of range.
+static heap_block_t *jit_grid(const jit_slot_t *sp, int dim, int size)
+{
+  int extent[GRID_DIM];
+  for (int i = 0; i < dim; i++)
+    extent[i] = sp[dim - 1 - i].i32;
+  
+  return heap_alloc_grid(extent, dim, size);
+}
+
+void jit_error(const s_node_t *node, jit_err_t err)
+{
+  switch (err) {
+  case JIT_ERR_INDEX_NULL:
+    c_error(
+      node->index.left_bracket,
+      "cannot index into uninitialised array '%h'",
+      node->index.base);
+    break;
+  case JIT_ERR_INDEX_BOUNDS:
+    c_error(node->index.left_bracket, "index out of bounds '%h'", node);
+    break;
+  case JIT_ERR_MEMBER_NULL:
+    c_error(
+      node->direct.child_ident,
+      "request for member '%s' in uninitialised class",
+      node->direct.child_ident->data.ident);
+    break;
+  case JIT_ERR_NO_VALUE:
+    c_error(
+      node->proc.left_bracket,
+      "function '%h' returned no value",
+      node->proc.base);
+    break;
+  case JIT_ERR_STACK:
+    LOG_ERROR("ran out of memory %i/%i", JIT_STACK_SIZE, JIT_STACK_SIZE);
+    break;
+  case JIT_ERR_ARRAY_NULL:
+    c_error(
+      node->proc.base->direct.child_ident,
+      "call to '%s' on uninitialised array '%h'",
+      node->proc.base->direct.child_ident->data.ident,
+      node->proc.base->direct.base);
+    break;
+  case JIT_ERR_ARRAY_EMPTY:
+    c_error(
+      node->proc.base->direct.child_ident,
+      "pop from empty array '%h'",
+      node->proc.base->direct.base);
+    break;
+  case JIT_ERR_ARRAY_BOUNDS:
+    c_error(node->proc.left_bracket, "index out of bounds '%h'", node);
+    break;
+  case JIT_ERR_ARRAY_SIZE:
+    c_error(node->proc.left_bracket, "size of array out of range '%h'", node);
+    break;
+  case JIT_ERR_GRID_SIZE:
+    c_error(node->array_init.array_init, "size of array out of range");
+    break;
+  }
+}
+
+// int_type() without the error, a class which can not be found is left to
+// the interpreter to report
+bool jit_type(const scope_t *scope, type_t *type, const s_node_t *node)
+{
+  type->class = NULL;
+  switch (node->type.spec->token) {
+  case TK_I32:
+    type->spec = SPEC_I32;
+    break;
+  case TK_F32:
+    type->spec = SPEC_F32;
+    break;
+  case TK_STRING:
+    type->spec = SPEC_STRING;
+    break;
+  case TK_CLASS:
+    type->spec = SPEC_CLASS;
+    type->class = scope_find_class(scope, node->type.class_ident->data.ident);
+    if (!type->class)
+      return false;
+    if (type->class->value) {
+      // a struct_def named by 'class', held in place like TK_STRUCT
+      type->spec = SPEC_STRUCT;
+      if (!node->type.left_bracket)
+        return false;
+    }
+    break;
+  case TK_STRUCT:
+  case TK_SOA:
+    // only arrays, whose elements are used in place
+    type->spec = node->type.spec->token == TK_STRUCT ? SPEC_STRUCT : SPEC_SOA;
+    type->class = scope_find_class(scope, node->type.class_ident->data.ident);
+    if (!type->class || !node->type.left_bracket)
+      return false;
+    break;
+  default:
+    return false;
+  }
+  
+  type->arr = node->type.left_bracket != NULL;
+  type->dim = node->type.dim;
+  
+  return type->dim <= GRID_DIM && (!type->dim || type->spec != SPEC_SOA);
+}
+
+bool jit_param(const scope_t *scope, const fn_t *fn, type_t *arg_type, int *num_arg)
+{
+  *num_arg = 0;
+  
+  const s_node_t *head = fn->param;
+  while (head) {
+    if (*num_arg == JIT_MAX_ARG)
+      return false;
+    
+    if (!jit_type(scope, &arg_type[*num_arg], head->param_decl.type))
+      return false;
+    
+    (*num_arg)++;
+    head = head->param_decl.next;
+  }
+  
+  return true;
+}
+
+jit_site_t *jit_site(const s_node_t *node, fn_t *fn, const type_t *type)
+{
+  jit_site_t *site = ZONE_ALLOC(sizeof(jit_site_t));
+  site->fn = fn;
+  site->node = node;
+  site->type = *type;
+  site->num_arg = 0;
+  site->next = jit_site_list;
+  jit_site_list = site;
+  
+  return site;
+}
+
+int jit_count_decl(const s_node_t *node)
+{
+  if (!node)
+    return 0;
+  
+  switch (node->node_type) {
+  case S_STMT: {
+    int num_decl = 0;
+    while (node) {
+      num_decl += jit_count_decl(node->stmt.body);
+      node = node->stmt.next;
+    }
+    return num_decl;
+  }
+  case S_DECL:
+    return 1;
+  case S_IF_STMT:
+    return jit_count_decl(node->if_stmt.body) + jit_count_decl(node->if_stmt.next);
+  case S_WHILE_STMT:
+    return jit_count_decl(node->while_stmt.body);
+  case S_FOR_STMT:
+    return jit_count_decl(node->for_stmt.decl) + jit_count_decl(node->for_stmt.body);
+  default:
+    return 0;
+  }
+}
+
+// whether a body always ends in a return
+bool jit_returns(const s_node_t *node)
+{
+  while (node) {
+    const s_node_t *body = node->stmt.body;
+    
+    if (body->node_type == S_RET_STMT)
+      return true;
+    
+    if (body->node_type == S_IF_STMT && body->if_stmt.next) {
+      if (jit_returns(body->if_stmt.body) && jit_returns(body->if_stmt.next))
+        return true;
+    }
+    
+    node = node->stmt.next;
+  }
+  
+  return false;
+}
+
+// whether an lvalue, or a struct used by its address, may be in the block of
+// an array, which moves if the array grows. the address is only held while
+// code which can not grow an array runs.
+bool jit_in_array(const s_node_t *node)
+{
+  while (node && node->node_type == S_DIRECT)
+    node = node->direct.base;
+  
+  return node && node->node_type == S_INDEX;
+}
+
+// where the block of a T[,] or T[,,] keeps the extent a member names, or -1
+int jit_extent(const type_t *type, const char *ident)
+{
+  if (type->dim && strcmp(ident, "rows") == 0)
+    return offsetof(heap_block_t, rows);
+  if (type->dim && strcmp(ident, "cols") == 0)
+    return offsetof(heap_block_t, cols);
+  if (type->dim == 3 && strcmp(ident, "layers") == 0)
+    return offsetof(heap_block_t, layers);
+  
+  return -1;
+}
+
+// the function called by 'return f(...)' if the call can be made in place
+// of the function making it: a script function returning the same type. a
+// function calling itself this way is run again on its own frame if it
+// always returns, otherwise the value the last call returns is checked.
+fn_t *jit_tail(const scope_t *scope, const fn_t *fn, const s_node_t *node)
+{
+  const s_node_t *proc = node->ret_stmt.body;
+  
+  if (fn->is_new || fn->type.spec == SPEC_STRUCT || proc->node_type != S_PROC)
+    return NULL;
+  
+  const s_node_t *base = proc->proc.base;
+  if (base->node_type != S_CONSTANT || base->constant.lexeme->token != TK_IDENTIFIER)
+    return NULL;
+  
+  const char *ident = base->constant.lexeme->data.ident;
+  if (scope_find_var(scope, ident))
+    return NULL;
+  
+  fn_t *callee = scope_find_fn(scope, ident);
+  if (!callee || callee->scope_class || callee->is_new)
+    return NULL;
+  
+  if (!type_cmp(&callee->type, &fn->type))
+    return NULL;
+  
+  return callee;
+}
+
+#if JIT_X86_64
+
+typedef struct {
+  const char  *ident;
+  type_t      type;
+  int         slot;
+  int         block;
+} jit_var_t;
+
+// a for loop's counter times a constant or a local, kept in a slot which
+// steps with the counter. step is the slot of the local, or 0 for factor,
+// and delta what the slot or, for a local, the local is stepped by.
+typedef struct {
+  int           counter;
+  int           step;
+  int           factor;
+  int           delta;
+  int           slot;
+} jit_reduce_t;
+
+typedef struct {
+  fn_t          *fn;
+  const scope_t *scope;
+  
+  unsigned char *code;
+  int           len;
+  int           cap;
+  
+  int           ret_label;
+  int           fail_label;
+  int           entry;
+  int           body_label;
+  
+  jit_var_t     var[JIT_MAX_VAR];
+  int           num_var;
+  int           num_slot;
+  int           frame;
+  int           block;
+  
+  int           loop;
+  int           brk[JIT_MAX_BREAK];
+  int           num_brk;
+  int           cont[JIT_MAX_BREAK];
+  int           num_cont;
+  
+  jit_reduce_t  reduce[JIT_MAX_REDUCE];
+  int           num_reduce;
+  
+  // the address of an element is on the stack, so no script function can
+  // be called, which could grow its array
+  int           hold;
+} jit_t;
+
+// registers: rbx holds the frame, r12 the scope, r13 the stack pointer
+// across aligned calls. values are computed into rax (eax for i32 and the
+// bits of f32) with rcx as the second operand and the stack for temps.
+
+enum {
+  CC_B  = 0x2,
+  CC_E  = 0x4,
+  CC_NE = 0x5,
+  CC_BE = 0x6,
+  CC_A  = 0x7,
+  CC_P  = 0xa,
+  CC_NP = 0xb,
+  CC_L  = 0xc,
+  CC_GE = 0xd,
+  CC_LE = 0xe,
+  CC_G  = 0xf,
+  CC_AE = 0x3
+};
+
+static void emit_byte(jit_t *j, int b)
+{
+  if (j->len == j->cap) {
+    j->cap *= 2;
+    j->code = ZONE_REALLOC(j->code, j->cap);
+  }
+  
+  j->code[j->len++] = b;
+}
+
+static void emit(jit_t *j, int n, ...)
+{
+  va_list args;
+  va_start(args, n);
+  
+  for (int i = 0; i < n; i++)
+    emit_byte(j, va_arg(args, int));
+  
+  va_end(args);
+}
+
+static void emit_i32(jit_t *j, int v)
+{
+  for (int i = 0; i < 4; i++)
+    emit_byte(j, (v >> (i * 8)) & 0xff);
+}
+
+static void emit_i64(jit_t *j, const void *p)
+{
+  long v = (long) p;
+  for (int i = 0; i < 8; i++)
+    emit_byte(j, (v >> (i * 8)) & 0xff);
+}
+
+static void emit_patch(jit_t *j, int pos)
+{
+  int rel = j->len - (pos + 4);
+  memcpy(&j->code[pos], &rel, 4);
+}
+
+static void emit_jmp(jit_t *j, int target)
+{
+  emit_byte(j, 0xe9);
+  emit_i32(j, target - (j->len + 4));
+}
+
+static int emit_jmp_fwd(jit_t *j)
+{
+  emit_byte(j, 0xe9);
+  emit_i32(j, 0);
+  return j->len - 4;
+}
+
+static void emit_jcc(jit_t *j, int cc, int target)
+{
+  emit(j, 2, 0x0f, 0x80 | cc);
+  emit_i32(j, target - (j->len + 4));
+}
+
+static int emit_jcc_fwd(jit_t *j, int cc)
+{
+  emit(j, 2, 0x0f, 0x80 | cc);
+  emit_i32(j, 0);
+  return j->len - 4;
+}
+
+// mov rax/rdi/rsi/rdx, imm64
+static void emit_mov_imm(jit_t *j, int reg, const void *p)
+{
+  emit(j, 2, 0x48, 0xb8 + reg);
+  emit_i64(j, p);
+}
+
+// call a C function with rsp aligned to 16 bytes
+static void emit_call(jit_t *j, const void *fn)
+{
+  emit(j, 3, 0x49, 0x89, 0xe5);       // mov r13, rsp
+  emit(j, 4, 0x48, 0x83, 0xe4, 0xf0); // and rsp, -16
+  emit_mov_imm(j, 0, fn);             // mov rax, fn
+  emit(j, 2, 0xff, 0xd0);             // call rax
+  emit(j, 3, 0x4c, 0x89, 0xec);       // mov rsp, r13
+}
+
+// continue if 'cc' holds, otherwise report the error and fail
+static void emit_check(jit_t *j, int cc, const s_node_t *node, jit_err_t err)
+{
+  int pos = emit_jcc_fwd(j, cc);
+  
+  emit(j, 4, 0x48, 0x83, 0xe4, 0xf0); // and rsp, -16
+  emit_mov_imm(j, 7, node);           // mov rdi, node
+  emit_byte(j, 0xbe);                 // mov esi, err
+  emit_i32(j, err);
+  emit_mov_imm(j, 0, jit_error);
+  emit(j, 2, 0xff, 0xd0);             // call rax
+  emit_jmp(j, j->fail_label);
+  
+  emit_patch(j, pos);
+}
+
+// mov (e/r)ax, [rbx + slot * 8]
+static void emit_load_slot(jit_t *j, int slot, int size)
+{
+  if (size == 8)
+    emit_byte(j, 0x48);
+  emit(j, 2, 0x8b, 0x83);
+  emit_i32(j, slot * 8);
+}
+
+// mov [rbx + slot * 8], (e/r)ax
+static void emit_store_slot(jit_t *j, int slot, int size)
+{
+  if (size == 8)
+    emit_byte(j, 0x48);
+  emit(j, 2, 0x89, 0x83);
+  emit_i32(j, slot * 8);
+}
+
+// mov (e/r)ax, [rax]
+static void emit_load(jit_t *j, int size)
+{
+  if (size == 8)
+    emit_byte(j, 0x48);
+  emit(j, 2, 0x8b, 0x00);
+}
+
+// mov [rcx], (e/r)ax
+static void emit_store(jit_t *j, int size)
+{
+  if (size == 8)
+    emit_byte(j, 0x48);
+  emit(j, 2, 0x89, 0x01);
+}
+
+static bool jit_body(jit_t *j, const s_node_t *node);
+static bool jit_body_scope(jit_t *j, const s_node_t *node);
+static bool jit_stmt(jit_t *j, const s_node_t *node);
+static bool jit_decl(jit_t *j, const s_node_t *node);
+static bool jit_print_stmt(jit_t *j, const s_node_t *node);
+static bool jit_if_stmt(jit_t *j, const s_node_t *node);
+static bool jit_while_stmt(jit_t *j, const s_node_t *node);
+static bool jit_for_stmt(jit_t *j, const s_node_t *node);
+static void jit_reduce(jit_t *j, const s_node_t *node);
+static void jit_reduce_mul(jit_t *j, const s_node_t *node, const s_node_t *loop, const jit_var_t *counter);
+static bool jit_reduced(jit_t *j, const s_node_t *node);
+static bool jit_ret_stmt(jit_t *j, const s_node_t *node);
+static bool jit_ret_tail(jit_t *j, const s_node_t *node, fn_t *callee);
+static bool jit_ctrl_stmt(jit_t *j, const s_node_t *node);
+
+static bool jit_expr(jit_t *j, const s_node_t *node, type_t *type);
+static bool jit_lvalue(jit_t *j, const s_node_t *node, type_t *type);
+static bool jit_constant(jit_t *j, const s_node_t *node, type_t *type);
+static bool jit_unary(jit_t *j, const s_node_t *node, type_t *type);
+static bool jit_binop(jit_t *j, const s_node_t *node, type_t *type);
+static bool jit_assign(jit_t *j, const s_node_t *node, type_t *type);
+static bool jit_index(jit_t *j, const s_node_t *node, type_t *type);
+static bool jit_direct(jit_t *j, const s_node_t *node, type_t *type, bool lvalue);
+static bool jit_proc(jit_t *j, const s_node_t *node, type_t *type, bool value);
+static bool jit_array_init(jit_t *j, const s_node_t *node, type_t *type);
+static bool jit_post_op(jit_t *j, const s_node_t *node, type_t *type);
+
+static bool jit_cast(jit_t *j, const type_t *from, const type_t *to);
+static jit_var_t *jit_find(jit_t *j, const char *ident);
+static jit_var_t *jit_add(jit_t *j, const type_t *type, const char *ident);
+
+static int  jit_child(const s_node_t *node, const s_node_t *child[4]);
+static bool jit_ident(const s_node_t *node, const char *ident);
+static bool jit_writes(const s_node_t *node, const char *ident);
+static int  jit_count_reduce(const s_node_t *node, const char *ident);
+
+static bool type_num(const type_t *type)
+{
+  return type_cmp(type, &type_i32) || type_cmp(type, &type_f32);
+}
+
+// structs and soa elements are held in place and used by their address
+static bool type_addr(const type_t *type)
+{
+  return type_struct(type) || type_soa(type);
+}
+
+static bool jit_compile(fn_t *fn)
+{
+  jit_t j = {0};
+  
+  j.fn = fn;
+  j.scope = fn->scope_class ? fn->scope_parent->scope_find : fn->scope_parent;
+  
+  // globals are addressed directly so only functions defined at the top
+  // level are compiled
+  if (!j.scope || j.scope->scope_find)
+    return false;
+  
+  j.cap = 256;
+  j.code = ZONE_ALLOC(j.cap);
+  
+  type_t arg_type[JIT_MAX_ARG];
+  int num_arg;
+  if (!jit_param(j.scope, fn, arg_type, &num_arg))
+    goto err_cleanup;
+  
+  j.num_slot = 1;
+  j.frame = 1 + (fn->scope_class ? 1 : 0) + num_arg + jit_count_decl(fn->node)
+    + jit_count_reduce(fn->node, NULL);
+  
+  if (fn->scope_class) {
+    type_t type = { .spec = SPEC_CLASS, .arr = false, .class = fn->scope_class };
+    jit_add(&j, &type, "this");
+  }
+  
+  s_node_t *head = fn->param;
+  for (int i = 0; i < num_arg; i++) {
+    if (!jit_add(&j, &arg_type[i], head->param_decl.ident->data.ident))
+      goto err_cleanup;
+    head = head->param_decl.next;
+  }
+  
+  j.ret_label = j.len;
+  emit(&j, 4, 0x48, 0x8d, 0x65, 0xe0); // lea rsp, [rbp - 32]
+  emit(&j, 2, 0x41, 0x5e);             // pop r14
+  emit(&j, 2, 0x41, 0x5d);             // pop r13
+  emit(&j, 2, 0x41, 0x5c);             // pop r12
+  emit(&j, 1, 0x5b);                   // pop rbx
+  emit(&j, 1, 0x5d);                   // pop rbp
+  emit(&j, 1, 0xc3);                   // ret
+  
+  j.fail_label = j.len;
+  emit(&j, 2, 0x31, 0xc0);             // xor eax, eax
+  emit_jmp(&j, j.ret_label);
+  
+  j.entry = j.len;
+  emit(&j, 1, 0x55);                   // push rbp
+  emit(&j, 3, 0x48, 0x89, 0xe5);       // mov rbp, rsp
+  emit(&j, 1, 0x53);                   // push rbx
+  emit(&j, 2, 0x41, 0x54);             // push r12
+  emit(&j, 2, 0x41, 0x55);             // push r13
+  emit(&j, 2, 0x41, 0x56);             // push r14
+  emit(&j, 3, 0x48, 0x89, 0xfb);       // mov rbx, rdi
+  emit(&j, 3, 0x49, 0x89, 0xf4);       // mov r12, rsi
+  
+  // the frame and the params of a call made from it must fit the stack
+  emit(&j, 3, 0x48, 0x8d, 0x8b);       // lea rcx, [rbx + end]
+  emit_i32(&j, (j.frame + 2 + JIT_MAX_ARG) * 8);
+  emit_mov_imm(&j, 0, &jit_stack[JIT_STACK_SIZE]);
+  emit(&j, 3, 0x48, 0x39, 0xc1);       // cmp rcx, rax
+  emit_check(&j, CC_BE, NULL, JIT_ERR_STACK);
+  
+  j.body_label = j.len;
+  
+  if (!jit_body(&j, fn->node))
+    goto err_cleanup;
+  
+  emit(&j, 1, 0xb8);                   // mov eax, JIT_VOID
+  emit_i32(&j, JIT_VOID);
+  emit_jmp(&j, j.ret_label);
+  
+  void *code = mmap(NULL, j.len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code == MAP_FAILED)
+    goto err_cleanup;
+  
+  memcpy(code, j.code, j.len);
+  mprotect(code, j.len, PROT_READ | PROT_EXEC);
+  
+  jit_page_t *page = ZONE_ALLOC(sizeof(jit_page_t));
+  page->code = code;
+  page->size = j.len;
+  page->next = jit_page_list;
+  jit_page_list = page;
+  
+  fn->jit = (char*) code + j.entry;
+  
+  ZONE_FREE(j.code);
+  
+  return true;
+
+err_cleanup:
+  ZONE_FREE(j.code);
+  return false;
+}
+
+static bool jit_body(jit_t *j, const s_node_t *node)
+{
+  while (node) {
+    if (!jit_stmt(j, node->stmt.body))
+      return false;
+    
+    node = node->stmt.next;
+  }
+  
+  return true;
+}
+
+static bool jit_body_scope(jit_t *j, const s_node_t *node)
+{
+  int num_var = j->num_var;
+  j->block++;
+  
+  bool ok = jit_body(j, node);
+  
+  j->block--;
+  j->num_var = num_var;
+  
+  return ok;
+}
+
+static bool jit_stmt(jit_t *j, const s_node_t *node)
+{
+  type_t type;
+  
+  if (!node)
+    return false;
+  
+  switch (node->node_type) {
+  case S_PROC:
+    return jit_proc(j, node, &type, false);
+  case S_BINOP:
+  case S_CONSTANT:
+  case S_INDEX:
+  case S_DIRECT:
+  case S_UNARY:
+  case S_ARRAY_INIT:
+  case S_POST_OP:
+    return jit_expr(j, node, &type);
+  case S_DECL:
+    return jit_decl(j, node);
+  case S_PRINT:
+    return jit_print_stmt(j, node);
+  case S_IF_STMT:
+    return jit_if_stmt(j, node);
+  case S_WHILE_STMT:
+    return jit_while_stmt(j, node);
+  case S_FOR_STMT:
+    return jit_for_stmt(j, node);
+  case S_RET_STMT:
+    return jit_ret_stmt(j, node);
+  case S_CTRL_STMT:
+    return jit_ctrl_stmt(j, node);
+  default:
+    return false;
+  }
+}
+
+static bool jit_decl(jit_t *j, const s_node_t *node)
+{
+  type_t type;
+  if (!jit_type(j->scope, &type, node->decl.type))
+    return false;
+  
+  jit_var_t *var = jit_add(j, &type, node->decl.ident->data.ident);
+  if (!var)
+    return false;
+  
+  if (node->decl.init) {
+    type_t init_type;
+    if (!jit_expr(j, node->decl.init, &init_type))
+      return false;
+    
+    if (!jit_cast(j, &init_type, &type))
+      return false;
+  } else {
+    emit(j, 2, 0x31, 0xc0);            // xor eax, eax
+  }
+  
+  emit_store_slot(j, var->slot, 8);
+  
+  return true;
+}
+
+static bool jit_print_stmt(jit_t *j, const s_node_t *node)
+{
+  const s_node_t *arg = node->print.arg;
+  
+  while (arg) {
+    type_t type;
+    if (!jit_expr(j, arg->arg.body, &type))
+      return false;
+    
+    if (type_array(&type) || type_addr(&type) || type_cmp(&type, &type_none))
+      return false;
+    
+    jit_site_t *site = jit_site(arg->arg.body, NULL, &type);
+    
+    emit(j, 3, 0x48, 0x89, 0xc6);      // mov rsi, rax
+    emit_mov_imm(j, 7, site);
+    emit_call(j, jit_print);
+    
+    arg = arg->arg.next;
+  }
+  
+  emit_call(j, jit_print_end);
+  
+  return true;
+}
+
+static bool jit_cond(jit_t *j, const s_node_t *node)
+{
+  type_t type;
+  if (!jit_expr(j, node, &type))
+    return false;
+  
+  if (type_cmp(&type, &type_none) || type_addr(&type))
+    return false;
+  
+  emit(j, 2, 0x85, 0xc0);              // test eax, eax
+  
+  return true;
+}
+
+static bool jit_if_stmt(jit_t *j, const s_node_t *node)
+{
+  if (!jit_cond(j, node->if_stmt.cond))
+    return false;
+  
+  int pos_else = emit_jcc_fwd(j, CC_E);
+  
+  if (!jit_body_scope(j, node->if_stmt.body))
+    return false;
+  
+  if (node->if_stmt.next) {
+    int pos_end = emit_jmp_fwd(j);
+    emit_patch(j, pos_else);
+    
+    // the else branch runs in the enclosing scope, declarations made there
+    // are only visible if it was taken
+    const s_node_t *head = node->if_stmt.next;
+    while (head) {
+      if (head->stmt.body && head->stmt.body->node_type == S_DECL)
+        return false;
+      head = head->stmt.next;
+    }
+    
+    if (!jit_body(j, node->if_stmt.next))
+      return false;
+    
+    emit_patch(j, pos_end);
+  } else {
+    emit_patch(j, pos_else);
+  }
+  
+  return true;
+}
+
+// a break jumps past the loop and a continue to its increment, both are
+// patched once the loop is done
+// products reduced from num_reduce on step after the increment, which a
+// continue jumps to
+static bool jit_loop(
+  jit_t *j,
+  const s_node_t *cond,
+  const s_node_t *inc,
+  const s_node_t *body,
+  int num_reduce)
+{
+  int num_brk = j->num_brk;
+  int num_cont = j->num_cont;
+  j->loop++;
+  
+  int top = j->len;
+  
+  if (!jit_cond(j, cond))
+    return false;
+  
+  int pos_end = emit_jcc_fwd(j, CC_E);
+  
+  if (!jit_body_scope(j, body))
+    return false;
+  
+  for (int i = num_cont; i < j->num_cont; i++)
+    emit_patch(j, j->cont[i]);
+  
+  if (inc) {
+    type_t type;
+    if (inc->node_type == S_PROC) {
+      if (!jit_proc(j, inc, &type, false))
+        return false;
+    } else if (!jit_expr(j, inc, &type)) {
+      return false;
+    }
+  }
+  
+  for (int i = num_reduce; i < j->num_reduce; i++) {
+    const jit_reduce_t *reduce = &j->reduce[i];
+    
+    if (reduce->step) {
+      emit_load_slot(j, reduce->step, 4);
+      if (reduce->delta != 1) {
+        emit(j, 2, 0x69, 0xc0);        // imul eax, eax, delta
+        emit_i32(j, reduce->delta);
+      }
+      emit(j, 2, 0x01, 0x83);          // add [rbx + slot * 8], eax
+      emit_i32(j, reduce->slot * 8);
+    } else {
+      emit(j, 2, 0x81, 0x83);          // add dword [rbx + slot * 8], delta
+      emit_i32(j, reduce->slot * 8);
+      emit_i32(j, reduce->delta);
+    }
+  }
+  
+  emit_jmp(j, top);
+  emit_patch(j, pos_end);
+  
+  for (int i = num_brk; i < j->num_brk; i++)
+    emit_patch(j, j->brk[i]);
+  
+  j->num_brk = num_brk;
+  j->num_cont = num_cont;
+  j->loop--;
+  
+  return true;
+}
+
+static bool jit_while_stmt(jit_t *j, const s_node_t *node)
+{
+  return jit_loop(j, node->while_stmt.cond, NULL, node->while_stmt.body, j->num_reduce);
+}
+
+static bool jit_for_stmt(jit_t *j, const s_node_t *node)
+{
+  int num_var = j->num_var;
+  int num_reduce = j->num_reduce;
+  j->block++;
+  
+  bool ok = node->for_stmt.decl && jit_stmt(j, node->for_stmt.decl->stmt.body);
+  
+  if (ok) {
+    jit_reduce(j, node);
+    ok = jit_loop(j, node->for_stmt.cond, node->for_stmt.inc, node->for_stmt.body, num_reduce);
+  }
+  
+  j->block--;
+  j->num_var = num_var;
+  j->num_reduce = num_reduce;
+  
+  return ok;
+}
+
+// 'for (i32 i = ...; ...; i++)' with i only changed by its increment, of
+// 1 or any constant: i * k for a constant k or a local the loop does not
+// change is set before the loop and then stepped by k times the increment,
+// so each product in the loop is a load
+static void jit_reduce(jit_t *j, const s_node_t *node)
+{
+  const s_node_t *decl = node->for_stmt.decl->stmt.body;
+  const s_node_t *inc = node->for_stmt.inc;
+  
+  if (decl->node_type != S_DECL || !inc)
+    return;
+  
+  const char *ident = decl->decl.ident->data.ident;
+  
+  jit_var_t *counter = jit_find(j, ident);
+  if (!counter || !type_cmp(&counter->type, &type_i32))
+    return;
+  
+  int delta = 0;
+  if (inc->node_type == S_POST_OP && jit_ident(inc->post_op.lhs, ident)) {
+    delta = inc->post_op.op->token == TK_INC ? 1 : -1;
+  } else if (inc->node_type == S_BINOP
+    && (inc->binop.op->token == TK_ADD_ASSIGN || inc->binop.op->token == TK_SUB_ASSIGN)
+    && jit_ident(inc->binop.lhs, ident)
+    && inc->binop.rhs->node_type == S_CONSTANT
+    && inc->binop.rhs->constant.lexeme->token == TK_CONST_INTEGER) {
+    delta = inc->binop.rhs->constant.lexeme->data.i32;
+    if (inc->binop.op->token == TK_SUB_ASSIGN)
+      delta = (int) (0u - (unsigned) delta);
+  } else {
+    return;
+  }
+  
+  if (jit_writes(node->for_stmt.cond, ident) || jit_writes(node->for_stmt.body, ident))
+    return;
+  
+  int num_reduce = j->num_reduce;
+  
+  jit_reduce_mul(j, node->for_stmt.cond, node, counter);
+  jit_reduce_mul(j, node->for_stmt.body, node, counter);
+  
+  for (int i = num_reduce; i < j->num_reduce; i++) {
+    jit_reduce_t *reduce = &j->reduce[i];
+    
+    emit_load_slot(j, counter->slot, 4);
+    if (reduce->step) {
+      emit(j, 2, 0x8b, 0x8b);          // mov ecx, [rbx + step * 8]
+      emit_i32(j, reduce->step * 8);
+      emit(j, 3, 0x0f, 0xaf, 0xc1);    // imul eax, ecx
+      reduce->delta = delta;
+    } else {
+      emit(j, 2, 0x69, 0xc0);          // imul eax, eax, factor
+      emit_i32(j, reduce->factor);
+      reduce->delta = (int) ((unsigned) reduce->factor * (unsigned) delta);
+    }
+    emit_store_slot(j, reduce->slot, 4);
+  }
+}
+
+// the products of the counter in a loop which can be reduced, each taking
+// a slot of the ones jit_count_reduce() added to the frame
+static void jit_reduce_mul(jit_t *j, const s_node_t *node, const s_node_t *loop, const jit_var_t *counter)
+{
+  if (!node)
+    return;
+  
+  const s_node_t *child[4];
+  int num_child = jit_child(node, child);
+  for (int i = 0; i < num_child; i++)
+    jit_reduce_mul(j, child[i], loop, counter);
+  
+  if (node->node_type != S_BINOP || node->binop.op->token != '*')
+    return;
+  
+  const s_node_t *by = NULL;
+  if (jit_ident(node->binop.lhs, counter->ident))
+    by = node->binop.rhs;
+  else if (jit_ident(node->binop.rhs, counter->ident))
+    by = node->binop.lhs;
+  else
+    return;
+  
+  if (by->node_type != S_CONSTANT)
+    return;
+  
+  jit_reduce_t reduce = { .counter = counter->slot };
+  
+  if (by->constant.lexeme->token == TK_CONST_INTEGER) {
+    reduce.factor = by->constant.lexeme->data.i32;
+  } else if (by->constant.lexeme->token == TK_IDENTIFIER) {
+    const char *ident = by->constant.lexeme->data.ident;
+    
+    // only locals, globals may be changed by any call
+    jit_var_t *var = jit_find(j, ident);
+    if (!var || var == counter || !type_cmp(&var->type, &type_i32))
+      return;
+    
+    if (jit_writes(loop->for_stmt.cond, ident)
+      || jit_writes(loop->for_stmt.inc, ident)
+      || jit_writes(loop->for_stmt.body, ident))
+      return;
+    
+    reduce.step = var->slot;
+  } else {
+    return;
+  }
+  
+  for (int i = 0; i < j->num_reduce; i++) {
+    const jit_reduce_t *prev = &j->reduce[i];
+    if (prev->counter == reduce.counter
+      && prev->step == reduce.step
+      && (reduce.step || prev->factor == reduce.factor))
+      return;
+  }
+  
+  if (j->num_reduce == JIT_MAX_REDUCE || j->num_slot == j->frame)
+    return;
+  
+  reduce.slot = j->num_slot++;
+  j->reduce[j->num_reduce++] = reduce;
+}
+
+static bool jit_ret_stmt(jit_t *j, const s_node_t *node)
+{
+  if (j->fn->is_new)
+    return false;
+  
+  fn_t *callee = jit_tail(j->scope, j->fn, node);
+  if (callee && !jit_find(j, node->ret_stmt.body->proc.base->constant.lexeme->data.ident))
+    return jit_ret_tail(j, node, callee);
+  
+  type_t type;
+  if (!jit_expr(j, node->ret_stmt.body, &type))
+    return false;
+  
+  if (!type_cmp(&type, &j->fn->type) || type_addr(&type))
+    return false;
+  
+  emit_store_slot(j, 0, 8);
+  emit(j, 1, 0xb8);                    // mov eax, JIT_VALUE
+  emit_i32(j, JIT_VALUE);
+  emit_jmp(j, j->ret_label);
+  
+  return true;
+}
+
+// the args of a tail call replace the params on the frame. a function
+// calling itself jumps back to its body, any other call is left for
+// jit_tail_run to make once the frame is returned.
+static bool jit_ret_tail(jit_t *j, const s_node_t *node, fn_t *callee)
+{
+  const s_node_t *proc = node->ret_stmt.body;
+  
+  type_t arg_type[JIT_MAX_ARG];
+  int num_arg;
+  if (!jit_param(j->scope, callee, arg_type, &num_arg))
+    return false;
+  
+  const s_node_t *arg = proc->proc.arg;
+  for (int i = 0; i < num_arg; i++) {
+    if (!arg)
+      return false;
+    
+    type_t type;
+    if (!jit_expr(j, arg->arg.body, &type))
+      return false;
+    
+    if (!jit_cast(j, &type, &arg_type[i]))
+      return false;
+    
+    emit_byte(j, 0x50);                // push rax
+    arg = arg->arg.next;
+  }
+  
+  if (arg)
+    return false;
+  
+  for (int i = num_arg - 1; i >= 0; i--) {
+    emit_byte(j, 0x58);                // pop rax
+    emit_store_slot(j, 1 + i, 8);
+  }
+  
+  if (callee == j->fn && !j->fn->scope_class && jit_returns(j->fn->node)) {
+    emit_jmp(j, j->body_label);
+    return true;
+  }
+  
+  type_t ret_type = callee->type;
+  jit_site_t *site = jit_site(proc, callee, &ret_type);
+  memcpy(site->arg_type, arg_type, sizeof(type_t) * num_arg);
+  site->num_arg = num_arg;
+  
+  emit_mov_imm(j, 0, site);
+  emit_store_slot(j, 0, 8);
+  emit(j, 1, 0xb8);                    // mov eax, JIT_TAIL
+  emit_i32(j, JIT_TAIL);
+  emit_jmp(j, j->ret_label);
+  
+  return true;
+}
+
+// one outside a loop is left for the interpreter to report
+static bool jit_ctrl_stmt(jit_t *j, const s_node_t *node)
+{
+  if (!j->loop)
+    return false;
+  
+  if (node->ctrl_stmt.lexeme->token == TK_BREAK) {
+    if (j->num_brk == JIT_MAX_BREAK)
+      return false;
+    
+    j->brk[j->num_brk++] = emit_jmp_fwd(j);
+  } else {
+    if (j->num_cont == JIT_MAX_BREAK)
+      return false;
+    
+    j->cont[j->num_cont++] = emit_jmp_fwd(j);
+  }
+  
+  return true;
+}
+
+static bool jit_expr(jit_t *j, const s_node_t *node, type_t *type)
+{
+  switch (node->node_type) {
+  case S_BINOP:
+    return jit_binop(j, node, type);
+  case S_UNARY:
+    return jit_unary(j, node, type);
+  case S_INDEX:
+    if (!jit_index(j, node, type))
+      return false;
+    if (!type_addr(type))
+      emit_load(j, type_size(type));
+    return true;
+  case S_DIRECT:
+    return jit_direct(j, node, type, false);
+  case S_PROC:
+    return jit_proc(j, node, type, true);
+  case S_CONSTANT:
+    return jit_constant(j, node, type);
+  case S_ARRAY_INIT:
+    return jit_array_init(j, node, type);
+  case S_POST_OP:
+    return jit_post_op(j, node, type);
+  default:
+    return false;
+  }
+}
+
+// leaves the address of an assignable expression in rax
+static bool jit_lvalue(jit_t *j, const s_node_t *node, type_t *type)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    if (node->constant.lexeme->token != TK_IDENTIFIER)
+      return false;
+    
+    jit_var_t *var = jit_find(j, node->constant.lexeme->data.ident);
+    if (var) {
+      emit(j, 3, 0x48, 0x8d, 0x83);    // lea rax, [rbx + slot * 8]
+      emit_i32(j, var->slot * 8);
+      *type = var->type;
+      return true;
+    }
+    
+    var_t *global = scope_find_var(j->scope, node->constant.lexeme->data.ident);
+    if (!global)
+      return false;
+    
+    emit_mov_imm(j, 0, &stack_mem->block[global->loc]);
+    *type = global->type;
+    return true;
+  case S_INDEX:
+    return jit_index(j, node, type);
+  case S_DIRECT:
+    return jit_direct(j, node, type, true);
+  default:
+    return false;
+  }
+}
+
+static bool jit_constant(jit_t *j, const s_node_t *node, type_t *type)
+{
+  const lexeme_t *lexeme = node->constant.lexeme;
+  
+  switch (lexeme->token) {
+  case TK_CONST_INTEGER:
+    emit_byte(j, 0xb8);                // mov eax, i32
+    emit_i32(j, lexeme->data.i32);
+    *type = type_i32;
+    return true;
+  case TK_CONST_FLOAT:
+    emit_byte(j, 0xb8);                // mov eax, f32
+    int bits;
+    memcpy(&bits, &lexeme->data.f32, 4);
+    emit_i32(j, bits);
+    *type = type_f32;
+    return true;
+  case TK_STRING_LITERAL:
+    emit_mov_imm(j, 7, lexeme->data.string_literal);
+    emit_call(j, heap_alloc_string);
+    *type = type_string;
+    return true;
+  case TK_IDENTIFIER:
+    if (!jit_lvalue(j, node, type))
+      return false;
+    if (!type_addr(type))
+      emit_load(j, type_size(type));
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool jit_unary(jit_t *j, const s_node_t *node, type_t *type)
+{
+  if (!jit_expr(j, node->unary.rhs, type))
+    return false;
+  
+  if (node->unary.op->token == '-') {
+    if (type_cmp(type, &type_i32))
+      emit(j, 2, 0xf7, 0xd8);          // neg eax
+    else if (type_cmp(type, &type_f32)) {
+      emit_byte(j, 0x35);              // xor eax, sign
+      emit_i32(j, 0x80000000);
+    } else
+      return false;
+  } else if (node->unary.op->token == '!') {
+    if (!type_cmp(type, &type_i32))
+      return false;
+    emit(j, 2, 0x85, 0xc0);            // test eax, eax
+    emit(j, 3, 0x0f, 0x94, 0xc0);      // sete al
+    emit(j, 3, 0x0f, 0xb6, 0xc0);      // movzx eax, al
+  } else {
+    return false;
+  }
+  
+  return true;
+}
+
+static bool jit_binop_i32(jit_t *j, int op)
+{
+  int cc = 0;
+  
+  switch (op) {
+  case '+':
+    emit(j, 2, 0x01, 0xc8);            // add eax, ecx
+    return true;
+  case '-':
+    emit(j, 2, 0x29, 0xc8);            // sub eax, ecx
+    return true;
+  case '*':
+    emit(j, 3, 0x0f, 0xaf, 0xc1);      // imul eax, ecx
+    return true;
+  case '/':
+    emit(j, 1, 0x99);                  // cdq
+    emit(j, 2, 0xf7, 0xf9);            // idiv ecx
+    return true;
+  case TK_AND:
+  case TK_OR:
+    emit(j, 2, 0x85, 0xc0);            // test eax, eax
+    emit(j, 3, 0x0f, 0x95, 0xc0);      // setne al
+    emit(j, 2, 0x85, 0xc9);            // test ecx, ecx
+    emit(j, 3, 0x0f, 0x95, 0xc1);      // setne cl
+    emit(j, 2, op == TK_AND ? 0x20 : 0x08, 0xc8); // and/or al, cl
+    emit(j, 3, 0x0f, 0xb6, 0xc0);      // movzx eax, al
+    return true;
+  case '<':
+    cc = CC_L;
+    break;
+  case '>':
+    cc = CC_G;
+    break;
+  case TK_LE:
+    cc = CC_LE;
+    break;
+  case TK_GE:
+    cc = CC_GE;
+    break;
+  case TK_EQ:
+    cc = CC_E;
+    break;
+  case TK_NE:
+    cc = CC_NE;
+    break;
+  default:
+    return false;
+  }
+  
+  emit(j, 2, 0x39, 0xc8);              // cmp eax, ecx
+  emit(j, 3, 0x0f, 0x90 | cc, 0xc0);   // setcc al
+  emit(j, 3, 0x0f, 0xb6, 0xc0);        // movzx eax, al
+  
+  return true;
+}
+
+static bool jit_binop_f32(jit_t *j, int op, type_t *type)
+{
+  *type = type_f32;
+  
+  switch (op) {
+  case '+':
+    emit(j, 4, 0xf3, 0x0f, 0x58, 0xc1); // addss xmm0, xmm1
+    break;
+  case '-':
+    emit(j, 4, 0xf3, 0x0f, 0x5c, 0xc1); // subss xmm0, xmm1
+    break;
+  case '*':
+    emit(j, 4, 0xf3, 0x0f, 0x59, 0xc1); // mulss xmm0, xmm1
+    break;
+  case '/':
+    emit(j, 4, 0xf3, 0x0f, 0x5e, 0xc1); // divss xmm0, xmm1
+    break;
+  case '<':
+    emit(j, 3, 0x0f, 0x2e, 0xc8);      // ucomiss xmm1, xmm0
+    emit(j, 3, 0x0f, 0x90 | CC_A, 0xc0);
+    break;
+  case '>':
+    emit(j, 3, 0x0f, 0x2e, 0xc1);      // ucomiss xmm0, xmm1
+    emit(j, 3, 0x0f, 0x90 | CC_A, 0xc0);
+    break;
+  case TK_LE:
+    emit(j, 3, 0x0f, 0x2e, 0xc8);
+    emit(j, 3, 0x0f, 0x90 | CC_AE, 0xc0);
+    break;
+  case TK_GE:
+    emit(j, 3, 0x0f, 0x2e, 0xc1);
+    emit(j, 3, 0x0f, 0x90 | CC_AE, 0xc0);
+    break;
+  case TK_EQ:
+    emit(j, 3, 0x0f, 0x2e, 0xc1);
+    emit(j, 3, 0x0f, 0x90 | CC_E, 0xc0);
+    emit(j, 3, 0x0f, 0x90 | CC_NP, 0xc1);
+    emit(j, 2, 0x20, 0xc8);            // and al, cl
+    break;
+  case TK_NE:
+    emit(j, 3, 0x0f, 0x2e, 0xc1);
+    emit(j, 3, 0x0f, 0x90 | CC_NE, 0xc0);
+    emit(j, 3, 0x0f, 0x90 | CC_P, 0xc1);
+    emit(j, 2, 0x08, 0xc8);            // or al, cl
+    break;
+  default:
+    return false;
+  }
+  
+  switch (op) {
+  case '+':
+  case '-':
+  case '*':
+  case '/':
+    emit(j, 4, 0x66, 0x0f, 0x7e, 0xc0); // movd eax, xmm0
+    break;
+  case TK_LE:
+  case TK_GE:
+  case TK_EQ:
+  case TK_NE:
+    // the interpreter stores these as the f32 1.0 in an i32
+    emit(j, 3, 0x0f, 0xb6, 0xc0);      // movzx eax, al
+    emit(j, 2, 0xf7, 0xd8);            // neg eax
+    emit_byte(j, 0x25);                // and eax, 1.0
+    emit_i32(j, 0x3f800000);
+    *type = type_i32;
+    break;
+  default:
+    emit(j, 3, 0x0f, 0xb6, 0xc0);      // movzx eax, al
+    *type = type_i32;
+    break;
+  }
+  
+  return true;
+}
+
+static bool jit_binop(jit_t *j, const s_node_t *node, type_t *type)
+{
+  int op = node->binop.op->token;
+  
+  if (op == '=' || (op >= TK_ADD_ASSIGN && op <= TK_DIV_ASSIGN))
+    return jit_assign(j, node, type);
+  
+  if (op == '*' && jit_reduced(j, node)) {
+    *type = type_i32;
+    return true;
+  }
+  
+  type_t lhs;
+  if (!jit_expr(j, node->binop.lhs, &lhs))
+    return false;
+  
+  emit_byte(j, 0x50);                  // push rax
+  
+  type_t rhs;
+  if (!jit_expr(j, node->binop.rhs, &rhs))
+    return false;
+  
+  emit(j, 3, 0x48, 0x89, 0xc1);        // mov rcx, rax
+  emit_byte(j, 0x58);                  // pop rax
+  
+  if (type_cmp(&lhs, &type_i32) && type_cmp(&rhs, &type_i32)) {
+    *type = type_i32;
+    return jit_binop_i32(j, op);
+  } else if (type_num(&lhs) && type_num(&rhs)) {
+    if (op == TK_AND || op == TK_OR)
+      return false;
+    
+    if (type_cmp(&lhs, &type_i32))
+      emit(j, 4, 0xf3, 0x0f, 0x2a, 0xc0); // cvtsi2ss xmm0, eax
+    else
+      emit(j, 4, 0x66, 0x0f, 0x6e, 0xc0); // movd xmm0, eax
+    
+    if (type_cmp(&rhs, &type_i32))
+      emit(j, 4, 0xf3, 0x0f, 0x2a, 0xc9); // cvtsi2ss xmm1, ecx
+    else
+      emit(j, 4, 0x66, 0x0f, 0x6e, 0xc9); // movd xmm1, ecx
+    
+    return jit_binop_f32(j, op, type);
+  } else if (type_cmp(&lhs, &type_string) && type_cmp(&rhs, &type_string) && op == '+') {
+    emit(j, 3, 0x48, 0x89, 0xc7);      // mov rdi, rax
+    emit(j, 3, 0x48, 0x89, 0xce);      // mov rsi, rcx
+    emit_call(j, jit_concat);
+    *type = type_string;
+    return true;
+  }
+  
+  return false;
+}
+
+// loads a product jit_reduce() keeps in a slot
+static bool jit_reduced(jit_t *j, const s_node_t *node)
+{
+  for (int side = 0; side < 2; side++) {
+    const s_node_t *lhs = side ? node->binop.rhs : node->binop.lhs;
+    const s_node_t *by = side ? node->binop.lhs : node->binop.rhs;
+    
+    if (!jit_ident(lhs, NULL) || by->node_type != S_CONSTANT)
+      continue;
+    
+    const jit_var_t *counter = jit_find(j, lhs->constant.lexeme->data.ident);
+    if (!counter)
+      continue;
+    
+    const jit_var_t *var = NULL;
+    if (jit_ident(by, NULL))
+      var = jit_find(j, by->constant.lexeme->data.ident);
+    else if (by->constant.lexeme->token != TK_CONST_INTEGER)
+      continue;
+    
+    for (int i = j->num_reduce - 1; i >= 0; i--) {
+      const jit_reduce_t *reduce = &j->reduce[i];
+      if (reduce->counter != counter->slot)
+        continue;
+      
+      if ((var && reduce->step == var->slot)
+        || (!jit_ident(by, NULL) && !reduce->step && reduce->factor == by->constant.lexeme->data.i32)) {
+        emit_load_slot(j, reduce->slot, 4);
+        return true;
+      }
+    }
+  }
+  
+  return false;
+}
+
+static bool jit_assign(jit_t *j, const s_node_t *node, type_t *type)
+{
+  int op = node->binop.op->token;
+  
+  // structs are copied by the interpreter
+  if (!jit_lvalue(j, node->binop.lhs, type) || type_addr(type))
+    return false;
+  
+  int size = type_size(type);
+  
+  emit_byte(j, 0x50);                  // push rax
+  
+  // compound assignments read the lhs before the rhs is evaluated
+  if (op != '=') {
+    emit_load(j, size);
+    emit_byte(j, 0x50);                // push rax
+  }
+  
+  bool hold = jit_in_array(node->binop.lhs);
+  
+  j->hold += hold;
+  type_t rhs;
+  bool ok = jit_expr(j, node->binop.rhs, &rhs);
+  j->hold -= hold;
+  
+  if (!ok)
+    return false;
+  
+  if (type_num(type)) {
+    if (!type_num(&rhs) || !jit_cast(j, &rhs, type))
+      return false;
+    
+    if (op != '=') {
+      emit(j, 3, 0x48, 0x89, 0xc1);    // mov rcx, rax
+      emit_byte(j, 0x58);              // pop rax
+      
+      int arith_op = "+-*/"[op - TK_ADD_ASSIGN];
+      
+      if (type_cmp(type, &type_i32)) {
+        if (!jit_binop_i32(j, arith_op))
+          return false;
+      } else {
+        type_t f32;
+        emit(j, 4, 0x66, 0x0f, 0x6e, 0xc0); // movd xmm0, eax
+        emit(j, 4, 0x66, 0x0f, 0x6e, 0xc9); // movd xmm1, ecx
+        if (!jit_binop_f32(j, arith_op, &f32))
+          return false;
+      }
+    }
+  } else if (type_cmp(type, &type_string) && type_cmp(&rhs, &type_string)) {
+    if (op == TK_ADD_ASSIGN) {
+      emit(j, 3, 0x48, 0x89, 0xc6);    // mov rsi, rax
+      emit_byte(j, 0x5f);              // pop rdi
+      emit_call(j, jit_concat);
+    } else if (op != '=') {
+      return false;
+    }
+  } else if (op != '=' || !type_cmp(type, &rhs)) {
+    return false;
+  }
+  
+  emit_byte(j, 0x59);                  // pop rcx
+  emit_store(j, size);
+  
+  return true;
+}
+
+// leaves the address of the element in rax
+// the indices of a T[,] or T[,,] are pushed after the array, then each is
+// checked against its extent as the element is found in rcx
+static bool jit_grid_index(jit_t *j, const s_node_t *node, const type_t *base)
+{
+  emit_byte(j, 0x50);                  // push rax
+  
+  int dim = base->dim;
+  const s_node_t *head = node->index.index;
+  
+  for (int i = 0; i < dim; i++) {
+    if (!head || head->node_type != S_ARG)
+      return false;
+    
+    type_t index;
+    if (!jit_expr(j, head->arg.body, &index) || !type_cmp(&index, &type_i32))
+      return false;
+    
+    emit(j, 3, 0x48, 0x63, 0xc0);      // movsxd rax, eax
+    emit_byte(j, 0x50);                // push rax
+    
+    head = head->arg.next;
+  }
+  
+  if (head)
+    return false;
+  
+  emit(j, 5, 0x48, 0x8b, 0x44, 0x24, dim * 8); // mov rax, [rsp + dim * 8]
+  emit(j, 3, 0x48, 0x85, 0xc0);        // test rax, rax
+  emit_check(j, CC_NE, node, JIT_ERR_INDEX_NULL);
+  
+  static const int extent[GRID_DIM] = {
+    offsetof(heap_block_t, layers),
+    offsetof(heap_block_t, rows),
+    offsetof(heap_block_t, cols)
+  };
+  
+  // a negative index compares above any extent
+  emit(j, 2, 0x31, 0xc9);              // xor ecx, ecx
+  for (int i = 0; i < dim; i++) {
+    emit(j, 5, 0x48, 0x8b, 0x54, 0x24, (dim - 1 - i) * 8); // mov rdx, [rsp + index]
+    emit(j, 3, 0x44, 0x8b, 0x80);      // mov r8d, [rax + extent]
+    emit_i32(j, extent[GRID_DIM - dim + i]);
+    emit(j, 3, 0x4c, 0x39, 0xc2);      // cmp rdx, r8
+    emit_check(j, CC_B, node, JIT_ERR_INDEX_BOUNDS);
+    emit(j, 4, 0x49, 0x0f, 0xaf, 0xc8); // imul rcx, r8
+    emit(j, 3, 0x48, 0x01, 0xd1);      // add rcx, rdx
+  }
+  
+  emit(j, 3, 0x48, 0x69, 0xc9);        // imul rcx, rcx, size
+  emit_i32(j, type_size_base(base));
+  emit(j, 4, 0x48, 0x83, 0xc4, (dim + 1) * 8); // add rsp, (dim + 1) * 8
+  
+  emit(j, 3, 0x48, 0x8b, 0x80);        // mov rax, [rax + block]
+  emit_i32(j, offsetof(heap_block_t, block));
+  emit(j, 3, 0x48, 0x01, 0xc8);        // add rax, rcx
+  
+  return true;
+}
+
+static bool jit_index(jit_t *j, const s_node_t *node, type_t *type)
+{
+  type_t base;
+  if (!jit_expr(j, node->index.base, &base))
+    return false;
+  
+  if (!type_array(&base))
+    return false;
+  
+  if (base.dim) {
+    if (!jit_grid_index(j, node, &base))
+      return false;
+    
+    *type = base;
+    type->arr = false;
+    type->dim = 0;
+    
+    return true;
+  }
+  
+  emit_byte(j, 0x50);                  // push rax
+  
+  type_t index;
+  if (!jit_expr(j, node->index.index, &index))
+    return false;
+  
+  if (!type_cmp(&index, &type_i32))
+    return false;
+  
+  emit(j, 3, 0x48, 0x63, 0xc8);        // movsxd rcx, eax
+  emit_byte(j, 0x58);                  // pop rax
+  
+  // an soa index is kept in r8 while it is checked
+  bool soa = base.spec == SPEC_SOA;
+  bool check = !node->index.in_range;
+  
+  if (soa && check)
+    emit(j, 3, 0x49, 0x89, 0xc8);      // mov r8, rcx
+  
+  if (!soa || check) {
+    emit(j, 3, 0x48, 0x69, 0xc9);      // imul rcx, rcx, size
+    emit_i32(j, type_size_base(&base));
+  }
+  
+  // a negative offset compares above any size
+  if (check) {
+    emit(j, 3, 0x48, 0x85, 0xc0);      // test rax, rax
+    emit_check(j, CC_NE, node, JIT_ERR_INDEX_NULL);
+    
+    emit(j, 2, 0x8b, 0x90);            // mov edx, [rax + size]
+    emit_i32(j, offsetof(heap_block_t, size));
+    emit(j, 3, 0x48, 0x39, 0xd1);      // cmp rcx, rdx
+    emit_check(j, CC_B, node, JIT_ERR_INDEX_BOUNDS);
+  }
+  
+  // soa_offset() of the index
+  if (soa) {
+    if (check)
+      emit(j, 3, 0x4c, 0x89, 0xc1);    // mov rcx, r8
+    emit(j, 3, 0x48, 0x89, 0xca);      // mov rdx, rcx
+    emit(j, 4, 0x48, 0xc1, 0xf9, __builtin_ctz(SOA_RUN)); // sar rcx, log2(SOA_RUN)
+    emit(j, 3, 0x48, 0x69, 0xc9);      // imul rcx, rcx, SOA_RUN * size
+    emit_i32(j, SOA_RUN * type_size_base(&base));
+    emit(j, 3, 0x83, 0xe2, SOA_RUN - 1); // and edx, SOA_RUN - 1
+    emit(j, 4, 0x48, 0x8d, 0x0c, 0x91); // lea rcx, [rcx + rdx * 4]
+  }
+  
+  emit(j, 3, 0x48, 0x8b, 0x80);        // mov rax, [rax + block]
+  emit_i32(j, offsetof(heap_block_t, block));
+  emit(j, 3, 0x48, 0x01, 0xc8);        // add rax, rcx
+  
+  *type = base;
+  type->arr = false;
+  
+  return true;
+}
+
+static bool jit_direct(jit_t *j, const s_node_t *node, type_t *type, bool lvalue)
+{
+  type_t base;
+  if (!jit_expr(j, node->direct.base, &base))
+    return false;
+  
+  const char *ident = node->direct.child_ident->data.ident;
+  
+  emit(j, 3, 0x48, 0x85, 0xc0);        // test rax, rax
+  
+  if (type_array(&base)) {
+    int extent = jit_extent(&base, ident);
+    
+    if (lvalue || (extent < 0 && strcmp(ident, "length") != 0 && strcmp(ident, "capacity") != 0))
+      return false;
+    
+    emit_check(j, CC_NE, node, JIT_ERR_MEMBER_NULL);
+    
+    if (extent >= 0) {
+      emit(j, 2, 0x8b, 0x80);          // mov eax, [rax + extent]
+      emit_i32(j, extent);
+      
+      *type = type_i32;
+      return true;
+    }
+    
+    emit(j, 2, 0x8b, 0x80);            // mov eax, [rax + size or cap]
+    emit_i32(j, ident[0] == 'l' ? offsetof(heap_block_t, size) : offsetof(heap_block_t, cap));
+    
+    int size = type_size_base(&base);
+    if (size == 4 || size == 8) {
+      emit(j, 3, 0xc1, 0xf8, size == 8 ? 3 : 2); // sar eax, n
+    } else {
+      emit_byte(j, 0xb9);              // mov ecx, size
+      emit_i32(j, size);
+      emit(j, 2, 0x31, 0xd2);          // xor edx, edx
+      emit(j, 2, 0xf7, 0xf1);          // div ecx
+    }
+    
+    *type = type_i32;
+    return true;
+  }
+  
+  if (!type_class(&base) && !type_addr(&base))
+    return false;
+  
+  var_t *var = map_get(&base.class->map_var, ident);
+  if (!var)
+    return false;
+  
+  // a struct is held in place, so its fields are at an offset from it
+  if (type_class(&base)) {
+    emit_check(j, CC_NE, node, JIT_ERR_MEMBER_NULL);
+    
+    emit(j, 3, 0x48, 0x8b, 0x80);      // mov rax, [rax + block]
+    emit_i32(j, offsetof(heap_block_t, block));
+  }
+  
+  *type = var->type;
+  
+  // the fields of an soa element are a run apart
+  int loc = var->loc;
+  if (type_soa(&base)) {
+    loc *= SOA_RUN;
+    if (type_struct(type))
+      type->spec = SPEC_SOA;
+  }
+  
+  emit(j, 3, 0x48, 0x8d, 0x80);        // lea rax, [rax + loc]
+  emit_i32(j, loc);
+  
+  if (!lvalue && !type_addr(type))
+    emit_load(j, type_size(type));
+  
+  return true;
+}
+
+static bool jit_proc(jit_t *j, const s_node_t *node, type_t *type, bool value)
+{
+  const s_node_t *base = node->proc.base;
+  fn_t *fn = NULL;
+  bool self = false;
+  
+  switch (base->node_type) {
+  case S_CONSTANT: {
+    if (base->constant.lexeme->token != TK_IDENTIFIER)
+      return false;
+    
+    const char *ident = base->constant.lexeme->data.ident;
+    if (jit_find(j, ident) || scope_find_var(j->scope, ident))
+      return false;
+    
+    fn = scope_find_fn(j->scope, ident);
+    break;
+  }
+  case S_DIRECT: {
+    type_t class;
+    if (!jit_expr(j, base->direct.base, &class))
+      return false;
+    
+    if (!type_class(&class))
+      return false;
+    
+    const char *method = base->direct.child_ident->data.ident;
+    if (map_get(&class.class->map_var, method))
+      return false;
+    
+    fn = map_get(&class.class->map_fn, method);
+    
+    emit(j, 3, 0x48, 0x85, 0xc0);      // test rax, rax
+    emit_check(j, CC_NE, base, JIT_ERR_MEMBER_NULL);
+    emit_byte(j, 0x50);                // push rax
+    self = true;
+    break;
+  }
+  case S_NEW: {
+    const scope_t *new_class = scope_find_class(j->scope, base->new.class_ident->data.ident);
+    if (!new_class)
+      return false;
+    
+    fn = scope_find_fn(new_class, "+new");
+    break;
+  }
+  default:
+    return false;
+  }
+  
+  // structs, which are copied rather than referenced, are left to the
+  // interpreter. natives can not reach the arrays of the script.
+  if (!fn || fn->type.spec == SPEC_STRUCT || (j->hold && !fn->xaction))
+    return false;
+  
+  type_t arg_type[JIT_MAX_ARG];
+  int num_arg;
+  if (!jit_param(j->scope, fn, arg_type, &num_arg))
+    return false;
+  
+  const s_node_t *arg = node->proc.arg;
+  for (int i = 0; i < num_arg; i++) {
+    if (!arg)
+      return false;
+    
+    type_t type;
+    if (!jit_expr(j, arg->arg.body, &type))
+      return false;
+    
+    if (!jit_cast(j, &type, &arg_type[i]))
+      return false;
+    
+    emit_byte(j, 0x50);                // push rax
+    arg = arg->arg.next;
+  }
+  
+  if (arg)
+    return false;
+  
+  int arg_slot = j->frame + (fn->scope_class ? 2 : 1);
+  for (int i = num_arg - 1; i >= 0; i--) {
+    emit_byte(j, 0x58);                // pop rax
+    emit_store_slot(j, arg_slot + i, 8);
+  }
+  
+  if (self) {
+    emit_byte(j, 0x58);                // pop rax
+    emit_store_slot(j, j->frame + 1, 8);
+  }
+  
+  if ((fn == j->fn || fn->jit) && !fn->is_new) {
+    emit(j, 3, 0x48, 0x8d, 0xbb);      // lea rdi, [rbx + frame * 8]
+    emit_i32(j, j->frame * 8);
+    emit(j, 3, 0x4c, 0x89, 0xe6);      // mov rsi, r12
+    
+    if (fn == j->fn) {
+      emit_byte(j, 0xe8);              // call entry
+      emit_i32(j, j->entry - (j->len + 4));
+    } else {
+      emit_mov_imm(j, 0, fn->jit);
+      emit(j, 2, 0xff, 0xd0);          // call rax
+    }
+    
+    emit(j, 3, 0x83, 0xf8, JIT_TAIL);  // cmp eax, JIT_TAIL
+    int pos = emit_jcc_fwd(j, CC_NE);
+    emit(j, 3, 0x48, 0x8d, 0xbb);      // lea rdi, [rbx + frame * 8]
+    emit_i32(j, j->frame * 8);
+    emit(j, 3, 0x4c, 0x89, 0xe6);      // mov rsi, r12
+    emit_call(j, jit_tail_run);
+    emit_patch(j, pos);
+  } else {
+    type_t ret_type = fn->type;
+    jit_site_t *site = jit_site(node, fn, &ret_type);
+    memcpy(site->arg_type, arg_type, sizeof(type_t) * num_arg);
+    site->num_arg = num_arg;
+    
+    emit_mov_imm(j, 7, site);
+    emit(j, 3, 0x4c, 0x89, 0xe6);      // mov rsi, r12
+    emit(j, 3, 0x48, 0x8d, 0x93);      // lea rdx, [rbx + frame * 8]
+    emit_i32(j, j->frame * 8);
+    emit_call(j, jit_call);
+  }
+  
+  emit(j, 2, 0x85, 0xc0);              // test eax, eax
+  emit_jcc(j, CC_E, j->fail_label);
+  
+  if (!value) {
+    *type = type_none;
+    return true;
+  }
+  
+  if (fn->is_new) {
+    *type = (type_t) { .spec = SPEC_CLASS, .arr = false, .class = fn->scope_class };
+  } else {
+    if (type_cmp(&fn->type, &type_none))
+      return false;
+    
+    emit(j, 3, 0x83, 0xf8, JIT_VALUE); // cmp eax, JIT_VALUE
+    emit_check(j, CC_E, node, JIT_ERR_NO_VALUE);
+    
+    *type = fn->type;
+  }
+  
+  emit_load_slot(j, j->frame, type_size(type));
+  
+  return true;
+}
+
+static bool jit_array_init(jit_t *j, const s_node_t *node, type_t *type)
+{
+  if (!jit_type(j->scope, type, node->array_init.type))
+    return false;
+  
+  int size = type_size(type);
+  
+  if (node->array_init.init) {
+    int num_arg = 0;
+    const s_node_t *head = node->array_init.init;
+    while (head) {
+      num_arg++;
+      head = head->arg.next;
+    }
+    
+    emit_byte(j, 0xbf);                // mov edi, size
+    emit_i32(j, num_arg * size);
+    emit_call(j, heap_alloc);
+    emit_byte(j, 0x50);                // push rax
+    
+    head = node->array_init.init;
+    for (int i = 0; i < num_arg; i++) {
+      type_t arg;
+      if (!jit_expr(j, head->arg.body, &arg))
+        return false;
+      
+      if (!type_cmp(&arg, type))
+        return false;
+      
+      emit(j, 4, 0x48, 0x8b, 0x0c, 0x24); // mov rcx, [rsp]
+      emit(j, 3, 0x48, 0x8b, 0x49);    // mov rcx, [rcx + block]
+      emit_byte(j, offsetof(heap_block_t, block));
+      if (size == 8)
+        emit_byte(j, 0x48);
+      emit(j, 2, 0x89, 0x81);          // mov [rcx + i * size], (e/r)ax
+      emit_i32(j, i * size);
+      
+      head = head->arg.next;
+    }
+    
+    emit_byte(j, 0x58);                // pop rax
+  } else if (node->array_init.size && node->array_init.size->node_type != S_ARG) {
+    type_t num;
+    if (!jit_expr(j, node->array_init.size, &num))
+      return false;
+    
+    if (!type_cmp(&num, &type_i32))
+      return false;
+    
+    emit(j, 2, 0x89, 0xc7);            // mov edi, eax
+    emit(j, 2, 0x69, 0xff);            // imul edi, edi, size
+    emit_i32(j, size);
+    emit_call(j, heap_alloc);
+  } else if (node->array_init.size) {
+    // the extents of a T[,] or T[,,] are pushed and made into it by a call
+    int dim = 0;
+    for (const s_node_t *head = node->array_init.size; head; head = head->arg.next) {
+      if (++dim > GRID_DIM)
+        return false;
+      
+      type_t num;
+      if (!jit_expr(j, head->arg.body, &num) || !type_cmp(&num, &type_i32))
+        return false;
+      
+      emit_byte(j, 0x50);              // push rax
+    }
+    
+    emit(j, 3, 0x48, 0x89, 0xe7);      // mov rdi, rsp
+    emit_byte(j, 0xbe);                // mov esi, dim
+    emit_i32(j, dim);
+    emit_byte(j, 0xba);                // mov edx, size
+    emit_i32(j, size);
+    emit_call(j, jit_grid);
+    emit(j, 4, 0x48, 0x83, 0xc4, dim * 8); // add rsp, dim * 8
+    
+    emit(j, 3, 0x48, 0x85, 0xc0);      // test rax, rax
+    emit_check(j, CC_NE, node, JIT_ERR_GRID_SIZE);
+    
+    type->dim = dim;
+  } else {
+    return false;
+  }
+  
+  type->arr = true;
+  
+  return true;
+}
+
+static bool jit_post_op(jit_t *j, const s_node_t *node, type_t *type)
+{
+  if (!jit_lvalue(j, node->post_op.lhs, type))
+    return false;
+  
+  bool inc = node->post_op.op->token == TK_INC;
+  
+  emit(j, 3, 0x48, 0x89, 0xc1);        // mov rcx, rax
+  emit(j, 2, 0x8b, 0x01);              // mov eax, [rcx]
+  
+  if (type_cmp(type, &type_i32)) {
+    emit(j, 2, 0x89, 0xc2);            // mov edx, eax
+    emit(j, 3, 0x83, inc ? 0xc2 : 0xea, 0x01); // add/sub edx, 1
+    emit(j, 2, 0x89, 0x11);            // mov [rcx], edx
+  } else if (type_cmp(type, &type_f32)) {
+    emit(j, 4, 0x66, 0x0f, 0x6e, 0xc0); // movd xmm0, eax
+    emit_byte(j, 0xba);                // mov edx, 1.0
+    emit_i32(j, 0x3f800000);
+    emit(j, 4, 0x66, 0x0f, 0x6e, 0xca); // movd xmm1, edx
+    emit(j, 4, 0xf3, 0x0f, inc ? 0x58 : 0x5c, 0xc1); // addss/subss xmm0, xmm1
+    emit(j, 4, 0x66, 0x0f, 0x7e, 0x01); // movd [rcx], xmm0
+  } else {
+    return false;
+  }
+  
+  return true;
+}
+
+static bool jit_cast(jit_t *j, const type_t *from, const type_t *to)
+{
+  if (type_cmp(from, to))
+    return true;
+  
+  if (type_cmp(from, &type_i32) && type_cmp(to, &type_f32)) {
+    emit(j, 4, 0xf3, 0x0f, 0x2a, 0xc0); // cvtsi2ss xmm0, eax
+    emit(j, 4, 0x66, 0x0f, 0x7e, 0xc0); // movd eax, xmm0
+  } else if (type_cmp(from, &type_f32) && type_cmp(to, &type_i32)) {
+    emit(j, 4, 0x66, 0x0f, 0x6e, 0xc0); // movd xmm0, eax
+    emit(j, 4, 0xf3, 0x0f, 0x2c, 0xc0); // cvttss2si eax, xmm0
+  } else {
+    return false;
+  }
+  
+  return true;
+}
+
+static jit_var_t *jit_find(jit_t *j, const char *ident)
+{
+  for (int i = j->num_var - 1; i >= 0; i--) {
+    if (strcmp(j->var[i].ident, ident) == 0)
+      return &j->var[i];
+  }
+  
+  return NULL;
+}
+
+static jit_var_t *jit_add(jit_t *j, const type_t *type, const char *ident)
+{
+  jit_var_t *var = jit_find(j, ident);
+  if (var && var->block == j->block)
+    return NULL;
+  
+  if (j->num_var == JIT_MAX_VAR || j->num_slot == j->frame)
+    return NULL;
+  
+  var = &j->var[j->num_var++];
+  var->ident = ident;
+  var->type = *type;
+  var->slot = j->num_slot++;
+  var->block = j->block;
+  
+  return var;
+}
+
+// the nodes a statement or an expression is made of
+static int jit_child(const s_node_t *node, const s_node_t *child[4])
+{
+  switch (node->node_type) {
+  case S_STMT:
+    child[0] = node->stmt.body;
+    child[1] = node->stmt.next;
+    return 2;
+  case S_DECL:
+    child[0] = node->decl.init;
+    return 1;
+  case S_PRINT:
+    child[0] = node->print.arg;
+    return 1;
+  case S_IF_STMT:
+    child[0] = node->if_stmt.cond;
+    child[1] = node->if_stmt.body;
+    child[2] = node->if_stmt.next;
+    return 3;
+  case S_WHILE_STMT:
+    child[0] = node->while_stmt.cond;
+    child[1] = node->while_stmt.body;
+    return 2;
+  case S_FOR_STMT:
+    child[0] = node->for_stmt.decl;
+    child[1] = node->for_stmt.cond;
+    child[2] = node->for_stmt.inc;
+    child[3] = node->for_stmt.body;
+    return 4;
+  case S_RET_STMT:
+    child[0] = node->ret_stmt.body;
+    return 1;
+  case S_BINOP:
+    child[0] = node->binop.lhs;
+    child[1] = node->binop.rhs;
+    return 2;
+  case S_UNARY:
+    child[0] = node->unary.rhs;
+    return 1;
+  case S_POST_OP:
+    child[0] = node->post_op.lhs;
+    return 1;
+  case S_INDEX:
+    child[0] = node->index.base;
+    child[1] = node->index.index;
+    return 2;
+  case S_DIRECT:
+    child[0] = node->direct.base;
+    return 1;
+  case S_PROC:
+    child[0] = node->proc.base;
+    child[1] = node->proc.arg;
+    return 2;
+  case S_ARG:
+    child[0] = node->arg.body;
+    child[1] = node->arg.next;
+    return 2;
+  case S_ARRAY_INIT:
+    child[0] = node->array_init.size;
+    child[1] = node->array_init.init;
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+// whether a node is a name, or the name given
+static bool jit_ident(const s_node_t *node, const char *ident)
+{
+  return node
+    && node->node_type == S_CONSTANT
+    && node->constant.lexeme->token == TK_IDENTIFIER
+    && (!ident || strcmp(node->constant.lexeme->data.ident, ident) == 0);
+}
+
+// whether a name is declared or assigned anywhere in a node
+static bool jit_writes(const s_node_t *node, const char *ident)
+{
+  if (!node)
+    return false;
+  
+  if (node->node_type == S_DECL && strcmp(node->decl.ident->data.ident, ident) == 0)
+    return true;
+  
+  if (node->node_type == S_POST_OP && jit_ident(node->post_op.lhs, ident))
+    return true;
+  
+  if (node->node_type == S_BINOP && jit_ident(node->binop.lhs, ident)) {
+    int op = node->binop.op->token;
+    if (op == '=' || (op >= TK_ADD_ASSIGN && op <= TK_DIV_ASSIGN))
+      return true;
+  }
+  
+  const s_node_t *child[4];
+  int num_child = jit_child(node, child);
+  for (int i = 0; i < num_child; i++) {
+    if (jit_writes(child[i], ident))
+      return true;
+  }
+  
+  return false;
+}
+
+// at least the number of slots jit_reduce() can take: the products of each
+// for loop's counter in its condition and body
+static int jit_count_reduce(const s_node_t *node, const char *ident)
+{
+  if (!node)
+    return 0;
+  
+  int num_reduce = 0;
+  
+  if (ident
+    && node->node_type == S_BINOP
+    && node->binop.op->token == '*'
+    && (jit_ident(node->binop.lhs, ident) || jit_ident(node->binop.rhs, ident)))
+    num_reduce++;
+  
+  if (node->node_type == S_FOR_STMT
+    && node->for_stmt.decl
+    && node->for_stmt.decl->stmt.body->node_type == S_DECL) {
+    const char *counter = node->for_stmt.decl->stmt.body->decl.ident->data.ident;
+    num_reduce += jit_count_reduce(node->for_stmt.cond, counter);
+    num_reduce += jit_count_reduce(node->for_stmt.body, counter);
+  }
+  
+  const s_node_t *child[4];
+  int num_child = jit_child(node, child);
+  for (int i = 0; i < num_child; i++)
+    num_reduce += jit_count_reduce(child[i], ident);
+  
+  return num_reduce;
+}
+
+#else
+
+static bool jit_compile(fn_t *fn)
+{
+  return false;
+}
+
+#endif
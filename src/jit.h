@@ -0,0 +1,9 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdbool.h>
+
+extern void jit_init(bool enable, bool native);
+extern void jit_stop();
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef JIT_LOCAL_H
+#define JIT_LOCAL_H
+
+#include "jit.h"
+
+#include "int_local.h"
+
+#define JIT_STACK_SIZE  65536
+#define JIT_MAX_ARG     8
+
+typedef struct jit_site_s jit_site_t;
+
+typedef union {
+  int           i32;
+  float         f32;
+  heap_block_t  *block;
+  char          *ptr;
+  jit_site_t    *site;
+} jit_slot_t;
+
+// compiled functions take a frame of slots: the return value, 'this' for
+// methods, the params and then the locals. callees get the frame after it.
+typedef int (*jit_code_t)(jit_slot_t *frame, scope_t *scope);
+
+// JIT_TAIL leaves a call made in tail position to the caller: its site is
+// in slot 0 and the args in the params of the frame
+typedef enum {
+  JIT_FAIL,
+  JIT_VALUE,
+  JIT_VOID,
+  JIT_TAIL
+} jit_status_t;
+
+typedef enum {
+  JIT_ERR_INDEX_NULL,
+  JIT_ERR_INDEX_BOUNDS,
+  JIT_ERR_MEMBER_NULL,
+  JIT_ERR_NO_VALUE,
+  JIT_ERR_STACK,
+  JIT_ERR_ARRAY_NULL,
+  JIT_ERR_ARRAY_EMPTY,
+  JIT_ERR_ARRAY_BOUNDS,
+  JIT_ERR_ARRAY_SIZE,
+  JIT_ERR_GRID_SIZE
+} jit_err_t;
+
+// a call or print made from compiled code back into the interpreter
+struct jit_site_s {
+  fn_t              *fn;
+  const s_node_t    *node;
+  type_t            type;
+  type_t            arg_type[JIT_MAX_ARG];
+  int               num_arg;
+  struct jit_site_s *next;
+};
+
+extern jit_slot_t jit_stack[];
+extern jit_slot_t *jit_sp;
+
+// jit.c
+extern int          jit_call(jit_site_t *site, scope_t *scope, jit_slot_t *frame);
+extern int          jit_tail_run(jit_slot_t *frame, scope_t *scope);
+extern void         jit_expr_load(expr_t *expr, const type_t *type, jit_slot_t slot);
+extern void         jit_print(jit_site_t *site, heap_block_t *value);
+extern void         jit_print_end();
+extern heap_block_t *jit_concat(heap_block_t *str_lhs, heap_block_t *str_rhs);
+extern void         jit_error(const s_node_t *node, jit_err_t err);
+extern bool         jit_type(const scope_t *scope, type_t *type, const s_node_t *node);
+extern bool         jit_param(const scope_t *scope, const fn_t *fn, type_t *arg_type, int *num_arg);
+extern jit_site_t   *jit_site(const s_node_t *node, fn_t *fn, const type_t *type);
+extern int          jit_count_decl(const s_node_t *node);
+extern bool         jit_returns(const s_node_t *node);
+extern bool         jit_in_array(const s_node_t *node);
+extern int          jit_extent(const type_t *type, const char *ident);
+extern fn_t         *jit_tail(const scope_t *scope, const fn_t *fn, const s_node_t *node);
+
+// exe.c
+extern bool         exe_compile(fn_t *fn);
+extern int          exe_call(fn_t *fn, jit_slot_t *frame, scope_t *scope);
+extern void         exe_stop();
+
+#endif
@@ -7,13 +7,6 @@
 #include <unistd.h>
 #include <string.h>
 
-typedef struct {
-  char        *file;
-  char        *src;
-  const char  *c;
-  int         line;
-} lex_file_t;
-
 typedef struct {
   char    str[2];
   token_t tk;
@@ -40,6 +33,11 @@ static word_t word_table[] = {
   { "break",      TK_BREAK      },
   { "continue",   TK_CONTINUE   },
   { "else",       TK_ELSE       },
+  { "struct",     TK_STRUCT     },
+  { "struct_def", TK_STRUCT_DEF },
+  { "soa",        TK_SOA        },
+  { "map",        TK_MAP        },
+  { "map_init",   TK_MAP_INIT   },
   { "if",         TK_IF         }
 };
 
@@ -87,13 +85,14 @@ static lexeme_t *match_const_integer(lex_file_t *lex);
 static lexeme_t *match_string_literal(lex_file_t *lex);
 static lexeme_t *match_word(lex_file_t *lex);
 static lexeme_t *match_op(lex_file_t *lex);
-static lexeme_t *match_include(lex_file_t *lex, lex_t *base);
+static bool     match_include(lex_file_t *lex, lex_t *base);
 static void     token_print(token_t token);
 static void     lexeme_print(const lexeme_t *lexeme);
 static void     lex_printf(const lexeme_t *lexeme, const char *fmt, va_list args);
 
-static lexeme_t *lex_scan(lex_file_t *lex_file, lex_t *base);
-static bool     lex_file_open(lex_file_t *lex_file, lex_t *base, const char *src);
+static lexeme_t *lex_scan(lex_t *lex);
+static bool     lex_file_open(lex_t *base, const char *src);
+static void     lex_file_close(lex_t *base);
 
 static void lexeme_free(lexeme_t *lexeme);
 static char *filename(lex_file_t *lex);
@@ -101,23 +100,27 @@ static char *filename(lex_file_t *lex);
 bool lex_parse(lex_t *lex, const char *src)
 {
   lex->num_file = 0;
+  lex->num_file_stack = 0;
+  lex->mark = NULL;
   
-  lex_file_t lex_file;
-  if (!lex_file_open(&lex_file, lex, src))
-    return NULL;
+  if (!lex_file_open(lex, src))
+    return false;
   
-  lexeme_t *body = lex_scan(&lex_file, lex);
+  lexeme_t *body = lex_scan(lex);
   
   lex->lexeme = body;
   lex->start = body;
   
-  ZONE_FREE(lex_file.src);
-  
   return true;
 }
 
-static bool lex_file_open(lex_file_t *lex_file, lex_t *base, const char *src)
+static bool lex_file_open(lex_t *base, const char *src)
 {
+  if (base->num_file >= 16) {
+    printf("%s: error: too many files\n", src);
+    return false;
+  }
+  
   FILE *fp = fopen(src, "rb");
   
   if (!fp)
@@ -137,6 +140,8 @@ static bool lex_file_open(lex_file_t *lex_file, lex_t *base, const char *src)
   heap_file[heap_file_len] = 0;
   
   base->file[base->num_file++] = heap_file;
+  
+  lex_file_t *lex_file = &base->file_stack[base->num_file_stack++];
   lex_file->file = heap_file;
   lex_file->src = buffer;
   lex_file->c = buffer;
@@ -145,56 +150,62 @@ static bool lex_file_open(lex_file_t *lex_file, lex_t *base, const char *src)
   return true;
 }
 
-static lexeme_t *lex_scan(lex_file_t *lex_file, lex_t *base)
+static void lex_file_close(lex_t *base)
+{
+  lex_file_t *lex_file = &base->file_stack[--base->num_file_stack];
+  ZONE_FREE(lex_file->src);
+}
+
+// scans one lexeme on demand, descending into includes as they are
+// reached. only the outermost file ends in TK_EOF.
+static lexeme_t *lex_scan(lex_t *lex)
 {
-  lexeme_t *head = NULL, *body = NULL;
-  
-  while (*lex_file->c) {
-    lexeme_t *lexeme = match_const_integer(lex_file);
-    if (!lexeme)
-      lexeme = match_include(lex_file, base);
-    if (!lexeme)
-      lexeme = match_string_literal(lex_file);
-    if (!lexeme)
-      lexeme = match_word(lex_file);
-    if (!lexeme)
-      lexeme = match_op(lex_file);
+  while (lex->num_file_stack > 0) {
+    int depth = lex->num_file_stack;
+    lex_file_t *lex_file = &lex->file_stack[depth - 1];
     
-    if (!lexeme) {
+    while (*lex_file->c && lex->num_file_stack == depth) {
       switch (*lex_file->c) {
       case '\n':
         lex_file->line++;
-      case 0:
       case ' ':
       case '\t':
+      case '\r':
         lex_file->c++;
-        break;
-      default:
-        LOG_DEBUG("skipping unknown character: %i", *lex_file->c);
-        lex_file->c++;
+        continue;
       }
-    } else {
-      if (head)
-        head->next = lexeme;
-      else
-        body = head = lexeme;
       
-      while (head->next) {
-        if (head->next->token == TK_EOF) {
-          lexeme_free(head->next);
-          head->next = NULL;
-        } else
-          head = head->next;
-      }
+      if (match_include(lex_file, lex))
+        continue;
+      
+      lexeme_t *lexeme = match_const_integer(lex_file);
+      if (!lexeme)
+        lexeme = match_string_literal(lex_file);
+      if (!lexeme)
+        lexeme = match_word(lex_file);
+      if (!lexeme)
+        lexeme = match_op(lex_file);
+      
+      if (lexeme)
+        return lexeme;
+      
+      LOG_DEBUG("skipping unknown character: %i", *lex_file->c);
+      lex_file->c++;
+    }
+    
+    if (lex->num_file_stack != depth)
+      continue;
+    
+    if (depth == 1) {
+      lexeme_t *lexeme = make_lexeme(TK_EOF, lex_file);
+      lex_file_close(lex);
+      return lexeme;
     }
+    
+    lex_file_close(lex);
   }
   
-  if (head)
-    head->next = make_lexeme(TK_EOF, lex_file);
-  else
-    head = make_lexeme(TK_EOF, lex_file);
-  
-  return body;
+  return NULL;
 }
 
 static void lexeme_free(lexeme_t *lexeme)
@@ -220,16 +231,27 @@ void lex_free(lex_t *lex)
     lexeme = next;
   }
   
+  while (lex->num_file_stack > 0)
+    lex_file_close(lex);
+  
   for (int i = 0; i < lex->num_file; i++)
     ZONE_FREE(lex->file[i]);
 }
 
+static void lex_advance(lex_t *lex)
+{
+  if (!lex->lexeme->next && lex->lexeme->token != TK_EOF)
+    lex->lexeme->next = lex_scan(lex);
+  
+  lex->lexeme = lex->lexeme->next;
+}
+
 void lex_next(lex_t *lex)
 {
   if (!lex->lexeme)
     return;
   
-  lex->lexeme = lex->lexeme->next;
+  lex_advance(lex);
 }
 
 const lexeme_t *lex_match(lex_t *lex, token_t token)
@@ -241,12 +263,54 @@ const lexeme_t *lex_match(lex_t *lex, token_t token)
   
   if (lex->lexeme->token == token) {
     lexeme = lex->lexeme;
-    lex->lexeme = lex->lexeme->next;
+    lex_advance(lex);
   }
   
   return lexeme;
 }
 
+// keep everything consumed so far until lex_free
+void lex_mark(lex_t *lex)
+{
+  lexeme_t *lexeme = lex->mark ? lex->mark : lex->start;
+  
+  if (!lexeme || lexeme == lex->lexeme)
+    return;
+  
+  while (lexeme->next != lex->lexeme)
+    lexeme = lexeme->next;
+  
+  lex->mark = lexeme;
+}
+
+// free everything consumed since the last mark except 'keep'
+void lex_release(lex_t *lex, const lexeme_t *keep)
+{
+  lexeme_t *lexeme = lex->mark ? lex->mark->next : lex->start;
+  
+  while (lexeme && lexeme != lex->lexeme) {
+    lexeme_t *next = lexeme->next;
+    
+    if (lexeme == keep) {
+      if (lex->mark)
+        lex->mark->next = lexeme;
+      else
+        lex->start = lexeme;
+      
+      lex->mark = lexeme;
+    } else {
+      lexeme_free(lexeme);
+    }
+    
+    lexeme = next;
+  }
+  
+  if (lex->mark)
+    lex->mark->next = lex->lexeme;
+  else
+    lex->start = lex->lexeme;
+}
+
 static lexeme_t *make_lexeme(token_t token, const lex_file_t *lex)
 {
   lexeme_t *lexeme = ZONE_ALLOC(sizeof(lexeme_t));
@@ -329,7 +393,7 @@ static char *filename(lex_file_t *lex)
   if (slash) {
     int dir_len = slash - lex->file;
     int total_len = dir_len + str_len;
-    char *file_dir_concat = ZONE_ALLOC(total_len + 1);
+    char *file_dir_concat = ZONE_ALLOC(total_len + 2);
     memcpy(file_dir_concat, lex->file, dir_len);
     file_dir_concat[dir_len] = '/';
     memcpy(&file_dir_concat[dir_len + 1], file, str_len);
@@ -342,37 +406,34 @@ static char *filename(lex_file_t *lex)
   return file;
 }
 
-static lexeme_t *match_include(lex_file_t *lex, lex_t *base)
+static bool match_include(lex_file_t *lex, lex_t *base)
 {
   if (*lex->c != '#')
-    return NULL;
+    return false;
   
   if (strncmp(lex->c, "#include ", strlen("#include ")) == 0) {
     lex->c += strlen("#include ");
     char *file = filename(lex);
     
+    if (!file)
+      return true;
+    
     for (int i = 0; i < base->num_file; i++) {
       if (strcmp(file, base->file[i]) == 0) {
         ZONE_FREE(file);
-        return NULL;
+        return true;
       }
     }
     
-    lex_file_t lex_file;
-    if (!lex_file_open(&lex_file, base, file)) {
+    if (!lex_file_open(base, file))
       printf("%s:%i:error: could not open '%s'\n", lex->file, lex->line, file);
-      return NULL;
-    }
-    
-    lexeme_t *body = lex_scan(&lex_file, base);
     
-    ZONE_FREE(lex_file.src);
     ZONE_FREE(file);
     
-    return body;
+    return true;
   }
   
-  return NULL;
+  return false;
 }
 
 static lexeme_t *match_const_integer(lex_file_t *lex)
@@ -38,6 +38,11 @@ typedef enum {
   TK_BREAK,
   TK_CONTINUE,
   TK_ELSE,
+  TK_STRUCT,
+  TK_STRUCT_DEF,
+  TK_SOA,
+  TK_MAP,
+  TK_MAP_INIT,
   TK_EOF
 } token_t;
 
@@ -54,16 +59,28 @@ typedef struct lexeme_s {
   struct lexeme_s *next;
 } lexeme_t;
 
+typedef struct {
+  char        *file;
+  char        *src;
+  const char  *c;
+  int         line;
+} lex_file_t;
+
 typedef struct {
   char        *file[16];
   int         num_file;
+  lex_file_t  file_stack[16];
+  int         num_file_stack;
   lexeme_t    *lexeme;
   lexeme_t    *start;
+  lexeme_t    *mark;
 } lex_t;
 
 extern bool           lex_parse(lex_t *lex, const char *src);
 extern const lexeme_t *lex_match(lex_t *lex, token_t);
 extern void           lex_next(lex_t *lex);
+extern void           lex_mark(lex_t *lex);
+extern void           lex_release(lex_t *lex, const lexeme_t *keep);
 extern void           lex_free(lex_t *lex);
 
 
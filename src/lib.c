@@ -1,12 +1,15 @@
 #include "lib.h"
 
+#include "arr.h"
 #include "data.h"
 #include "mem.h"
 #include "int_main.h"
+#include "sort.h"
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 bool clear_f(expr_t *ret_value, scope_t *scope_args)
 {
@@ -64,6 +67,386 @@ bool input_f(expr_t *ret_value, scope_t *scope_args)
   ret_value->loc_offset = 0;
 }
 
+// an array which was never initialised is taken to be empty. those taken
+// together are worked on as far as the shorter one goes.
+static void *arg_array(scope_t *scope_args, char *ident, int *n)
+{
+  expr_t array;
+  int_arg_load(scope_args, &array, ident);
+  
+  if (!array.block) {
+    *n = 0;
+    return NULL;
+  }
+  
+  *n = array.block->size / 4;
+  return array.block->block;
+}
+
+static float arg_f32(scope_t *scope_args, char *ident)
+{
+  expr_t x;
+  int_arg_load(scope_args, &x, ident);
+  return x.f32;
+}
+
+static int arg_i32(scope_t *scope_args, char *ident)
+{
+  expr_t x;
+  int_arg_load(scope_args, &x, ident);
+  return x.i32;
+}
+
+static int min_n(int a, int b)
+{
+  return a < b ? a : b;
+}
+
+bool array_fill_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  arr_fill_f32(a, arg_f32(scope_args, "x"), n);
+  return true;
+}
+
+bool array_copy_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n_dst, n_src;
+  void *dst = arg_array(scope_args, "dst", &n_dst);
+  void *src = arg_array(scope_args, "src", &n_src);
+  
+  if (dst && src)
+    memmove(dst, src, min_n(n_dst, n_src) * 4);
+  return true;
+}
+
+bool array_axpy_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n_y, n_x;
+  float *y = arg_array(scope_args, "y", &n_y);
+  float *x = arg_array(scope_args, "x", &n_x);
+  arr_axpy_f32(y, arg_f32(scope_args, "a"), x, min_n(n_y, n_x));
+  return true;
+}
+
+bool array_scale_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  arr_scale_f32(a, arg_f32(scope_args, "s"), n);
+  return true;
+}
+
+bool array_add_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n_a, n_b;
+  float *a = arg_array(scope_args, "a", &n_a);
+  float *b = arg_array(scope_args, "b", &n_b);
+  arr_add_f32(a, b, min_n(n_a, n_b));
+  return true;
+}
+
+bool array_mul_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n_a, n_b;
+  float *a = arg_array(scope_args, "a", &n_a);
+  float *b = arg_array(scope_args, "b", &n_b);
+  arr_mul_f32(a, b, min_n(n_a, n_b));
+  return true;
+}
+
+bool array_min_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  expr_f32(ret_value, arr_min_f32(a, n));
+  return true;
+}
+
+bool array_max_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  expr_f32(ret_value, arr_max_f32(a, n));
+  return true;
+}
+
+bool array_sum_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  expr_f32(ret_value, arr_sum_f32(a, n));
+  return true;
+}
+
+bool array_dot_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n_a, n_b;
+  float *a = arg_array(scope_args, "a", &n_a);
+  float *b = arg_array(scope_args, "b", &n_b);
+  expr_f32(ret_value, arr_dot_f32(a, b, min_n(n_a, n_b)));
+  return true;
+}
+
+bool array_prefix_sum_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  arr_prefix_sum_f32(a, n);
+  return true;
+}
+
+bool array_clamp_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  arr_clamp_f32(a, arg_f32(scope_args, "lo"), arg_f32(scope_args, "hi"), n);
+  return true;
+}
+
+bool array_fill_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  arr_fill_i32(a, arg_i32(scope_args, "x"), n);
+  return true;
+}
+
+bool array_scale_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  arr_scale_i32(a, arg_i32(scope_args, "s"), n);
+  return true;
+}
+
+bool array_add_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n_a, n_b;
+  int *a = arg_array(scope_args, "a", &n_a);
+  int *b = arg_array(scope_args, "b", &n_b);
+  arr_add_i32(a, b, min_n(n_a, n_b));
+  return true;
+}
+
+bool array_mul_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n_a, n_b;
+  int *a = arg_array(scope_args, "a", &n_a);
+  int *b = arg_array(scope_args, "b", &n_b);
+  arr_mul_i32(a, b, min_n(n_a, n_b));
+  return true;
+}
+
+bool array_min_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  expr_i32(ret_value, arr_min_i32(a, n));
+  return true;
+}
+
+bool array_max_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  expr_i32(ret_value, arr_max_i32(a, n));
+  return true;
+}
+
+bool array_sum_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  expr_i32(ret_value, arr_sum_i32(a, n));
+  return true;
+}
+
+bool array_prefix_sum_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  arr_prefix_sum_i32(a, n);
+  return true;
+}
+
+bool array_clamp_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  arr_clamp_i32(a, arg_i32(scope_args, "lo"), arg_i32(scope_args, "hi"), n);
+  return true;
+}
+
+bool array_sin_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  arr_sin(a, n);
+  return true;
+}
+
+bool array_cos_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  arr_cos(a, n);
+  return true;
+}
+
+bool array_sqrt_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  arr_sqrt(a, n);
+  return true;
+}
+
+bool array_pow_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  arr_pow(a, arg_f32(scope_args, "y"), n);
+  return true;
+}
+
+bool array_sort_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  sort_f32(a, n);
+  return true;
+}
+
+bool array_nth_element_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  sort_nth_f32(a, n, arg_i32(scope_args, "k"));
+  return true;
+}
+
+bool array_lower_bound_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  expr_i32(ret_value, sort_lower_bound_f32(a, n, arg_f32(scope_args, "x")));
+  return true;
+}
+
+// the index of 'x' in a sorted array, or -1
+bool array_binary_search_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  float *a = arg_array(scope_args, "a", &n);
+  float x = arg_f32(scope_args, "x");
+  
+  int i = sort_lower_bound_f32(a, n, x);
+  expr_i32(ret_value, i < n && a[i] == x ? i : -1);
+  return true;
+}
+
+bool array_sort_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  sort_i32(a, n);
+  return true;
+}
+
+bool array_nth_element_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  sort_nth_i32(a, n, arg_i32(scope_args, "k"));
+  return true;
+}
+
+bool array_lower_bound_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  expr_i32(ret_value, sort_lower_bound_i32(a, n, arg_i32(scope_args, "x")));
+  return true;
+}
+
+bool array_binary_search_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  int n;
+  int *a = arg_array(scope_args, "a", &n);
+  int x = arg_i32(scope_args, "x");
+  
+  int i = sort_lower_bound_i32(a, n, x);
+  expr_i32(ret_value, i < n && a[i] == x ? i : -1);
+  return true;
+}
+
+// a loop 'for (i32 i = lo; i < hi; i++) a[i] = ...;' which -O turned into a
+// program for arr_eval. it is left to the loop if an array is shorter than
+// 'hi', so an index out of bounds is reported where it would have been.
+static bool vec_array(scope_t *scope_args, void *array[], int hi)
+{
+  static char *ident[] = { "a", "b", "c", "d" };
+  
+  for (int i = 0; i < 4; i++) {
+    int n;
+    array[i] = arg_array(scope_args, ident[i], &n);
+    if (n < hi)
+      return false;
+  }
+  
+  return true;
+}
+
+bool vec_f32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  expr_t prog;
+  int_arg_load(scope_args, &prog, "prog");
+  
+  int lo = arg_i32(scope_args, "lo");
+  int hi = arg_i32(scope_args, "hi");
+  
+  float *array[4];
+  float scalar[] = {
+    arg_f32(scope_args, "p"),
+    arg_f32(scope_args, "q"),
+    arg_f32(scope_args, "r"),
+    arg_f32(scope_args, "s")
+  };
+  
+  bool done = lo >= hi || (prog.block && lo >= 0
+    && vec_array(scope_args, (void**) array, hi)
+    && arr_eval_f32((char*) prog.block->block, array, scalar, lo, hi));
+  
+  expr_i32(ret_value, done);
+  return true;
+}
+
+bool vec_i32_f(expr_t *ret_value, scope_t *scope_args)
+{
+  expr_t prog;
+  int_arg_load(scope_args, &prog, "prog");
+  
+  int lo = arg_i32(scope_args, "lo");
+  int hi = arg_i32(scope_args, "hi");
+  
+  int *array[4];
+  int scalar[] = {
+    arg_i32(scope_args, "p"),
+    arg_i32(scope_args, "q"),
+    arg_i32(scope_args, "r"),
+    arg_i32(scope_args, "s")
+  };
+  
+  bool done = lo >= hi || (prog.block && lo >= 0
+    && vec_array(scope_args, (void**) array, hi)
+    && arr_eval_i32((char*) prog.block->block, array, scalar, lo, hi));
+  
+  expr_i32(ret_value, done);
+  return true;
+}
+
 void lib_load_stdlib()
 {
   int_bind("clear", clear_f);
@@ -77,3 +460,48 @@ void lib_load_math()
   int_bind("pow", pow_f);
   int_bind("sqrt", sqrt_f);
 }
+
+void lib_load_array()
+{
+  int_bind("array_fill", array_fill_f);
+  int_bind("array_copy", array_copy_f);
+  int_bind("array_axpy", array_axpy_f);
+  int_bind("array_scale", array_scale_f);
+  int_bind("array_add", array_add_f);
+  int_bind("array_mul", array_mul_f);
+  int_bind("array_min", array_min_f);
+  int_bind("array_max", array_max_f);
+  int_bind("array_sum", array_sum_f);
+  int_bind("array_dot", array_dot_f);
+  int_bind("array_prefix_sum", array_prefix_sum_f);
+  int_bind("array_clamp", array_clamp_f);
+  
+  int_bind("array_fill_i32", array_fill_i32_f);
+  int_bind("array_copy_i32", array_copy_f);
+  int_bind("array_scale_i32", array_scale_i32_f);
+  int_bind("array_add_i32", array_add_i32_f);
+  int_bind("array_mul_i32", array_mul_i32_f);
+  int_bind("array_min_i32", array_min_i32_f);
+  int_bind("array_max_i32", array_max_i32_f);
+  int_bind("array_sum_i32", array_sum_i32_f);
+  int_bind("array_prefix_sum_i32", array_prefix_sum_i32_f);
+  int_bind("array_clamp_i32", array_clamp_i32_f);
+  
+  int_bind("array_sin", array_sin_f);
+  int_bind("array_cos", array_cos_f);
+  int_bind("array_sqrt", array_sqrt_f);
+  int_bind("array_pow", array_pow_f);
+  
+  int_bind("array_sort", array_sort_f);
+  int_bind("array_nth_element", array_nth_element_f);
+  int_bind("array_lower_bound", array_lower_bound_f);
+  int_bind("array_binary_search", array_binary_search_f);
+  int_bind("array_sort_i32", array_sort_i32_f);
+  int_bind("array_nth_element_i32", array_nth_element_i32_f);
+  int_bind("array_lower_bound_i32", array_lower_bound_i32_f);
+  int_bind("array_binary_search_i32", array_binary_search_i32_f);
+  
+  // declared by -O for the loops it runs with them
+  int_bind("__vec_f32", vec_f32_f);
+  int_bind("__vec_i32", vec_i32_f);
+}
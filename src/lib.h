@@ -3,5 +3,6 @@
 
 void lib_load_stdlib();
 void lib_load_math();
+void lib_load_array();
 
 #endif
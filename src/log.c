@@ -4,6 +4,8 @@
 #include "syntax.h"
 #include <stdlib.h>
 
+static FILE *c_out = NULL;
+
 static void c_printf(const char *fmt, va_list args);
 static void s_node_print(const s_node_t *node);
 static void expr_print(const expr_t *expr);
@@ -16,23 +18,34 @@ void c_error(const lexeme_t *lexeme, const char *fmt, ...)
   if (!lexeme)
     return;
   
+  c_out = stdout;
+  
   va_list args;
   va_start(args, fmt);
-  printf("%s:%i:error: ", lexeme->src, lexeme->line);
+  fprintf(c_out, "%s:%i:error: ", lexeme->src, lexeme->line);
   c_printf(fmt, args);
   va_end(args);
   
-  putc('\n', stdout);
+  putc('\n', c_out);
 }
 
 void c_debug(const char *fmt, ...)
 {
+  c_out = stdout;
+  
   va_list args;
   va_start(args, fmt);
   c_printf(fmt, args);
   va_end(args);
 }
 
+// c_debug() into 'out'
+void c_vfprint(FILE *out, const char *fmt, va_list args)
+{
+  c_out = out;
+  c_printf(fmt, args);
+}
+
 static void c_printf(const char *fmt, va_list args)
 {
   while (*fmt) {
@@ -51,22 +64,22 @@ static void c_printf(const char *fmt, va_list args)
         lexeme_print(va_arg(args, const lexeme_t *));
         break;
       case 's':
-        printf("%s", va_arg(args, char*));
+        fprintf(c_out, "%s", va_arg(args, char*));
         break;
       case 'i':
-        printf("%i", va_arg(args, int));
+        fprintf(c_out, "%i", va_arg(args, int));
         break;
       case 'h': // s_node_t expr
         s_node_print(va_arg(args, const s_node_t *));
         break;
       default:
-        putc('%', stdout);
+        putc('%', c_out);
         break;
       }
       
       *++fmt;
     } else {
-      printf("%c", *fmt++);
+      fprintf(c_out, "%c", *fmt++);
     }
   }
 }
@@ -86,31 +99,35 @@ static void s_node_print(const s_node_t *node)
     break;
   case S_INDEX:
     s_node_print(node->index.base);
-    putc('[', stdout);
+    putc('[', c_out);
     s_node_print(node->index.index);
-    putc(']', stdout);
+    putc(']', c_out);
     break;
   case S_DIRECT:
     s_node_print(node->direct.base);
-    putc('.', stdout);
-    printf("%s", node->direct.child_ident->data.ident);
+    putc('.', c_out);
+    fprintf(c_out, "%s", node->direct.child_ident->data.ident);
     break;
   case S_PROC:
     s_node_print(node->proc.base);
-    putc('(', stdout);
+    putc('(', c_out);
     s_node_print(node->proc.arg);
-    putc(')', stdout);
+    putc(')', c_out);
     break;
   case S_CONSTANT:
     lexeme_print(node->constant.lexeme);
     break;
   case S_NEW:
-    printf("new %s", node->new.class_ident->data.ident);
+    fprintf(c_out, "new %s", node->new.class_ident->data.ident);
+    break;
+  case S_POST_OP:
+    s_node_print(node->post_op.lhs);
+    lexeme_print(node->post_op.op);
     break;
   case S_ARG:
     s_node_print(node->arg.body);
     if (node->arg.next) {
-      putc(',', stdout);
+      putc(',', c_out);
       s_node_print(node->arg.next);
     }
     break;
@@ -124,32 +141,37 @@ static void expr_print(const expr_t *expr)
 {
   if (type_array(&expr->type)) {
     type_print(&expr->type);
-    printf(" (%p)", &expr->loc_base[expr->loc_offset]);
+    fprintf(c_out, " (%p)", &expr->loc_base[expr->loc_offset]);
     return;
   }
   
   switch (expr->type.spec) {
   case SPEC_NONE:
-    printf("(none)");
+    fprintf(c_out, "(none)");
     break;
   case SPEC_I32:
-    printf("%i", expr->i32);
+    fprintf(c_out, "%i", expr->i32);
     break;
   case SPEC_F32:
-    printf("%f", expr->f32);
+    fprintf(c_out, "%f", expr->f32);
     break;
   case SPEC_CLASS:
+  case SPEC_MAP:
     type_print(&expr->type);
-    printf(" [ %p ]", expr->block);
+    fprintf(c_out, " [ %p ]", expr->block);
     break;
   case SPEC_FN:
-    printf("fn:");
+    fprintf(c_out, "fn:");
     fn_t *fn = (fn_t*) expr->block;
     if (fn)
       type_print(&fn->type);
     break;
   case SPEC_STRING:
-    printf("%s", (char*) (*(heap_block_t*) expr->block).block);
+    fprintf(c_out, "%s", (char*) (*(heap_block_t*) expr->block).block);
+    break;
+  case SPEC_STRUCT:
+  case SPEC_SOA:
+    type_print(&expr->type);
     break;
   }
 }
@@ -162,16 +184,34 @@ static void type_print(const type_t *type)
     "f32",
     "class",
     "fn",
-    "string"
+    "string",
+    "struct",
+    "soa",
+    "map"
   };
   
-  printf("%s", str_spec_table[type->spec]);
+  fprintf(c_out, "%s", str_spec_table[type->spec]);
   
-  if (type->spec == SPEC_CLASS)
-    printf(" %s", type->class->ident);
+  if (type->spec == SPEC_CLASS || type->spec == SPEC_STRUCT || type->spec == SPEC_SOA)
+    fprintf(c_out, " %s", type->class->ident);
   
-  if (type->arr)
-    printf("[]");
+  if (type->spec == SPEC_MAP) {
+    const var_t *key = map_get(&type->class->map_var, "key");
+    const var_t *value = map_get(&type->class->map_var, "value");
+    
+    fprintf(c_out, "<");
+    type_print(&key->type);
+    fprintf(c_out, ", ");
+    type_print(&value->type);
+    fprintf(c_out, ">");
+  }
+  
+  if (type->arr) {
+    putc('[', c_out);
+    for (int i = 1; i < type->dim; i++)
+      putc(',', c_out);
+    putc(']', c_out);
+  }
 }
 
 static void lexeme_print(const lexeme_t *lexeme)
@@ -179,23 +219,23 @@ static void lexeme_print(const lexeme_t *lexeme)
   if (lexeme) {
     switch (lexeme->token) {
     case TK_CONST_INTEGER:
-      printf("%i", lexeme->data.i32);
+      fprintf(c_out, "%i", lexeme->data.i32);
       break;
     case TK_CONST_FLOAT:
-      printf("%f", lexeme->data.f32);
+      fprintf(c_out, "%f", lexeme->data.f32);
       break;
     case TK_IDENTIFIER:
-      printf("%s", lexeme->data.ident);
+      fprintf(c_out, "%s", lexeme->data.ident);
       break;
     case TK_STRING_LITERAL:
-      printf("\"%s\"", lexeme->data.string_literal);
+      fprintf(c_out, "\"%s\"", lexeme->data.string_literal);
       break;
     default:
       token_print(lexeme->token);
       break;
     }
   } else {
-    printf("EOF");
+    fprintf(c_out, "EOF");
   }
 }
 
@@ -235,14 +275,19 @@ static void token_print(token_t token)
     "break",          // TK_BREAK,
     "continue",       // TK_CONTINUE,
     "else",           // TK_ELSE,
+    "struct",         // TK_STRUCT
+    "struct_def",     // TK_STRUCT_DEF
+    "soa",            // TK_SOA
+    "map",            // TK_MAP
+    "map_init",       // TK_MAP_INIT
     "EOF"             // TK_EOF
   };
   
   if (token < TK_CONST_INTEGER) {
-    printf("%c", token);
+    fprintf(c_out, "%c", token);
   } else if (token <= TK_EOF) {
-    printf("%s", str_token_table[token - TK_CONST_INTEGER]);
+    fprintf(c_out, "%s", str_token_table[token - TK_CONST_INTEGER]);
   } else {
-    printf("(unknown:%i)", token);
+    fprintf(c_out, "(unknown:%i)", token);
   }
 }
@@ -2,11 +2,13 @@
 #define LOG_H
 
 #include "lex.h"
+#include <stdarg.h>
 #include <stdio.h>
 #define LOG_DEBUG(fmt, ...) { fprintf(stdout, "[DEBUG] %s:%i:%s: ", __FILE__, __LINE__, __func__); fprintf(stdout, fmt, ##__VA_ARGS__); fprintf(stdout, "\n"); }
 #define LOG_ERROR(fmt, ...) { fprintf(stderr, "[ERROR] %s:%i:%s: ", __FILE__, __LINE__, __func__); fprintf(stderr, fmt, ##__VA_ARGS__); fprintf(stderr, "\n"); }
 
 void c_error(const lexeme_t *lexeme, const char *fmt, ...);
 void c_debug(const char *fmt, ...);
+void c_vfprint(FILE *out, const char *fmt, va_list args);
 
 #endif
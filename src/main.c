@@ -4,12 +4,24 @@
 #include "syntax.h"
 #include "int_main.h"
 #include "lib.h"
+#include "opt.h"
+#include "jit.h"
+#include "emit.h"
+#include <getopt.h>
 #include <unistd.h>
 #include <stdio.h>
 
+static bool run_stream(lex_t *lex, s_node_t **body);
+
 int main(int argc, char *argv[])
 {
   bool flag_sdl = false;
+  bool flag_stream = false;
+  bool flag_opt = false;
+  bool flag_verbose = false;
+  bool flag_nojit = false;
+  bool flag_nonative = false;
+  bool flag_emit = false;
   
   extern char *optarg;
   extern int optind;
@@ -17,13 +29,36 @@ int main(int argc, char *argv[])
   int c = 0;
   bool err = 0;
   
-  static char usage[] = "usage: %s [-w] <file>\n";
+  static char usage[] = "usage: %s [-w] [-s] [-O] [-v] [-J] [-N] [--emit-c] <file>\n";
+  
+  static struct option long_options[] = {
+    { "emit-c", no_argument, NULL, 'C' },
+    { NULL, 0, NULL, 0 }
+  };
   
-  while ((c = getopt(argc, argv, "w")) != -1) {
+  while ((c = getopt_long(argc, argv, "wsOvJN", long_options, NULL)) != -1) {
     switch (c) {
     case 'w':
       flag_sdl = true;
       break;
+    case 's':
+      flag_stream = true;
+      break;
+    case 'O':
+      flag_opt = true;
+      break;
+    case 'v':
+      flag_verbose = true;
+      break;
+    case 'J':
+      flag_nojit = true;
+      break;
+    case 'N':
+      flag_nonative = true;
+      break;
+    case 'C':
+      flag_emit = true;
+      break;
     case '?':
       err = true;
       break;
@@ -47,30 +82,121 @@ int main(int argc, char *argv[])
     return 1;
   }
   
-  s_node_t *node = s_parse(&lex);
-  if (!s_error()) {
+  if (flag_emit) {
+    s_node_t *node = s_parse(&lex);
+    if (!s_error() && flag_opt)
+      node = opt_run(node, false);
+    
+    if (!s_error()) {
+      if (!emit_c(stdout, node, file)) {
+        printf("cirno: failed to translate '%s'\n", file);
+        err = true;
+      }
+    }
+    
+    s_free(node);
+    opt_stop();
+  } else if (flag_stream) {
+    s_node_t *body = NULL;
+    
     int_init();
+    jit_init(!flag_nojit, !flag_nonative);
     
     lib_load_stdlib();
     lib_load_math();
+    lib_load_array();
     
     if (flag_sdl)
       sdl_init();
     
-    if (int_run(node)) {
+    if (run_stream(&lex, &body)) {
       if (flag_sdl)
         while (sdl_frame());
-    } else {
+    } else if (!s_error()) {
       printf("cirno: failed to run '%s'\n", file);
     }
     
     int_stop();
+    jit_stop();
+    
+    s_free(body);
+  } else {
+    s_node_t *node = s_parse(&lex);
+    if (!s_error() && flag_opt)
+      node = opt_run(node, flag_verbose);
+    
+    // -O parses the bodies it inlines into, which may fail
+    if (!s_error()) {
+      int_init();
+      jit_init(!flag_nojit, !flag_nonative);
+      
+      lib_load_stdlib();
+      lib_load_math();
+      lib_load_array();
+      
+      if (flag_sdl)
+        sdl_init();
+      
+      if (int_run(node)) {
+        if (flag_sdl)
+          while (sdl_frame());
+      } else {
+        printf("cirno: failed to run '%s'\n", file);
+      }
+      
+      int_stop();
+      jit_stop();
+    }
+    
+    s_free(node);
+    opt_stop();
   }
   
-  s_free(node);
   lex_free(&lex);
   
   zone_log();
   
-  return 0;
+  return err;
+}
+
+// parse and run one top-level statement at a time. statements which do not
+// define functions or classes are released as soon as they have run, the
+// rest are returned in 'body'.
+static bool run_stream(lex_t *lex, s_node_t **body)
+{
+  s_node_t *head = NULL;
+  bool ok = true;
+  
+  s_node_t *node = s_parse_stmt(lex);
+  
+  while (node) {
+    if (s_error() || !int_run(node)) {
+      s_free(node);
+      ok = false;
+      break;
+    }
+    
+    if (s_retain(node)) {
+      lex_mark(lex);
+      
+      if (head)
+        head = head->stmt.next = node;
+      else
+        *body = head = node;
+    } else {
+      const lexeme_t *keep = NULL;
+      if (node->stmt.body->node_type == S_DECL)
+        keep = node->stmt.body->decl.ident;
+      
+      s_free(node);
+      lex_release(lex, keep);
+    }
+    
+    node = s_parse_stmt(lex);
+  }
+  
+  if (s_error())
+    ok = false;
+  
+  return ok;
 }
@@ -1,7 +1,9 @@
 #include "mem.h"
 
+#include "hmap.h"
 #include "log.h"
 #include "zone.h"
+#include <limits.h>
 #include <string.h>
 
 static heap_block_t *heap_block_list = NULL;
@@ -9,19 +11,56 @@ static heap_block_t *heap_block_list = NULL;
 static void heap_mark_R(scope_t *scope);
 static void heap_mark_class(heap_block_t *heap_block, const scope_t *class);
 static void heap_mark_array_class(heap_block_t *heap_block, const scope_t *class);
+static void heap_mark_map(heap_block_t *heap_block, const type_t *type);
 static void heap_mark_var(var_t *var);
 static void heap_mark_expr(expr_t *expr);
 
 heap_block_t *stack_mem = NULL;
 
+// struct values an expression makes rather than loads, such as the result of
+// an operator or a call, are kept here until the statement making them ends
+heap_block_t *temp_mem = NULL;
+int temp_top = 0;
+
 void stack_init()
 {
   stack_mem = heap_alloc_static(1024);
+  temp_mem = heap_alloc_static(1024);
+  temp_top = 0;
 }
 
 void stack_clean()
 {
   heap_free(stack_mem);
+  heap_free(temp_mem);
+}
+
+// the offset of 'size' new bytes in temp_mem. its block can move as it grows,
+// so only offsets into it are held
+int temp_alloc(int size)
+{
+  int offset = temp_top;
+  temp_top = (temp_top + size + 15) & ~15;
+  
+  if (temp_top > temp_mem->size) {
+    while (temp_top > temp_mem->size)
+      temp_mem->size *= 2;
+    temp_mem->block = ZONE_REALLOC(temp_mem->block, temp_mem->size);
+  }
+  
+  return offset;
+}
+
+// a struct returned from a call is moved down to the caller's end of
+// temp_mem, which is where the statements of the call left it
+void temp_keep(expr_t *expr)
+{
+  int size = type_size(&expr->type);
+  int offset = temp_alloc(size);
+  memmove(&temp_mem->block[offset], &expr->loc_base->block[expr->loc_offset], size);
+  
+  expr->loc_base = temp_mem;
+  expr->loc_offset = offset;
 }
 
 void mem_load(heap_block_t *loc_base, int loc_offset, const type_t *type, expr_t *expr)
@@ -31,7 +70,7 @@ void mem_load(heap_block_t *loc_base, int loc_offset, const type_t *type, expr_t
   expr->type = *type;
   if (type_array(type)) {
     expr->block = *((heap_block_t**) &loc_base->block[loc_offset]);
-  } else if (type_class(type))
+  } else if (type_class(type) || type_map(type))
     expr->block = *((heap_block_t**) &loc_base->block[loc_offset]);
   else if (type_cmp(type, &type_string))
     expr->block = *((heap_block_t**) &loc_base->block[loc_offset]);
@@ -41,6 +80,8 @@ void mem_load(heap_block_t *loc_base, int loc_offset, const type_t *type, expr_t
     expr->i32 = *((int*) &loc_base->block[loc_offset]);
   else if (type_cmp(type, &type_f32))
     expr->f32 = *((float*) &loc_base->block[loc_offset]);
+  else if (type_struct(type) || type_soa(type))
+    expr->block = NULL;
   else
     LOG_DEBUG("unknown type");
 }
@@ -49,7 +90,7 @@ void mem_assign(heap_block_t *loc_base, int loc_offset, const type_t *type, expr
 {
   if (type_array(type))
     *((heap_block_t**) &loc_base->block[loc_offset]) = expr->block;
-  else if (type_class(type))
+  else if (type_class(type) || type_map(type))
     *((heap_block_t**) &loc_base->block[loc_offset]) = expr->block;
   else if (type_cmp(type, &type_string))
     *((heap_block_t**) &loc_base->block[loc_offset]) = expr->block;
@@ -61,7 +102,13 @@ void mem_assign(heap_block_t *loc_base, int loc_offset, const type_t *type, expr
     *((int*) &loc_base->block[loc_offset]) = expr->i32;
   else if (type_cmp(type, &type_f32))
     *((float*) &loc_base->block[loc_offset]) = expr->f32;
-  else
+  else if (type_struct(type)) {
+    // a struct is where its expr is loaded from, a zero expr clears it
+    if (expr->loc_base)
+      memmove(&loc_base->block[loc_offset], &expr->loc_base->block[expr->loc_offset], type_size(type));
+    else
+      memset(&loc_base->block[loc_offset], 0, type_size(type));
+  } else
     LOG_DEBUG("unknown type");
 }
 
@@ -71,18 +118,19 @@ heap_block_t *heap_alloc_static(int size)
   heap_block->block = ZONE_ALLOC(size);
   heap_block->use = true;
   heap_block->size = size;
+  heap_block->cap = size;
+  heap_block->parent = NULL;
+  heap_block->layers = 0;
+  heap_block->rows = 0;
+  heap_block->cols = 0;
   heap_block->next = NULL;
   heap_block->prev = NULL;
   memset(heap_block->block, 0, size);
   return heap_block;
 }
 
-heap_block_t *heap_alloc(int size)
+static void heap_link(heap_block_t *heap_block)
 {
-  heap_block_t *heap_block = heap_alloc_static(size);
-  
-  memset(heap_block->block, 0, size);
-  
   if (heap_block_list) {
     heap_block->next = heap_block_list;
     heap_block->prev = NULL;
@@ -93,10 +141,34 @@ heap_block_t *heap_alloc(int size)
     heap_block_list->prev = NULL;
     heap_block_list->next = NULL;
   }
+}
+
+heap_block_t *heap_alloc(int size)
+{
+  heap_block_t *heap_block = heap_alloc_static(size);
+  
+  memset(heap_block->block, 0, size);
+  heap_link(heap_block);
   
   return heap_block;
 }
 
+// a header over 'size' bytes of a block owned by 'parent'
+static heap_block_t *heap_alloc_view(char *block, int size, int cap, heap_block_t *parent)
+{
+  heap_block_t *heap_block = ZONE_ALLOC(sizeof(heap_block_t));
+  heap_block->block = block;
+  heap_block->use = true;
+  heap_block->size = size;
+  heap_block->cap = cap;
+  heap_block->parent = parent;
+  heap_block->layers = 0;
+  heap_block->rows = 0;
+  heap_block->cols = 0;
+  heap_link(heap_block);
+  return heap_block;
+}
+
 heap_block_t *heap_alloc_string(const char *string)
 {
   int len = strlen(string);
@@ -106,9 +178,132 @@ heap_block_t *heap_alloc_string(const char *string)
   return heap_block;
 }
 
+// an array's elements are the first 'size' bytes of its block, which is
+// grown to at least twice what it was so that adding elements one at a time
+// is amortised constant time. an soa array grows by whole runs, which keeps
+// the elements it has where they are.
+void heap_reserve(heap_block_t *array, int length, int size, bool soa)
+{
+  long cap = soa ? (long) (length + SOA_RUN - 1) / SOA_RUN * SOA_RUN * size : (long) length * size;
+  if (cap <= array->cap)
+    return;
+  
+  if (cap < (long) array->cap * 2 && (long) array->cap * 2 <= INT_MAX)
+    cap = (long) array->cap * 2;
+  
+  // a slice stops sharing its parent's elements once it outgrows them
+  if (array->parent) {
+    char *block = ZONE_ALLOC(cap);
+    memcpy(block, array->block, array->size);
+    array->block = block;
+    array->parent = NULL;
+  } else {
+    array->block = ZONE_REALLOC(array->block, cap);
+  }
+  
+  array->cap = cap;
+}
+
+// elements it gains are zero
+void heap_resize(heap_block_t *array, int length, int size, bool soa)
+{
+  heap_reserve(array, length, size, soa);
+  
+  int old_length = array->size / size;
+  
+  if (soa) {
+    for (int i = old_length; i < length; i++) {
+      for (int field = 0; field < size; field += 4)
+        memset(&array->block[soa_offset(size, i) + field * SOA_RUN], 0, 4);
+    }
+  } else if (length > old_length) {
+    memset(&array->block[array->size], 0, (length - old_length) * size);
+  }
+  
+  array->size = length * size;
+}
+
+// a zeroed element at 'index', which is at most the length, moving those
+// after it up. returns its address.
+char *heap_insert(heap_block_t *array, int index, int size)
+{
+  int length = array->size / size;
+  heap_reserve(array, length + 1, size, false);
+  
+  char *ptr = &array->block[index * size];
+  memmove(ptr + size, ptr, (length - index) * size);
+  memset(ptr, 0, size);
+  array->size += size;
+  
+  return ptr;
+}
+
+void heap_remove(heap_block_t *array, int index, int size)
+{
+  char *ptr = &array->block[index * size];
+  memmove(ptr, ptr + size, array->size - (index + 1) * size);
+  array->size -= size;
+}
+
+// elements 'lo' up to 'hi' of 'array', sharing its block. the block is handed
+// to a parent of its own the first time an array is sliced, which keeps it
+// alive while the array or any slice of it is. the array is then a slice of
+// all of it.
+heap_block_t *heap_slice(heap_block_t *array, int lo, int hi, int size)
+{
+  if (!array->parent)
+    array->parent = heap_alloc_view(array->block, array->size, array->cap, NULL);
+  
+  return heap_alloc_view(&array->block[lo * size], (hi - lo) * size, (hi - lo) * size, array->parent);
+}
+
+// a T[,] or T[,,] of the 'dim' extents in 'extent', outermost first, whose
+// elements are one block in row-major order. NULL if an extent is negative or
+// the elements would not fit.
+heap_block_t *heap_alloc_grid(const int *extent, int dim, int size)
+{
+  int shape[GRID_DIM] = { 1, 1, 1 };
+  long num = size;
+  
+  for (int i = 0; i < dim; i++) {
+    if (extent[i] < 0)
+      return NULL;
+    
+    shape[GRID_DIM - dim + i] = extent[i];
+    num *= extent[i];
+    if (num > INT_MAX)
+      return NULL;
+  }
+  
+  heap_block_t *grid = heap_alloc(num);
+  grid->layers = shape[0];
+  grid->rows = shape[1];
+  grid->cols = shape[2];
+  
+  return grid;
+}
+
+// the element at the 'dim' indices in 'index', or -1 if one is out of range
+int heap_grid_index(const heap_block_t *grid, const int *index, int dim)
+{
+  const int shape[GRID_DIM] = { grid->layers, grid->rows, grid->cols };
+  int element = 0;
+  
+  for (int i = 0; i < dim; i++) {
+    int extent = shape[GRID_DIM - dim + i];
+    if ((unsigned) index[i] >= (unsigned) extent)
+      return -1;
+    
+    element = element * extent + index[i];
+  }
+  
+  return element;
+}
+
 void heap_free(heap_block_t *heap_block)
 {
-  ZONE_FREE(heap_block->block);
+  if (!heap_block->parent)
+    ZONE_FREE(heap_block->block);
   ZONE_FREE(heap_block);
 }
 
@@ -148,8 +343,7 @@ static void heap_mark_R(scope_t *scope)
   if (!scope)
     return;
   
-  if (scope->ret_flag)
-    heap_mark_expr(&scope->ret_value);
+  heap_mark_expr(&scope->ret_value);
   
   entry_t *entry = scope->map_var.start;
   while (entry) {
@@ -188,6 +382,7 @@ static void heap_mark_var(var_t *var)
 {
   if (var->type.spec == SPEC_CLASS
   || var->type.spec == SPEC_STRING
+  || var->type.spec == SPEC_MAP
   || var->type.arr) {
     expr_t expr;
     mem_load(stack_mem, var->loc, &var->type, &expr);
@@ -199,6 +394,7 @@ static void heap_mark_expr(expr_t *expr)
 {
   if (expr->type.spec == SPEC_CLASS
   || expr->type.spec == SPEC_STRING
+  || expr->type.spec == SPEC_MAP
   || expr->type.arr) {
     heap_block_t *heap_block = (heap_block_t*) expr->block;
     
@@ -206,11 +402,32 @@ static void heap_mark_expr(expr_t *expr)
       return;
     
     heap_block->use = true;
+    if (heap_block->parent)
+      heap_block->parent->use = true;
+    
     if (expr->type.spec == SPEC_CLASS) {
       if (expr->type.arr)
         heap_mark_array_class(heap_block, expr->type.class);
       else
         heap_mark_class(heap_block, expr->type.class);
+    } else if (type_map(&expr->type)) {
+      heap_mark_map(heap_block, &expr->type);
     }
   }
 }
+
+// the string keys of a map and what its values hold
+static void heap_mark_map(heap_block_t *heap_block, const type_t *type)
+{
+  const var_t *key = map_get(&type->class->map_var, "key");
+  const var_t *value = map_get(&type->class->map_var, "value");
+  
+  for (int slot = hmap_next(heap_block, 0); slot >= 0; slot = hmap_next(heap_block, slot + 1)) {
+    expr_t expr;
+    mem_load(heap_block, hmap_key(heap_block, slot) - heap_block->block, &key->type, &expr);
+    heap_mark_expr(&expr);
+    
+    mem_load(heap_block, hmap_value(heap_block, slot) - heap_block->block, &value->type, &expr);
+    heap_mark_expr(&expr);
+  }
+}
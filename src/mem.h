@@ -10,10 +10,22 @@ extern heap_block_t *heap_alloc_static(int size);
 extern heap_block_t *heap_alloc(int size);
 extern heap_block_t *heap_alloc_string(const char *string);
 extern void         heap_free(heap_block_t *heap_block);
+extern void         heap_reserve(heap_block_t *array, int length, int size, bool soa);
+extern void         heap_resize(heap_block_t *array, int length, int size, bool soa);
+extern char         *heap_insert(heap_block_t *array, int index, int size);
+extern void         heap_remove(heap_block_t *array, int index, int size);
+extern heap_block_t *heap_slice(heap_block_t *array, int lo, int hi, int size);
+extern heap_block_t *heap_alloc_grid(const int *extent, int dim, int size);
+extern int          heap_grid_index(const heap_block_t *grid, const int *index, int dim);
 extern void         heap_clean(scope_t *scope_global);
 
 extern heap_block_t *stack_mem;
 extern void         stack_init();
 extern void         stack_clean();
 
+extern heap_block_t *temp_mem;
+extern int          temp_top;
+extern int          temp_alloc(int size);
+extern void         temp_keep(expr_t *expr);
+
 #endif
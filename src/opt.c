@@ -0,0 +1,3644 @@
+#include "opt.h"
+
+#include "log.h"
+#include "map.h"
+#include "zone.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+  DEF_FN,
+  DEF_METHOD,
+  DEF_CLASS,
+  DEF_GLOBAL
+} def_kind_t;
+
+typedef struct {
+  def_kind_t      kind;
+  const lexeme_t  *ident;
+  s_node_t        *stmt;
+  int             owner;
+  bool            live;
+} def_t;
+
+// the top-level definitions of a program by name, names defined more than
+// once are only kept in dup
+typedef struct {
+  map_t       fn;
+  map_t       class;
+  map_t       global;
+  map_t       dup;
+} opt_t;
+
+typedef struct {
+  token_t     spec;
+  bool        arr;
+  const char  *class;
+  int         dim;
+} opt_type_t;
+
+// the function being walked: its params and locals, and the class of 'this'
+typedef struct {
+  map_t           var;
+  map_t           clash;
+  const s_node_t  *class_def;
+  int             stmt;
+} opt_scope_t;
+
+// calls to functions and methods whose body is a single small return are
+// replaced by the returned expression, with the params substituted
+#define OPT_INLINE_TOKENS 48
+#define OPT_INLINE_SIZE   24
+#define OPT_INLINE_ARG    8
+
+typedef enum {
+  INLINE_NEW,
+  INLINE_BUSY,
+  INLINE_OK,
+  INLINE_NO
+} inline_state_t;
+
+typedef struct {
+  s_node_t        *fn;
+  const s_node_t  *class_def;
+  int             def;
+  inline_state_t  state;
+  bool            call;
+  bool            native;
+  int             num_call;
+} inline_fn_t;
+
+typedef struct {
+  opt_t       opt;
+  map_t       name;
+  inline_fn_t *inl;
+  int         num_inl;
+  bool        report;
+} inline_t;
+
+// expressions hoisted out of a loop, each
+#define OPT_LICM_MAX 8
+
+typedef struct {
+  opt_t       opt;
+  int         num_temp;
+  int         num_loop;
+  int         num_hoist;
+  int         num_range;
+  bool        report;
+} licm_t;
+
+// the loop being hoisted out of: the names it sets, whether it calls script
+// functions, stores to members or elements or defines functions, what is
+// declared before it and how many indices its counter keeps in range
+typedef struct {
+  map_t           set;
+  bool            call;
+  bool            store;
+  bool            nest;
+  bool            anchor;
+  const lexeme_t  *lexeme;
+  s_node_t        *hoist[OPT_LICM_MAX];
+  int             num_hoist;
+  int             num_range;
+} licm_loop_t;
+
+// for loops which store an expression of the elements at their counter to
+// an array's element at it are run by a native over blocks of elements, by
+// a program of at most this many ops on as many arrays and scalars
+#define OPT_VEC_PROG    15
+#define OPT_VEC_ARRAY   4
+#define OPT_VEC_SCALAR  4
+
+typedef struct {
+  opt_t           opt;
+  const lexeme_t  *lexeme;
+  bool            f32;
+  bool            i32;
+  int             num_loop;
+  bool            report;
+} vec_t;
+
+// the loop being compiled: the arrays its program reads, the first of which
+// it stores to, and the scalars
+typedef struct {
+  token_t         spec;
+  const char      *counter;
+  const s_node_t  *array[OPT_VEC_ARRAY];
+  int             num_array;
+  const s_node_t  *scalar[OPT_VEC_SCALAR];
+  int             num_scalar;
+  char            prog[OPT_VEC_PROG + 1];
+  int             len;
+} vec_loop_t;
+
+// loads repeated in straight-line code are kept in a temporary, assigned
+// where the first one is evaluated, until something they read is written.
+// loads, and reuses of each, looked at in one run of statements
+#define OPT_CSE_MAX 32
+#define OPT_CSE_USE 8
+
+typedef struct {
+  s_node_t    **def;
+  s_node_t    **stmt;
+  s_node_t    **use[OPT_CSE_USE];
+  int         num_use;
+  int         size;
+  opt_type_t  type;
+  bool        live;
+} cse_load_t;
+
+typedef struct {
+  opt_t       opt;
+  cse_load_t  load[OPT_CSE_MAX];
+  int         num_load;
+  s_node_t    **stmt;
+  int         num_temp;
+  int         num_expr;
+  int         num_reuse;
+  bool        report;
+} cse_t;
+
+// lexemes for the statements a pass adds, copied from one in the code they
+// are made for so errors still point at its line
+typedef struct opt_lexeme_s {
+  lexeme_t            lexeme;
+  char                ident[16];
+  struct opt_lexeme_s *next;
+} opt_lexeme_t;
+
+static opt_lexeme_t *opt_lexeme_list = NULL;
+
+static s_node_t *opt_inline(s_node_t *node, bool report);
+static void     opt_inline_add(inline_t *in, s_node_t *fn, const s_node_t *class_def, int def);
+static bool     opt_inline_ready(inline_t *in, inline_fn_t *inl);
+static void     opt_inline_fn(inline_t *in, s_node_t *fn, const s_node_t *class_def);
+static void     opt_inline_stmt(inline_t *in, opt_scope_t *scope, s_node_t **node);
+static void     opt_inline_expr(inline_t *in, opt_scope_t *scope, s_node_t **node);
+static void     opt_inline_call(inline_t *in, opt_scope_t *scope, s_node_t **node);
+static bool     opt_inline_args(const inline_t *in, const opt_scope_t *scope, const inline_fn_t *inl, const s_node_t *self, const s_node_t *arg);
+static bool     opt_inline_plain(const s_node_t *node, const s_node_t *param_decl);
+static void     opt_inline_report(const inline_fn_t *inl, const lexeme_t *lexeme);
+static bool     opt_inline_read(const s_node_t *node);
+static inline_fn_t *opt_inline_find(const inline_t *in, const s_node_t *fn);
+
+static s_node_t *opt_inline_body(s_node_t *fn);
+static bool     opt_inline_small(const lexeme_t *lexeme);
+static bool     opt_inline_named(const inline_t *in, const lexeme_t *lexeme);
+static bool     opt_inline_pure(const inline_t *in, const s_node_t *node, int *size, bool *call, bool *native);
+static bool     opt_inline_free(const opt_scope_t *scope, const s_node_t *node, const s_node_t *param_decl);
+
+static s_node_t *opt_shake(s_node_t *node, bool report);
+static void     opt_shake_def(map_t *use, def_t *def, int num_def);
+static void     opt_shake_report(const def_t *def, const def_t *owner);
+
+static s_node_t *opt_licm(s_node_t *node, bool report);
+static void     opt_licm_fn(licm_t *lm, s_node_t *fn, const s_node_t *class_def);
+static s_node_t **opt_licm_stmt(licm_t *lm, opt_scope_t *scope, s_node_t **link);
+static s_node_t *opt_licm_loop(licm_t *lm, opt_scope_t *scope, s_node_t *node);
+static void     opt_licm_walk(licm_t *lm, opt_scope_t *scope, licm_loop_t *loop, s_node_t *node);
+static void     opt_licm_expr(licm_t *lm, opt_scope_t *scope, licm_loop_t *loop, s_node_t **node, bool lvalue);
+static bool     opt_licm_candidate(const licm_t *lm, const opt_scope_t *scope, const licm_loop_t *loop, const s_node_t *node);
+static bool     opt_licm_hoist(licm_t *lm, opt_scope_t *scope, licm_loop_t *loop, s_node_t **node);
+static void     opt_licm_scan(const licm_t *lm, licm_loop_t *loop, const s_node_t *node);
+static void     opt_licm_set(const licm_t *lm, licm_loop_t *loop, const s_node_t *lhs);
+static void     opt_licm_range(const licm_t *lm, const opt_scope_t *scope, licm_loop_t *loop, const s_node_t *node);
+static int      opt_licm_mark(s_node_t *node, const s_node_t *base, const char *counter, int lo, int k);
+static bool     opt_licm_offset(const s_node_t *node, const char *counter, int *offset);
+static bool     opt_licm_int(const s_node_t *node, int *value);
+
+static bool     opt_licm_invariant(const licm_t *lm, const opt_scope_t *scope, const licm_loop_t *loop, const s_node_t *node);
+static bool     opt_licm_safe(const licm_t *lm, const opt_scope_t *scope, const licm_loop_t *loop, const s_node_t *node);
+static bool     opt_licm_clean(const licm_t *lm, const opt_scope_t *scope, const licm_loop_t *loop, const s_node_t *node);
+static bool     opt_licm_plain(const s_node_t *node);
+static bool     opt_licm_anchor(const licm_loop_t *loop, const s_node_t *node);
+static bool     opt_licm_within(const s_node_t *node, const s_node_t *part);
+static bool     opt_licm_read(const s_node_t *node);
+static bool     opt_licm_is(const s_node_t *node, const char *ident);
+static bool     opt_licm_named(const lexeme_t *lexeme);
+
+static s_node_t *opt_vec(s_node_t *node, bool report);
+static void     opt_vec_fn(vec_t *vc, s_node_t *fn, const s_node_t *class_def);
+static void     opt_vec_stmt(vec_t *vc, const opt_scope_t *scope, s_node_t *stmt);
+static s_node_t *opt_vec_loop(vec_t *vc, const opt_scope_t *scope, s_node_t *node);
+static bool     opt_vec_expr(const vec_t *vc, const opt_scope_t *scope, vec_loop_t *loop, const s_node_t *node);
+static bool     opt_vec_array(const vec_t *vc, const opt_scope_t *scope, vec_loop_t *loop, const s_node_t *node);
+static bool     opt_vec_scalar(const vec_t *vc, const opt_scope_t *scope, vec_loop_t *loop, const s_node_t *node);
+static bool     opt_vec_bound(const vec_t *vc, const opt_scope_t *scope, const vec_loop_t *loop, const s_node_t *node);
+static bool     opt_vec_op(vec_loop_t *loop, char op);
+static s_node_t *opt_vec_call(const vec_loop_t *loop, s_node_t *node);
+static s_node_t *opt_vec_native(const lexeme_t *where, token_t spec, s_node_t *node);
+
+static s_node_t *opt_cse(s_node_t *node, bool report);
+static void     opt_cse_fn(cse_t *cs, s_node_t *fn, const s_node_t *class_def);
+static void     opt_cse_block(cse_t *cs, opt_scope_t *scope, s_node_t **link);
+static void     opt_cse_nested(cse_t *cs, opt_scope_t *scope, s_node_t *node);
+static void     opt_cse_run(cse_t *cs, opt_scope_t *scope, s_node_t **link, const s_node_t *end);
+static void     opt_cse_stmt(cse_t *cs, const opt_scope_t *scope, s_node_t **link);
+static void     opt_cse_expr(cse_t *cs, const opt_scope_t *scope, s_node_t **node);
+static void     opt_cse_target(cse_t *cs, const opt_scope_t *scope, s_node_t *lhs);
+static void     opt_cse_store(cse_t *cs, const s_node_t *lhs);
+static bool     opt_cse_use(cse_t *cs, const opt_scope_t *scope, s_node_t **node);
+static void     opt_cse_reuse(cse_t *cs, opt_scope_t *scope, cse_load_t *load);
+static void     opt_cse_kill(cse_t *cs, const char *ident, const char *member, bool index);
+static bool     opt_cse_reads(const s_node_t *node, const char *ident, const char *member, bool index);
+static int      opt_cse_size(const s_node_t *node);
+static bool     opt_cse_straight(const s_node_t *node);
+
+static void     opt_scan(opt_t *opt, const s_node_t *node);
+static void     opt_free(opt_t *opt);
+static void     opt_scope(opt_scope_t *scope, const s_node_t *class_def, int stmt);
+static void     opt_scope_free(opt_scope_t *scope);
+static void     opt_param(const opt_t *opt, opt_scope_t *scope, const s_node_t *param_decl);
+static void     opt_decl(const opt_t *opt, opt_scope_t *scope, const s_node_t *node);
+static void     opt_bind(const opt_t *opt, opt_scope_t *scope, const char *ident, const s_node_t *type);
+
+static bool     opt_type(const opt_t *opt, const opt_scope_t *scope, const s_node_t *node, opt_type_t *type);
+static bool     opt_var(const opt_t *opt, const opt_scope_t *scope, const char *ident, opt_type_t *type);
+static bool     opt_bound(const opt_t *opt, const opt_scope_t *scope, const char *ident);
+static bool     opt_local(const opt_scope_t *scope, const char *ident);
+static bool     opt_ret(const s_node_t *fn, opt_type_t *type);
+static void     opt_spec(const s_node_t *node, opt_type_t *type);
+static bool     opt_cmp(const opt_type_t *a, const opt_type_t *b);
+static s_node_t *opt_method(const opt_t *opt, const char *class, const char *ident, const s_node_t **class_def);
+static int      opt_count(const s_node_t *node, const char *ident);
+static s_node_t *opt_copy(const s_node_t *node, const s_node_t *param_decl, s_node_t **arg, const s_node_t *self);
+static bool     opt_equal(const s_node_t *a, const s_node_t *b);
+static const lexeme_t *opt_where(const s_node_t *node);
+static s_node_t *opt_temp(const opt_t *opt, opt_scope_t *scope, int *num_temp, const lexeme_t *where, const opt_type_t *type, const char *prefix);
+static s_node_t *opt_ident(const lexeme_t *ident);
+static s_node_t *opt_node(s_node_type_t node_type);
+static const lexeme_t *opt_lexeme(const lexeme_t *from, token_t token, const char *ident);
+
+static void     opt_use(map_t *use, const s_node_t *node);
+static void     opt_use_lazy(map_t *use, const lexeme_t *lexeme);
+static void     opt_use_ident(map_t *use, const char *ident);
+static bool     opt_pure(const s_node_t *node);
+static bool     opt_assign(const s_node_t *node);
+static bool     opt_native(const opt_t *opt, const s_node_t *node);
+
+static void     _no_free(void *block);
+
+s_node_t *opt_run(s_node_t *node, bool report)
+{
+  node = opt_inline(node, report);
+  node = opt_shake(node, report);
+  node = opt_licm(node, report);
+  node = opt_vec(node, report);
+  node = opt_cse(node, report);
+  
+  return node;
+}
+
+void opt_stop()
+{
+  while (opt_lexeme_list) {
+    opt_lexeme_t *next = opt_lexeme_list->next;
+    ZONE_FREE(opt_lexeme_list);
+    opt_lexeme_list = next;
+  }
+}
+
+// bodies are only walked if they name a function which may be inlined, so
+// those the parser skipped stay unparsed otherwise, and a function is only
+// parsed once a call to it is seen. a top-level statement only sees the
+// functions and classes defined before it.
+static s_node_t *opt_inline(s_node_t *node, bool report)
+{
+  inline_t in;
+  opt_scan(&in.opt, node);
+  map_new(&in.name);
+  in.report = report;
+  
+  int num_fn = 0;
+  for (s_node_t *head = node; head; head = head->stmt.next) {
+    s_node_t *body = head->stmt.body;
+    
+    if (body->node_type == S_FN) {
+      num_fn++;
+    } else if (body->node_type == S_CLASS_DEF) {
+      for (s_node_t *decl = body->class_def.class_decl; decl; decl = decl->stmt.next) {
+        if (decl->stmt.body->node_type == S_FN)
+          num_fn++;
+      }
+    }
+  }
+  
+  in.inl = ZONE_ALLOC(num_fn * sizeof(inline_fn_t) + 1);
+  in.num_inl = 0;
+  
+  int stmt = 0;
+  for (s_node_t *head = node; head; head = head->stmt.next) {
+    s_node_t *body = head->stmt.body;
+    
+    if (body->node_type == S_FN) {
+      opt_inline_add(&in, body, NULL, stmt);
+    } else if (body->node_type == S_CLASS_DEF) {
+      for (s_node_t *decl = body->class_def.class_decl; decl; decl = decl->stmt.next) {
+        if (decl->stmt.body->node_type == S_FN)
+          opt_inline_add(&in, decl->stmt.body, body, stmt);
+      }
+    }
+    
+    stmt++;
+  }
+  
+  stmt = 0;
+  for (s_node_t *head = node; head; head = head->stmt.next) {
+    s_node_t *body = head->stmt.body;
+    
+    switch (body->node_type) {
+    case S_FN:
+      opt_inline_fn(&in, body, NULL);
+      break;
+    case S_CLASS_DEF:
+      for (s_node_t *decl = body->class_def.class_decl; decl; decl = decl->stmt.next) {
+        if (decl->stmt.body->node_type == S_FN || decl->stmt.body->node_type == S_CLASS_NEW)
+          opt_inline_fn(&in, decl->stmt.body, body);
+      }
+      break;
+    default: {
+      opt_scope_t scope;
+      opt_scope(&scope, NULL, stmt);
+      
+      // top-level declarations are globals, only those in blocks are local
+      if (body->node_type != S_DECL)
+        opt_decl(&in.opt, &scope, body);
+      
+      opt_inline_stmt(&in, &scope, &head->stmt.body);
+      opt_scope_free(&scope);
+      break;
+    }
+    }
+    
+    stmt++;
+  }
+  
+  if (report) {
+    int num_inlined = 0;
+    int num_call = 0;
+    
+    for (int i = 0; i < in.num_inl; i++) {
+      if (in.inl[i].num_call > 0) {
+        num_inlined++;
+        num_call += in.inl[i].num_call;
+      }
+    }
+    
+    printf("opt: inline: inlined %i calls to %i functions\n", num_call, num_inlined);
+  }
+  
+  ZONE_FREE(in.inl);
+  opt_free(&in.opt);
+  map_flush(&in.name, _no_free);
+  
+  return node;
+}
+
+static void opt_inline_add(inline_t *in, s_node_t *fn, const s_node_t *class_def, int def)
+{
+  if (fn->fn.body ? !opt_inline_body(fn) : !opt_inline_small(fn->fn.lazy_body))
+    return;
+  
+  in->inl[in->num_inl++] = (inline_fn_t) { fn, class_def, def, INLINE_NEW, false, false, 0 };
+  opt_use_ident(&in->name, fn->fn.fn_ident->data.ident);
+}
+
+// the returned expression is inlined into first, a function reached again
+// while that is done is recursive and left alone
+static bool opt_inline_ready(inline_t *in, inline_fn_t *inl)
+{
+  if (inl->state != INLINE_NEW)
+    return inl->state == INLINE_OK;
+  
+  inl->state = INLINE_BUSY;
+  
+  s_node_t *ret = opt_inline_body(inl->fn);
+  if (!ret) {
+    inl->state = INLINE_NO;
+    return false;
+  }
+  
+  opt_scope_t scope;
+  opt_scope(&scope, inl->class_def, INT_MAX);
+  opt_param(&in->opt, &scope, inl->fn->fn.param_decl);
+  opt_inline_expr(in, &scope, &ret->ret_stmt.body);
+  
+  int size = 0;
+  opt_type_t type;
+  opt_type_t ret_type;
+  bool ok = ret->ret_stmt.body
+    && opt_inline_pure(in, ret->ret_stmt.body, &size, &inl->call, &inl->native)
+    && size <= OPT_INLINE_SIZE
+    && opt_type(&in->opt, &scope, ret->ret_stmt.body, &type)
+    && opt_ret(inl->fn, &ret_type)
+    && opt_cmp(&type, &ret_type);
+  
+  opt_scope_free(&scope);
+  
+  inl->state = ok ? INLINE_OK : INLINE_NO;
+  
+  return ok;
+}
+
+static void opt_inline_fn(inline_t *in, s_node_t *fn, const s_node_t *class_def)
+{
+  const lexeme_t *lazy_body = NULL;
+  const s_node_t *param_decl = NULL;
+  
+  if (fn->node_type == S_FN) {
+    lazy_body = fn->fn.lazy_body;
+    param_decl = fn->fn.param_decl;
+  } else {
+    lazy_body = fn->class_new.lazy_body;
+    param_decl = fn->class_new.param_decl;
+  }
+  
+  if (lazy_body && !opt_inline_named(in, lazy_body))
+    return;
+  
+  inline_fn_t *inl = fn->node_type == S_FN ? opt_inline_find(in, fn) : NULL;
+  if (inl) {
+    opt_inline_ready(in, inl);
+    return;
+  }
+  
+  s_node_t *body = s_lazy_body(fn);
+  if (!body)
+    return;
+  
+  opt_scope_t scope;
+  opt_scope(&scope, class_def, INT_MAX);
+  opt_param(&in->opt, &scope, param_decl);
+  opt_decl(&in->opt, &scope, body);
+  opt_inline_stmt(in, &scope, &body);
+  opt_scope_free(&scope);
+}
+
+static void opt_inline_stmt(inline_t *in, opt_scope_t *scope, s_node_t **node)
+{
+  s_node_t *body = *node;
+  if (!body)
+    return;
+  
+  switch (body->node_type) {
+  case S_STMT:
+    for (s_node_t *head = body; head; head = head->stmt.next)
+      opt_inline_stmt(in, scope, &head->stmt.body);
+    break;
+  case S_DECL:
+    opt_inline_expr(in, scope, &body->decl.init);
+    break;
+  case S_IF_STMT:
+    opt_inline_expr(in, scope, &body->if_stmt.cond);
+    opt_inline_stmt(in, scope, &body->if_stmt.body);
+    opt_inline_stmt(in, scope, &body->if_stmt.next);
+    break;
+  case S_WHILE_STMT:
+    opt_inline_expr(in, scope, &body->while_stmt.cond);
+    opt_inline_stmt(in, scope, &body->while_stmt.body);
+    break;
+  case S_FOR_STMT:
+    opt_inline_stmt(in, scope, &body->for_stmt.decl);
+    opt_inline_expr(in, scope, &body->for_stmt.cond);
+    opt_inline_expr(in, scope, &body->for_stmt.inc);
+    opt_inline_stmt(in, scope, &body->for_stmt.body);
+    break;
+  case S_RET_STMT:
+    opt_inline_expr(in, scope, &body->ret_stmt.body);
+    break;
+  case S_PRINT:
+    opt_inline_expr(in, scope, &body->print.arg);
+    break;
+  case S_FN:
+  case S_CLASS_DEF:
+  case S_CTRL_STMT:
+    break;
+  default:
+    opt_inline_expr(in, scope, node);
+    break;
+  }
+}
+
+// calls are inlined after their args, so those are already as small as
+// they get
+static void opt_inline_expr(inline_t *in, opt_scope_t *scope, s_node_t **node)
+{
+  s_node_t *body = *node;
+  if (!body)
+    return;
+  
+  switch (body->node_type) {
+  case S_BINOP:
+    opt_inline_expr(in, scope, &body->binop.lhs);
+    opt_inline_expr(in, scope, &body->binop.rhs);
+    break;
+  case S_UNARY:
+    opt_inline_expr(in, scope, &body->unary.rhs);
+    break;
+  case S_DIRECT:
+    opt_inline_expr(in, scope, &body->direct.base);
+    break;
+  case S_INDEX:
+    opt_inline_expr(in, scope, &body->index.base);
+    opt_inline_expr(in, scope, &body->index.index);
+    break;
+  case S_PROC:
+    if (body->proc.base->node_type == S_DIRECT)
+      opt_inline_expr(in, scope, &body->proc.base->direct.base);
+    opt_inline_expr(in, scope, &body->proc.arg);
+    opt_inline_call(in, scope, node);
+    break;
+  case S_ARG:
+    for (s_node_t *head = body; head; head = head->arg.next)
+      opt_inline_expr(in, scope, &head->arg.body);
+    break;
+  case S_ARRAY_INIT:
+    opt_inline_expr(in, scope, &body->array_init.size);
+    opt_inline_expr(in, scope, &body->array_init.init);
+    break;
+  case S_POST_OP:
+    opt_inline_expr(in, scope, &body->post_op.lhs);
+    break;
+  default:
+    break;
+  }
+}
+
+static void opt_inline_call(inline_t *in, opt_scope_t *scope, s_node_t **node)
+{
+  s_node_t *proc = *node;
+  const s_node_t *base = proc->proc.base;
+  const s_node_t *self = NULL;
+  const s_node_t *class_def = NULL;
+  s_node_t *fn = NULL;
+  
+  if (base->node_type == S_CONSTANT) {
+    if (base->constant.lexeme->token != TK_IDENTIFIER)
+      return;
+    
+    const char *ident = base->constant.lexeme->data.ident;
+    if (opt_bound(&in->opt, scope, ident) || map_get(&in->opt.dup, ident))
+      return;
+    
+    fn = map_get(&in->opt.fn, ident);
+  } else if (base->node_type == S_DIRECT) {
+    opt_type_t type;
+    if (!opt_type(&in->opt, scope, base->direct.base, &type))
+      return;
+    
+    if (type.spec != TK_CLASS || type.arr)
+      return;
+    
+    fn = opt_method(&in->opt, type.class, base->direct.child_ident->data.ident, &class_def);
+    self = base->direct.base;
+  }
+  
+  if (!fn)
+    return;
+  
+  inline_fn_t *inl = opt_inline_find(in, fn);
+  if (!inl || inl->def >= scope->stmt || !opt_inline_ready(in, inl))
+    return;
+  
+  const s_node_t *body = opt_inline_body(fn)->ret_stmt.body;
+  if (!opt_inline_args(in, scope, inl, self, proc->proc.arg))
+    return;
+  
+  if (!opt_inline_free(scope, body, fn->fn.param_decl))
+    return;
+  
+  s_node_t *arg[OPT_INLINE_ARG];
+  int num_arg = 0;
+  for (s_node_t *head = proc->proc.arg; head; head = head->arg.next)
+    arg[num_arg++] = head->arg.body;
+  
+  *node = opt_copy(body, fn->fn.param_decl, arg, self);
+  inl->num_call++;
+  
+  if (in->report)
+    opt_inline_report(inl, proc->proc.left_bracket);
+  
+  s_free(proc);
+}
+
+// the args are evaluated where the params are used instead of before the
+// call. constants and locals can go anywhere, other reads only where no
+// script function is called, and one arg with side effects only in place
+// of a param used once in arithmetic on constants and locals.
+static bool opt_inline_args(const inline_t *in, const opt_scope_t *scope, const inline_fn_t *inl, const s_node_t *self, const s_node_t *arg)
+{
+  const s_node_t *body = opt_inline_body(inl->fn)->ret_stmt.body;
+  
+  const s_node_t *value[OPT_INLINE_ARG + 1];
+  int use[OPT_INLINE_ARG + 1];
+  int num_value = 0;
+  
+  if (self) {
+    value[num_value] = self;
+    use[num_value++] = opt_count(body, "this");
+    
+    // the call checks 'this' is not null
+    if (use[0] == 0)
+      return false;
+  }
+  
+  const s_node_t *param = inl->fn->fn.param_decl;
+  while (param && arg) {
+    if (num_value == OPT_INLINE_ARG + 1)
+      return false;
+    
+    opt_type_t param_type;
+    opt_type_t arg_type;
+    opt_spec(param->param_decl.type, &param_type);
+    if (!opt_type(&in->opt, scope, arg->arg.body, &arg_type) || !opt_cmp(&arg_type, &param_type))
+      return false;
+    
+    value[num_value] = arg->arg.body;
+    use[num_value++] = opt_count(body, param->param_decl.ident->data.ident);
+    
+    param = param->param_decl.next;
+    arg = arg->arg.next;
+  }
+  
+  if (param || arg)
+    return false;
+  
+  int num_effect = 0;
+  bool fixed = true;
+  
+  for (int i = 0; i < num_value; i++) {
+    const s_node_t *node = value[i];
+    
+    if (node->node_type == S_CONSTANT) {
+      if (node->constant.lexeme->token != TK_IDENTIFIER)
+        continue;
+      
+      if (!opt_local(scope, node->constant.lexeme->data.ident)) {
+        if (inl->call)
+          return false;
+        fixed = false;
+      }
+    } else if (opt_inline_read(node)) {
+      if (inl->call || use[i] == 0)
+        return false;
+      fixed = false;
+    } else {
+      if (inl->call || inl->native || use[i] != 1)
+        return false;
+      num_effect++;
+    }
+  }
+  
+  if (num_effect == 0)
+    return true;
+  
+  return num_effect == 1 && fixed && opt_inline_plain(body, inl->fn->fn.param_decl);
+}
+
+// arithmetic on params and constants, which nothing an arg does can change
+static bool opt_inline_plain(const s_node_t *node, const s_node_t *param_decl)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    if (node->constant.lexeme->token != TK_IDENTIFIER)
+      return true;
+    
+    for (const s_node_t *head = param_decl; head; head = head->param_decl.next) {
+      if (strcmp(head->param_decl.ident->data.ident, node->constant.lexeme->data.ident) == 0)
+        return true;
+    }
+    
+    return false;
+  case S_UNARY:
+    return opt_inline_plain(node->unary.rhs, param_decl);
+  case S_BINOP:
+    return opt_inline_plain(node->binop.lhs, param_decl) && opt_inline_plain(node->binop.rhs, param_decl);
+  default:
+    return false;
+  }
+}
+
+static void opt_inline_report(const inline_fn_t *inl, const lexeme_t *lexeme)
+{
+  printf("opt: inline: %s:%i: inlined %s '", lexeme->src, lexeme->line, inl->class_def ? "method" : "function");
+  
+  if (inl->class_def)
+    printf("%s.", inl->class_def->class_def.ident->data.ident);
+  
+  printf("%s'\n", inl->fn->fn.fn_ident->data.ident);
+}
+
+static bool opt_inline_read(const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return node->constant.lexeme->token == TK_IDENTIFIER;
+  case S_DIRECT:
+    return opt_inline_read(node->direct.base);
+  case S_INDEX:
+    if (!opt_inline_read(node->index.base))
+      return false;
+    return node->index.index->node_type == S_CONSTANT || opt_inline_read(node->index.index);
+  default:
+    return false;
+  }
+}
+
+static inline_fn_t *opt_inline_find(const inline_t *in, const s_node_t *fn)
+{
+  for (int i = 0; i < in->num_inl; i++) {
+    if (in->inl[i].fn == fn)
+      return &in->inl[i];
+  }
+  
+  return NULL;
+}
+
+// the return statement of a function whose body is only that
+static s_node_t *opt_inline_body(s_node_t *fn)
+{
+  s_node_t *body = s_lazy_body(fn);
+  if (!body || body->stmt.next || body->stmt.body->node_type != S_RET_STMT)
+    return NULL;
+  
+  return body->stmt.body;
+}
+
+// '{' 'return' ... ';' '}'
+static bool opt_inline_small(const lexeme_t *lexeme)
+{
+  if (!lexeme || lexeme->token != '{')
+    return false;
+  
+  lexeme = lexeme->next;
+  if (!lexeme || lexeme->token != TK_RETURN)
+    return false;
+  
+  for (int i = 0; lexeme && i < OPT_INLINE_TOKENS; i++) {
+    if (lexeme->token == '{' || lexeme->token == '}')
+      return false;
+    
+    if (lexeme->token == ';')
+      return lexeme->next && lexeme->next->token == '}';
+    
+    lexeme = lexeme->next;
+  }
+  
+  return false;
+}
+
+// whether a body the parser skipped names a function which may be inlined
+static bool opt_inline_named(const inline_t *in, const lexeme_t *lexeme)
+{
+  int depth = 0;
+  
+  while (lexeme) {
+    switch (lexeme->token) {
+    case '{':
+      depth++;
+      break;
+    case '}':
+      depth--;
+      break;
+    case TK_IDENTIFIER:
+      if (map_get(&in->name, lexeme->data.ident))
+        return true;
+      break;
+    default:
+      break;
+    }
+    
+    if (depth == 0)
+      break;
+    
+    lexeme = lexeme->next;
+  }
+  
+  return false;
+}
+
+// expressions which can be inlined: no assignments, allocations of arrays
+// or functions which can not be named from anywhere
+static bool opt_inline_pure(const inline_t *in, const s_node_t *node, int *size, bool *call, bool *native)
+{
+  (*size)++;
+  
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return true;
+  case S_UNARY:
+    return opt_inline_pure(in, node->unary.rhs, size, call, native);
+  case S_BINOP:
+    return !opt_assign(node)
+      && opt_inline_pure(in, node->binop.lhs, size, call, native)
+      && opt_inline_pure(in, node->binop.rhs, size, call, native);
+  case S_DIRECT:
+    return opt_inline_pure(in, node->direct.base, size, call, native);
+  case S_INDEX:
+    return opt_inline_pure(in, node->index.base, size, call, native)
+      && opt_inline_pure(in, node->index.index, size, call, native);
+  case S_PROC: {
+    const s_node_t *base = node->proc.base;
+    
+    if (base->node_type == S_CONSTANT) {
+      const s_node_t *fn = map_get(&in->opt.fn, base->constant.lexeme->data.ident);
+      if (!fn)
+        return false;
+      
+      if (opt_native(&in->opt, node))
+        *native = true;
+      else
+        *call = true;
+    } else if (base->node_type == S_DIRECT) {
+      if (!opt_inline_pure(in, base->direct.base, size, call, native))
+        return false;
+      *call = true;
+    } else if (base->node_type == S_NEW) {
+      *call = true;
+    } else {
+      return false;
+    }
+    
+    for (const s_node_t *arg = node->proc.arg; arg; arg = arg->arg.next) {
+      if (!opt_inline_pure(in, arg->arg.body, size, call, native))
+        return false;
+    }
+    
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+// the names a call site declares must not hide those the body refers to
+static bool opt_inline_free(const opt_scope_t *scope, const s_node_t *node, const s_node_t *param_decl)
+{
+  switch (node->node_type) {
+  case S_CONSTANT: {
+    if (node->constant.lexeme->token != TK_IDENTIFIER)
+      return true;
+    
+    const char *ident = node->constant.lexeme->data.ident;
+    if (strcmp(ident, "this") == 0)
+      return true;
+    
+    for (const s_node_t *head = param_decl; head; head = head->param_decl.next) {
+      if (strcmp(head->param_decl.ident->data.ident, ident) == 0)
+        return true;
+    }
+    
+    return !map_get(&scope->var, ident) && !map_get(&scope->clash, ident);
+  }
+  case S_UNARY:
+    return opt_inline_free(scope, node->unary.rhs, param_decl);
+  case S_BINOP:
+    return opt_inline_free(scope, node->binop.lhs, param_decl)
+      && opt_inline_free(scope, node->binop.rhs, param_decl);
+  case S_DIRECT:
+    return opt_inline_free(scope, node->direct.base, param_decl);
+  case S_INDEX:
+    return opt_inline_free(scope, node->index.base, param_decl)
+      && opt_inline_free(scope, node->index.index, param_decl);
+  case S_PROC:
+    if (node->proc.base->node_type != S_NEW && !opt_inline_free(scope, node->proc.base, param_decl))
+      return false;
+    
+    for (const s_node_t *arg = node->proc.arg; arg; arg = arg->arg.next) {
+      if (!opt_inline_free(scope, arg->arg.body, param_decl))
+        return false;
+    }
+    
+    return true;
+  default:
+    return true;
+  }
+}
+
+// drop top-level functions, classes and globals, and the methods of live
+// classes, which are never named by the top-level statements or the host
+// entry points. globals are only dropped if their initialiser is pure.
+static s_node_t *opt_shake(s_node_t *node, bool report)
+{
+  int num_def = 0;
+  int num_stmt = 0;
+  
+  s_node_t *head = node;
+  while (head) {
+    num_def++;
+    num_stmt++;
+    
+    if (head->stmt.body->node_type == S_CLASS_DEF) {
+      s_node_t *decl = head->stmt.body->class_def.class_decl;
+      while (decl) {
+        num_def++;
+        decl = decl->stmt.next;
+      }
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  map_t use;
+  map_new(&use);
+  
+  opt_use_ident(&use, "update");
+  opt_use_ident(&use, "draw");
+  
+  def_t *def = ZONE_ALLOC(num_def * sizeof(def_t) + 1);
+  num_def = 0;
+  
+  // the definition each top-level statement makes, or -1
+  int *stmt_def = ZONE_ALLOC(num_stmt * sizeof(int) + 1);
+  num_stmt = 0;
+  
+  head = node;
+  while (head) {
+    s_node_t *body = head->stmt.body;
+    
+    stmt_def[num_stmt++] = num_def;
+    
+    switch (body->node_type) {
+    case S_FN:
+      def[num_def++] = (def_t) { DEF_FN, body->fn.fn_ident, head, -1, false };
+      break;
+    case S_CLASS_DEF: {
+      int owner = num_def;
+      def[num_def++] = (def_t) { DEF_CLASS, body->class_def.ident, head, -1, false };
+      
+      s_node_t *decl = body->class_def.class_decl;
+      while (decl) {
+        if (decl->stmt.body->node_type == S_FN)
+          def[num_def++] = (def_t) { DEF_METHOD, decl->stmt.body->fn.fn_ident, decl, owner, false };
+        decl = decl->stmt.next;
+      }
+      break;
+    }
+    case S_DECL:
+      if (opt_pure(body->decl.init)) {
+        def[num_def++] = (def_t) { DEF_GLOBAL, body->decl.ident, head, -1, false };
+      } else {
+        stmt_def[num_stmt - 1] = -1;
+        opt_use(&use, body);
+      }
+      break;
+    default:
+      stmt_def[num_stmt - 1] = -1;
+      opt_use(&use, body);
+      break;
+    }
+    
+    head = head->stmt.next;
+  }
+  
+  opt_shake_def(&use, def, num_def);
+  
+  int num_removed[] = { 0, 0, 0, 0 };
+  
+  s_node_t *body = NULL;
+  head = NULL;
+  
+  num_stmt = 0;
+  s_node_t *next = NULL;
+  for (s_node_t *stmt = node; stmt; stmt = next) {
+    next = stmt->stmt.next;
+    
+    int i = stmt_def[num_stmt++];
+    
+    bool live = true;
+    if (i != -1) {
+      live = def[i].live;
+      
+      if (!live) {
+        num_removed[def[i].kind]++;
+        if (report)
+          opt_shake_report(&def[i], NULL);
+      } else if (def[i].kind == DEF_CLASS) {
+        s_node_t *class_decl = stmt->stmt.body->class_def.class_decl;
+        s_node_t *decl_body = NULL;
+        s_node_t *decl_head = NULL;
+        s_node_t *decl_next = NULL;
+        
+        int j = i + 1;
+        for (s_node_t *decl = class_decl; decl; decl = decl_next) {
+          decl_next = decl->stmt.next;
+          decl->stmt.next = NULL;
+          
+          if (j < num_def && def[j].stmt == decl && !def[j].live) {
+            num_removed[DEF_METHOD]++;
+            if (report)
+              opt_shake_report(&def[j], &def[i]);
+            s_free(decl);
+          } else {
+            if (decl_head)
+              decl_head = decl_head->stmt.next = decl;
+            else
+              decl_body = decl_head = decl;
+          }
+          
+          if (j < num_def && def[j].stmt == decl)
+            j++;
+        }
+        
+        stmt->stmt.body->class_def.class_decl = decl_body;
+      }
+    }
+    
+    stmt->stmt.next = NULL;
+    
+    if (!live) {
+      s_free(stmt);
+      continue;
+    }
+    
+    if (head)
+      head = head->stmt.next = stmt;
+    else
+      body = head = stmt;
+  }
+  
+  if (report) {
+    printf(
+      "opt: shake: removed %i functions, %i methods, %i classes, %i globals\n",
+      num_removed[DEF_FN],
+      num_removed[DEF_METHOD],
+      num_removed[DEF_CLASS],
+      num_removed[DEF_GLOBAL]);
+  }
+  
+  ZONE_FREE(stmt_def);
+  ZONE_FREE(def);
+  map_flush(&use, _no_free);
+  
+  return body;
+}
+
+static void opt_shake_def(map_t *use, def_t *def, int num_def)
+{
+  bool grow = true;
+  
+  while (grow) {
+    grow = false;
+    
+    for (int i = 0; i < num_def; i++) {
+      if (def[i].live)
+        continue;
+      
+      if (def[i].kind == DEF_METHOD && !def[def[i].owner].live)
+        continue;
+      
+      if (!map_get(use, def[i].ident->data.ident))
+        continue;
+      
+      def[i].live = true;
+      grow = true;
+      
+      if (def[i].kind == DEF_CLASS) {
+        s_node_t *decl = def[i].stmt->stmt.body->class_def.class_decl;
+        while (decl) {
+          if (decl->stmt.body->node_type != S_FN)
+            opt_use(use, decl->stmt.body);
+          decl = decl->stmt.next;
+        }
+      } else {
+        opt_use(use, def[i].stmt->stmt.body);
+      }
+    }
+  }
+}
+
+static void opt_shake_report(const def_t *def, const def_t *owner)
+{
+  static const char *str_def_table[] = {
+    "function", // DEF_FN
+    "method",   // DEF_METHOD
+    "class",    // DEF_CLASS
+    "global"    // DEF_GLOBAL
+  };
+  
+  printf("opt: shake: %s:%i: removed %s '", def->ident->src, def->ident->line, str_def_table[def->kind]);
+  
+  if (owner)
+    printf("%s.", owner->ident->data.ident);
+  
+  printf("%s'\n", def->ident->data.ident);
+}
+
+// expressions which can not change while a loop runs are computed once
+// into a variable declared before it
+static s_node_t *opt_licm(s_node_t *node, bool report)
+{
+  licm_t lm;
+  opt_scan(&lm.opt, node);
+  lm.num_temp = 0;
+  lm.num_loop = 0;
+  lm.num_hoist = 0;
+  lm.num_range = 0;
+  lm.report = report;
+  
+  for (s_node_t **link = &node; *link; link = &(*link)->stmt.next) {
+    s_node_t *body = (*link)->stmt.body;
+    
+    switch (body->node_type) {
+    case S_FN:
+      opt_licm_fn(&lm, body, NULL);
+      break;
+    case S_CLASS_DEF:
+      for (s_node_t *decl = body->class_def.class_decl; decl; decl = decl->stmt.next) {
+        if (decl->stmt.body->node_type == S_FN || decl->stmt.body->node_type == S_CLASS_NEW)
+          opt_licm_fn(&lm, decl->stmt.body, body);
+      }
+      break;
+    default: {
+      opt_scope_t scope;
+      opt_scope(&scope, NULL, INT_MAX);
+      
+      if (body->node_type != S_DECL)
+        opt_decl(&lm.opt, &scope, body);
+      
+      link = opt_licm_stmt(&lm, &scope, link);
+      opt_scope_free(&scope);
+      break;
+    }
+    }
+  }
+  
+  if (report) {
+    printf(
+      "opt: licm: hoisted %i expressions and kept %i indices in range in %i loops\n",
+      lm.num_hoist,
+      lm.num_range,
+      lm.num_loop);
+  }
+  
+  opt_free(&lm.opt);
+  
+  return node;
+}
+
+static void opt_licm_fn(licm_t *lm, s_node_t *fn, const s_node_t *class_def)
+{
+  const lexeme_t *lazy_body = NULL;
+  const s_node_t *param_decl = NULL;
+  s_node_t **link = NULL;
+  
+  if (fn->node_type == S_FN) {
+    lazy_body = fn->fn.lazy_body;
+    param_decl = fn->fn.param_decl;
+    link = &fn->fn.body;
+  } else {
+    lazy_body = fn->class_new.lazy_body;
+    param_decl = fn->class_new.param_decl;
+    link = &fn->class_new.body;
+  }
+  
+  if (lazy_body && !opt_licm_named(lazy_body))
+    return;
+  
+  s_node_t *body = s_lazy_body(fn);
+  if (!body)
+    return;
+  
+  opt_scope_t scope;
+  opt_scope(&scope, class_def, INT_MAX);
+  opt_param(&lm->opt, &scope, param_decl);
+  opt_decl(&lm->opt, &scope, body);
+  
+  for (; *link; link = &(*link)->stmt.next)
+    link = opt_licm_stmt(lm, &scope, link);
+  
+  opt_scope_free(&scope);
+}
+
+// inner loops are done first, what they hoist is then declared in the body
+// of the outer one. returns the link the statement is at after that.
+static s_node_t **opt_licm_stmt(licm_t *lm, opt_scope_t *scope, s_node_t **link)
+{
+  s_node_t *body = (*link)->stmt.body;
+  s_node_t **inner = NULL;
+  
+  switch (body->node_type) {
+  case S_IF_STMT:
+    for (inner = &body->if_stmt.body; *inner; inner = &(*inner)->stmt.next)
+      inner = opt_licm_stmt(lm, scope, inner);
+    for (inner = &body->if_stmt.next; *inner; inner = &(*inner)->stmt.next)
+      inner = opt_licm_stmt(lm, scope, inner);
+    return link;
+  case S_WHILE_STMT:
+    inner = &body->while_stmt.body;
+    break;
+  case S_FOR_STMT:
+    inner = &body->for_stmt.body;
+    break;
+  default:
+    return link;
+  }
+  
+  for (; *inner; inner = &(*inner)->stmt.next)
+    inner = opt_licm_stmt(lm, scope, inner);
+  
+  s_node_t *pre = opt_licm_loop(lm, scope, body);
+  if (!pre)
+    return link;
+  
+  s_node_t *tail = pre;
+  while (tail->stmt.next)
+    tail = tail->stmt.next;
+  
+  tail->stmt.next = *link;
+  *link = pre;
+  
+  return &tail->stmt.next;
+}
+
+// the statements to insert before the loop, if any
+static s_node_t *opt_licm_loop(licm_t *lm, opt_scope_t *scope, s_node_t *node)
+{
+  licm_loop_t loop = { 0 };
+  map_new(&loop.set);
+  
+  s_node_t **cond = NULL;
+  s_node_t *decl = NULL;
+  
+  if (node->node_type == S_FOR_STMT) {
+    cond = &node->for_stmt.cond;
+    decl = node->for_stmt.decl;
+    
+    opt_licm_scan(lm, &loop, node->for_stmt.cond);
+    opt_licm_scan(lm, &loop, node->for_stmt.body);
+    
+    // the counter may only be set by its declaration and increment
+    if (!loop.nest)
+      opt_licm_range(lm, scope, &loop, node);
+    
+    opt_licm_scan(lm, &loop, node->for_stmt.decl);
+    opt_licm_scan(lm, &loop, node->for_stmt.inc);
+  } else {
+    cond = &node->while_stmt.cond;
+    
+    opt_licm_scan(lm, &loop, node->while_stmt.cond);
+    opt_licm_scan(lm, &loop, node->while_stmt.body);
+  }
+  
+  loop.lexeme = opt_where(*cond);
+  
+  if (loop.nest || !loop.lexeme) {
+    map_flush(&loop.set, _no_free);
+    return NULL;
+  }
+  
+  // reads which may fail are only hoisted out of the condition, which would
+  // make them first anyway, if nothing before them may fail
+  loop.anchor = opt_licm_clean(lm, scope, &loop, *cond) && (!decl || opt_licm_plain(decl->stmt.body));
+  
+  opt_licm_expr(lm, scope, &loop, cond, false);
+  loop.anchor = false;
+  
+  if (node->node_type == S_FOR_STMT) {
+    opt_licm_expr(lm, scope, &loop, &node->for_stmt.inc, false);
+    opt_licm_walk(lm, scope, &loop, node->for_stmt.body);
+  } else {
+    opt_licm_walk(lm, scope, &loop, node->while_stmt.body);
+  }
+  
+  s_node_t *pre = NULL;
+  s_node_t *tail = NULL;
+  
+  for (int i = 0; i < loop.num_hoist; i++) {
+    s_node_t *stmt = opt_node(S_STMT);
+    stmt->stmt.body = loop.hoist[i];
+    
+    if (tail)
+      tail = tail->stmt.next = stmt;
+    else
+      pre = tail = stmt;
+  }
+  
+  if (pre || loop.num_range > 0) {
+    lm->num_loop++;
+    lm->num_hoist += loop.num_hoist;
+    lm->num_range += loop.num_range;
+    
+    if (lm->report) {
+      printf(
+        "opt: licm: %s:%i: hoisted %i expressions, kept %i indices in range\n",
+        loop.lexeme->src,
+        loop.lexeme->line,
+        loop.num_hoist,
+        loop.num_range);
+    }
+  }
+  
+  map_flush(&loop.set, _no_free);
+  
+  return pre;
+}
+
+static void opt_licm_walk(licm_t *lm, opt_scope_t *scope, licm_loop_t *loop, s_node_t *node)
+{
+  if (!node)
+    return;
+  
+  switch (node->node_type) {
+  case S_STMT:
+    for (; node; node = node->stmt.next) {
+      switch (node->stmt.body->node_type) {
+      case S_STMT:
+      case S_DECL:
+      case S_IF_STMT:
+      case S_WHILE_STMT:
+      case S_FOR_STMT:
+      case S_RET_STMT:
+      case S_PRINT:
+      case S_FN:
+      case S_CLASS_DEF:
+      case S_CTRL_STMT:
+        opt_licm_walk(lm, scope, loop, node->stmt.body);
+        break;
+      default:
+        opt_licm_expr(lm, scope, loop, &node->stmt.body, false);
+        break;
+      }
+    }
+    break;
+  case S_DECL:
+    opt_licm_expr(lm, scope, loop, &node->decl.init, false);
+    break;
+  case S_IF_STMT:
+    opt_licm_expr(lm, scope, loop, &node->if_stmt.cond, false);
+    opt_licm_walk(lm, scope, loop, node->if_stmt.body);
+    opt_licm_walk(lm, scope, loop, node->if_stmt.next);
+    break;
+  case S_WHILE_STMT:
+    opt_licm_expr(lm, scope, loop, &node->while_stmt.cond, false);
+    opt_licm_walk(lm, scope, loop, node->while_stmt.body);
+    break;
+  case S_FOR_STMT:
+    opt_licm_walk(lm, scope, loop, node->for_stmt.decl);
+    opt_licm_expr(lm, scope, loop, &node->for_stmt.cond, false);
+    opt_licm_expr(lm, scope, loop, &node->for_stmt.inc, false);
+    opt_licm_walk(lm, scope, loop, node->for_stmt.body);
+    break;
+  case S_RET_STMT:
+    opt_licm_expr(lm, scope, loop, &node->ret_stmt.body, false);
+    break;
+  case S_PRINT:
+    opt_licm_expr(lm, scope, loop, &node->print.arg, false);
+    break;
+  default:
+    break;
+  }
+}
+
+// the left side of an assignment is only walked into, as what it names has
+// to stay there
+static void opt_licm_expr(licm_t *lm, opt_scope_t *scope, licm_loop_t *loop, s_node_t **node, bool lvalue)
+{
+  s_node_t *body = *node;
+  if (!body)
+    return;
+  
+  if (!lvalue) {
+    if (opt_licm_candidate(lm, scope, loop, body)) {
+      if (opt_licm_hoist(lm, scope, loop, node))
+        return;
+      loop->anchor = false;
+    }
+  }
+  
+  switch (body->node_type) {
+  case S_BINOP:
+    opt_licm_expr(lm, scope, loop, &body->binop.lhs, opt_assign(body));
+    opt_licm_expr(lm, scope, loop, &body->binop.rhs, false);
+    break;
+  case S_UNARY:
+    opt_licm_expr(lm, scope, loop, &body->unary.rhs, false);
+    break;
+  case S_DIRECT:
+    opt_licm_expr(lm, scope, loop, &body->direct.base, false);
+    break;
+  case S_INDEX:
+    opt_licm_expr(lm, scope, loop, &body->index.base, false);
+    opt_licm_expr(lm, scope, loop, &body->index.index, false);
+    break;
+  case S_PROC:
+    if (body->proc.base->node_type == S_DIRECT)
+      opt_licm_expr(lm, scope, loop, &body->proc.base->direct.base, false);
+    opt_licm_expr(lm, scope, loop, &body->proc.arg, false);
+    break;
+  case S_ARG:
+    for (s_node_t *head = body; head; head = head->arg.next)
+      opt_licm_expr(lm, scope, loop, &head->arg.body, false);
+    break;
+  case S_ARRAY_INIT:
+    opt_licm_expr(lm, scope, loop, &body->array_init.size, false);
+    opt_licm_expr(lm, scope, loop, &body->array_init.init, false);
+    break;
+  case S_POST_OP:
+    opt_licm_expr(lm, scope, loop, &body->post_op.lhs, true);
+    break;
+  default:
+    break;
+  }
+}
+
+// an expression which reads a name and is worth a variable
+static bool opt_licm_candidate(const licm_t *lm, const opt_scope_t *scope, const licm_loop_t *loop, const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_BINOP:
+  case S_UNARY:
+  case S_DIRECT:
+  case S_INDEX:
+    return opt_licm_read(node) && opt_licm_invariant(lm, scope, loop, node);
+  default:
+    return false;
+  }
+}
+
+static bool opt_licm_hoist(licm_t *lm, opt_scope_t *scope, licm_loop_t *loop, s_node_t **node)
+{
+  s_node_t *body = *node;
+  
+  opt_type_t type;
+  if (!opt_type(&lm->opt, scope, body, &type) || type.arr || (type.spec != TK_I32 && type.spec != TK_F32))
+    return false;
+  
+  if (!opt_licm_safe(lm, scope, loop, body))
+    return false;
+  
+  const lexeme_t *ident = NULL;
+  for (int i = 0; i < loop->num_hoist; i++) {
+    if (opt_equal(loop->hoist[i]->decl.init, body))
+      ident = loop->hoist[i]->decl.ident;
+  }
+  
+  if (ident) {
+    s_free(body);
+  } else {
+    if (loop->num_hoist == OPT_LICM_MAX)
+      return false;
+    
+    s_node_t *decl = opt_temp(&lm->opt, scope, &lm->num_temp, loop->lexeme, &type, "__licm");
+    decl->decl.init = body;
+    loop->hoist[loop->num_hoist++] = decl;
+    ident = decl->decl.ident;
+  }
+  
+  *node = opt_ident(ident);
+  
+  return true;
+}
+
+// the names a loop sets, and whether it calls script functions, stores to
+// members or elements, or defines functions
+static void opt_licm_scan(const licm_t *lm, licm_loop_t *loop, const s_node_t *node)
+{
+  if (!node)
+    return;
+  
+  switch (node->node_type) {
+  case S_STMT:
+    for (; node; node = node->stmt.next)
+      opt_licm_scan(lm, loop, node->stmt.body);
+    break;
+  case S_DECL:
+    opt_use_ident(&loop->set, node->decl.ident->data.ident);
+    opt_licm_scan(lm, loop, node->decl.init);
+    break;
+  case S_IF_STMT:
+    opt_licm_scan(lm, loop, node->if_stmt.cond);
+    opt_licm_scan(lm, loop, node->if_stmt.body);
+    opt_licm_scan(lm, loop, node->if_stmt.next);
+    break;
+  case S_WHILE_STMT:
+    opt_licm_scan(lm, loop, node->while_stmt.cond);
+    opt_licm_scan(lm, loop, node->while_stmt.body);
+    break;
+  case S_FOR_STMT:
+    opt_licm_scan(lm, loop, node->for_stmt.decl);
+    opt_licm_scan(lm, loop, node->for_stmt.cond);
+    opt_licm_scan(lm, loop, node->for_stmt.inc);
+    opt_licm_scan(lm, loop, node->for_stmt.body);
+    break;
+  case S_RET_STMT:
+    opt_licm_scan(lm, loop, node->ret_stmt.body);
+    break;
+  case S_FN:
+  case S_CLASS_DEF:
+    loop->nest = true;
+    break;
+  case S_PRINT:
+    opt_licm_scan(lm, loop, node->print.arg);
+    break;
+  case S_BINOP:
+    if (opt_assign(node))
+      opt_licm_set(lm, loop, node->binop.lhs);
+    else
+      opt_licm_scan(lm, loop, node->binop.lhs);
+    opt_licm_scan(lm, loop, node->binop.rhs);
+    break;
+  case S_POST_OP:
+    opt_licm_set(lm, loop, node->post_op.lhs);
+    break;
+  case S_UNARY:
+    opt_licm_scan(lm, loop, node->unary.rhs);
+    break;
+  case S_DIRECT:
+    opt_licm_scan(lm, loop, node->direct.base);
+    break;
+  case S_INDEX:
+    opt_licm_scan(lm, loop, node->index.base);
+    opt_licm_scan(lm, loop, node->index.index);
+    break;
+  case S_PROC: {
+    const s_node_t *base = node->proc.base;
+    
+    if (!opt_native(&lm->opt, node))
+      loop->call = true;
+    
+    if (base->node_type == S_DIRECT)
+      opt_licm_scan(lm, loop, base->direct.base);
+    
+    opt_licm_scan(lm, loop, node->proc.arg);
+    break;
+  }
+  case S_ARG:
+    for (; node; node = node->arg.next)
+      opt_licm_scan(lm, loop, node->arg.body);
+    break;
+  case S_ARRAY_INIT:
+    opt_licm_scan(lm, loop, node->array_init.size);
+    opt_licm_scan(lm, loop, node->array_init.init);
+    break;
+  default:
+    break;
+  }
+}
+
+static void opt_licm_set(const licm_t *lm, licm_loop_t *loop, const s_node_t *lhs)
+{
+  if (lhs->node_type == S_CONSTANT && lhs->constant.lexeme->token == TK_IDENTIFIER) {
+    opt_use_ident(&loop->set, lhs->constant.lexeme->data.ident);
+    return;
+  }
+  
+  loop->store = true;
+  
+  if (lhs->node_type == S_DIRECT) {
+    opt_licm_scan(lm, loop, lhs->direct.base);
+  } else if (lhs->node_type == S_INDEX) {
+    opt_licm_scan(lm, loop, lhs->index.base);
+    opt_licm_scan(lm, loop, lhs->index.index);
+  }
+}
+
+// a for loop's counter which counts up from a constant while it is below the
+// length of an array, less a constant, keeps that array's elements at the
+// counter plus or minus a constant in range where they stay within both.
+// the array can not change while the loop runs, nor can its length, which
+// only a call can.
+static void opt_licm_range(const licm_t *lm, const opt_scope_t *scope, licm_loop_t *loop, const s_node_t *node)
+{
+  const s_node_t *decl = node->for_stmt.decl ? node->for_stmt.decl->stmt.body : NULL;
+  const s_node_t *inc = node->for_stmt.inc;
+  
+  if (!decl || decl->node_type != S_DECL || !decl->decl.init)
+    return;
+  
+  if (decl->decl.type->type.spec->token != TK_I32 || decl->decl.type->type.left_bracket)
+    return;
+  
+  int lo = 0;
+  if (!opt_licm_int(decl->decl.init, &lo))
+    return;
+  
+  const char *counter = decl->decl.ident->data.ident;
+  if (map_get(&loop->set, counter))
+    return;
+  
+  if (!inc || inc->node_type != S_POST_OP || inc->post_op.op->token != TK_INC || !opt_licm_is(inc->post_op.lhs, counter))
+    return;
+  
+  // each side of an '&&' has to hold for the body to run
+  const s_node_t *cond = node->for_stmt.cond;
+  
+  while (cond) {
+    const s_node_t *test = cond;
+    cond = NULL;
+    
+    if (test->node_type != S_BINOP)
+      break;
+    
+    if (test->binop.op->token == TK_AND) {
+      cond = test->binop.lhs;
+      test = test->binop.rhs;
+      
+      if (test->node_type != S_BINOP)
+        continue;
+    }
+    
+    const s_node_t *bound = NULL;
+    
+    if (test->binop.op->token == '<' && opt_licm_is(test->binop.lhs, counter))
+      bound = test->binop.rhs;
+    else if (test->binop.op->token == '>' && opt_licm_is(test->binop.rhs, counter))
+      bound = test->binop.lhs;
+    else
+      continue;
+    
+    int k = 0;
+    if (bound->node_type == S_BINOP && bound->binop.op->token == '-' && opt_licm_int(bound->binop.rhs, &k))
+      bound = bound->binop.lhs;
+    
+    if (bound->node_type != S_DIRECT || strcmp(bound->direct.child_ident->data.ident, "length") != 0)
+      continue;
+    
+    const s_node_t *base = bound->direct.base;
+    
+    opt_type_t type;
+    if (!opt_type(&lm->opt, scope, base, &type) || !type.arr)
+      continue;
+    
+    if (loop->call || !opt_licm_invariant(lm, scope, loop, base))
+      continue;
+    
+    loop->num_range += opt_licm_mark(node->for_stmt.body, base, counter, lo, k);
+  }
+}
+
+// the number of indices newly marked
+static int opt_licm_mark(s_node_t *node, const s_node_t *base, const char *counter, int lo, int k)
+{
+  if (!node)
+    return 0;
+  
+  int num = 0;
+  
+  switch (node->node_type) {
+  case S_STMT:
+    for (; node; node = node->stmt.next)
+      num += opt_licm_mark(node->stmt.body, base, counter, lo, k);
+    break;
+  case S_DECL:
+    num += opt_licm_mark(node->decl.init, base, counter, lo, k);
+    break;
+  case S_IF_STMT:
+    num += opt_licm_mark(node->if_stmt.cond, base, counter, lo, k);
+    num += opt_licm_mark(node->if_stmt.body, base, counter, lo, k);
+    num += opt_licm_mark(node->if_stmt.next, base, counter, lo, k);
+    break;
+  case S_WHILE_STMT:
+    num += opt_licm_mark(node->while_stmt.cond, base, counter, lo, k);
+    num += opt_licm_mark(node->while_stmt.body, base, counter, lo, k);
+    break;
+  case S_FOR_STMT:
+    num += opt_licm_mark(node->for_stmt.decl, base, counter, lo, k);
+    num += opt_licm_mark(node->for_stmt.cond, base, counter, lo, k);
+    num += opt_licm_mark(node->for_stmt.inc, base, counter, lo, k);
+    num += opt_licm_mark(node->for_stmt.body, base, counter, lo, k);
+    break;
+  case S_RET_STMT:
+    num += opt_licm_mark(node->ret_stmt.body, base, counter, lo, k);
+    break;
+  case S_PRINT:
+    num += opt_licm_mark(node->print.arg, base, counter, lo, k);
+    break;
+  case S_BINOP:
+    num += opt_licm_mark(node->binop.lhs, base, counter, lo, k);
+    num += opt_licm_mark(node->binop.rhs, base, counter, lo, k);
+    break;
+  case S_POST_OP:
+    num += opt_licm_mark(node->post_op.lhs, base, counter, lo, k);
+    break;
+  case S_UNARY:
+    num += opt_licm_mark(node->unary.rhs, base, counter, lo, k);
+    break;
+  case S_DIRECT:
+    num += opt_licm_mark(node->direct.base, base, counter, lo, k);
+    break;
+  case S_INDEX: {
+    int offset = 0;
+    
+    if (!node->index.in_range
+    && opt_equal(node->index.base, base)
+    && opt_licm_offset(node->index.index, counter, &offset)
+    && (long) lo + offset >= 0
+    && offset <= k) {
+      node->index.in_range = true;
+      num++;
+    }
+    
+    num += opt_licm_mark(node->index.base, base, counter, lo, k);
+    num += opt_licm_mark(node->index.index, base, counter, lo, k);
+    break;
+  }
+  case S_PROC:
+    num += opt_licm_mark(node->proc.base, base, counter, lo, k);
+    num += opt_licm_mark(node->proc.arg, base, counter, lo, k);
+    break;
+  case S_ARG:
+    for (; node; node = node->arg.next)
+      num += opt_licm_mark(node->arg.body, base, counter, lo, k);
+    break;
+  case S_ARRAY_INIT:
+    num += opt_licm_mark(node->array_init.size, base, counter, lo, k);
+    num += opt_licm_mark(node->array_init.init, base, counter, lo, k);
+    break;
+  default:
+    break;
+  }
+  
+  return num;
+}
+
+// 'i', 'i + c', 'c + i' or 'i - c'
+static bool opt_licm_offset(const s_node_t *node, const char *counter, int *offset)
+{
+  if (opt_licm_is(node, counter)) {
+    *offset = 0;
+    return true;
+  }
+  
+  if (node->node_type != S_BINOP)
+    return false;
+  
+  int c = 0;
+  
+  switch (node->binop.op->token) {
+  case '+':
+    if (opt_licm_is(node->binop.lhs, counter) && opt_licm_int(node->binop.rhs, &c)) {
+      *offset = c;
+      return true;
+    }
+    if (opt_licm_int(node->binop.lhs, &c) && opt_licm_is(node->binop.rhs, counter)) {
+      *offset = c;
+      return true;
+    }
+    return false;
+  case '-':
+    if (opt_licm_is(node->binop.lhs, counter) && opt_licm_int(node->binop.rhs, &c)) {
+      *offset = -c;
+      return true;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+// integer literals are never negative
+static bool opt_licm_int(const s_node_t *node, int *value)
+{
+  if (node->node_type != S_CONSTANT || node->constant.lexeme->token != TK_CONST_INTEGER)
+    return false;
+  
+  *value = node->constant.lexeme->data.i32;
+  
+  return *value >= 0;
+}
+
+// locals keep their value unless the loop sets them, globals and what
+// members and elements hold also only while no script function is called.
+// the length of an array only changes in a call, of its methods too.
+static bool opt_licm_invariant(const licm_t *lm, const opt_scope_t *scope, const licm_loop_t *loop, const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_CONSTANT: {
+    if (node->constant.lexeme->token != TK_IDENTIFIER)
+      return true;
+    
+    const char *ident = node->constant.lexeme->data.ident;
+    if (map_get(&loop->set, ident))
+      return false;
+    
+    if (strcmp(ident, "this") == 0)
+      return scope->class_def != NULL;
+    
+    if (opt_local(scope, ident) && !map_get(&lm->opt.global, ident))
+      return true;
+    
+    return !loop->call;
+  }
+  case S_UNARY:
+    return opt_licm_invariant(lm, scope, loop, node->unary.rhs);
+  case S_BINOP:
+    return !opt_assign(node)
+      && opt_licm_invariant(lm, scope, loop, node->binop.lhs)
+      && opt_licm_invariant(lm, scope, loop, node->binop.rhs);
+  case S_DIRECT: {
+    if (!opt_licm_invariant(lm, scope, loop, node->direct.base))
+      return false;
+    
+    opt_type_t base;
+    if (opt_type(&lm->opt, scope, node->direct.base, &base) && base.arr)
+      return !loop->call;
+    
+    return !loop->store && !loop->call;
+  }
+  case S_INDEX:
+    return !loop->store && !loop->call
+      && opt_licm_invariant(lm, scope, loop, node->index.base)
+      && opt_licm_invariant(lm, scope, loop, node->index.index);
+  default:
+    return false;
+  }
+}
+
+// whether computing an expression before the loop can not fail where the
+// loop would not have. members of 'this' can always be read, other reads
+// only once the loop's condition or an earlier hoisted expression has made
+// them, and i32 division only by a positive constant.
+static bool opt_licm_safe(const licm_t *lm, const opt_scope_t *scope, const licm_loop_t *loop, const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return true;
+  case S_UNARY:
+    return opt_licm_safe(lm, scope, loop, node->unary.rhs);
+  case S_BINOP: {
+    if (!opt_licm_safe(lm, scope, loop, node->binop.lhs) || !opt_licm_safe(lm, scope, loop, node->binop.rhs))
+      return false;
+    
+    if (node->binop.op->token != '/')
+      return true;
+    
+    opt_type_t type;
+    if (opt_type(&lm->opt, scope, node, &type) && type.spec == TK_F32)
+      return true;
+    
+    const s_node_t *rhs = node->binop.rhs;
+    return rhs->node_type == S_CONSTANT
+      && rhs->constant.lexeme->token == TK_CONST_INTEGER
+      && rhs->constant.lexeme->data.i32 > 0;
+  }
+  case S_DIRECT:
+    if (!opt_licm_safe(lm, scope, loop, node->direct.base))
+      return false;
+    
+    if (opt_licm_is(node->direct.base, "this") && scope->class_def) {
+      opt_type_t type;
+      return opt_type(&lm->opt, scope, node, &type);
+    }
+    
+    return loop->anchor || opt_licm_anchor(loop, node);
+  case S_INDEX:
+    if (!opt_licm_safe(lm, scope, loop, node->index.base) || !opt_licm_safe(lm, scope, loop, node->index.index))
+      return false;
+    
+    return loop->anchor || opt_licm_anchor(loop, node);
+  default:
+    return false;
+  }
+}
+
+// the condition is only read from, and everything in it which may fail
+// does not change while the loop runs
+static bool opt_licm_clean(const licm_t *lm, const opt_scope_t *scope, const licm_loop_t *loop, const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return true;
+  case S_UNARY:
+    return opt_licm_clean(lm, scope, loop, node->unary.rhs);
+  case S_BINOP:
+    if (opt_assign(node) || node->binop.op->token == '/')
+      return false;
+    return opt_licm_clean(lm, scope, loop, node->binop.lhs) && opt_licm_clean(lm, scope, loop, node->binop.rhs);
+  case S_DIRECT:
+  case S_INDEX:
+    return opt_licm_invariant(lm, scope, loop, node);
+  default:
+    return false;
+  }
+}
+
+// arithmetic on names and constants, which can not fail
+static bool opt_licm_plain(const s_node_t *node)
+{
+  if (!node)
+    return true;
+  
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return true;
+  case S_DECL:
+    return opt_licm_plain(node->decl.init);
+  case S_UNARY:
+    return opt_licm_plain(node->unary.rhs);
+  case S_BINOP:
+    if (node->binop.op->token == '/')
+      return false;
+    if (opt_assign(node) && node->binop.lhs->node_type != S_CONSTANT)
+      return false;
+    return opt_licm_plain(node->binop.lhs) && opt_licm_plain(node->binop.rhs);
+  default:
+    return false;
+  }
+}
+
+// whether a read was already made by an expression hoisted before it
+static bool opt_licm_anchor(const licm_loop_t *loop, const s_node_t *node)
+{
+  for (int i = 0; i < loop->num_hoist; i++) {
+    if (opt_licm_within(loop->hoist[i]->decl.init, node))
+      return true;
+  }
+  
+  return false;
+}
+
+static bool opt_licm_within(const s_node_t *node, const s_node_t *part)
+{
+  if (opt_equal(node, part))
+    return true;
+  
+  switch (node->node_type) {
+  case S_UNARY:
+    return opt_licm_within(node->unary.rhs, part);
+  case S_BINOP:
+    return opt_licm_within(node->binop.lhs, part) || opt_licm_within(node->binop.rhs, part);
+  case S_DIRECT:
+    return opt_licm_within(node->direct.base, part);
+  case S_INDEX:
+    return opt_licm_within(node->index.base, part) || opt_licm_within(node->index.index, part);
+  default:
+    return false;
+  }
+}
+
+// whether an expression reads a name, and so is not a constant
+static bool opt_licm_read(const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return node->constant.lexeme->token == TK_IDENTIFIER;
+  case S_UNARY:
+    return opt_licm_read(node->unary.rhs);
+  case S_BINOP:
+    return opt_licm_read(node->binop.lhs) || opt_licm_read(node->binop.rhs);
+  case S_DIRECT:
+  case S_INDEX:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool opt_licm_is(const s_node_t *node, const char *ident)
+{
+  return node->node_type == S_CONSTANT
+    && node->constant.lexeme->token == TK_IDENTIFIER
+    && strcmp(node->constant.lexeme->data.ident, ident) == 0;
+}
+
+// whether a body the parser skipped has a loop in it
+static bool opt_licm_named(const lexeme_t *lexeme)
+{
+  int depth = 0;
+  
+  while (lexeme) {
+    switch (lexeme->token) {
+    case '{':
+      depth++;
+      break;
+    case '}':
+      depth--;
+      break;
+    case TK_FOR:
+    case TK_WHILE:
+      return true;
+    default:
+      break;
+    }
+    
+    if (depth == 0)
+      break;
+    
+    lexeme = lexeme->next;
+  }
+  
+  return false;
+}
+
+// after the loop pass, so what it hoisted out of a loop is a name. the loop
+// is kept for when an array is shorter than the bound, and the natives are
+// declared ahead of the statements which call them.
+static s_node_t *opt_vec(s_node_t *node, bool report)
+{
+  vec_t vc;
+  opt_scan(&vc.opt, node);
+  vc.lexeme = NULL;
+  vc.f32 = false;
+  vc.i32 = false;
+  vc.num_loop = 0;
+  vc.report = report;
+  
+  for (s_node_t *head = node; head; head = head->stmt.next) {
+    s_node_t *body = head->stmt.body;
+    
+    switch (body->node_type) {
+    case S_FN:
+      opt_vec_fn(&vc, body, NULL);
+      break;
+    case S_CLASS_DEF:
+      for (s_node_t *decl = body->class_def.class_decl; decl; decl = decl->stmt.next) {
+        if (decl->stmt.body->node_type == S_FN || decl->stmt.body->node_type == S_CLASS_NEW)
+          opt_vec_fn(&vc, decl->stmt.body, body);
+      }
+      break;
+    default: {
+      opt_scope_t scope;
+      opt_scope(&scope, NULL, INT_MAX);
+      
+      if (body->node_type != S_DECL)
+        opt_decl(&vc.opt, &scope, body);
+      
+      opt_vec_stmt(&vc, &scope, head);
+      opt_scope_free(&scope);
+      break;
+    }
+    }
+  }
+  
+  if (vc.f32)
+    node = opt_vec_native(vc.lexeme, TK_F32, node);
+  if (vc.i32)
+    node = opt_vec_native(vc.lexeme, TK_I32, node);
+  
+  if (report)
+    printf("opt: vec: ran %i loops with array kernels\n", vc.num_loop);
+  
+  opt_free(&vc.opt);
+  
+  return node;
+}
+
+static void opt_vec_fn(vec_t *vc, s_node_t *fn, const s_node_t *class_def)
+{
+  const s_node_t *param_decl = NULL;
+  s_node_t *body = NULL;
+  
+  if (fn->node_type == S_FN) {
+    param_decl = fn->fn.param_decl;
+    body = fn->fn.body;
+  } else {
+    param_decl = fn->class_new.param_decl;
+    body = fn->class_new.body;
+  }
+  
+  if (!body)
+    return;
+  
+  opt_scope_t scope;
+  opt_scope(&scope, class_def, INT_MAX);
+  opt_param(&vc->opt, &scope, param_decl);
+  opt_decl(&vc->opt, &scope, body);
+  
+  for (s_node_t *head = body; head; head = head->stmt.next)
+    opt_vec_stmt(vc, &scope, head);
+  
+  opt_scope_free(&scope);
+}
+
+static void opt_vec_stmt(vec_t *vc, const opt_scope_t *scope, s_node_t *stmt)
+{
+  s_node_t *body = stmt->stmt.body;
+  
+  switch (body->node_type) {
+  case S_IF_STMT:
+    for (s_node_t *head = body->if_stmt.body; head; head = head->stmt.next)
+      opt_vec_stmt(vc, scope, head);
+    for (s_node_t *head = body->if_stmt.next; head; head = head->stmt.next)
+      opt_vec_stmt(vc, scope, head);
+    break;
+  case S_WHILE_STMT:
+    for (s_node_t *head = body->while_stmt.body; head; head = head->stmt.next)
+      opt_vec_stmt(vc, scope, head);
+    break;
+  case S_FOR_STMT:
+    for (s_node_t *head = body->for_stmt.body; head; head = head->stmt.next)
+      opt_vec_stmt(vc, scope, head);
+    stmt->stmt.body = opt_vec_loop(vc, scope, body);
+    break;
+  default:
+    break;
+  }
+}
+
+// 'for (i32 i = lo; i < hi; i++) a[i] op= ...;', where lo is a constant, hi
+// is computed from names and lengths and each element read is at 'i'. as
+// the store can not change anything else the loop reads, and each element
+// only depends on those at the same index, running the program a block of
+// elements at a time stores what the loop would.
+static s_node_t *opt_vec_loop(vec_t *vc, const opt_scope_t *scope, s_node_t *node)
+{
+  const s_node_t *decl = node->for_stmt.decl ? node->for_stmt.decl->stmt.body : NULL;
+  const s_node_t *cond = node->for_stmt.cond;
+  const s_node_t *inc = node->for_stmt.inc;
+  const s_node_t *body = node->for_stmt.body;
+  
+  if (!decl || decl->node_type != S_DECL || !decl->decl.init)
+    return node;
+  
+  if (decl->decl.type->type.spec->token != TK_I32 || decl->decl.type->type.left_bracket)
+    return node;
+  
+  int lo = 0;
+  if (!opt_licm_int(decl->decl.init, &lo))
+    return node;
+  
+  vec_loop_t loop = { 0 };
+  loop.counter = decl->decl.ident->data.ident;
+  
+  if (!inc || inc->node_type != S_POST_OP || inc->post_op.op->token != TK_INC || !opt_licm_is(inc->post_op.lhs, loop.counter))
+    return node;
+  
+  if (cond->node_type != S_BINOP || cond->binop.op->token != '<' || !opt_licm_is(cond->binop.lhs, loop.counter))
+    return node;
+  
+  if (!opt_vec_bound(vc, scope, &loop, cond->binop.rhs))
+    return node;
+  
+  if (!body || body->stmt.next || body->stmt.body->node_type != S_BINOP || !opt_assign(body->stmt.body))
+    return node;
+  
+  const s_node_t *store = body->stmt.body;
+  const s_node_t *lhs = store->binop.lhs;
+  token_t op = store->binop.op->token;
+  
+  if (lhs->node_type != S_INDEX || !opt_licm_is(lhs->index.index, loop.counter))
+    return node;
+  
+  opt_type_t type;
+  if (!opt_type(&vc->opt, scope, lhs, &type) || (type.spec != TK_F32 && type.spec != TK_I32) || type.class)
+    return node;
+  
+  loop.spec = type.spec;
+  
+  // the array stored to is the first, which 'op=' reads before the rest
+  const s_node_t *dst = lhs->index.base;
+  if (dst->node_type != S_CONSTANT || dst->constant.lexeme->token != TK_IDENTIFIER || opt_licm_is(dst, loop.counter))
+    return node;
+  
+  loop.array[loop.num_array++] = dst;
+  
+  if (op != '=' && !opt_vec_op(&loop, 'a'))
+    return node;
+  
+  if (!opt_vec_expr(vc, scope, &loop, store->binop.rhs))
+    return node;
+  
+  if (op != '=') {
+    char binop = "+-*/"[op - TK_ADD_ASSIGN];
+    if ((binop == '/' && loop.spec == TK_I32) || !opt_vec_op(&loop, binop))
+      return node;
+  }
+  
+  if (!vc->lexeme)
+    vc->lexeme = cond->binop.op;
+  
+  if (loop.spec == TK_F32)
+    vc->f32 = true;
+  else
+    vc->i32 = true;
+  
+  vc->num_loop++;
+  
+  if (vc->report) {
+    printf(
+      "opt: vec: %s:%i: ran a loop over %i arrays as '%s'\n",
+      cond->binop.op->src,
+      cond->binop.op->line,
+      loop.num_array,
+      loop.prog);
+  }
+  
+  return opt_vec_call(&loop, node);
+}
+
+// ops other than those on the counter's elements are of the loop's type, so
+// each is rounded as in the loop. i32 names and constants are only cast to
+// f32 where they are read, as they would be.
+static bool opt_vec_expr(const vec_t *vc, const opt_scope_t *scope, vec_loop_t *loop, const s_node_t *node)
+{
+  opt_type_t type;
+  
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return opt_vec_scalar(vc, scope, loop, node);
+  case S_INDEX:
+    return opt_licm_is(node->index.index, loop->counter) && opt_vec_array(vc, scope, loop, node->index.base);
+  case S_UNARY:
+    if (node->unary.op->token != '-' || !opt_type(&vc->opt, scope, node, &type) || type.spec != loop->spec)
+      return false;
+    return opt_vec_expr(vc, scope, loop, node->unary.rhs) && opt_vec_op(loop, '~');
+  case S_BINOP: {
+    token_t op = node->binop.op->token;
+    
+    if (op != '+' && op != '-' && op != '*' && (op != '/' || loop->spec != TK_F32))
+      return false;
+    
+    if (!opt_type(&vc->opt, scope, node, &type) || type.spec != loop->spec)
+      return false;
+    
+    return opt_vec_expr(vc, scope, loop, node->binop.lhs)
+      && opt_vec_expr(vc, scope, loop, node->binop.rhs)
+      && opt_vec_op(loop, op);
+  }
+  default:
+    return false;
+  }
+}
+
+// an array named by a local or global of the loop's type
+static bool opt_vec_array(const vec_t *vc, const opt_scope_t *scope, vec_loop_t *loop, const s_node_t *node)
+{
+  if (node->node_type != S_CONSTANT || node->constant.lexeme->token != TK_IDENTIFIER || opt_licm_is(node, loop->counter))
+    return false;
+  
+  opt_type_t type;
+  if (!opt_type(&vc->opt, scope, node, &type) || !type.arr || type.spec != loop->spec || type.class)
+    return false;
+  
+  int slot = 0;
+  while (slot < loop->num_array && !opt_equal(loop->array[slot], node))
+    slot++;
+  
+  if (slot == loop->num_array) {
+    if (slot == OPT_VEC_ARRAY)
+      return false;
+    loop->array[loop->num_array++] = node;
+  }
+  
+  return opt_vec_op(loop, 'a' + slot);
+}
+
+// a constant or a name which is not the counter, read once for the loop
+static bool opt_vec_scalar(const vec_t *vc, const opt_scope_t *scope, vec_loop_t *loop, const s_node_t *node)
+{
+  if (opt_licm_is(node, loop->counter))
+    return false;
+  
+  opt_type_t type;
+  if (!opt_type(&vc->opt, scope, node, &type) || type.arr)
+    return false;
+  
+  if (type.spec != TK_I32 && (type.spec != TK_F32 || loop->spec != TK_F32))
+    return false;
+  
+  int slot = 0;
+  while (slot < loop->num_scalar && !opt_equal(loop->scalar[slot], node))
+    slot++;
+  
+  if (slot == loop->num_scalar) {
+    if (slot == OPT_VEC_SCALAR)
+      return false;
+    loop->scalar[loop->num_scalar++] = node;
+  }
+  
+  return opt_vec_op(loop, 'p' + slot);
+}
+
+// the bound is computed once for the call, from what the loop can not change
+static bool opt_vec_bound(const vec_t *vc, const opt_scope_t *scope, const vec_loop_t *loop, const s_node_t *node)
+{
+  opt_type_t type;
+  if (!opt_type(&vc->opt, scope, node, &type) || type.arr || type.spec != TK_I32)
+    return false;
+  
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return !opt_licm_is(node, loop->counter);
+  case S_DIRECT:
+    return node->direct.base->node_type == S_CONSTANT && !opt_licm_is(node->direct.base, loop->counter);
+  case S_BINOP:
+    if (node->binop.op->token != '+' && node->binop.op->token != '-')
+      return false;
+    return opt_vec_bound(vc, scope, loop, node->binop.lhs) && opt_vec_bound(vc, scope, loop, node->binop.rhs);
+  default:
+    return false;
+  }
+}
+
+static bool opt_vec_op(vec_loop_t *loop, char op)
+{
+  if (loop->len == OPT_VEC_PROG)
+    return false;
+  
+  loop->prog[loop->len++] = op;
+  loop->prog[loop->len] = '\0';
+  
+  return true;
+}
+
+// 'if (!__vec_f32("prog", a, b, c, d, p, q, r, s, lo, hi)) for (...) ...;'.
+// slots the program does not read are passed the first array or 'lo'.
+static s_node_t *opt_vec_call(const vec_loop_t *loop, s_node_t *node)
+{
+  const lexeme_t *where = node->for_stmt.cond->binop.op;
+  const s_node_t *lo = node->for_stmt.decl->stmt.body->decl.init;
+  const s_node_t *hi = node->for_stmt.cond->binop.rhs;
+  
+  s_node_t *value[11];
+  
+  value[0] = opt_node(S_CONSTANT);
+  value[0]->constant.lexeme = opt_lexeme(where, TK_STRING_LITERAL, loop->prog);
+  
+  for (int i = 0; i < OPT_VEC_ARRAY; i++)
+    value[1 + i] = opt_copy(loop->array[i < loop->num_array ? i : 0], NULL, NULL, NULL);
+  
+  for (int i = 0; i < OPT_VEC_SCALAR; i++)
+    value[5 + i] = opt_copy(i < loop->num_scalar ? loop->scalar[i] : lo, NULL, NULL, NULL);
+  
+  value[9] = opt_copy(lo, NULL, NULL, NULL);
+  value[10] = opt_copy(hi, NULL, NULL, NULL);
+  
+  s_node_t *arg = NULL;
+  for (int i = 10; i >= 0; i--) {
+    s_node_t *head = opt_node(S_ARG);
+    head->arg.body = value[i];
+    head->arg.next = arg;
+    arg = head;
+  }
+  
+  s_node_t *call = opt_node(S_PROC);
+  call->proc.base = opt_ident(opt_lexeme(where, TK_IDENTIFIER, loop->spec == TK_F32 ? "__vec_f32" : "__vec_i32"));
+  call->proc.arg = arg;
+  call->proc.left_bracket = opt_lexeme(where, '(', NULL);
+  
+  s_node_t *cond = opt_node(S_UNARY);
+  cond->unary.op = opt_lexeme(where, '!', NULL);
+  cond->unary.rhs = call;
+  
+  s_node_t *body = opt_node(S_STMT);
+  body->stmt.body = node;
+  
+  s_node_t *if_stmt = opt_node(S_IF_STMT);
+  if_stmt->if_stmt.cond = cond;
+  if_stmt->if_stmt.body = body;
+  
+  return if_stmt;
+}
+
+// 'fn __vec_f32(string prog, f32[] a, ..., f32 p, ..., i32 lo, i32 hi) : i32;'
+static s_node_t *opt_vec_native(const lexeme_t *where, token_t spec, s_node_t *node)
+{
+  static const char *ident[] = { "prog", "a", "b", "c", "d", "p", "q", "r", "s", "lo", "hi" };
+  
+  s_node_t *param_decl = NULL;
+  for (int i = 10; i >= 0; i--) {
+    s_node_t *type = opt_node(S_TYPE);
+    type->type.spec = opt_lexeme(where, i == 0 ? TK_STRING : i < 9 ? spec : TK_I32, NULL);
+    
+    if (i >= 1 && i <= 4)
+      type->type.left_bracket = opt_lexeme(where, '[', NULL);
+    
+    s_node_t *head = opt_node(S_PARAM_DECL);
+    head->param_decl.type = type;
+    head->param_decl.ident = opt_lexeme(where, TK_IDENTIFIER, ident[i]);
+    head->param_decl.next = param_decl;
+    param_decl = head;
+  }
+  
+  s_node_t *type = opt_node(S_TYPE);
+  type->type.spec = opt_lexeme(where, TK_I32, NULL);
+  
+  s_node_t *fn = opt_node(S_FN);
+  fn->fn.fn_ident = opt_lexeme(where, TK_IDENTIFIER, spec == TK_F32 ? "__vec_f32" : "__vec_i32");
+  fn->fn.param_decl = param_decl;
+  fn->fn.type = type;
+  
+  s_node_t *stmt = opt_node(S_STMT);
+  stmt->stmt.body = fn;
+  stmt->stmt.next = node;
+  
+  return stmt;
+}
+
+// bodies the parser skipped are parsed here. top-level statements are one
+// list, cut into runs by functions and classes as by branches, and a load
+// reused there is kept in a global.
+static s_node_t *opt_cse(s_node_t *node, bool report)
+{
+  cse_t cs;
+  opt_scan(&cs.opt, node);
+  cs.num_load = 0;
+  cs.stmt = NULL;
+  cs.num_temp = 0;
+  cs.num_expr = 0;
+  cs.num_reuse = 0;
+  cs.report = report;
+  
+  for (s_node_t *head = node; head; head = head->stmt.next) {
+    s_node_t *body = head->stmt.body;
+    
+    switch (body->node_type) {
+    case S_FN:
+      opt_cse_fn(&cs, body, NULL);
+      break;
+    case S_CLASS_DEF:
+      for (s_node_t *decl = body->class_def.class_decl; decl; decl = decl->stmt.next) {
+        if (decl->stmt.body->node_type == S_FN || decl->stmt.body->node_type == S_CLASS_NEW)
+          opt_cse_fn(&cs, decl->stmt.body, body);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  
+  opt_scope_t scope;
+  opt_scope(&scope, NULL, INT_MAX);
+  opt_decl(&cs.opt, &scope, node);
+  opt_cse_block(&cs, &scope, &node);
+  opt_scope_free(&scope);
+  
+  if (report) {
+    printf(
+      "opt: cse: reused %i loads of %i expressions\n",
+      cs.num_reuse,
+      cs.num_expr);
+  }
+  
+  opt_free(&cs.opt);
+  
+  return node;
+}
+
+static void opt_cse_fn(cse_t *cs, s_node_t *fn, const s_node_t *class_def)
+{
+  const s_node_t *param_decl = NULL;
+  s_node_t **link = NULL;
+  
+  if (fn->node_type == S_FN) {
+    param_decl = fn->fn.param_decl;
+    link = &fn->fn.body;
+  } else {
+    param_decl = fn->class_new.param_decl;
+    link = &fn->class_new.body;
+  }
+  
+  if (!s_lazy_body(fn))
+    return;
+  
+  opt_scope_t scope;
+  opt_scope(&scope, class_def, INT_MAX);
+  opt_param(&cs->opt, &scope, param_decl);
+  opt_decl(&cs->opt, &scope, *link);
+  
+  opt_cse_block(cs, &scope, link);
+  
+  opt_scope_free(&scope);
+}
+
+// a statement list is cut into runs of straight-line statements by those
+// which branch, whose bodies are lists of their own
+static void opt_cse_block(cse_t *cs, opt_scope_t *scope, s_node_t **link)
+{
+  s_node_t **start = link;
+  
+  while (*link) {
+    s_node_t *stmt = *link;
+    
+    if (opt_cse_straight(stmt->stmt.body)) {
+      link = &stmt->stmt.next;
+      continue;
+    }
+    
+    opt_cse_run(cs, scope, start, stmt);
+    opt_cse_nested(cs, scope, stmt->stmt.body);
+    
+    start = link = &stmt->stmt.next;
+  }
+  
+  opt_cse_run(cs, scope, start, NULL);
+}
+
+static void opt_cse_nested(cse_t *cs, opt_scope_t *scope, s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_IF_STMT:
+    opt_cse_block(cs, scope, &node->if_stmt.body);
+    opt_cse_block(cs, scope, &node->if_stmt.next);
+    break;
+  case S_WHILE_STMT:
+    opt_cse_block(cs, scope, &node->while_stmt.body);
+    break;
+  case S_FOR_STMT:
+    opt_cse_block(cs, scope, &node->for_stmt.body);
+    break;
+  default:
+    break;
+  }
+}
+
+// the statements from link up to end, and the condition of end if it is an
+// if or the value of a return, as that is evaluated right after them. the
+// largest load with reuses is kept in a temporary, then the run is walked
+// again for the next.
+static void opt_cse_run(cse_t *cs, opt_scope_t *scope, s_node_t **link, const s_node_t *end)
+{
+  while (true) {
+    cs->num_load = 0;
+    
+    s_node_t **head = link;
+    for (; *head != end; head = &(*head)->stmt.next) {
+      cs->stmt = head;
+      opt_cse_stmt(cs, scope, &(*head)->stmt.body);
+    }
+    
+    if (end) {
+      cs->stmt = head;
+      if (end->stmt.body->node_type == S_IF_STMT)
+        opt_cse_expr(cs, scope, &end->stmt.body->if_stmt.cond);
+      else if (end->stmt.body->node_type == S_RET_STMT)
+        opt_cse_expr(cs, scope, &end->stmt.body->ret_stmt.body);
+    }
+    
+    cse_load_t *best = NULL;
+    for (int i = 0; i < cs->num_load; i++) {
+      if (cs->load[i].num_use > 0 && (!best || cs->load[i].size > best->size))
+        best = &cs->load[i];
+    }
+    
+    if (!best)
+      break;
+    
+    opt_cse_reuse(cs, scope, best);
+  }
+}
+
+static void opt_cse_stmt(cse_t *cs, const opt_scope_t *scope, s_node_t **link)
+{
+  s_node_t *node = *link;
+  
+  switch (node->node_type) {
+  case S_DECL:
+    opt_cse_expr(cs, scope, &node->decl.init);
+    opt_cse_kill(cs, node->decl.ident->data.ident, NULL, false);
+    break;
+  case S_PRINT:
+    opt_cse_expr(cs, scope, &node->print.arg);
+    break;
+  default:
+    opt_cse_expr(cs, scope, link);
+    break;
+  }
+}
+
+// in the order the interpreter and compilers evaluate it
+static void opt_cse_expr(cse_t *cs, const opt_scope_t *scope, s_node_t **node)
+{
+  if (!node || !*node)
+    return;
+  
+  s_node_t *body = *node;
+  
+  switch (body->node_type) {
+  case S_BINOP:
+    if (opt_assign(body)) {
+      opt_cse_target(cs, scope, body->binop.lhs);
+      opt_cse_expr(cs, scope, &body->binop.rhs);
+      opt_cse_store(cs, body->binop.lhs);
+    } else {
+      opt_cse_expr(cs, scope, &body->binop.lhs);
+      opt_cse_expr(cs, scope, &body->binop.rhs);
+    }
+    break;
+  case S_POST_OP:
+    opt_cse_target(cs, scope, body->post_op.lhs);
+    opt_cse_store(cs, body->post_op.lhs);
+    break;
+  case S_UNARY:
+    opt_cse_expr(cs, scope, &body->unary.rhs);
+    break;
+  case S_DIRECT:
+    if (opt_cse_use(cs, scope, node))
+      return;
+    opt_cse_expr(cs, scope, &body->direct.base);
+    break;
+  case S_INDEX:
+    if (opt_cse_use(cs, scope, node))
+      return;
+    opt_cse_expr(cs, scope, &body->index.base);
+    opt_cse_expr(cs, scope, &body->index.index);
+    break;
+  case S_PROC:
+    if (body->proc.base->node_type == S_DIRECT)
+      opt_cse_expr(cs, scope, &body->proc.base->direct.base);
+    
+    opt_cse_expr(cs, scope, &body->proc.arg);
+    
+    // script functions may write anything
+    if (!opt_native(&cs->opt, body))
+      opt_cse_kill(cs, NULL, NULL, false);
+    break;
+  case S_ARG:
+    for (; body; body = body->arg.next)
+      opt_cse_expr(cs, scope, &body->arg.body);
+    break;
+  case S_ARRAY_INIT:
+    opt_cse_expr(cs, scope, &body->array_init.size);
+    opt_cse_expr(cs, scope, &body->array_init.init);
+    break;
+  default:
+    break;
+  }
+}
+
+// what is read to find where an assignment stores
+static void opt_cse_target(cse_t *cs, const opt_scope_t *scope, s_node_t *lhs)
+{
+  if (lhs->node_type == S_DIRECT) {
+    opt_cse_expr(cs, scope, &lhs->direct.base);
+  } else if (lhs->node_type == S_INDEX) {
+    opt_cse_expr(cs, scope, &lhs->index.base);
+    opt_cse_expr(cs, scope, &lhs->index.index);
+  }
+}
+
+// a store to a member may change that member of any object, and a store to
+// an element any element
+static void opt_cse_store(cse_t *cs, const s_node_t *lhs)
+{
+  switch (lhs->node_type) {
+  case S_CONSTANT:
+    if (lhs->constant.lexeme->token == TK_IDENTIFIER)
+      opt_cse_kill(cs, lhs->constant.lexeme->data.ident, NULL, false);
+    break;
+  case S_DIRECT:
+    opt_cse_kill(cs, NULL, lhs->direct.child_ident->data.ident, false);
+    break;
+  case S_INDEX:
+    opt_cse_kill(cs, NULL, NULL, true);
+    break;
+  default:
+    opt_cse_kill(cs, NULL, NULL, false);
+    break;
+  }
+}
+
+// records a load as a reuse of an earlier one or as a new one. a new load
+// is walked into for the loads it is made of, a reuse is not.
+static bool opt_cse_use(cse_t *cs, const opt_scope_t *scope, s_node_t **node)
+{
+  int size = opt_cse_size(*node);
+  if (size == 0)
+    return false;
+  
+  for (int i = 0; i < cs->num_load; i++) {
+    cse_load_t *load = &cs->load[i];
+    
+    if (load->live && opt_equal(*load->def, *node)) {
+      if (load->num_use == OPT_CSE_USE)
+        return false;
+      
+      load->use[load->num_use++] = node;
+      return true;
+    }
+  }
+  
+  if (cs->num_load == OPT_CSE_MAX)
+    return false;
+  
+  opt_type_t type;
+  if (!opt_type(&cs->opt, scope, *node, &type))
+    return false;
+  
+  if (type.spec != TK_I32 && type.spec != TK_F32 && type.spec != TK_STRING && type.spec != TK_CLASS)
+    return false;
+  
+  if (type.spec == TK_CLASS && (!type.class || !map_get(&cs->opt.class, type.class)))
+    return false;
+  
+  cse_load_t *load = &cs->load[cs->num_load++];
+  load->def = node;
+  load->stmt = cs->stmt;
+  load->num_use = 0;
+  load->size = size;
+  load->type = type;
+  load->live = true;
+  
+  return false;
+}
+
+// 'T __cseN;' before the statement of the first load, which becomes
+// '(__cseN = load)', and the reuses read __cseN
+static void opt_cse_reuse(cse_t *cs, opt_scope_t *scope, cse_load_t *load)
+{
+  const lexeme_t *where = opt_where(*load->def);
+  
+  s_node_t *decl = opt_temp(&cs->opt, scope, &cs->num_temp, where, &load->type, "__cse");
+  
+  s_node_t *stmt = opt_node(S_STMT);
+  stmt->stmt.body = decl;
+  stmt->stmt.next = *load->stmt;
+  *load->stmt = stmt;
+  
+  s_node_t *assign = opt_node(S_BINOP);
+  assign->binop.lhs = opt_ident(decl->decl.ident);
+  assign->binop.op = opt_lexeme(where, '=', NULL);
+  assign->binop.rhs = *load->def;
+  *load->def = assign;
+  
+  for (int i = 0; i < load->num_use; i++) {
+    s_free(*load->use[i]);
+    *load->use[i] = opt_ident(decl->decl.ident);
+  }
+  
+  cs->num_expr++;
+  cs->num_reuse += load->num_use;
+  
+  if (cs->report) {
+    printf(
+      "opt: cse: %s:%i: reused %i loads\n",
+      where->src,
+      where->line,
+      load->num_use);
+  }
+}
+
+// loads which read a name, a member or any element can not be reused past
+// here, all of them if none is given
+static void opt_cse_kill(cse_t *cs, const char *ident, const char *member, bool index)
+{
+  for (int i = 0; i < cs->num_load; i++) {
+    if ((!ident && !member && !index) || opt_cse_reads(*cs->load[i].def, ident, member, index))
+      cs->load[i].live = false;
+  }
+}
+
+static bool opt_cse_reads(const s_node_t *node, const char *ident, const char *member, bool index)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return ident
+      && node->constant.lexeme->token == TK_IDENTIFIER
+      && strcmp(node->constant.lexeme->data.ident, ident) == 0;
+  case S_UNARY:
+    return opt_cse_reads(node->unary.rhs, ident, member, index);
+  case S_BINOP:
+    return opt_cse_reads(node->binop.lhs, ident, member, index)
+      || opt_cse_reads(node->binop.rhs, ident, member, index);
+  case S_DIRECT:
+    if (member && strcmp(node->direct.child_ident->data.ident, member) == 0)
+      return true;
+    return opt_cse_reads(node->direct.base, ident, member, index);
+  case S_INDEX:
+    return index
+      || opt_cse_reads(node->index.base, ident, member, index)
+      || opt_cse_reads(node->index.index, ident, member, index);
+  default:
+    return true;
+  }
+}
+
+// the number of nodes in a member or element read made of names, constants,
+// arithmetic and other such reads, 0 for anything else
+static int opt_cse_size(const s_node_t *node)
+{
+  int lhs = 0;
+  int rhs = 0;
+  
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return 1;
+  case S_UNARY:
+    lhs = opt_cse_size(node->unary.rhs);
+    return lhs > 0 ? lhs + 1 : 0;
+  case S_BINOP:
+    if (opt_assign(node))
+      return 0;
+    lhs = opt_cse_size(node->binop.lhs);
+    rhs = opt_cse_size(node->binop.rhs);
+    return lhs > 0 && rhs > 0 ? lhs + rhs + 1 : 0;
+  case S_DIRECT:
+    lhs = opt_cse_size(node->direct.base);
+    return lhs > 0 ? lhs + 1 : 0;
+  case S_INDEX:
+    lhs = opt_cse_size(node->index.base);
+    rhs = opt_cse_size(node->index.index);
+    return lhs > 0 && rhs > 0 ? lhs + rhs + 1 : 0;
+  default:
+    return 0;
+  }
+}
+
+// statements which do not branch
+static bool opt_cse_straight(const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_IF_STMT:
+  case S_WHILE_STMT:
+  case S_FOR_STMT:
+  case S_RET_STMT:
+  case S_CTRL_STMT:
+  case S_FN:
+  case S_CLASS_DEF:
+    return false;
+  default:
+    return true;
+  }
+}
+
+static void opt_scan(opt_t *opt, const s_node_t *node)
+{
+  map_new(&opt->fn);
+  map_new(&opt->class);
+  map_new(&opt->global);
+  map_new(&opt->dup);
+  
+  for (const s_node_t *head = node; head; head = head->stmt.next) {
+    s_node_t *body = head->stmt.body;
+    
+    switch (body->node_type) {
+    case S_FN:
+      if (!map_put(&opt->fn, body->fn.fn_ident->data.ident, body))
+        opt_use_ident(&opt->dup, body->fn.fn_ident->data.ident);
+      break;
+    case S_DECL:
+      if (!map_put(&opt->global, body->decl.ident->data.ident, body->decl.type))
+        opt_use_ident(&opt->dup, body->decl.ident->data.ident);
+      break;
+    case S_CLASS_DEF:
+      if (!map_put(&opt->class, body->class_def.ident->data.ident, body))
+        opt_use_ident(&opt->dup, body->class_def.ident->data.ident);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+static void opt_free(opt_t *opt)
+{
+  map_flush(&opt->fn, _no_free);
+  map_flush(&opt->class, _no_free);
+  map_flush(&opt->global, _no_free);
+  map_flush(&opt->dup, _no_free);
+}
+
+static void opt_scope(opt_scope_t *scope, const s_node_t *class_def, int stmt)
+{
+  map_new(&scope->var);
+  map_new(&scope->clash);
+  scope->class_def = class_def;
+  scope->stmt = stmt;
+}
+
+static void opt_scope_free(opt_scope_t *scope)
+{
+  map_flush(&scope->var, _no_free);
+  map_flush(&scope->clash, _no_free);
+}
+
+static void opt_param(const opt_t *opt, opt_scope_t *scope, const s_node_t *param_decl)
+{
+  for (const s_node_t *head = param_decl; head; head = head->param_decl.next)
+    opt_bind(opt, scope, head->param_decl.ident->data.ident, head->param_decl.type);
+}
+
+// every name declared anywhere in a body, those declared twice with
+// different types are not typed
+static void opt_decl(const opt_t *opt, opt_scope_t *scope, const s_node_t *node)
+{
+  if (!node)
+    return;
+  
+  switch (node->node_type) {
+  case S_STMT:
+    for (; node; node = node->stmt.next)
+      opt_decl(opt, scope, node->stmt.body);
+    break;
+  case S_DECL:
+    opt_bind(opt, scope, node->decl.ident->data.ident, node->decl.type);
+    break;
+  case S_IF_STMT:
+    opt_decl(opt, scope, node->if_stmt.body);
+    opt_decl(opt, scope, node->if_stmt.next);
+    break;
+  case S_WHILE_STMT:
+    opt_decl(opt, scope, node->while_stmt.body);
+    break;
+  case S_FOR_STMT:
+    opt_decl(opt, scope, node->for_stmt.decl);
+    opt_decl(opt, scope, node->for_stmt.body);
+    break;
+  case S_FN:
+    opt_bind(opt, scope, node->fn.fn_ident->data.ident, NULL);
+    break;
+  default:
+    break;
+  }
+}
+
+static void opt_bind(const opt_t *opt, opt_scope_t *scope, const char *ident, const s_node_t *type)
+{
+  if (map_get(&scope->clash, ident))
+    return;
+  
+  const s_node_t *prev = map_get(&scope->var, ident);
+  if (!prev) {
+    if (type)
+      map_put(&scope->var, ident, (void*) type);
+    else
+      opt_use_ident(&scope->clash, ident);
+    return;
+  }
+  
+  opt_type_t a;
+  opt_type_t b;
+  opt_spec(prev, &a);
+  
+  if (type)
+    opt_spec(type, &b);
+  
+  if (!type || !opt_cmp(&a, &b))
+    opt_use_ident(&scope->clash, ident);
+}
+
+// the type an expression has in the interpreter, without any casts
+static bool opt_type(const opt_t *opt, const opt_scope_t *scope, const s_node_t *node, opt_type_t *type)
+{
+  *type = (opt_type_t) { 0, false, NULL };
+  
+  switch (node->node_type) {
+  case S_CONSTANT:
+    switch (node->constant.lexeme->token) {
+    case TK_CONST_INTEGER:
+      type->spec = TK_I32;
+      return true;
+    case TK_CONST_FLOAT:
+      type->spec = TK_F32;
+      return true;
+    case TK_STRING_LITERAL:
+      type->spec = TK_STRING;
+      return true;
+    case TK_IDENTIFIER:
+      return opt_var(opt, scope, node->constant.lexeme->data.ident, type);
+    default:
+      return false;
+    }
+  case S_UNARY:
+    if (!opt_type(opt, scope, node->unary.rhs, type) || type->arr)
+      return false;
+    
+    if (node->unary.op->token == '-')
+      return type->spec == TK_I32 || type->spec == TK_F32;
+    
+    return node->unary.op->token == '!' && type->spec == TK_I32;
+  case S_BINOP: {
+    if (opt_assign(node))
+      return false;
+    
+    opt_type_t lhs;
+    opt_type_t rhs;
+    if (!opt_type(opt, scope, node->binop.lhs, &lhs) || !opt_type(opt, scope, node->binop.rhs, &rhs))
+      return false;
+    
+    if (lhs.arr || rhs.arr)
+      return false;
+    
+    token_t op = node->binop.op->token;
+    
+    if (lhs.spec == TK_I32 && rhs.spec == TK_I32) {
+      type->spec = TK_I32;
+      return true;
+    }
+    
+    if ((lhs.spec == TK_I32 || lhs.spec == TK_F32) && (rhs.spec == TK_I32 || rhs.spec == TK_F32)) {
+      if (op == '+' || op == '-' || op == '*' || op == '/')
+        type->spec = TK_F32;
+      else if (op == '<' || op == '>' || op == TK_LE || op == TK_GE || op == TK_EQ || op == TK_NE)
+        type->spec = TK_I32;
+      else
+        return false;
+      return true;
+    }
+    
+    if (lhs.spec == TK_STRING && rhs.spec == TK_STRING && op == '+') {
+      type->spec = TK_STRING;
+      return true;
+    }
+    
+    return false;
+  }
+  case S_DIRECT: {
+    opt_type_t base;
+    if (!opt_type(opt, scope, node->direct.base, &base))
+      return false;
+    
+    const char *ident = node->direct.child_ident->data.ident;
+    
+    if (base.arr) {
+      type->spec = TK_I32;
+      return strcmp(ident, "length") == 0 || strcmp(ident, "capacity") == 0;
+    }
+    
+    if (base.spec != TK_CLASS || map_get(&opt->dup, base.class))
+      return false;
+    
+    const s_node_t *class_def = map_get(&opt->class, base.class);
+    if (!class_def)
+      return false;
+    
+    for (const s_node_t *decl = class_def->class_def.class_decl; decl; decl = decl->stmt.next) {
+      const s_node_t *body = decl->stmt.body;
+      if (body->node_type == S_DECL && strcmp(body->decl.ident->data.ident, ident) == 0) {
+        opt_spec(body->decl.type, type);
+        return true;
+      }
+    }
+    
+    return false;
+  }
+  case S_INDEX: {
+    opt_type_t index;
+    if (!opt_type(opt, scope, node->index.index, &index) || index.spec != TK_I32 || index.arr)
+      return false;
+    
+    if (!opt_type(opt, scope, node->index.base, type) || !type->arr)
+      return false;
+    
+    type->arr = false;
+    return true;
+  }
+  case S_PROC: {
+    for (const s_node_t *arg = node->proc.arg; arg; arg = arg->arg.next) {
+      opt_type_t arg_type;
+      if (!opt_type(opt, scope, arg->arg.body, &arg_type))
+        return false;
+    }
+    
+    const s_node_t *base = node->proc.base;
+    
+    switch (base->node_type) {
+    case S_CONSTANT: {
+      if (base->constant.lexeme->token != TK_IDENTIFIER)
+        return false;
+      
+      const char *ident = base->constant.lexeme->data.ident;
+      if (opt_bound(opt, scope, ident) || map_get(&opt->dup, ident))
+        return false;
+      
+      const s_node_t *fn = map_get(&opt->fn, ident);
+      return fn && opt_ret(fn, type);
+    }
+    case S_DIRECT: {
+      opt_type_t class;
+      if (!opt_type(opt, scope, base->direct.base, &class) || class.spec != TK_CLASS || class.arr)
+        return false;
+      
+      const s_node_t *class_def;
+      const s_node_t *fn = opt_method(opt, class.class, base->direct.child_ident->data.ident, &class_def);
+      return fn && opt_ret(fn, type);
+    }
+    case S_NEW: {
+      const char *ident = base->new.class_ident->data.ident;
+      const s_node_t *class_def = map_get(&opt->class, ident);
+      if (!class_def || map_get(&opt->dup, ident))
+        return false;
+      
+      token_t spec = class_def->class_def.spec->token == TK_STRUCT_DEF ? TK_STRUCT : TK_CLASS;
+      *type = (opt_type_t) { spec, false, ident };
+      return true;
+    }
+    default:
+      return false;
+    }
+  }
+  default:
+    return false;
+  }
+}
+
+// locals are only typed if any global of the same name has the same type,
+// as a use before the declaration still names the global
+static bool opt_var(const opt_t *opt, const opt_scope_t *scope, const char *ident, opt_type_t *type)
+{
+  if (map_get(&scope->clash, ident))
+    return false;
+  
+  const s_node_t *global = map_get(&opt->dup, ident) ? NULL : map_get(&opt->global, ident);
+  
+  const s_node_t *decl = map_get(&scope->var, ident);
+  if (decl) {
+    opt_spec(decl, type);
+    
+    if (global) {
+      opt_type_t global_type;
+      opt_spec(global, &global_type);
+      return opt_cmp(type, &global_type);
+    }
+    
+    return true;
+  }
+  
+  if (scope->class_def && strcmp(ident, "this") == 0) {
+    *type = (opt_type_t) { TK_CLASS, false, scope->class_def->class_def.ident->data.ident };
+    return true;
+  }
+  
+  if (!global)
+    return false;
+  
+  opt_spec(global, type);
+  
+  return true;
+}
+
+static bool opt_bound(const opt_t *opt, const opt_scope_t *scope, const char *ident)
+{
+  if (map_get(&scope->var, ident) || map_get(&scope->clash, ident) || map_get(&opt->global, ident))
+    return true;
+  
+  return scope->class_def && strcmp(ident, "this") == 0;
+}
+
+// locals can not be assigned by the functions a call makes
+static bool opt_local(const opt_scope_t *scope, const char *ident)
+{
+  if (map_get(&scope->var, ident) || map_get(&scope->clash, ident))
+    return true;
+  
+  return scope->class_def && strcmp(ident, "this") == 0;
+}
+
+static bool opt_ret(const s_node_t *fn, opt_type_t *type)
+{
+  if (!fn->fn.type)
+    return false;
+  
+  opt_spec(fn->fn.type, type);
+  
+  return true;
+}
+
+static void opt_spec(const s_node_t *node, opt_type_t *type)
+{
+  type->spec = node->type.spec->token;
+  type->arr = node->type.left_bracket != NULL;
+  type->class = node->type.class_ident ? node->type.class_ident->data.ident : NULL;
+  type->dim = node->type.dim;
+}
+
+static bool opt_cmp(const opt_type_t *a, const opt_type_t *b)
+{
+  // the types a map holds are not kept, so two maps may differ
+  if (a->spec != b->spec || a->arr != b->arr || a->dim != b->dim || a->spec == TK_MAP)
+    return false;
+  
+  return (a->spec != TK_CLASS && a->spec != TK_STRUCT && a->spec != TK_SOA) || strcmp(a->class, b->class) == 0;
+}
+
+// a field of the same name hides a method
+static s_node_t *opt_method(const opt_t *opt, const char *class, const char *ident, const s_node_t **class_def)
+{
+  if (map_get(&opt->dup, class))
+    return NULL;
+  
+  *class_def = map_get(&opt->class, class);
+  if (!*class_def)
+    return NULL;
+  
+  s_node_t *method = NULL;
+  
+  for (s_node_t *decl = (*class_def)->class_def.class_decl; decl; decl = decl->stmt.next) {
+    s_node_t *body = decl->stmt.body;
+    
+    if (body->node_type == S_DECL && strcmp(body->decl.ident->data.ident, ident) == 0)
+      return NULL;
+    
+    if (body->node_type == S_FN && strcmp(body->fn.fn_ident->data.ident, ident) == 0)
+      method = body;
+  }
+  
+  return method;
+}
+
+static int opt_count(const s_node_t *node, const char *ident)
+{
+  if (!node)
+    return 0;
+  
+  switch (node->node_type) {
+  case S_CONSTANT:
+    if (node->constant.lexeme->token != TK_IDENTIFIER)
+      return 0;
+    return strcmp(node->constant.lexeme->data.ident, ident) == 0;
+  case S_UNARY:
+    return opt_count(node->unary.rhs, ident);
+  case S_BINOP:
+    return opt_count(node->binop.lhs, ident) + opt_count(node->binop.rhs, ident);
+  case S_DIRECT:
+    return opt_count(node->direct.base, ident);
+  case S_INDEX:
+    return opt_count(node->index.base, ident) + opt_count(node->index.index, ident);
+  case S_PROC:
+    return opt_count(node->proc.base, ident) + opt_count(node->proc.arg, ident);
+  case S_ARG:
+    return opt_count(node->arg.body, ident) + opt_count(node->arg.next, ident);
+  default:
+    return 0;
+  }
+}
+
+// a copy of an expression with the params and 'this' replaced by copies of
+// the args and the object the method is called on
+static s_node_t *opt_copy(const s_node_t *node, const s_node_t *param_decl, s_node_t **arg, const s_node_t *self)
+{
+  if (!node)
+    return NULL;
+  
+  if (node->node_type == S_CONSTANT && node->constant.lexeme->token == TK_IDENTIFIER) {
+    const char *ident = node->constant.lexeme->data.ident;
+    
+    if (self && strcmp(ident, "this") == 0)
+      return opt_copy(self, NULL, NULL, NULL);
+    
+    int i = 0;
+    for (const s_node_t *head = param_decl; head; head = head->param_decl.next) {
+      if (strcmp(head->param_decl.ident->data.ident, ident) == 0)
+        return opt_copy(arg[i], NULL, NULL, NULL);
+      i++;
+    }
+  }
+  
+  s_node_t *copy = ZONE_ALLOC(sizeof(s_node_t));
+  *copy = *node;
+  
+  switch (node->node_type) {
+  case S_BINOP:
+    copy->binop.lhs = opt_copy(node->binop.lhs, param_decl, arg, self);
+    copy->binop.rhs = opt_copy(node->binop.rhs, param_decl, arg, self);
+    break;
+  case S_UNARY:
+    copy->unary.rhs = opt_copy(node->unary.rhs, param_decl, arg, self);
+    break;
+  case S_DIRECT:
+    copy->direct.base = opt_copy(node->direct.base, param_decl, arg, self);
+    break;
+  case S_INDEX:
+    copy->index.base = opt_copy(node->index.base, param_decl, arg, self);
+    copy->index.index = opt_copy(node->index.index, param_decl, arg, self);
+    break;
+  case S_PROC:
+    copy->proc.base = opt_copy(node->proc.base, param_decl, arg, self);
+    copy->proc.arg = opt_copy(node->proc.arg, param_decl, arg, self);
+    break;
+  case S_ARG:
+    copy->arg.body = opt_copy(node->arg.body, param_decl, arg, self);
+    copy->arg.next = opt_copy(node->arg.next, param_decl, arg, self);
+    break;
+  case S_ARRAY_INIT:
+    copy->array_init.type = opt_copy(node->array_init.type, param_decl, arg, self);
+    copy->array_init.size = opt_copy(node->array_init.size, param_decl, arg, self);
+    copy->array_init.init = opt_copy(node->array_init.init, param_decl, arg, self);
+    break;
+  case S_POST_OP:
+    copy->post_op.lhs = opt_copy(node->post_op.lhs, param_decl, arg, self);
+    break;
+  case S_TYPE:
+    copy->type.key = opt_copy(node->type.key, NULL, NULL, NULL);
+    copy->type.value = opt_copy(node->type.value, NULL, NULL, NULL);
+    break;
+  default:
+    break;
+  }
+  
+  return copy;
+}
+
+static bool opt_equal(const s_node_t *a, const s_node_t *b)
+{
+  if (a->node_type != b->node_type)
+    return false;
+  
+  switch (a->node_type) {
+  case S_CONSTANT: {
+    const lexeme_t *x = a->constant.lexeme;
+    const lexeme_t *y = b->constant.lexeme;
+    
+    if (x->token != y->token)
+      return false;
+    
+    switch (x->token) {
+    case TK_CONST_INTEGER:
+      return x->data.i32 == y->data.i32;
+    case TK_CONST_FLOAT:
+      return memcmp(&x->data.f32, &y->data.f32, sizeof(float)) == 0;
+    case TK_IDENTIFIER:
+      return strcmp(x->data.ident, y->data.ident) == 0;
+    default:
+      return false;
+    }
+  }
+  case S_UNARY:
+    return a->unary.op->token == b->unary.op->token && opt_equal(a->unary.rhs, b->unary.rhs);
+  case S_BINOP:
+    return a->binop.op->token == b->binop.op->token
+      && opt_equal(a->binop.lhs, b->binop.lhs)
+      && opt_equal(a->binop.rhs, b->binop.rhs);
+  case S_DIRECT:
+    return strcmp(a->direct.child_ident->data.ident, b->direct.child_ident->data.ident) == 0
+      && opt_equal(a->direct.base, b->direct.base);
+  case S_INDEX:
+    return opt_equal(a->index.base, b->index.base) && opt_equal(a->index.index, b->index.index);
+  default:
+    return false;
+  }
+}
+
+// a lexeme of an expression, which what is made for it is reported at
+static const lexeme_t *opt_where(const s_node_t *node)
+{
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return node->constant.lexeme;
+  case S_UNARY:
+    return node->unary.op;
+  case S_BINOP:
+    return node->binop.op;
+  case S_DIRECT:
+    return node->direct.child_ident;
+  case S_INDEX:
+    return node->index.left_bracket;
+  case S_PROC:
+    return node->proc.left_bracket;
+  default:
+    return NULL;
+  }
+}
+
+// 'T prefixN;', numbered past the names the function can see
+static s_node_t *opt_temp(const opt_t *opt, opt_scope_t *scope, int *num_temp, const lexeme_t *where, const opt_type_t *type, const char *prefix)
+{
+  char ident[16];
+  
+  do {
+    snprintf(ident, sizeof(ident), "%s%i", prefix, (*num_temp)++);
+  } while (opt_bound(opt, scope, ident) || map_get(&opt->fn, ident) || map_get(&opt->class, ident));
+  
+  s_node_t *spec = opt_node(S_TYPE);
+  spec->type.spec = opt_lexeme(where, type->spec, NULL);
+  
+  if (type->arr)
+    spec->type.left_bracket = opt_lexeme(where, '[', NULL);
+  
+  spec->type.dim = type->dim;
+  
+  if (type->class) {
+    const s_node_t *class_def = map_get(&opt->class, type->class);
+    spec->type.class_ident = class_def->class_def.ident;
+  }
+  
+  s_node_t *decl = opt_node(S_DECL);
+  decl->decl.type = spec;
+  decl->decl.ident = opt_lexeme(where, TK_IDENTIFIER, ident);
+  
+  opt_bind(opt, scope, decl->decl.ident->data.ident, spec);
+  
+  return decl;
+}
+
+static s_node_t *opt_ident(const lexeme_t *ident)
+{
+  s_node_t *node = opt_node(S_CONSTANT);
+  node->constant.lexeme = ident;
+  return node;
+}
+
+static s_node_t *opt_node(s_node_type_t node_type)
+{
+  s_node_t *node = ZONE_ALLOC(sizeof(s_node_t));
+  *node = (s_node_t) { 0 };
+  node->node_type = node_type;
+  return node;
+}
+
+static const lexeme_t *opt_lexeme(const lexeme_t *from, token_t token, const char *ident)
+{
+  opt_lexeme_t *lexeme = ZONE_ALLOC(sizeof(opt_lexeme_t));
+  lexeme->lexeme = *from;
+  lexeme->lexeme.token = token;
+  lexeme->lexeme.next = NULL;
+  
+  if (ident) {
+    snprintf(lexeme->ident, sizeof(lexeme->ident), "%s", ident);
+    lexeme->lexeme.data.ident = lexeme->ident;
+  }
+  
+  lexeme->next = opt_lexeme_list;
+  opt_lexeme_list = lexeme;
+  
+  return &lexeme->lexeme;
+}
+
+// names an expression or statement refers to, over-approximated: members
+// and shadowing locals are counted as uses of any definition of that name
+static void opt_use(map_t *use, const s_node_t *node)
+{
+  if (!node)
+    return;
+  
+  switch (node->node_type) {
+  case S_CONSTANT:
+    if (node->constant.lexeme->token == TK_IDENTIFIER)
+      opt_use_ident(use, node->constant.lexeme->data.ident);
+    break;
+  case S_BINOP:
+    opt_use(use, node->binop.lhs);
+    opt_use(use, node->binop.rhs);
+    break;
+  case S_TYPE:
+    if (node->type.class_ident)
+      opt_use_ident(use, node->type.class_ident->data.ident);
+    opt_use(use, node->type.key);
+    opt_use(use, node->type.value);
+    break;
+  case S_DECL:
+    opt_use(use, node->decl.type);
+    opt_use(use, node->decl.init);
+    break;
+  case S_CLASS_DEF:
+    opt_use(use, node->class_def.class_decl);
+    break;
+  case S_CLASS_NEW:
+    opt_use(use, node->class_new.param_decl);
+    opt_use(use, node->class_new.body);
+    opt_use_lazy(use, node->class_new.lazy_body);
+    break;
+  case S_INDEX:
+    opt_use(use, node->index.base);
+    opt_use(use, node->index.index);
+    break;
+  case S_STMT:
+    while (node) {
+      opt_use(use, node->stmt.body);
+      node = node->stmt.next;
+    }
+    break;
+  case S_IF_STMT:
+    opt_use(use, node->if_stmt.cond);
+    opt_use(use, node->if_stmt.body);
+    opt_use(use, node->if_stmt.next);
+    break;
+  case S_UNARY:
+    opt_use(use, node->unary.rhs);
+    break;
+  case S_WHILE_STMT:
+    opt_use(use, node->while_stmt.cond);
+    opt_use(use, node->while_stmt.body);
+    break;
+  case S_PRINT:
+    opt_use(use, node->print.arg);
+    break;
+  case S_DIRECT:
+    opt_use(use, node->direct.base);
+    opt_use_ident(use, node->direct.child_ident->data.ident);
+    break;
+  case S_FN:
+    opt_use(use, node->fn.param_decl);
+    opt_use(use, node->fn.type);
+    opt_use(use, node->fn.body);
+    opt_use_lazy(use, node->fn.lazy_body);
+    break;
+  case S_PARAM_DECL:
+    while (node) {
+      opt_use(use, node->param_decl.type);
+      node = node->param_decl.next;
+    }
+    break;
+  case S_PROC:
+    opt_use(use, node->proc.base);
+    opt_use(use, node->proc.arg);
+    break;
+  case S_ARG:
+    while (node) {
+      opt_use(use, node->arg.body);
+      node = node->arg.next;
+    }
+    break;
+  case S_RET_STMT:
+    opt_use(use, node->ret_stmt.body);
+    break;
+  case S_NEW:
+    opt_use_ident(use, node->new.class_ident->data.ident);
+    break;
+  case S_ARRAY_INIT:
+    opt_use(use, node->array_init.type);
+    opt_use(use, node->array_init.size);
+    opt_use(use, node->array_init.init);
+    break;
+  case S_POST_OP:
+    opt_use(use, node->post_op.lhs);
+    break;
+  case S_FOR_STMT:
+    opt_use(use, node->for_stmt.decl);
+    opt_use(use, node->for_stmt.cond);
+    opt_use(use, node->for_stmt.inc);
+    opt_use(use, node->for_stmt.body);
+    break;
+  case S_CTRL_STMT:
+    break;
+  default:
+    LOG_ERROR("unknown s_node_t (%i)", node->node_type);
+    break;
+  }
+}
+
+// bodies which have not been parsed yet are scanned for identifiers
+static void opt_use_lazy(map_t *use, const lexeme_t *lexeme)
+{
+  int depth = 0;
+  
+  while (lexeme) {
+    switch (lexeme->token) {
+    case '{':
+      depth++;
+      break;
+    case '}':
+      depth--;
+      break;
+    case TK_IDENTIFIER:
+      opt_use_ident(use, lexeme->data.ident);
+      break;
+    default:
+      break;
+    }
+    
+    if (depth == 0)
+      break;
+    
+    lexeme = lexeme->next;
+  }
+}
+
+static void opt_use_ident(map_t *use, const char *ident)
+{
+  if (!map_get(use, ident))
+    map_put(use, ident, (void*) ident);
+}
+
+// expressions which can be dropped without changing what the program does
+static bool opt_pure(const s_node_t *node)
+{
+  if (!node)
+    return true;
+  
+  switch (node->node_type) {
+  case S_CONSTANT:
+    return true;
+  case S_UNARY:
+    return opt_pure(node->unary.rhs);
+  case S_BINOP:
+    return !opt_assign(node) && opt_pure(node->binop.lhs) && opt_pure(node->binop.rhs);
+  case S_ARRAY_INIT:
+    return opt_pure(node->array_init.size) && opt_pure(node->array_init.init);
+  case S_ARG:
+    while (node) {
+      if (!opt_pure(node->arg.body))
+        return false;
+      node = node->arg.next;
+    }
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool opt_assign(const s_node_t *node)
+{
+  token_t op = node->binop.op->token;
+  return op == '=' || (op >= TK_ADD_ASSIGN && op <= TK_DIV_ASSIGN);
+}
+
+// functions declared without a body are natives, which can not change what
+// a script sees unless they are passed an array to fill in
+static bool opt_native(const opt_t *opt, const s_node_t *node)
+{
+  const s_node_t *base = node->proc.base;
+  
+  if (base->node_type != S_CONSTANT || base->constant.lexeme->token != TK_IDENTIFIER)
+    return false;
+  
+  const char *ident = base->constant.lexeme->data.ident;
+  const s_node_t *fn = map_get(&opt->dup, ident) ? NULL : map_get(&opt->fn, ident);
+  
+  if (!fn || fn->fn.body || fn->fn.lazy_body)
+    return false;
+  
+  for (const s_node_t *param = fn->fn.param_decl; param; param = param->param_decl.next) {
+    if (param->param_decl.type->type.left_bracket)
+      return false;
+  }
+  
+  return true;
+}
+
+static void _no_free(void *block)
+{
+}
@@ -0,0 +1,10 @@
+#ifndef OPT_H
+#define OPT_H
+
+#include "syntax.h"
+#include <stdbool.h>
+
+extern s_node_t *opt_run(s_node_t *node, bool report);
+extern void     opt_stop();
+
+#endif
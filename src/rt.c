@@ -0,0 +1,237 @@
+#include "rt.h"
+
+#include "int_main.h"
+#include "log.h"
+#include "mem.h"
+#include "sort.h"
+#include <limits.h>
+#include <setjmp.h>
+#include <string.h>
+
+static jmp_buf *rt_jmp = NULL;
+
+// run 'fn', returning false if it stopped on an error
+bool rt_run(void (*fn)())
+{
+  jmp_buf *prev = rt_jmp;
+  jmp_buf jmp;
+  
+  rt_jmp = &jmp;
+  
+  if (setjmp(jmp) != 0) {
+    rt_jmp = prev;
+    return false;
+  }
+  
+  fn();
+  
+  rt_jmp = prev;
+  
+  return true;
+}
+
+void rt_error(const char *msg)
+{
+  if (msg)
+    printf("%s\n", msg);
+  
+  longjmp(*rt_jmp, 1);
+}
+
+char *rt_index(heap_block_t *base, int index, int size, const char *err_null, const char *err_bounds)
+{
+  if (!base)
+    rt_error(err_null);
+  
+  if (index < 0 || (long) index * size >= base->size)
+    rt_error(err_bounds);
+  
+  return &base->block[index * size];
+}
+
+char *rt_grid_index(heap_block_t *base, const int *index, int dim, int size, const char *err_null, const char *err_bounds)
+{
+  if (!base)
+    rt_error(err_null);
+  
+  int element = heap_grid_index(base, index, dim);
+  if (element < 0)
+    rt_error(err_bounds);
+  
+  return &base->block[element * size];
+}
+
+heap_block_t *rt_class(heap_block_t *base, const char *err)
+{
+  if (!base)
+    rt_error(err);
+  
+  return base;
+}
+
+int rt_length(heap_block_t *base, int size)
+{
+  return base->size / size;
+}
+
+int rt_capacity(heap_block_t *base, int size)
+{
+  return base->cap / size;
+}
+
+// the slot an element is stored to, which array methods fill in
+char *rt_insert(heap_block_t *array, int index, int size, const char *err_bounds)
+{
+  if (index < 0 || (long) index * size > array->size)
+    rt_error(err_bounds);
+  
+  return heap_insert(array, index, size);
+}
+
+void rt_remove(heap_block_t *array, int index, int size, const char *err_bounds)
+{
+  if (index < 0 || (long) index * size >= array->size)
+    rt_error(err_bounds);
+  
+  heap_remove(array, index, size);
+}
+
+// the element popped is left past the end, where nothing can grow into it
+// before it is read
+char *rt_pop(heap_block_t *array, int size, const char *err_empty)
+{
+  if (array->size == 0)
+    rt_error(err_empty);
+  
+  array->size -= size;
+  
+  return &array->block[array->size];
+}
+
+void rt_resize(heap_block_t *array, int length, int size, bool reserve, const char *err_size)
+{
+  if (length < 0 || (long) length * size > INT_MAX - SOA_RUN * size)
+    rt_error(err_size);
+  
+  if (reserve)
+    heap_reserve(array, length, size, false);
+  else
+    heap_resize(array, length, size, false);
+}
+
+heap_block_t *rt_slice(heap_block_t *array, int lo, int hi, int size, const char *err_bounds)
+{
+  if (lo < 0 || lo > hi || (long) hi * size > array->size)
+    rt_error(err_bounds);
+  
+  return heap_slice(array, lo, hi, size);
+}
+
+heap_block_t *rt_grid(const int *extent, int dim, int size, const char *err_size)
+{
+  heap_block_t *grid = heap_alloc_grid(extent, dim, size);
+  if (!grid)
+    rt_error(err_size);
+  
+  return grid;
+}
+
+void rt_sort_by(heap_block_t *array, int size, int offset, bool f32, bool ref, const char *err_null)
+{
+  if (!sort_by(array->block, array->size / size, size, offset, f32, ref))
+    rt_error(err_null);
+}
+
+heap_block_t *rt_concat(heap_block_t *lhs, heap_block_t *rhs)
+{
+  int new_len = lhs->size + rhs->size - 2;
+  
+  heap_block_t *concat_str = heap_alloc(new_len + 1);
+  
+  memcpy(concat_str->block, lhs->block, lhs->size - 1);
+  memcpy(&concat_str->block[lhs->size - 1], rhs->block, rhs->size - 1);
+  
+  concat_str->block[new_len] = 0;
+  
+  return concat_str;
+}
+
+// conditions test the low 32 bits of a value, which for f32 are its bits
+int rt_f32_bits(float f32)
+{
+  int i32;
+  memcpy(&i32, &f32, sizeof(int));
+  return i32;
+}
+
+void rt_print_i32(int i32)
+{
+  expr_t expr = rt_i32(i32);
+  c_debug("%w ", &expr);
+}
+
+void rt_print_f32(float f32)
+{
+  expr_t expr = rt_f32(f32);
+  c_debug("%w ", &expr);
+}
+
+void rt_print_string(heap_block_t *string)
+{
+  expr_t expr = rt_string(string);
+  c_debug("%w ", &expr);
+}
+
+void rt_print_none()
+{
+  expr_t expr = { .type = type_none };
+  c_debug("%w ", &expr);
+}
+
+void rt_print_end()
+{
+  c_debug("\n");
+}
+
+expr_t rt_i32(int i32)
+{
+  expr_t expr;
+  expr_i32(&expr, i32);
+  return expr;
+}
+
+expr_t rt_f32(float f32)
+{
+  expr_t expr;
+  expr_f32(&expr, f32);
+  return expr;
+}
+
+expr_t rt_string(heap_block_t *string)
+{
+  expr_t expr;
+  expr.type = type_string;
+  expr.block = string;
+  expr.loc_base = NULL;
+  expr.loc_offset = 0;
+  return expr;
+}
+
+expr_t rt_array(heap_block_t *array, spec_t spec)
+{
+  expr_t expr;
+  expr.type = (type_t) { .spec = spec, .arr = true, .class = NULL };
+  expr.block = array;
+  expr.loc_base = NULL;
+  expr.loc_offset = 0;
+  return expr;
+}
+
+expr_t rt_native(const char *ident, const char *param[], expr_t *arg_list, int num_arg_list)
+{
+  expr_t ret_value;
+  if (!int_call_bind(ident, &ret_value, param, arg_list, num_arg_list))
+    rt_error(NULL);
+  
+  return ret_value;
+}
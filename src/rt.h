@@ -0,0 +1,39 @@
+#ifndef RT_H
+#define RT_H
+
+#include "data.h"
+#include <stdbool.h>
+
+// runtime for programs translated with --emit-c
+
+extern bool         rt_run(void (*fn)());
+extern void         rt_error(const char *msg);
+
+extern char         *rt_index(heap_block_t *base, int index, int size, const char *err_null, const char *err_bounds);
+extern char         *rt_grid_index(heap_block_t *base, const int *index, int dim, int size, const char *err_null, const char *err_bounds);
+extern heap_block_t *rt_class(heap_block_t *base, const char *err);
+extern int          rt_length(heap_block_t *base, int size);
+extern int          rt_capacity(heap_block_t *base, int size);
+extern char         *rt_insert(heap_block_t *array, int index, int size, const char *err_bounds);
+extern void         rt_remove(heap_block_t *array, int index, int size, const char *err_bounds);
+extern char         *rt_pop(heap_block_t *array, int size, const char *err_empty);
+extern void         rt_resize(heap_block_t *array, int length, int size, bool reserve, const char *err_size);
+extern heap_block_t *rt_slice(heap_block_t *array, int lo, int hi, int size, const char *err_bounds);
+extern heap_block_t *rt_grid(const int *extent, int dim, int size, const char *err_size);
+extern void         rt_sort_by(heap_block_t *array, int size, int offset, bool f32, bool ref, const char *err_null);
+extern heap_block_t *rt_concat(heap_block_t *lhs, heap_block_t *rhs);
+extern int          rt_f32_bits(float f32);
+
+extern void         rt_print_i32(int i32);
+extern void         rt_print_f32(float f32);
+extern void         rt_print_string(heap_block_t *string);
+extern void         rt_print_none();
+extern void         rt_print_end();
+
+extern expr_t       rt_i32(int i32);
+extern expr_t       rt_f32(float f32);
+extern expr_t       rt_string(heap_block_t *string);
+extern expr_t       rt_array(heap_block_t *array, spec_t spec);
+extern expr_t       rt_native(const char *ident, const char *param[], expr_t *arg_list, int num_arg_list);
+
+#endif
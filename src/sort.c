@@ -0,0 +1,320 @@
+#include "sort.h"
+
+#include "data.h"
+#include "zone.h"
+#include <limits.h>
+#include <string.h>
+
+// i32s and f32s are sorted as unsigned keys in the same order, f32s with -0
+// before 0 and NaNs at either end. arrays of SORT_RADIX or more are sorted a
+// byte at a time with a radix sort, which skips a byte all keys share, and
+// shorter ones with an introsort: quicksort on the median of three, heapsort
+// once it has gone too deep and insertion sort on what is left.
+
+#define SORT_SMALL  16
+#define SORT_RADIX  512
+
+typedef unsigned            sort_u32_t __attribute__((may_alias));
+typedef unsigned long long  sort_u64_t;
+
+static unsigned sort_key_i32(unsigned x)
+{
+  return x ^ 0x80000000u;
+}
+
+static unsigned sort_key_f32(unsigned x)
+{
+  return x & 0x80000000u ? ~x : x | 0x80000000u;
+}
+
+static unsigned sort_unkey_f32(unsigned x)
+{
+  return x & 0x80000000u ? x & 0x7fffffffu : ~x;
+}
+
+static int sort_depth(int n)
+{
+  return n > 1 ? 2 * (31 - __builtin_clz(n)) : 0;
+}
+
+// the radix sort of 'type' sorts on bytes 'lo' to 'hi', which for a u64
+// leaves the order of keys the same in their high half as it was
+#define SORT_DEFINE(name, type, lo, hi) \
+static void name##_insert(type *a, int n) \
+{ \
+  for (int i = 1; i < n; i++) { \
+    type x = a[i]; \
+    int j = i; \
+    for (; j > 0 && a[j - 1] > x; j--) \
+      a[j] = a[j - 1]; \
+    a[j] = x; \
+  } \
+} \
+\
+static void name##_sift(type *a, int i, int n) \
+{ \
+  type x = a[i]; \
+  for (int child; (child = 2 * i + 1) < n; i = child) { \
+    if (child + 1 < n && a[child + 1] > a[child]) \
+      child++; \
+    if (a[child] <= x) \
+      break; \
+    a[i] = a[child]; \
+  } \
+  a[i] = x; \
+} \
+\
+static void name##_heap(type *a, int n) \
+{ \
+  for (int i = n / 2 - 1; i >= 0; i--) \
+    name##_sift(a, i, n); \
+  \
+  for (int i = n - 1; i > 0; i--) { \
+    type x = a[0]; \
+    a[0] = a[i]; \
+    a[i] = x; \
+    name##_sift(a, 0, i); \
+  } \
+} \
+\
+/* splits more than SORT_SMALL keys in two, the first no greater than the */ \
+/* second, around the median of the first, middle and last. both halves */ \
+/* have at least one key. */ \
+static int name##_partition(type *a, int n) \
+{ \
+  type x = a[0], y = a[n / 2], z = a[n - 1]; \
+  type p = x < y ? (y < z ? y : x < z ? z : x) : (x < z ? x : y < z ? z : y); \
+  \
+  int i = -1; \
+  int j = n; \
+  for (;;) { \
+    do i++; while (a[i] < p); \
+    do j--; while (a[j] > p); \
+    \
+    if (i >= j) \
+      return j + 1; \
+    \
+    type t = a[i]; \
+    a[i] = a[j]; \
+    a[j] = t; \
+  } \
+} \
+\
+static void name##_intro(type *a, int n, int depth) \
+{ \
+  while (n > SORT_SMALL) { \
+    if (depth-- == 0) { \
+      name##_heap(a, n); \
+      return; \
+    } \
+    \
+    /* the shorter half is recursed into, which bounds the stack */ \
+    int k = name##_partition(a, n); \
+    if (k < n - k) { \
+      name##_intro(a, k, depth); \
+      a += k; \
+      n -= k; \
+    } else { \
+      name##_intro(a + k, n - k, depth); \
+      n = k; \
+    } \
+  } \
+  \
+  name##_insert(a, n); \
+} \
+\
+static void name##_radix(type *a, type *tmp, int n) \
+{ \
+  int count[hi - lo + 1][256]; \
+  memset(count, 0, sizeof(count)); \
+  \
+  for (int i = 0; i < n; i++) { \
+    for (int b = lo; b <= hi; b++) \
+      count[b - lo][(a[i] >> (8 * b)) & 255]++; \
+  } \
+  \
+  type *src = a; \
+  type *dst = tmp; \
+  \
+  for (int b = lo; b <= hi; b++) { \
+    int *c = count[b - lo]; \
+    int shift = 8 * b; \
+    if (c[(src[0] >> shift) & 255] == n) \
+      continue; \
+    \
+    int offset = 0; \
+    for (int d = 0; d < 256; d++) { \
+      int num = c[d]; \
+      c[d] = offset; \
+      offset += num; \
+    } \
+    \
+    for (int i = 0; i < n; i++) \
+      dst[c[(src[i] >> shift) & 255]++] = src[i]; \
+    \
+    type *t = src; \
+    src = dst; \
+    dst = t; \
+  } \
+  \
+  if (src != a) \
+    memcpy(a, src, n * sizeof(type)); \
+} \
+\
+static void name##_sort(type *a, int n) \
+{ \
+  if (n < SORT_RADIX || n > INT_MAX / (int) sizeof(type)) { \
+    name##_intro(a, n, sort_depth(n)); \
+    return; \
+  } \
+  \
+  type *tmp = ZONE_ALLOC(n * sizeof(type)); \
+  name##_radix(a, tmp, n); \
+  ZONE_FREE(tmp); \
+}
+
+SORT_DEFINE(sort_u32, sort_u32_t, 0, 3)
+SORT_DEFINE(sort_u64, sort_u64_t, 4, 7)
+
+// the 'k'th smallest key is put at 'k', those before it are no greater and
+// those after no less
+static void sort_u32_nth(sort_u32_t *a, int n, int k)
+{
+  int depth = sort_depth(n);
+  
+  while (n > SORT_SMALL) {
+    if (depth-- == 0) {
+      sort_u32_heap(a, n);
+      return;
+    }
+    
+    int split = sort_u32_partition(a, n);
+    if (k < split) {
+      n = split;
+    } else {
+      a += split;
+      n -= split;
+      k -= split;
+    }
+  }
+  
+  sort_u32_insert(a, n);
+}
+
+static void sort_key(sort_u32_t *a, int n, bool f32)
+{
+  for (int i = 0; i < n; i++)
+    a[i] = f32 ? sort_key_f32(a[i]) : sort_key_i32(a[i]);
+}
+
+static void sort_unkey(sort_u32_t *a, int n, bool f32)
+{
+  for (int i = 0; i < n; i++)
+    a[i] = f32 ? sort_unkey_f32(a[i]) : sort_key_i32(a[i]);
+}
+
+void sort_i32(int *a, int n)
+{
+  sort_key((sort_u32_t*) a, n, false);
+  sort_u32_sort((sort_u32_t*) a, n);
+  sort_unkey((sort_u32_t*) a, n, false);
+}
+
+void sort_f32(float *a, int n)
+{
+  sort_key((sort_u32_t*) a, n, true);
+  sort_u32_sort((sort_u32_t*) a, n);
+  sort_unkey((sort_u32_t*) a, n, true);
+}
+
+// a 'k' outside the array leaves it as it is
+void sort_nth_i32(int *a, int n, int k)
+{
+  if (k < 0 || k >= n)
+    return;
+  
+  sort_key((sort_u32_t*) a, n, false);
+  sort_u32_nth((sort_u32_t*) a, n, k);
+  sort_unkey((sort_u32_t*) a, n, false);
+}
+
+void sort_nth_f32(float *a, int n, int k)
+{
+  if (k < 0 || k >= n)
+    return;
+  
+  sort_key((sort_u32_t*) a, n, true);
+  sort_u32_nth((sort_u32_t*) a, n, k);
+  sort_unkey((sort_u32_t*) a, n, true);
+}
+
+// the first index whose element is not less than 'x', or 'n'
+int sort_lower_bound_i32(const int *a, int n, int x)
+{
+  int lo = 0;
+  int hi = n;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (a[mid] < x)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  
+  return lo;
+}
+
+int sort_lower_bound_f32(const float *a, int n, float x)
+{
+  int lo = 0;
+  int hi = n;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (a[mid] < x)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  
+  return lo;
+}
+
+// a stable sort of 'n' elements of 'size' bytes on the i32 or f32 at
+// 'offset' in each, or when they are 'ref'erences to classes, at 'offset' in
+// what they refer to. keys are sorted with the index they came from in their
+// low half, then the elements are moved into their order. false if a
+// reference is null.
+bool sort_by(char *a, int n, int size, int offset, bool f32, bool ref)
+{
+  sort_u64_t *key = ZONE_ALLOC(n * sizeof(sort_u64_t) + 1);
+  
+  for (int i = 0; i < n; i++) {
+    const char *elem = &a[i * size];
+    if (ref) {
+      const heap_block_t *object = *(heap_block_t* const*) elem;
+      if (!object) {
+        ZONE_FREE(key);
+        return false;
+      }
+      
+      elem = object->block;
+    }
+    
+    unsigned x;
+    memcpy(&x, &elem[offset], sizeof(x));
+    key[i] = (sort_u64_t) (f32 ? sort_key_f32(x) : sort_key_i32(x)) << 32 | (unsigned) i;
+  }
+  
+  sort_u64_sort(key, n);
+  
+  char *tmp = ZONE_ALLOC(n * size + 1);
+  for (int i = 0; i < n; i++)
+    memcpy(&tmp[i * size], &a[(unsigned) key[i] * size], size);
+  
+  memcpy(a, tmp, n * size);
+  
+  ZONE_FREE(tmp);
+  ZONE_FREE(key);
+  
+  return true;
+}
@@ -0,0 +1,14 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include <stdbool.h>
+
+extern void sort_i32(int *a, int n);
+extern void sort_f32(float *a, int n);
+extern void sort_nth_i32(int *a, int n, int k);
+extern void sort_nth_f32(float *a, int n, int k);
+extern int  sort_lower_bound_i32(const int *a, int n, int x);
+extern int  sort_lower_bound_f32(const float *a, int n, float x);
+extern bool sort_by(char *a, int n, int size, int offset, bool f32, bool ref);
+
+#endif
@@ -7,25 +7,41 @@
 
 static bool s_err = false;
 
+typedef enum {
+  ASSOC_LEFT,
+  ASSOC_RIGHT
+} assoc_t;
+
 typedef struct {
-  token_t op[8];
-} op_set_t;
-
-static op_set_t op_set_table[] = {
-  { '=', TK_ADD_ASSIGN, TK_SUB_ASSIGN, TK_MUL_ASSIGN, TK_DIV_ASSIGN },
-  { TK_OR },
-  { TK_AND },
-  { TK_EQ, TK_NE },
-  { '<', '>', TK_GE, TK_LE },
-  { '+', '-' },
-  { '*', '/' }
+  int     prec;
+  assoc_t assoc;
+} op_prec_t;
+
+// binary operators by token, prec 0 is not a binary operator
+static op_prec_t op_prec_table[TK_EOF + 1] = {
+  ['=']           = { 1, ASSOC_RIGHT },
+  [TK_ADD_ASSIGN] = { 1, ASSOC_RIGHT },
+  [TK_SUB_ASSIGN] = { 1, ASSOC_RIGHT },
+  [TK_MUL_ASSIGN] = { 1, ASSOC_RIGHT },
+  [TK_DIV_ASSIGN] = { 1, ASSOC_RIGHT },
+  [TK_OR]         = { 2, ASSOC_LEFT  },
+  [TK_AND]        = { 3, ASSOC_LEFT  },
+  [TK_EQ]         = { 4, ASSOC_LEFT  },
+  [TK_NE]         = { 4, ASSOC_LEFT  },
+  ['<']           = { 5, ASSOC_LEFT  },
+  ['>']           = { 5, ASSOC_LEFT  },
+  [TK_GE]         = { 5, ASSOC_LEFT  },
+  [TK_LE]         = { 5, ASSOC_LEFT  },
+  ['+']           = { 6, ASSOC_LEFT  },
+  ['-']           = { 6, ASSOC_LEFT  },
+  ['*']           = { 7, ASSOC_LEFT  },
+  ['/']           = { 7, ASSOC_LEFT  }
 };
 
-static int num_op_set = sizeof(op_set_table) / sizeof(op_set_t);
-
 static const lexeme_t *s_expect(lex_t *lex, token_t token);
 
 static s_node_t *s_body(lex_t *lex);
+static const lexeme_t *s_skip_body(lex_t *lex);
 static s_node_t *s_fn(lex_t *lex);
 static s_node_t *s_param_decl(lex_t *lex);
 static s_node_t *s_if_stmt(lex_t *lex);
@@ -40,8 +56,9 @@ static s_node_t *s_stmt(lex_t *lex);
 static s_node_t *s_print(lex_t *lex);
 static s_node_t *s_decl(lex_t *lex);
 static s_node_t *s_type(lex_t *lex);
+static s_node_t *s_map_type(lex_t *lex, const lexeme_t *spec);
 static s_node_t *s_expr(lex_t *lex);
-static s_node_t *s_binop(lex_t *lex, int op_set);
+static s_node_t *s_binop(lex_t *lex, int min_prec);
 static s_node_t *s_unary(lex_t *lex);
 static s_node_t *s_postfix(lex_t *lex);
 static s_node_t *s_arg(lex_t *lex);
@@ -63,15 +80,15 @@ typedef s_node_t *(*s_rule_t)(lex_t *lex);
 
 static s_node_t *s_expect_rule(lex_t *lex, rule_t rule);
 
-static s_node_t *make_fn(const lexeme_t *fn_ident, s_node_t *param_decl, s_node_t *type, s_node_t *body);
+static s_node_t *make_fn(const lexeme_t *fn_ident, s_node_t *param_decl, s_node_t *type, s_node_t *body, const lexeme_t *lazy_body);
 static s_node_t *make_param_decl(s_node_t *type, const lexeme_t *ident, s_node_t *next);
 static s_node_t *make_stmt(s_node_t *body, s_node_t *next);
 static s_node_t *make_if_stmt(s_node_t *cond, s_node_t *body, s_node_t *next);
 static s_node_t *make_ctrl_stmt(const lexeme_t *lexeme);
 static s_node_t *make_while_stmt(s_node_t *cond, s_node_t *body);
 static s_node_t *make_for_stmt(s_node_t *decl, s_node_t *cond, s_node_t *inc, s_node_t *body);
-static s_node_t *make_class_def(const lexeme_t *ident, s_node_t *class_decl);
-static s_node_t *make_class_new(s_node_t *arg, s_node_t *param_decl);
+static s_node_t *make_class_def(const lexeme_t *spec, const lexeme_t *ident, s_node_t *class_decl);
+static s_node_t *make_class_new(s_node_t *param_decl, s_node_t *body, const lexeme_t *lazy_body);
 static s_node_t *make_decl(s_node_t *type, const lexeme_t *ident, s_node_t *init);
 static s_node_t *make_type(const lexeme_t *spec, const lexeme_t *left_bracket, const lexeme_t *class_ident);
 static s_node_t *make_constant(const lexeme_t *lexeme);
@@ -107,6 +124,48 @@ s_node_t *s_parse(lex_t *lex)
   return body;
 }
 
+s_node_t *s_parse_stmt(lex_t *lex)
+{
+  s_node_t *stmt_body = s_stmt(lex);
+  if (!stmt_body)
+    return NULL;
+  
+  return make_stmt(stmt_body, NULL);
+}
+
+// whether a statement list defines functions or classes, whose nodes stay
+// referenced by the interpreter after the statement has run
+bool s_retain(const s_node_t *node)
+{
+  while (node) {
+    const s_node_t *body = node->stmt.body;
+    
+    switch (body->node_type) {
+    case S_FN:
+    case S_CLASS_DEF:
+      return true;
+    case S_IF_STMT:
+      if (s_retain(body->if_stmt.body) || s_retain(body->if_stmt.next))
+        return true;
+      break;
+    case S_WHILE_STMT:
+      if (s_retain(body->while_stmt.body))
+        return true;
+      break;
+    case S_FOR_STMT:
+      if (s_retain(body->for_stmt.body))
+        return true;
+      break;
+    default:
+      break;
+    }
+    
+    node = node->stmt.next;
+  }
+  
+  return false;
+}
+
 bool s_error()
 {
   return s_err;
@@ -114,27 +173,97 @@ bool s_error()
 
 static s_node_t *s_body(lex_t *lex)
 {
+  if (!lex_match(lex, '{')) {
+    s_node_t *stmt_body = s_stmt(lex);
+    if (!stmt_body)
+      return NULL;
+    
+    return make_stmt(stmt_body, NULL);
+  }
+  
   s_node_t *body = NULL;
+  s_node_t *head = NULL;
   s_node_t *stmt_body = s_stmt(lex);
-  if (stmt_body) {
-    body = make_stmt(stmt_body, NULL);
-  } else if (lex_match(lex, '{')) {
-    s_node_t *head = NULL;
+  
+  while (stmt_body) {
+    if (head)
+      head = head->stmt.next = make_stmt(stmt_body, NULL);
+    else
+      body = head = make_stmt(stmt_body, NULL);
+    
     stmt_body = s_stmt(lex);
+  }
+  
+  s_expect(lex, '}');
+  
+  return body;
+}
+
+// brace delimited bodies are only matched here and parsed by s_lazy_body on
+// first call, so unused functions cost no more than a scan of their tokens
+static const lexeme_t *s_skip_body(lex_t *lex)
+{
+  const lexeme_t *lazy_body = lex->lexeme;
+  int depth = 0;
+  
+  do {
+    switch (lex->lexeme->token) {
+    case '{':
+      depth++;
+      break;
+    case '}':
+      depth--;
+      break;
+    case TK_EOF:
+      c_error(lex->lexeme, "error: expected '}' before '%l'", lex->lexeme);
+      s_err = true;
+      return NULL;
+    default:
+      break;
+    }
     
-    while (stmt_body) {
-      if (head)
-        head = head->stmt.next = make_stmt(stmt_body, NULL);
-      else
-        body = head = make_stmt(stmt_body, NULL);
-      
-      stmt_body = s_stmt(lex);
+    lex_next(lex);
+  } while (depth > 0);
+  
+  return lazy_body;
+}
+
+s_node_t *s_lazy_body(s_node_t *node)
+{
+  s_node_t **body = NULL;
+  const lexeme_t **lazy_body = NULL;
+  
+  switch (node->node_type) {
+  case S_FN:
+    body = &node->fn.body;
+    lazy_body = &node->fn.lazy_body;
+    break;
+  case S_CLASS_NEW:
+    body = &node->class_new.body;
+    lazy_body = &node->class_new.lazy_body;
+    break;
+  default:
+    LOG_ERROR("unknown node_type (%i)", node->node_type);
+    return NULL;
+  }
+  
+  if (!*body && *lazy_body) {
+    bool err = s_err;
+    s_err = false;
+    
+    lex_t lex = { .lexeme = (lexeme_t*) *lazy_body };
+    *body = s_expect_rule(&lex, R_BODY);
+    *lazy_body = NULL;
+    
+    if (s_err) {
+      s_free(*body);
+      *body = NULL;
     }
     
-    s_expect(lex, '}');
+    s_err = s_err || err;
   }
   
-  return body;
+  return *body;
 }
 
 static s_node_t *s_fn(lex_t *lex)
@@ -153,77 +282,85 @@ static s_node_t *s_fn(lex_t *lex)
     type = s_expect_rule(lex, R_TYPE);
   
   s_node_t *body = NULL;
-  if (!lex_match(lex, ';'))
+  const lexeme_t *lazy_body = NULL;
+  if (lex->lexeme && lex->lexeme->token == '{')
+    lazy_body = s_skip_body(lex);
+  else if (!lex_match(lex, ';'))
     body = s_expect_rule(lex, R_BODY);
   
-  return make_fn(fn_ident, param_decl, type, body);
+  return make_fn(fn_ident, param_decl, type, body, lazy_body);
 }
 
 static s_node_t *s_param_decl(lex_t *lex)
 {
-  s_node_t *type = s_type(lex);
-  if (!type)
-    return NULL;
+  s_node_t *body = NULL;
+  s_node_t *head = NULL;
   
-  const lexeme_t *ident = s_expect(lex, TK_IDENTIFIER);
+  do {
+    s_node_t *type = s_type(lex);
+    if (!type)
+      break;
+    
+    const lexeme_t *ident = s_expect(lex, TK_IDENTIFIER);
+    
+    if (head)
+      head = head->param_decl.next = make_param_decl(type, ident, NULL);
+    else
+      body = head = make_param_decl(type, ident, NULL);
+  } while (lex_match(lex, ','));
   
-  if (lex_match(lex, ',')) 
-    return make_param_decl(type, ident, s_param_decl(lex));
-  else
-    return make_param_decl(type, ident, NULL);
+  return body;
 }
 
 static s_node_t *s_stmt(lex_t *lex)
 {
-  s_node_t *node = NULL;
-  
-  node = s_fn(lex);
-  if (node)
-    return node;
-  
-  node = s_ctrl_stmt(lex);
-  if (node)
-    return node;
-  
-  node = s_for_stmt(lex);
-  if (node)
-    return node;
-  
-  node = s_while_stmt(lex);
-  if (node)
-    return node;
-  
-  node = s_if_stmt(lex);
-  if (node)
-    return node;
-  
-  node = s_print(lex);
-  if (node)
-    return node;
-  
-  node = s_ret_stmt(lex); 
-  if (node)
-    return node;
+  if (!lex->lexeme)
+    return NULL;
   
-  node = s_decl(lex); 
-  if (node) {
-    s_expect(lex, ';');
-    return node;
-  }
+  s_node_t *node = NULL;
   
-  node = s_class_def(lex);
-  if (node) {
-    s_expect(lex, ';');
-    return node;
+  switch (lex->lexeme->token) {
+  case TK_FN:
+    return s_fn(lex);
+  case TK_BREAK:
+  case TK_CONTINUE:
+    return s_ctrl_stmt(lex);
+  case TK_FOR:
+    return s_for_stmt(lex);
+  case TK_WHILE:
+    return s_while_stmt(lex);
+  case TK_IF:
+    return s_if_stmt(lex);
+  case TK_PRINT:
+    return s_print(lex);
+  case TK_RETURN:
+    return s_ret_stmt(lex);
+  case TK_I32:
+  case TK_F32:
+  case TK_STRING:
+  case TK_CLASS:
+  case TK_STRUCT:
+  case TK_SOA:
+  case TK_MAP:
+    node = s_decl(lex);
+    break;
+  case TK_CLASS_DEF:
+  case TK_STRUCT_DEF:
+    node = s_class_def(lex);
+    break;
+  case TK_EOF:
+  case '{':
+  case '}':
+    return NULL;
+  default:
+    node = s_expr(lex);
+    break;
   }
   
-  node = s_expr(lex);
-  if (node) {
+  if (node)
     s_expect(lex, ';');
-    return node;
-  }
   
-  return NULL;
+  return node;
 }
 
 static s_node_t *s_ctrl_stmt(lex_t *lex)
@@ -319,7 +456,11 @@ static s_node_t *s_print(lex_t *lex)
 
 static s_node_t *s_class_def(lex_t *lex)
 {
-  if (!lex_match(lex, TK_CLASS_DEF))
+  const lexeme_t *spec = lex_match(lex, TK_CLASS_DEF);
+  if (!spec)
+    spec = lex_match(lex, TK_STRUCT_DEF);
+  
+  if (!spec)
     return NULL;
   
   const lexeme_t *ident = s_expect(lex, TK_IDENTIFIER);
@@ -328,7 +469,7 @@ static s_node_t *s_class_def(lex_t *lex)
   s_node_t *class_decl = s_class_decl(lex);
   s_expect(lex, '}');
   
-  return make_class_def(ident, class_decl);
+  return make_class_def(spec, ident, class_decl);
 }
 
 static s_node_t *s_class_new(lex_t *lex)
@@ -340,30 +481,52 @@ static s_node_t *s_class_new(lex_t *lex)
   s_node_t *param_decl = s_param_decl(lex);
   s_expect(lex, ')');
   
-  s_node_t *body = s_expect_rule(lex, R_BODY);
+  s_node_t *body = NULL;
+  const lexeme_t *lazy_body = NULL;
+  if (lex->lexeme && lex->lexeme->token == '{')
+    lazy_body = s_skip_body(lex);
+  else
+    body = s_expect_rule(lex, R_BODY);
   
-  return make_class_new(param_decl, body);
+  return make_class_new(param_decl, body, lazy_body);
 }
 
 static s_node_t *s_class_decl(lex_t *lex)
 {
   s_node_t *body = NULL;
+  s_node_t *head = NULL;
   
-  body = s_class_new(lex);
-  if (body)
-    return make_stmt(body, s_class_decl(lex));
-  
-  body = s_decl(lex);
-  if (body) {
-    s_expect(lex, ';');
-    return make_stmt(body, s_class_decl(lex));
+  while (lex->lexeme) {
+    s_node_t *decl = NULL;
+    
+    switch (lex->lexeme->token) {
+    case TK_NEW:
+      decl = s_class_new(lex);
+      break;
+    case TK_FN:
+      decl = s_fn(lex);
+      break;
+    case TK_I32:
+    case TK_F32:
+    case TK_STRING:
+    case TK_CLASS:
+    case TK_STRUCT:
+    case TK_SOA:
+    case TK_MAP:
+      decl = s_decl(lex);
+      s_expect(lex, ';');
+      break;
+    default:
+      return body;
+    }
+    
+    if (head)
+      head = head->stmt.next = make_stmt(decl, NULL);
+    else
+      body = head = make_stmt(decl, NULL);
   }
   
-  body = s_fn(lex);
-  if (body)
-    return make_stmt(body, s_class_decl(lex));
-  
-  return NULL;
+  return body;
 }
 
 static s_node_t *s_decl(lex_t *lex)
@@ -383,50 +546,88 @@ static s_node_t *s_decl(lex_t *lex)
 
 static s_node_t *s_type(lex_t *lex)
 {
-  const lexeme_t *spec = NULL;
+  const lexeme_t *spec = lex->lexeme;
   const lexeme_t *class_ident = NULL;
+  s_node_t *type = NULL;
   
-  if ((spec = lex_match(lex, TK_I32)));
-  else if ((spec = lex_match(lex, TK_F32)));
-  else if ((spec = lex_match(lex, TK_STRING)));
-  else if ((spec = lex_match(lex, TK_CLASS))) {
+  if (!spec)
+    return NULL;
+  
+  switch (spec->token) {
+  case TK_I32:
+  case TK_F32:
+  case TK_STRING:
+    lex_next(lex);
+    break;
+  case TK_CLASS:
+  case TK_STRUCT:
+  case TK_SOA:
+    lex_next(lex);
     class_ident = s_expect(lex, TK_IDENTIFIER);
-  } else
+    break;
+  case TK_MAP:
+    lex_next(lex);
+    type = s_map_type(lex, spec);
+    break;
+  default:
     return NULL;
+  }
   
+  // 'T[,]' and 'T[,,]' have an index for each comma and one more
   const lexeme_t *left_bracket = NULL;
-  if ((left_bracket = lex_match(lex, '[')))
+  int dim = 0;
+  if ((left_bracket = lex_match(lex, '['))) {
+    while (lex_match(lex, ','))
+      dim = dim ? dim + 1 : 2;
     s_expect(lex, ']');
+  }
   
-  return make_type(spec, left_bracket, class_ident);
+  if (!type)
+    type = make_type(spec, left_bracket, class_ident);
+  
+  type->type.left_bracket = left_bracket;
+  type->type.dim = dim;
+  
+  return type;
+}
+
+// '<K, V>' after 'map' or 'map_init'
+static s_node_t *s_map_type(lex_t *lex, const lexeme_t *spec)
+{
+  s_node_t *type = make_type(spec, NULL, NULL);
+  
+  s_expect(lex, '<');
+  type->type.key = s_expect_rule(lex, R_TYPE);
+  s_expect(lex, ',');
+  type->type.value = s_expect_rule(lex, R_TYPE);
+  s_expect(lex, '>');
+  
+  return type;
 }
 
 static s_node_t *s_expr(lex_t *lex)
 {
-  return s_binop(lex, 0);
+  return s_binop(lex, 1);
 }
 
-static s_node_t *s_binop(lex_t *lex, int op_set)
+static s_node_t *s_binop(lex_t *lex, int min_prec)
 {
-  if (op_set >= num_op_set)
-    return s_unary(lex);
-  
-  s_node_t *lhs = s_binop(lex, op_set + 1);
+  s_node_t *lhs = s_unary(lex);
   if (!lhs)
     return NULL;
   
-  while (1) {
-    const lexeme_t *op = NULL;
-    for (int i = 0; i < 8; i++) {
-      op = lex_match(lex, op_set_table[op_set].op[i]);
-      if (op)
-        break;
-    }
+  while (lex->lexeme) {
+    const lexeme_t *op = lex->lexeme;
+    const op_prec_t *op_prec = &op_prec_table[op->token];
     
-    if (!op)
+    if (op_prec->prec < min_prec || op_prec->prec == 0)
       break;
     
-    s_node_t *rhs = s_binop(lex, op_set + 1);
+    lex_next(lex);
+    
+    int next_prec = op_prec->assoc == ASSOC_LEFT ? op_prec->prec + 1 : op_prec->prec;
+    
+    s_node_t *rhs = s_binop(lex, next_prec);
     if (!rhs) {
       c_error(lex->lexeme, "expected 'expression' before '%l'", lex->lexeme);
       s_err = true;
@@ -440,36 +641,54 @@ static s_node_t *s_binop(lex_t *lex, int op_set)
 
 static s_node_t *s_unary(lex_t *lex)
 {
-  const lexeme_t *op = NULL;
-  if ((op = lex_match(lex, '-')))
-    return make_unary(op, s_unary(lex));
-  else if ((op = lex_match(lex, '!')))
+  const lexeme_t *op = lex->lexeme;
+  if (!op)
+    return NULL;
+  
+  switch (op->token) {
+  case '-':
+  case '!':
+    lex_next(lex);
     return make_unary(op, s_unary(lex));
-  return s_postfix(lex);
+  default:
+    return s_postfix(lex);
+  }
 }
 
 static s_node_t *s_postfix(lex_t *lex)
 {
   s_node_t *base = s_primary(lex);
   
-  while (1) {
-    const lexeme_t *lexeme = NULL;
-    if ((lexeme = lex_match(lex, '['))) {
+  while (lex->lexeme) {
+    const lexeme_t *lexeme = lex->lexeme;
+    
+    switch (lexeme->token) {
+    case '[':
+      lex_next(lex);
       s_node_t *index = s_expect_rule(lex, R_EXPR);
+      if (lex_match(lex, ','))
+        index = make_arg(index, s_expect_rule(lex, R_ARG));
       s_expect(lex, ']');
       base = make_index(base, index, lexeme);
-    } else if (lex_match(lex, '.')) {
+      break;
+    case '.':
+      lex_next(lex);
       const lexeme_t *child_ident = s_expect(lex, TK_IDENTIFIER);
       base = make_direct(base, child_ident);
-    } else if ((lexeme = lex_match(lex, TK_INC))) {
-      base = make_post_op(base, lexeme);
-    } else if ((lexeme =lex_match(lex, TK_DEC))) {
+      break;
+    case TK_INC:
+    case TK_DEC:
+      lex_next(lex);
       base = make_post_op(base, lexeme);
-    } else if ((lexeme = lex_match(lex, '('))) {
+      break;
+    case '(':
+      lex_next(lex);
       s_node_t *arg = s_arg(lex);
       s_expect(lex, ')');
       base = make_proc(base, arg, lexeme);
-    } else if ((lexeme = lex_match(lex, TK_ARRAY_INIT))) {
+      break;
+    case TK_ARRAY_INIT:
+      lex_next(lex);
       s_expect(lex, '<');
       s_node_t *type = s_type(lex);
       s_expect(lex, '>');
@@ -481,26 +700,44 @@ static s_node_t *s_postfix(lex_t *lex)
         s_expect(lex, '}');
       } else if (s_expect(lex, '(')) {
         size = s_expect_rule(lex, R_EXPR);
+        if (lex_match(lex, ','))
+          size = make_arg(size, s_expect_rule(lex, R_ARG));
         s_expect(lex, ')');
       }
       
       return make_array_init(lexeme, type, size, init);
-    } else {
+    case TK_MAP_INIT:
+      lex_next(lex);
+      type = s_map_type(lex, lexeme);
+      s_expect(lex, '(');
+      s_expect(lex, ')');
+      
+      return make_array_init(lexeme, type, NULL, NULL);
+    default:
       return base;
     }
   }
+  
+  return base;
 }
 
 static s_node_t *s_arg(lex_t *lex)
 {
-  s_node_t *body = s_expr(lex);
-  if (!body)
-    return NULL;
+  s_node_t *body = NULL;
+  s_node_t *head = NULL;
   
-  if (lex_match(lex, ','))
-    return make_arg(body, s_arg(lex));
-  else
-    return make_arg(body, NULL);
+  do {
+    s_node_t *arg_body = s_expr(lex);
+    if (!arg_body)
+      break;
+    
+    if (head)
+      head = head->arg.next = make_arg(arg_body, NULL);
+    else
+      body = head = make_arg(arg_body, NULL);
+  } while (lex_match(lex, ','));
+  
+  return body;
 }
 
 static s_node_t *s_new(lex_t *lex)
@@ -515,25 +752,28 @@ static s_node_t *s_new(lex_t *lex)
 
 static s_node_t *s_primary(lex_t *lex)
 {
-  const lexeme_t *lexeme = NULL;
+  const lexeme_t *lexeme = lex->lexeme;
+  if (!lexeme)
+    return NULL;
   
-  if ((lexeme = lex_match(lex, TK_CONST_INTEGER)))
-    return make_constant(lexeme);
-  else if ((lexeme = lex_match(lex, TK_CONST_FLOAT)))
+  switch (lexeme->token) {
+  case TK_CONST_INTEGER:
+  case TK_CONST_FLOAT:
+  case TK_IDENTIFIER:
+  case TK_STRING_LITERAL:
+    lex_next(lex);
     return make_constant(lexeme);
-  else if ((lexeme = lex_match(lex, TK_NEW))) {
+  case TK_NEW:
+    lex_next(lex);
     return s_new(lex);
-  } else if ((lexeme = lex_match(lex, TK_IDENTIFIER)))
-    return make_constant(lexeme);
-  else if ((lexeme = lex_match(lex, TK_STRING_LITERAL)))
-    return make_constant(lexeme);
-  else if (lex_match(lex, '(')) {
+  case '(':
+    lex_next(lex);
     s_node_t *body = s_expect_rule(lex, R_EXPR);
     s_expect(lex, ')');
     return body;
+  default:
+    return NULL;
   }
-  
-  return NULL;
 }
 
 static s_node_t *s_expect_rule(lex_t *lex, rule_t rule)
@@ -578,13 +818,14 @@ static const lexeme_t *s_expect(lex_t *lex, token_t token)
   return lexeme;
 }
 
-static s_node_t *make_fn(const lexeme_t *fn_ident, s_node_t *param_decl, s_node_t *type, s_node_t *body)
+static s_node_t *make_fn(const lexeme_t *fn_ident, s_node_t *param_decl, s_node_t *type, s_node_t *body, const lexeme_t *lazy_body)
 {
   s_node_t *node = make_node(S_FN);
   node->fn.fn_ident = fn_ident;
   node->fn.param_decl = param_decl;
   node->fn.type = type;
   node->fn.body = body;
+  node->fn.lazy_body = lazy_body;
   return node;
 }
 
@@ -645,19 +886,21 @@ static s_node_t *make_print(s_node_t *arg)
   return node;
 }
 
-static s_node_t *make_class_def(const lexeme_t *ident, s_node_t *class_decl)
+static s_node_t *make_class_def(const lexeme_t *spec, const lexeme_t *ident, s_node_t *class_decl)
 {
   s_node_t *node = make_node(S_CLASS_DEF);
+  node->class_def.spec = spec;
   node->class_def.ident = ident;
   node->class_def.class_decl = class_decl;
   return node;
 }
 
-static s_node_t *make_class_new(s_node_t *param_decl, s_node_t *body)
+static s_node_t *make_class_new(s_node_t *param_decl, s_node_t *body, const lexeme_t *lazy_body)
 {
   s_node_t *node = make_node(S_CLASS_NEW);
   node->class_new.param_decl = param_decl;
   node->class_new.body = body;
+  node->class_new.lazy_body = lazy_body;
   return node;
 }
 
@@ -797,6 +1040,8 @@ static void s_print_node_R(const s_node_t *node, int pad)
     break;
   case S_TYPE:
     LOG_DEBUG("%*sS_TYPE", pad, "");
+    s_print_node_R(node->type.key, pad + 2);
+    s_print_node_R(node->type.value, pad + 2);
     break;
   case S_DECL:
     LOG_DEBUG("%*sS_DECL", pad, "");
@@ -916,6 +1161,8 @@ void s_free(s_node_t *node)
     s_free(node->binop.rhs);
     break;
   case S_TYPE:
+    s_free(node->type.key);
+    s_free(node->type.value);
     break;
   case S_DECL:
     s_free(node->decl.type);
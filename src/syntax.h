@@ -43,6 +43,9 @@ typedef struct s_node_s {
       const lexeme_t  *spec;
       const lexeme_t  *left_bracket;
       const lexeme_t  *class_ident;
+      struct s_node_s *key;
+      struct s_node_s *value;
+      int             dim;
     } type;
     struct {
       struct s_node_s *type;
@@ -50,6 +53,7 @@ typedef struct s_node_s {
       struct s_node_s *init;
     } decl;
     struct {
+      const lexeme_t  *spec;
       const lexeme_t  *ident;
       struct s_node_s *class_decl;
     } class_def;
@@ -66,10 +70,12 @@ typedef struct s_node_s {
       struct s_node_s *base;
       const lexeme_t  *child_ident;
     } direct;
+    // an index or size with more than one dimension is an S_ARG list
     struct {
       struct s_node_s *base;
       struct s_node_s *index;
       const lexeme_t  *left_bracket;
+      bool            in_range;
     } index;
     struct {
       struct s_node_s *arg;
@@ -98,6 +104,7 @@ typedef struct s_node_s {
       struct s_node_s *param_decl;
       struct s_node_s *type;
       struct s_node_s *body;
+      const lexeme_t  *lazy_body;
     } fn;
     struct {
       struct s_node_s *type;
@@ -119,6 +126,7 @@ typedef struct s_node_s {
     struct {
       struct s_node_s *param_decl;
       struct s_node_s *body;
+      const lexeme_t  *lazy_body;
     } class_new;
     struct {
       const lexeme_t  *array_init;
@@ -138,6 +146,9 @@ typedef struct s_node_s {
 } s_node_t;
 
 extern s_node_t *s_parse(lex_t *lex);
+extern s_node_t *s_parse_stmt(lex_t *lex);
+extern bool s_retain(const s_node_t *node);
+extern s_node_t *s_lazy_body(s_node_t *node);
 extern void s_free(s_node_t *node);
 extern void s_print_node(const s_node_t *node);
 extern bool s_error();
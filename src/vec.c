@@ -0,0 +1,171 @@
+#include "vec.h"
+
+// the f32s of a vector are worked on four, then two, then one at a time with
+// SSE, which is enough for a vec2 or a vec3 to take one or two instructions.
+// 'r' may be 'a' or 'b', every lane is read before it is written.
+
+#ifdef __SSE__
+
+#include <xmmintrin.h>
+
+static inline int vec_width(int n)
+{
+  return n >= 4 ? 4 : n >= 2 ? 2 : 1;
+}
+
+static inline __m128 vec_load(const float *p, int w)
+{
+  if (w == 4)
+    return _mm_loadu_ps(p);
+  else if (w == 2)
+    return _mm_loadl_pi(_mm_setzero_ps(), (const __m64*) p);
+  else
+    return _mm_load_ss(p);
+}
+
+static inline void vec_store(float *p, __m128 x, int w)
+{
+  if (w == 4)
+    _mm_storeu_ps(p, x);
+  else if (w == 2)
+    _mm_storel_pi((__m64*) p, x);
+  else
+    _mm_store_ss(p, x);
+}
+
+void vec_add(float *r, const float *a, const float *b, int n)
+{
+  for (int i = 0, w; i < n; i += w) {
+    w = vec_width(n - i);
+    vec_store(&r[i], _mm_add_ps(vec_load(&a[i], w), vec_load(&b[i], w)), w);
+  }
+}
+
+void vec_sub(float *r, const float *a, const float *b, int n)
+{
+  for (int i = 0, w; i < n; i += w) {
+    w = vec_width(n - i);
+    vec_store(&r[i], _mm_sub_ps(vec_load(&a[i], w), vec_load(&b[i], w)), w);
+  }
+}
+
+void vec_mul(float *r, const float *a, float b, int n)
+{
+  __m128 s = _mm_set1_ps(b);
+  for (int i = 0, w; i < n; i += w) {
+    w = vec_width(n - i);
+    vec_store(&r[i], _mm_mul_ps(vec_load(&a[i], w), s), w);
+  }
+}
+
+void vec_div(float *r, const float *a, float b, int n)
+{
+  __m128 s = _mm_set1_ps(b);
+  for (int i = 0, w; i < n; i += w) {
+    w = vec_width(n - i);
+    vec_store(&r[i], _mm_div_ps(vec_load(&a[i], w), s), w);
+  }
+}
+
+void vec_lerp(float *r, const float *a, const float *b, float t, int n)
+{
+  __m128 s = _mm_set1_ps(t);
+  for (int i = 0, w; i < n; i += w) {
+    w = vec_width(n - i);
+    __m128 x = vec_load(&a[i], w);
+    __m128 y = vec_load(&b[i], w);
+    vec_store(&r[i], _mm_add_ps(x, _mm_mul_ps(_mm_sub_ps(y, x), s)), w);
+  }
+}
+
+float vec_dot(const float *a, const float *b, int n)
+{
+  __m128 sum = _mm_setzero_ps();
+  for (int i = 0, w; i < n; i += w) {
+    w = vec_width(n - i);
+    sum = _mm_add_ps(sum, _mm_mul_ps(vec_load(&a[i], w), vec_load(&b[i], w)));
+  }
+  
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  
+  return _mm_cvtss_f32(sum);
+}
+
+// 'm' is 'n' columns of 'n' f32s, each scaled by its f32 of 'v' and summed
+void vec_mat(float *r, const float *m, const float *v, int n)
+{
+  for (int i = 0, w; i < n; i += w) {
+    w = vec_width(n - i);
+    
+    __m128 sum = _mm_setzero_ps();
+    for (int j = 0; j < n; j++)
+      sum = _mm_add_ps(sum, _mm_mul_ps(vec_load(&m[j * n + i], w), _mm_set1_ps(v[j])));
+    
+    vec_store(&r[i], sum, w);
+  }
+}
+
+#else
+
+void vec_add(float *r, const float *a, const float *b, int n)
+{
+  for (int i = 0; i < n; i++)
+    r[i] = a[i] + b[i];
+}
+
+void vec_sub(float *r, const float *a, const float *b, int n)
+{
+  for (int i = 0; i < n; i++)
+    r[i] = a[i] - b[i];
+}
+
+void vec_mul(float *r, const float *a, float b, int n)
+{
+  for (int i = 0; i < n; i++)
+    r[i] = a[i] * b;
+}
+
+void vec_div(float *r, const float *a, float b, int n)
+{
+  for (int i = 0; i < n; i++)
+    r[i] = a[i] / b;
+}
+
+void vec_lerp(float *r, const float *a, const float *b, float t, int n)
+{
+  for (int i = 0; i < n; i++)
+    r[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+float vec_dot(const float *a, const float *b, int n)
+{
+  float sum = 0;
+  for (int i = 0; i < n; i++)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+void vec_mat(float *r, const float *m, const float *v, int n)
+{
+  for (int i = 0; i < n; i++) {
+    float sum = 0;
+    for (int j = 0; j < n; j++)
+      sum += m[j * n + i] * v[j];
+    r[i] = sum;
+  }
+}
+
+#endif
+
+// three lanes are too few to be worth shuffling
+void vec_cross(float *r, const float *a, const float *b)
+{
+  float x = a[1] * b[2] - a[2] * b[1];
+  float y = a[2] * b[0] - a[0] * b[2];
+  float z = a[0] * b[1] - a[1] * b[0];
+  
+  r[0] = x;
+  r[1] = y;
+  r[2] = z;
+}
@@ -0,0 +1,13 @@
+#ifndef VEC_H
+#define VEC_H
+
+extern void   vec_add(float *r, const float *a, const float *b, int n);
+extern void   vec_sub(float *r, const float *a, const float *b, int n);
+extern void   vec_mul(float *r, const float *a, float b, int n);
+extern void   vec_div(float *r, const float *a, float b, int n);
+extern void   vec_lerp(float *r, const float *a, const float *b, float t, int n);
+extern float  vec_dot(const float *a, const float *b, int n);
+extern void   vec_cross(float *r, const float *a, const float *b);
+extern void   vec_mat(float *r, const float *m, const float *v, int n);
+
+#endif
@@ -45,6 +45,10 @@ void *zone_realloc(void *block, int size)
   zone_block_t *zone_next = zone_block->next;
   
   zone_block_t *new_zone_block = realloc(zone_block, sizeof(zone_block_t) + size);
+  new_zone_block->size = size;
+  
+  if (zone_block == zone_block_list)
+    zone_block_list = new_zone_block;
   
   if (zone_prev)
     zone_prev->next = new_zone_block;
@@ -0,0 +1,18 @@
+#!/bin/bash
+# usage: test.sh [cirno] -- run each test with and without -O and compare its
+# output with the .out next to it
+
+cirno=${1:-./cirno}
+
+fail=0
+
+for script in test/*.9c; do
+  for flags in "" -O; do
+    if ! $cirno $flags $script 2>&1 | cmp -s - ${script%.9c}.out; then
+      echo "FAIL $script ${flags}"
+      fail=1
+    fi
+  done
+done
+
+exit $fail